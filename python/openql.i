@@ -686,6 +686,20 @@ Returns
 
 
 
+%feature("docstring") Program::set_option
+""" Sets an option for the compilation of this program only, overriding its
+global value set with openql.set_option; programs that have different values
+of an option can be compiled concurrently.
+
+Parameters
+----------
+arg1 : str
+    option name
+arg2 : str
+    option value
+"""
+
+
 %feature("docstring") Program::add_kernel
 """ Adds specified kernel to program.
 
@@ -0,0 +1,345 @@
+/**
+ * @file    cc_resource_manager.h
+ * @date    202010xx
+ * @brief   resource management for the Central Controller
+ * @note    models the constraints that codegen_cc puts on the schedule, so that the resource
+ *          constrained scheduler (and mapper) can pack gates onto the instruments without violating them
+ */
+
+#ifndef ARCH_CC_CC_RESOURCE_MANAGER_H
+#define ARCH_CC_CC_RESOURCE_MANAGER_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <sstream>
+#include <json.h>
+#include <utils.h>
+#include <resource_manager.h>
+#include "arch/cc_light/cc_light_resource_manager.h"   // for ccl_qubit_resource_t
+
+namespace ql
+{
+namespace arch
+{
+
+// a signal of an instruction as it drives one instrument group, for a particular qubit operand
+struct cc_signal_t
+{
+    size_t  instrument;                 // index in hardware_settings/eqasm_backend_cc/instruments
+    size_t  group;                      // index of the group over all instruments, see cc_instruments_t
+    size_t  value_id;                   // id of the signal value after macro expansion, equal ids meaning equal values
+};
+
+// a signal definition of an instruction: the operand it applies to, and per qubit how it drives the instruments
+struct cc_instruction_signal_t
+{
+    size_t                      operand_idx;
+    std::vector<cc_signal_t>    qubit2signal;   // instrument is instrument_count when no instrument drives the qubit
+};
+
+// The instruments of the CC and the signals of all instructions in the platform's instruction_settings,
+// resolved once from the json in the same way as codegen_cc does, so that checking and reserving resources
+// doesn't need json lookups and string compares.
+// Signals that codegen_cc cannot resolve are left out; it reports them when generating code.
+// The resources share it read-only, also with their copies (clones), so it is not copied itself.
+class cc_instruments_t
+{
+public:
+    size_t                                  instrument_count;
+    size_t                                  group_count;    // over all instruments
+    std::unordered_map<std::string, std::vector<cc_instruction_signal_t>> signals;  // instruction name to its signals
+
+    cc_instruments_t(const ql::quantum_platform & platform)
+    {
+        instrument_count = 0;
+        group_count = 0;
+        if (!JSON_EXISTS(platform.hardware_settings, "eqasm_backend_cc"))
+        {
+            return;
+        }
+        const json & backend_settings = platform.hardware_settings["eqasm_backend_cc"];
+        if (!JSON_EXISTS(backend_settings, "instruments"))
+        {
+            return;
+        }
+        const json & instruments = backend_settings["instruments"];
+        instrument_count = instruments.size();
+
+        // per signal type, per qubit: the first instrument group driving it, as codegen_cc::findSignalInfoForQubit
+        std::map<std::string, std::vector<cc_signal_t>> type_qubit2group;
+        std::vector<std::string> instrument_names(instrument_count);
+        std::vector<size_t> group2local;
+        for (size_t i = 0; i < instrument_count; i++)
+        {
+            const json & instrument = instruments[i];
+            if (!JSON_EXISTS(instrument, "name") || !JSON_EXISTS(instrument, "signal_type") || !JSON_EXISTS(instrument, "qubits"))
+            {
+                continue;
+            }
+            instrument_names[i] = instrument["name"].get<std::string>();
+            auto & qubit2group = type_qubit2group[instrument["signal_type"].get<std::string>()];
+            const json & qubits = instrument["qubits"];
+            for (size_t g = 0; g < qubits.size(); g++)
+            {
+                size_t group = group_count++;
+                group2local.push_back(g);
+                for (auto & jq : qubits[g])
+                {
+                    size_t q = jq;
+                    if (q >= qubit2group.size())
+                    {
+                        qubit2group.resize(q + 1, cc_signal_t{instrument_count, 0, 0});
+                    }
+                    if (qubit2group[q].instrument == instrument_count)
+                    {
+                        qubit2group[q] = cc_signal_t{i, group, 0};
+                    }
+                }
+            }
+        }
+
+        const json * ref_signals = (JSON_EXISTS(backend_settings, "signals") ? &backend_settings["signals"] : nullptr);
+        std::map<std::string, size_t> value_ids;
+        for (json::const_iterator it = platform.instruction_settings.begin(); it != platform.instruction_settings.end(); ++it)
+        {
+            const std::string & iname = it.key();
+            const json & instruction = it.value();
+            if (!JSON_EXISTS(instruction, "cc"))
+            {
+                continue;
+            }
+            const json & cc = instruction["cc"];
+            const json * signal = nullptr;
+            if (JSON_EXISTS(cc, "ref_signal"))
+            {
+                if (ref_signals && cc["ref_signal"].is_string() && JSON_EXISTS(*ref_signals, cc["ref_signal"].get<std::string>()))
+                {
+                    signal = &(*ref_signals)[cc["ref_signal"].get<std::string>()];
+                }
+            }
+            else if (JSON_EXISTS(cc, "signal"))
+            {
+                signal = &cc["signal"];
+            }
+            if (!signal || !signal->is_array())
+            {
+                continue;
+            }
+
+            std::vector<cc_instruction_signal_t> instruction_signals;
+            for (auto & s : *signal)
+            {
+                if (!JSON_EXISTS(s, "operand_idx") || !JSON_EXISTS(s, "type") || !JSON_EXISTS(s, "value"))
+                {
+                    continue;
+                }
+                auto type_it = type_qubit2group.find(s["type"].get<std::string>());
+                if (type_it == type_qubit2group.end())
+                {
+                    continue;
+                }
+                cc_instruction_signal_t is;
+                is.operand_idx = s["operand_idx"];
+                is.qubit2signal = type_it->second;
+                for (size_t q = 0; q < is.qubit2signal.size(); q++)
+                {
+                    cc_signal_t & si = is.qubit2signal[q];
+                    if (si.instrument == instrument_count)
+                    {
+                        continue;
+                    }
+
+                    // expand the macros in the signal value as codegen_cc::custom_gate
+                    std::stringstream ss;
+                    ss << s["value"];
+                    std::string value = ss.str();
+                    ql::utils::replace(value, std::string("\""), std::string(""));
+                    ql::utils::replace(value, std::string("{gateName}"), iname);
+                    ql::utils::replace(value, std::string("{instrumentName}"), instrument_names[si.instrument]);
+                    ql::utils::replace(value, std::string("{instrumentGroup}"), std::to_string(group2local[si.group]));
+                    ql::utils::replace(value, std::string("{qubit}"), std::to_string(q));
+
+                    auto id_it = value_ids.find(value);
+                    if (id_it == value_ids.end())
+                    {
+                        id_it = value_ids.insert(std::make_pair(value, value_ids.size() + 1)).first;
+                    }
+                    si.value_id = id_it->second;
+                }
+                instruction_signals.push_back(is);
+            }
+            signals[iname] = instruction_signals;
+        }
+        DOUT("resolved signals of " << signals.size() << " instructions on " << instrument_count << " instruments with "
+            << group_count << " groups to " << value_ids.size() << " signal values");
+    }
+
+    // call f(signal) for each instrument group that gate ins drives, until f returns false;
+    // return whether it didn't
+    template<class F>
+    bool for_each_signal(ql::gate * ins, F f) const
+    {
+        auto it = signals.find(ins->name);
+        if (it == signals.end())
+        {
+            return true;
+        }
+        for (auto & is : it->second)
+        {
+            if (is.operand_idx >= ins->operands.size())
+            {
+                continue;   // left to codegen_cc to report
+            }
+            size_t q = ins->operands[is.operand_idx];
+            if (q < is.qubit2signal.size() && is.qubit2signal[q].instrument < instrument_count && !f(is.qubit2signal[q]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+
+// ============ classes of resources of the CC
+
+// Each instrument executes one bundle at a time: the gates that start in the same cycle and that it drives.
+// codegen_cc generates one output word per instrument for such a bundle,
+// so the gates of a bundle must drive each group of the instrument with the same signal value,
+// and the instrument is busy until the longest of these gates has finished;
+// a next bundle on the instrument must start at or after that.
+class cc_instrument_resource_t : public resource_t
+{
+public:
+    cc_instrument_resource_t* clone() const & { DOUT("Cloning/copying cc_instrument_resource_t"); return new cc_instrument_resource_t(*this);}
+    cc_instrument_resource_t* clone() && { DOUT("Cloning/moving cc_instrument_resource_t"); return new cc_instrument_resource_t(std::move(*this)); }
+
+    // fwd: the last bundle on the instrument starts at fromcycle[i] and keeps it busy till tocycle[i]
+    // bwd: the first bundle on the instrument starts at fromcycle[i] and keeps it busy till tocycle[i],
+    //      and the bundle following it starts at nextcycle[i]
+    std::vector<size_t> fromcycle;
+    std::vector<size_t> tocycle;
+    std::vector<size_t> nextcycle;
+    std::vector<size_t> groupcycle;         // group g got its signal value for the bundle starting at groupcycle[g]
+    std::vector<size_t> groupvalue;         // ... which is signal value id groupvalue[g]
+    std::shared_ptr<const cc_instruments_t> instruments;
+
+    cc_instrument_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const cc_instruments_t> cc_instruments) :
+        resource_t("instruments", dir), instruments(cc_instruments)
+    {
+        // DOUT("... creating " << name << " resource");
+        count = instruments->instrument_count;
+        fromcycle.assign(count, (forward_scheduling == dir ? 0 : MAX_CYCLE));
+        tocycle.assign(count, (forward_scheduling == dir ? 0 : MAX_CYCLE));
+        nextcycle.assign(count, MAX_CYCLE);
+        groupcycle.assign(instruments->group_count, MAX_CYCLE);
+        groupvalue.assign(instruments->group_count, 0);
+    }
+
+    bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        size_t      operation_duration = platform.time_to_cycles(ins->duration);
+
+        bool is_available = instruments->for_each_signal(ins, [&](const cc_signal_t & si) -> bool
+        {
+            size_t i = si.instrument;
+            DOUT(" available " << name << "? op_start_cycle: " << op_start_cycle << "  instrument: " << i << " is busy from cycle: " << fromcycle[i] << " to cycle: " << tocycle[i]);
+            if (op_start_cycle == fromcycle[i])
+            {
+                // joining the bundle, which requires the same signal value on the group
+                if (groupcycle[si.group] == op_start_cycle && groupvalue[si.group] != si.value_id)
+                {
+                    return false;
+                }
+                return (forward_scheduling == direction || op_start_cycle + operation_duration <= nextcycle[i]);
+            }
+            if (forward_scheduling == direction)
+            {
+                return op_start_cycle >= tocycle[i];
+            }
+            else
+            {
+                return op_start_cycle + operation_duration <= fromcycle[i];
+            }
+        });
+        DOUT("    " << name << " resource " << (is_available ? "available ..." : "busy ..."));
+        return is_available;
+    }
+
+    void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        size_t      operation_duration = platform.time_to_cycles(ins->duration);
+
+        instruments->for_each_signal(ins, [&](const cc_signal_t & si) -> bool
+        {
+            size_t i = si.instrument;
+            if (op_start_cycle == fromcycle[i])
+            {
+                set(tocycle[i], std::max(tocycle[i], op_start_cycle + operation_duration));
+            }
+            else
+            {
+                if (backward_scheduling == direction)
+                {
+                    set(nextcycle[i], fromcycle[i]);
+                }
+                set(fromcycle[i], op_start_cycle);
+                set(tocycle[i], op_start_cycle + operation_duration);
+            }
+            set(groupcycle[si.group], op_start_cycle);
+            set(groupvalue[si.group], si.value_id);
+            DOUT("reserved " << name << ". op_start_cycle: " << op_start_cycle << " instrument: " << i << " reserved from cycle: " << fromcycle[i] << " to cycle: " << tocycle[i]);
+            return true;
+        });
+    }
+    ~cc_instrument_resource_t() {}
+};
+
+
+class cc_resource_manager_t : public platform_resource_manager_t
+{
+public:
+    cc_resource_manager_t* clone() const & { DOUT("Cloning/copying cc_resource_manager_t"); return new cc_resource_manager_t(*this);}
+    cc_resource_manager_t* clone() && { DOUT("Cloning/moving cc_resource_manager_t"); return new cc_resource_manager_t(std::move(*this)); }
+
+    cc_resource_manager_t() : platform_resource_manager_t()
+    {
+        // DOUT("Constructing virgin cc_resource_manager_t");
+    }
+
+    // The instruments are taken from the backend's settings, so they are always allocated.
+    // Of the resources in the config file, only the qubits are modelled;
+    // the others describe the CC-Light's control electronics and are ignored.
+    cc_resource_manager_t(const ql::quantum_platform & platform, scheduling_direction_t dir) : platform_resource_manager_t(platform, dir)
+    {
+        DOUT("Constructing (platform,dir) parameterized cc_resource_manager_t");
+        for (json::const_iterator it = platform.resources.begin(); it != platform.resources.end(); ++it)
+        {
+            std::string n = it.key();
+            if( n == "qubits")
+            {
+                resource_t * ares = new ccl_qubit_resource_t(platform, dir);
+                resource_ptrs.push_back( ares );
+            }
+            else
+            {
+                DOUT("... ignoring resource '" << n << "' which is not modelled for the CC");
+            }
+        }
+        std::shared_ptr<const cc_instruments_t> instruments = std::make_shared<const cc_instruments_t>(platform);
+        resource_t * ares = new cc_instrument_resource_t(platform, dir, instruments);
+        resource_ptrs.push_back( ares );
+    }
+    ~cc_resource_manager_t()
+    {
+        // DOUT("Destroying cc_resource_manager_t");
+    }
+};
+
+} // end of namespace arch
+} // end of namespace ql
+
+#endif  // ARCH_CC_CC_RESOURCE_MANAGER_H
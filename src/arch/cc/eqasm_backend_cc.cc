@@ -15,39 +15,16 @@
     Todo:
     - finish support for classical instructions
     - finish support for kernel conditionality
-    - allow runtime selection of scheduler
     - port https://github.com/QE-Lab/OpenQL/pull/238 to CC
 */
 
 
-// options:
-#define OPT_CC_SCHEDULE_RC          0       // 1=use resource constraint scheduler
-
 #include "eqasm_backend_cc.h"
 
 #include <options.h>
 #include <platform.h>
 #include <ir.h>
-// Including scheduler.h causes duplicate function definitions during make/linking;
-// instead of including it with its function bodies, declare those functions here and now ...
-// FIXME HvS create schedule.cc (but this waits until scheduler and mapper have been disentangled)
-// #include <scheduler.h>
-namespace ql
-{
-    namespace arch
-    {
-#if OPT_CC_SCHEDULE_KERNEL_H    // FIXME: WIP
-    void ql:schedule(quantum_program* programp, const ql::quantum_platform & platform, std::string passname);
-#else
-#if OPT_CC_SCHEDULE_RC
-    // FIXME To make rcschedule work on CC, make a src/arch/cc/cc_resource_manager.h
-    // and update src/resource_manager.h to include it and create a cc_resource_manager.
-    void ql::rcschedule(quantum_program* programp, const ql::quantum_platform & platform, std::string passname);
-#endif
-#endif
-
-    } // end of namespace arch
-} // end of namespace ql
+#include <scheduler.h>
 
 
 // define classical QASM instructions as generated by classical.h
@@ -86,6 +63,11 @@ void eqasm_backend_cc::compile(quantum_program* programp, const ql::quantum_plat
 {
     DOUT("Compiling " << programp->kernels.size() << " kernels to generate Central Controller program ... ");
 
+    // reschedule taking the instruments into account, see cc_resource_manager.h
+    if(ql::options::get("backend_cc_rcscheduler") == "yes") {
+        ql::rcschedule(programp, platform, "rcscheduler");
+    }
+
     // init
     load_hw_settings(platform);
     codegen.init(platform);
@@ -95,15 +77,6 @@ void eqasm_backend_cc::compile(quantum_program* programp, const ql::quantum_plat
     codegen.program_start(programp->unique_name);
 
     // generate code for all kernels
-#if OPT_CC_SCHEDULE_KERNEL_H    // FIXME: WIP
-    ql::schedule(programp, platform, "prescheduler");
-#else
- #if OPT_CC_SCHEDULE_RC
-    ql::rcschedule(programp, platform, "rcscheduler");
- #endif
-  // FIXME: plain old CClight scheduler
-#endif
-
     for(auto &kernel : programp->kernels) {
         IOUT("Compiling kernel: " << kernel.name);
         codegen_kernel_prologue(kernel);
@@ -296,13 +269,15 @@ void eqasm_backend_cc::codegen_bundles(ql::ir::bundles_t &bundles, const ql::qua
         // and if a non-zero duration is specified that duration is reflected in 'start_cycle' of the subsequent instruction
 
         // generate code for this bundle
-        for(auto section = bundle.parallel_sections.begin(); section != bundle.parallel_sections.end(); ++section ) {
+        for(auto &section : bundles.sections_of(bundle)) {
+            auto sectionGates = bundles.gates_of(section);
+
             // check whether section defines classical gate
-            ql::gate *firstInstr = *section->begin();
+            ql::gate *firstInstr = sectionGates.front();
             auto firstInstrType = firstInstr->type();
             if(firstInstrType == __classical_gate__) {
                 DOUT(SS2S("Classical bundle: instr='" << firstInstr->name << "'"));
-                if(section->size() != 1) {
+                if(sectionGates.size() != 1) {
                     FATAL("Inconsistency detected in bundle contents: classical gate with parallel sections");
                 }
                 codegen_classical_instruction(firstInstr);
@@ -311,8 +286,7 @@ void eqasm_backend_cc::codegen_bundles(ql::ir::bundles_t &bundles, const ql::qua
                  * NB: our strategy differs from cc_light_eqasm_compiler, we have no special treatment of first instruction
                  * and don't require all instructions to be identical
                  */
-                for(auto insIt = section->begin(); insIt != section->end(); ++insIt) {
-                    ql::gate *instr = *insIt;
+                for(ql::gate *instr : sectionGates) {
                     ql::gate_type_t itype = instr->type();
                     std::string iname = instr->name;
                     DOUT(SS2S("Bundle section: instr='" << iname << "'"));
@@ -17,9 +17,11 @@
 #include <ir.h>
 #include <eqasm_compiler.h>
 #include <arch/cc_light/cc_light_eqasm.h>
+#include <parallel.h>
 #include <scheduler.h>
 #include <mapper.h>
 #include <clifford.h>
+#include <cancel.h>
 #include <latency_compensation.h>
 #include <buffer_insertion.h>
 #include <qsoverlay.h>
@@ -45,9 +47,6 @@ typedef std::vector<qubit_pair_t>  qubit_pair_set_t;
 const size_t MAX_S_REG =32;
 const size_t MAX_T_REG =64;
 
-extern size_t CurrSRegCount;
-extern size_t CurrTRegCount;
-
 class Mask
 {
 public:
@@ -58,207 +57,467 @@ public:
 
     Mask() {}
 
-    Mask(qubit_set_t & qs) : squbits(qs)
-    {
+    Mask(const qubit_set_t & qs) : squbits(qs) {}
 
-        if(CurrSRegCount < MAX_S_REG)
+    Mask(const qubit_pair_set_t & qps) : dqubits(qps) {}
+
+    // the instruction setting the mask register, as in: smis s3, {0, 1}
+    std::string setInstruction() const
+    {
+        std::stringstream ss;
+        if (dqubits.empty())
         {
-            regNo = CurrSRegCount++;
-            regName = "s" + std::to_string(regNo);
+            ss << "smis " << regName << ", {";
+            for(auto it = squbits.begin(); it != squbits.end(); ++it)
+            {
+                ss << *it;
+                if( std::next(it) != squbits.end() )
+                    ss << ", ";
+            }
         }
         else
         {
-            COUT(" !!!! Handle cases requiring more registers");
+            ss << "smit " << regName << ", {";
+            for(auto it = dqubits.begin(); it != dqubits.end(); ++it)
+            {
+                ss << "(" << it->first << ", " << it->second << ")";
+                if( std::next(it) != dqubits.end() )
+                    ss << ", ";
+            }
+        }
+        ss << "}";
+        return ss.str();
+    }
+};
+
+/*
+ * allocation of the mask registers to the masks that the instructions of a program use as their operands:
+ * single-qubit instructions use a set of qubits in one of MAX_S_REG s registers (set by smis),
+ * two-qubit instructions use a set of qubit pairs in one of MAX_T_REG t registers (set by smit)
+ *
+ * Code is generated twice for the same bundles: first to collect the masks used by each bundle of each kernel,
+ * then, after allocate(), to generate the code with the allocated registers.
+ * Both times, each kernel starts with startKernel(weight), each bundle with startBundle(),
+ * and getRegName is called for each mask that the bundle uses.
+ *
+ * When all masks fit in the registers, each gets a register of its own, in order of first use,
+ * after some predefined ones, and all registers are set before the program starts.
+ * Otherwise, the masks used most often, counting the uses in a loop body its number of iterations,
+ * get a register of their own that is set before the program starts, as when they all fit;
+ * the other masks share a pool of the remaining registers, which are set in the kernels just before the bundle using them.
+ * When a mask must be set in a pool register, the one is reused of which the mask's next use in the kernel
+ * is furthest away (Belady's rule), or not at all.
+ * As kernels are the targets of branches, nothing is assumed about the pool registers at the start of a kernel.
+ * The size of the pool is the one with which the fewest instructions setting pool registers are executed,
+ * counting those in a loop body its number of iterations; this is found by doing the allocation above
+ * for each size from the most masks used by one bundle up to all registers (see poolCost).
+ * So pooled masks add smis/smit instructions to the stream of bundles, which a larger pool may reduce
+ * at the expense of fewer masks with a register of their own.
+ */
+class MaskManager
+{
+private:
+    // the masks of one kind, with their registers
+    struct mask_kind_t
+    {
+        std::string                         prefix;     // of the register names
+        size_t                              nregs;      // number of registers
+        std::map<std::vector<size_t>, size_t> ids;      // id of each mask, by its qubits, pairs flattened
+        std::vector<Mask>                   masks;      // by id, in order of first use
+        std::vector<double>                 weights;    // by id: number of uses, counting loop iterations
+        std::vector<bool>                   used;       // by id
+        std::vector<std::vector<std::pair<size_t,size_t>>> uses;    // per kernel, (bundle, id) of each use
+        size_t                              bundle_uses;            // masks used by the current bundle, while collecting
+        size_t                              max_per_bundle;         // most masks used by a bundle
+
+        // allocation
+        std::vector<size_t>                 reg;        // by id, register of its own, or MAX_CYCLE
+        std::vector<size_t>                 pool;       // registers shared by the other masks
+        std::vector<std::map<size_t,std::vector<size_t>>> bundles;  // per kernel, per id, the bundles using it
+
+        // while generating code
+        std::vector<size_t>                 contents;   // per pool register, the id of the mask in it or MAX_CYCLE
+        std::vector<bool>                   in_bundle;  // per pool register, whether used in the current bundle
+    };
+
+    mask_kind_t     skind;
+    mask_kind_t     tkind;
+    bool            collecting;
+    double          weight;         // of the current kernel
+    std::vector<double> kernel_weights; // of each kernel
+    size_t          kernel;         // index of the current kernel
+    size_t          bundle;         // index of the current bundle in the kernel
+    std::stringstream ssbundle;     // instructions setting pool registers for the current bundle
+    size_t          nsets;          // instructions setting pool registers
+
+    size_t addMask(mask_kind_t & kind, const std::vector<size_t> & key, const Mask & m)
+    {
+        auto it = kind.ids.find(key);
+        if (it != kind.ids.end())
+        {
+            return it->second;
         }
+        size_t id = kind.masks.size();
+        kind.ids[key] = id;
+        kind.masks.push_back(m);
+        kind.weights.push_back(0.0);
+        kind.used.push_back(false);
+        return id;
     }
 
-    Mask(std::string rn, qubit_set_t & qs ) : regName(rn), squbits(qs)
+    std::string regName(mask_kind_t & kind, const std::vector<size_t> & key, const Mask & m)
     {
-        if(CurrSRegCount < MAX_S_REG)
+        if (collecting)
         {
-            regNo = CurrSRegCount++;
+            size_t id = addMask(kind, key, m);
+            kind.weights[id] += weight;
+            kind.used[id] = true;
+            kind.uses.back().push_back(std::make_pair(bundle, id));
+            kind.bundle_uses++;
+            kind.max_per_bundle = std::max(kind.max_per_bundle, kind.bundle_uses);
+            return "";
         }
-        else
+
+        auto it = kind.ids.find(key);
+        CclAssert(it != kind.ids.end());
+        size_t id = it->second;
+        if (kind.reg[id] != MAX_CYCLE)
         {
-            COUT(" !!!! Handle cases requiring more registers");
+            return kind.masks[id].regName;
+        }
+
+        // a pool register: the one with the mask, or the one to reuse
+        size_t best = MAX_CYCLE;
+        size_t best_next = 0;
+        for (size_t r = 0; r < kind.pool.size(); r++)
+        {
+            if (kind.contents[r] == id)
+            {
+                kind.in_bundle[r] = true;
+                return kind.prefix + std::to_string(kind.pool[r]);
+            }
+            if (kind.in_bundle[r])
+            {
+                continue;
+            }
+            size_t next = MAX_CYCLE;
+            if (kind.contents[r] != MAX_CYCLE)
+            {
+                auto & b = kind.bundles[kernel][kind.contents[r]];
+                auto nit = std::upper_bound(b.begin(), b.end(), bundle);
+                next = (nit == b.end() ? MAX_CYCLE : *nit);
+            }
+            if (best == MAX_CYCLE || (kind.contents[best] != MAX_CYCLE && (kind.contents[r] == MAX_CYCLE || next > best_next)))
+            {
+                best = r;
+                best_next = next;
+            }
         }
+        CclAssert(best != MAX_CYCLE);
+        kind.contents[best] = id;
+        kind.in_bundle[best] = true;
+        Mask m2 = kind.masks[id];
+        m2.regNo = kind.pool[best];
+        m2.regName = kind.prefix + std::to_string(m2.regNo);
+        ssbundle << "    " << m2.setInstruction() << "\n";
+        nsets++;
+        return m2.regName;
     }
 
-    Mask(qubit_pair_set_t & qps) : dqubits(qps)
+    // the number of instructions setting pool registers that are executed when the masks byweight[nregs-npool..]
+    // share a pool of npool registers, counting the kernel weights; this follows regName when generating code
+    double poolCost(const mask_kind_t & kind, const std::vector<size_t> & byweight, size_t npool)
     {
-        if(CurrTRegCount < MAX_T_REG)
+        std::vector<bool> pooled(kind.masks.size(), false);
+        for (size_t i = kind.nregs - npool; i < byweight.size(); i++)
         {
-            regNo = CurrTRegCount++;
-            regName = "t" + std::to_string(regNo);
+            pooled[byweight[i]] = true;
         }
-        else
+
+        double cost = 0.0;
+        for (size_t k = 0; k < kind.uses.size(); k++)
         {
-            COUT(" !!!! Handle cases requiring more registers");
+            // per pooled mask, the bundles using it, as kind.bundles
+            std::map<size_t, std::vector<size_t>> bundles;
+            for (auto & u : kind.uses[k])
+            {
+                if (pooled[u.second])
+                {
+                    bundles[u.second].push_back(u.first);
+                }
+            }
+
+            std::vector<size_t> contents(npool, MAX_CYCLE);     // per pool register, the id of its mask
+            std::vector<size_t> in_bundle(npool, MAX_CYCLE);    // per pool register, the bundle last using it
+            size_t nsets_kernel = 0;
+            for (auto & u : kind.uses[k])
+            {
+                size_t b = u.first;
+                size_t id = u.second;
+                if (!pooled[id])
+                {
+                    continue;
+                }
+                size_t best = MAX_CYCLE;
+                size_t best_next = 0;
+                for (size_t r = 0; r < npool; r++)
+                {
+                    if (contents[r] == id)
+                    {
+                        best = r;
+                        break;
+                    }
+                    if (in_bundle[r] == b)
+                    {
+                        continue;
+                    }
+                    size_t next = MAX_CYCLE;
+                    if (contents[r] != MAX_CYCLE)
+                    {
+                        auto & cb = bundles[contents[r]];
+                        auto nit = std::upper_bound(cb.begin(), cb.end(), b);
+                        next = (nit == cb.end() ? MAX_CYCLE : *nit);
+                    }
+                    if (best == MAX_CYCLE || (contents[best] != MAX_CYCLE && (contents[r] == MAX_CYCLE || next > best_next)))
+                    {
+                        best = r;
+                        best_next = next;
+                    }
+                }
+                CclAssert(best != MAX_CYCLE);
+                if (contents[best] != id)
+                {
+                    contents[best] = id;
+                    nsets_kernel++;
+                }
+                in_bundle[best] = b;
+            }
+            cost += kernel_weights[k] * nsets_kernel;
         }
+        return cost;
     }
 
-};
+    void allocate(mask_kind_t & kind)
+    {
+        size_t n = kind.masks.size();
+        std::vector<size_t> own;    // ids of the masks with a register of their own, in order of first use
+        size_t nused = std::count(kind.used.begin(), kind.used.end(), true);
+        if (n <= kind.nregs)
+        {
+            for (size_t id = 0; id < n; id++)
+            {
+                own.push_back(id);
+            }
+        }
+        else if (nused <= kind.nregs)
+        {
+            for (size_t id = 0; id < n; id++)
+            {
+                if (kind.used[id])
+                {
+                    own.push_back(id);
+                }
+            }
+        }
+        else
+        {
+            if (kind.max_per_bundle > kind.nregs)
+            {
+                FATAL("A bundle uses " << kind.max_per_bundle << " different masks while there are only " << kind.nregs << " " << kind.prefix << " registers");
+            }
+            std::vector<size_t> byweight;
+            for (size_t id = 0; id < n; id++)
+            {
+                if (kind.used[id])
+                {
+                    byweight.push_back(id);
+                }
+            }
+            std::stable_sort(byweight.begin(), byweight.end(), [&](size_t a, size_t b) { return kind.weights[a] > kind.weights[b]; });
 
-class MaskManager
-{
-private:
-    std::map<size_t,Mask> SReg2Mask;
-    std::map<qubit_set_t,Mask> QS2Mask;
+            // the smallest pool with which the fewest pool registers are set
+            size_t npool = 0;
+            double npool_cost = 0.0;
+            for (size_t p = std::max(kind.max_per_bundle, size_t(1)); p <= kind.nregs; p++)
+            {
+                double cost = poolCost(kind, byweight, p);
+                DOUT("Mask registers " << kind.prefix << ": with a pool of " << p << " registers, these are set " << cost << " times");
+                if (npool == 0 || cost < npool_cost)
+                {
+                    npool = p;
+                    npool_cost = cost;
+                }
+            }
+            own.assign(byweight.begin(), byweight.begin() + (kind.nregs - npool));
+            std::sort(own.begin(), own.end());
+            for (size_t r = kind.nregs - npool; r < kind.nregs; r++)
+            {
+                kind.pool.push_back(r);
+            }
+        }
+
+        kind.reg.assign(n, MAX_CYCLE);
+        for (size_t r = 0; r < own.size(); r++)
+        {
+            kind.reg[own[r]] = r;
+            kind.masks[own[r]].regNo = r;
+            kind.masks[own[r]].regName = kind.prefix + std::to_string(r);
+        }
 
-    std::map<size_t,Mask> TReg2Mask;
-    std::map<qubit_pair_set_t,Mask> QPS2Mask;
+        kind.bundles.resize(kind.uses.size());
+        for (size_t k = 0; k < kind.uses.size(); k++)
+        {
+            for (auto & u : kind.uses[k])
+            {
+                if (kind.reg[u.second] == MAX_CYCLE)
+                {
+                    kind.bundles[k][u.second].push_back(u.first);
+                }
+            }
+        }
+        kind.contents.assign(kind.pool.size(), MAX_CYCLE);
+        kind.in_bundle.assign(kind.pool.size(), false);
+        DOUT("Mask registers " << kind.prefix << ": " << nused << " masks used, " << own.size() << " with a register of their own, "
+            << kind.pool.size() << " registers shared by the others");
+    }
 
 public:
-    MaskManager()
+    MaskManager() : collecting(true), weight(1.0), kernel(0), bundle(0), nsets(0)
     {
+        skind.prefix = "s";
+        skind.nregs = MAX_S_REG;
+        tkind.prefix = "t";
+        tkind.nregs = MAX_T_REG;
+        for (mask_kind_t * kind : {&skind, &tkind})
+        {
+            kind->bundle_uses = 0;
+            kind->max_per_bundle = 0;
+        }
+
         // add pre-defined smis
         for(size_t i=0; i<7; ++i)
         {
             qubit_set_t qs;
             qs.push_back(i);
-            Mask m(qs);
-            QS2Mask[qs] = m;
-            SReg2Mask[m.regNo] = m;
+            addMask(skind, qs, Mask(qs));
         }
 
         // add some common single qubit masks
         {
             qubit_set_t qs;
             for(auto i=0; i<7; i++) qs.push_back(i);
-            Mask m(qs); // TODO add proper support for:  Mask m(qs, "all_qubits");
-            QS2Mask[qs] = m;
-            SReg2Mask[m.regNo] = m;
+            addMask(skind, qs, Mask(qs)); // TODO add proper support for:  Mask m(qs, "all_qubits");
         }
 
         {
             qubit_set_t qs;
             qs.push_back(0); qs.push_back(1); qs.push_back(5); qs.push_back(6);
-            Mask m(qs); // TODO add proper support for:  Mask m(qs, "data_qubits");
-            QS2Mask[qs] = m;
-            SReg2Mask[m.regNo] = m;
+            addMask(skind, qs, Mask(qs)); // TODO add proper support for:  Mask m(qs, "data_qubits");
         }
 
         {
             qubit_set_t qs;
             qs.push_back(2); qs.push_back(3); qs.push_back(4);
-            Mask m(qs); // TODO add proper support for:  Mask m(qs, "ancilla_qubits");
-            QS2Mask[qs] = m;
-            SReg2Mask[m.regNo] = m;
+            addMask(skind, qs, Mask(qs)); // TODO add proper support for:  Mask m(qs, "ancilla_qubits");
         }
-
-
-        // qubit_pair_set_t pre_defined_edges = { {2,0}, {0,3}, {3,1}, {1,4}, {2,5}, {5,3}, {3,6}, {6,4},
-        //                                {0,2}, {3,0}, {1,3}, {4,1}, {5,2}, {3,5}, {6,3}, {4,6} };
-        // // add smit
-        // for(auto & p : pre_defined_edges)
-        // {
-        //     qubit_pair_set_t qps;
-        //     qps.push_back(p);
-        //     Mask m(qps);
-        //     QPS2Mask[qps] = m;
-        //     TReg2Mask[m.regNo] = m;
-        // }
-
     }
 
-    size_t getRegNo( qubit_set_t & qs )
+    // start of the code of a kernel; weight is the number of times that it is executed, as far as known
+    void startKernel(double w)
     {
-        // sort qubit operands to avoid variation in order
-        sort(qs.begin(), qs.end());
-
-        auto it = QS2Mask.find(qs);
-        if( it == QS2Mask.end() )
+        if (collecting)
         {
-            Mask m(qs);
-            QS2Mask[qs] = m;
-            SReg2Mask[m.regNo] = m;
+            skind.uses.emplace_back();
+            tkind.uses.emplace_back();
+            kernel_weights.push_back(w);
+            kernel = skind.uses.size() - 1;
         }
-        return QS2Mask[qs].regNo;
+        else
+        {
+            kernel = (kernel == MAX_CYCLE ? 0 : kernel + 1);
+            skind.contents.assign(skind.pool.size(), MAX_CYCLE);
+            tkind.contents.assign(tkind.pool.size(), MAX_CYCLE);
+        }
+        weight = w;
+        bundle = MAX_CYCLE;
     }
 
-    size_t getRegNo( qubit_pair_set_t & qps )
+    // start of the code of a bundle
+    void startBundle()
     {
-        // sort qubit operands pair to avoid variation in order
-        sort(qps.begin(), qps.end(), ql::utils::sort_pair_helper);
+        bundle = (bundle == MAX_CYCLE ? 0 : bundle + 1);
+        skind.bundle_uses = 0;
+        tkind.bundle_uses = 0;
+        skind.in_bundle.assign(skind.pool.size(), false);
+        tkind.in_bundle.assign(tkind.pool.size(), false);
+    }
 
-        auto it = QPS2Mask.find(qps);
-        if( it == QPS2Mask.end() )
-        {
-            Mask m(qps);
-            QPS2Mask[qps] = m;
-            TReg2Mask[m.regNo] = m;
-        }
-        return QPS2Mask[qps].regNo;
+    // after collecting, allocate the registers, and start generating code
+    void allocate()
+    {
+        allocate(skind);
+        allocate(tkind);
+        collecting = false;
+        kernel = MAX_CYCLE;
     }
 
+    // the name of the register with the mask of the given qubits; empty while collecting
     std::string getRegName( qubit_set_t & qs )
     {
         // sort qubit operands to avoid variation in order
         sort(qs.begin(), qs.end());
-
-        auto it = QS2Mask.find(qs);
-        if( it == QS2Mask.end() )
-        {
-            Mask m(qs);
-            QS2Mask[qs] = m;
-            SReg2Mask[m.regNo] = m;
-        }
-        return QS2Mask[qs].regName;
+        return regName(skind, qs, Mask(qs));
     }
 
     std::string getRegName( qubit_pair_set_t & qps )
     {
         // sort qubit operands pair to avoid variation in order
         sort(qps.begin(), qps.end(), ql::utils::sort_pair_helper);
-
-        auto it = QPS2Mask.find(qps);
-        if( it == QPS2Mask.end() )
+        std::vector<size_t> key;
+        for (auto & p : qps)
         {
-            Mask m(qps);
-            QPS2Mask[qps] = m;
-            TReg2Mask[m.regNo] = m;
+            key.push_back(p.first);
+            key.push_back(p.second);
         }
-        return QPS2Mask[qps].regName;
+        return regName(tkind, key, Mask(qps));
+    }
+
+    // the instructions setting pool registers that the current bundle needs, to precede it
+    std::string getBundleMaskInstructions()
+    {
+        std::string s = ssbundle.str();
+        ssbundle.str("");
+        return s;
+    }
+
+    // the number of instructions setting pool registers in the kernels
+    size_t getBundleMaskInstructionCount()
+    {
+        return nsets;
     }
 
+    // the instructions setting the registers of the masks that have one of their own, before the program starts
     std::string getMaskInstructions()
     {
         std::stringstream ssmasks;
-        for(size_t r=0; r<CurrSRegCount; ++r)
+        for (mask_kind_t * kind : {&skind, &tkind})
         {
-            auto & m = SReg2Mask[r];
-            ssmasks << "smis " << m.regName << ", {";
-            for(auto it = m.squbits.begin(); it != m.squbits.end(); ++it)
+            std::vector<const Mask *> byreg;
+            for (size_t id = 0; id < kind->masks.size(); id++)
             {
-                ssmasks << *it;
-                if( std::next(it) != m.squbits.end() )
-                    ssmasks << ", ";
+                if (kind->reg[id] != MAX_CYCLE)
+                {
+                    byreg.push_back(&kind->masks[id]);
+                }
             }
-            ssmasks << "} \n";
-        }
-
-        for(size_t r=0; r<CurrTRegCount; ++r)
-        {
-            auto & m = TReg2Mask[r];
-            ssmasks << "smit " << m.regName << ", {";
-            for(auto it = m.dqubits.begin(); it != m.dqubits.end(); ++it)
+            std::sort(byreg.begin(), byreg.end(), [](const Mask * a, const Mask * b) { return a->regNo < b->regNo; });
+            for (auto m : byreg)
             {
-                ssmasks << "(" << it->first << ", " << it->second << ")";
-                if( std::next(it) != m.dqubits.end() )
-                    ssmasks << ", ";
+                ssmasks << m->setInstruction() << " \n";
             }
-            ssmasks << "} \n";
         }
-
         return ssmasks.str();
     }
-
-    ~MaskManager()
-    {
-        CurrSRegCount=0;
-        CurrTRegCount=0;
-    }
-
 };
 
 
@@ -279,6 +538,7 @@ public:
         str::lower_case(operation);
         name=operation;
         duration = 20;
+        signature = __classical_signature__;
         creg_operands=opers;
         int sz = creg_operands.size();
         if((   (name == "add") || (name == "sub")
@@ -430,7 +690,7 @@ inline std::string get_cc_light_instruction_name(std::string & id, const ql::qua
     if (it != platform.instruction_map.end())
     {
         custom_gate* g = it->second;
-        cc_light_instr_name = g->arch_operation_name;
+        cc_light_instr_name = g->definition->arch_operation_name;
         if(cc_light_instr_name.empty())
         {
             FATAL("cc_light_instr not defined for instruction: " << id << " !");
@@ -444,76 +704,39 @@ inline std::string get_cc_light_instruction_name(std::string & id, const ql::qua
     return cc_light_instr_name;
 }
 
-static std::string ir2qisa(quantum_kernel & kernel,
-    const ql::quantum_platform & platform, MaskManager & gMaskManager)
+// the bundles of a kernel from which CC-Light QISA is generated, each section being a SIMD instruction
+// with the id in cc_light_instrs of its cc_light_instr, or no_instruction_id when classical
+static ql::ir::bundles_t ir2bundles(quantum_kernel & kernel, const ql::quantum_platform & platform,
+    ql::ir::instruction_ids_t & cc_light_instrs)
 {
-    IOUT("Generating CC-Light QISA");
+    IOUT("Bundling for CC-Light QISA");
 
-    ql::ir::bundles_t   bundles1;
     CclAssert(kernel.cycles_valid);
-    bundles1 = ql::ir::bundler(kernel.c, platform.cycle_time);
+    ql::ir::bundles_t bundles = ql::ir::bundler(kernel.c, platform.cycle_time);
 
     IOUT("Combining parallel sections...");
     // combine parallel instructions of same type from different sections into a single section
-    // this prepares for SIMD; each section will be a SIMD; of a quantum SIMD all operands are combined in a mask
-    ql::ir::DebugBundles("Before combining parallel sections", bundles1);
-    for (ql::ir::bundle_t & abundle : bundles1)
+    // this prepares for SIMD; each section will be a SIMD; of a quantum SIMD all operands are combined in a mask;
+    // instructions are of the same type when they have the same cc_light_instr; classical ones are not combined
+    ql::ir::DebugBundles("Before combining parallel sections", bundles);
+    std::unordered_map<std::string, ql::ir::instruction_id_t> gate_ids;    // id of cc_light_instr by gate name
+    for (auto & sec : bundles.sections)
     {
-        auto secIt1 = abundle.parallel_sections.begin();
-
-        for( ; secIt1 != abundle.parallel_sections.end(); ++secIt1 )
+        ql::gate * gp = bundles.gates[sec.begin_gate];
+        if (gp->type() == __classical_gate__)
         {
-            for( auto secIt2 = std::next(secIt1); secIt2 != abundle.parallel_sections.end(); ++secIt2)
-            {
-                auto insIt1 = secIt1->begin();
-                auto insIt2 = secIt2->begin();
-                if(insIt1 != secIt1->end() && insIt2 != secIt2->end() )
-                {
-                    auto id1 = (*insIt1)->name;
-                    auto id2 = (*insIt2)->name;
-                    auto itype1 = (*insIt1)->type();
-                    auto itype2 = (*insIt2)->type();
-                    if (itype1 == __classical_gate__ || itype2 == __classical_gate__)
-                    {
-                        DOUT("Not splicing " << id1 << " and " << id2);
-                        continue;
-                    }
-
-                    auto n1 = get_cc_light_instruction_name(id1, platform);
-                    auto n2 = get_cc_light_instruction_name(id2, platform);
-                    if( n1 == n2 )
-                    {
-                        DOUT("Splicing " << id1 << "/" << n1 << " and " << id2 << "/" << n2);
-                        (*secIt1).splice(insIt1, (*secIt2) );
-                    }
-                    else
-                    {
-                        DOUT("Not splicing " << id1 << "/" << n1 << " and " << id2 << "/" << n2);
-                    }
-                }
-            }
+            continue;
         }
-    }
-    ql::ir::DebugBundles("After combining", bundles1);
-    IOUT("Removing empty sections...");
-    // remove empty sections
-    ql::ir::bundles_t bundles2;
-    for (ql::ir::bundle_t & abundle1 : bundles1)
-    {
-        ql::ir::bundle_t abundle2;
-        abundle2.start_cycle = abundle1.start_cycle;
-        abundle2.duration_in_cycles = abundle1.duration_in_cycles;
-        for(auto & sec : abundle1.parallel_sections)
+        auto it = gate_ids.find(gp->name);
+        if (it == gate_ids.end())
         {
-            if( !sec.empty() )
-            {
-                abundle2.parallel_sections.push_back(sec);
-            }
+            auto id = cc_light_instrs.id(get_cc_light_instruction_name(gp->name, platform));
+            it = gate_ids.insert(std::make_pair(gp->name, id)).first;
         }
-        bundles2.push_back(abundle2);
+        sec.id = it->second;
     }
-    bundles1.clear();
-    ql::ir::DebugBundles("After removing empty sections", bundles2);
+    ql::ir::combine_sections(bundles);
+    ql::ir::DebugBundles("After combining", bundles);
 
     // sort sections to get consistent output across multiple runs. The output
     // is correct even without this sorting. Sorting is important to test the similarity
@@ -526,26 +749,36 @@ static std::string ir2qisa(quantum_kernel & kernel,
     // However, with sorting it will always generate:
     // x s0 | y s1
     //
+    // sections are sorted on the name of their last gate, which is the gate that sections were sorted on
+    // when combining sections prepended the gates of later sections
     IOUT("Sorting sections alphabetically according to instruction name ...");
-    for (ql::ir::bundle_t & abundle : bundles2)
+    for (ql::ir::bundle_t & abundle : bundles)
     {
         // sorts instructions alphabetically
-        abundle.parallel_sections.sort( []
+        auto secs = bundles.sections_of(abundle);
+        std::stable_sort(secs.begin(), secs.end(), [&bundles]
             (const ql::ir::section_t & sec1, const ql::ir::section_t & sec2) -> bool
             {
-                auto i1 = sec1.begin();
-                auto iname1 = (*(i1))->name;
-                auto i2 = sec2.begin();
-                auto iname2 = (*(i2))->name;
+                auto & iname1 = bundles.gates[sec1.end_gate - 1]->name;
+                auto & iname2 = bundles.gates[sec2.end_gate - 1]->name;
                 return iname2 < iname1;
             });
     }
+    return bundles;
+}
+
+// the QISA of the bundles of a kernel;
+// called twice for each kernel, first to collect the masks used, then to generate the code (see MaskManager)
+static std::string bundles2qisa(ql::ir::bundles_t & bundles2,
+    const ql::ir::instruction_ids_t & cc_light_instrs, MaskManager & gMaskManager)
+{
+    IOUT("Generating CC-Light QISA");
 
     // And now generate qisa
     // each section of a bundle will become a SIMD (all operations in a section are the same, see above)
     // for the operands of the SIMD, a mask will be used
     //
-    // kernel prologue (start label) and epilogue are generated by the caller or ir2qisa
+    // kernel prologue (start label) and epilogue are generated by the caller
     std::stringstream ssqisa;   // output qisa in here
     size_t curr_cycle=0; // first instruction should be with pre-interval 1, 'bs 1' FIXME HvS start in cycle 0
     for (ql::ir::bundle_t & abundle : bundles2)
@@ -555,48 +788,49 @@ static std::string ir2qisa(quantum_kernel & kernel,
         auto bcycle = abundle.start_cycle;
         auto delta = bcycle - curr_cycle;
         bool classical_bundle=false;
+        gMaskManager.startBundle();
         if(delta < 8)
             sspre << "    " << delta << "    ";
         else
             sspre << "    qwait " << delta-1 << "\n"
                   << "    1    ";
 
-        for(auto secIt = abundle.parallel_sections.begin();
-            secIt != abundle.parallel_sections.end(); ++secIt )
+        auto secs = bundles2.sections_of(abundle);
+        for(auto secIt = secs.begin(); secIt != secs.end(); ++secIt )
         {
             qubit_set_t squbits;
             qubit_pair_set_t dqubits;
-            auto firstInsIt = secIt->begin();
-            iname = (*(firstInsIt))->name;
-            auto itype = (*(firstInsIt))->type();
+            auto sec_gates = bundles2.gates_of(*secIt);
+            ql::gate * firstIns = sec_gates.front();
+            iname = firstIns->name;
+            auto itype = firstIns->type();
 
             if(__classical_gate__ == itype)
             {
                 classical_bundle = true;
-                ssinst << classical_instruction2qisa( (ql::arch::classical_cc *)(*firstInsIt) );
+                ssinst << classical_instruction2qisa( (ql::arch::classical_cc *)firstIns );
             }
             else
             {
-                DOUT("get cclight instr name for : " << iname);
-                std::string cc_light_instr_name = get_cc_light_instruction_name(iname, platform);
-                auto nOperands = ((*firstInsIt)->operands).size();
+                const std::string & cc_light_instr_name = cc_light_instrs.name(secIt->id);
+                auto nOperands = (firstIns->operands).size();
                 if( itype == __nop_gate__ )
                 {
                     ssinst << cc_light_instr_name;
                 }
                 else
                 {
-                    for(auto insIt = secIt->begin(); insIt != secIt->end(); ++insIt )
+                    for(auto gp : sec_gates)
                     {
                         if( 1 == nOperands )
                         {
-                            auto & op = (*insIt)->operands[0];
+                            auto & op = gp->operands[0];
                             squbits.push_back(op);
                         }
                         else if( 2 == nOperands )
                         {
-                            auto & op1 = (*insIt)->operands[0];
-                            auto & op2 = (*insIt)->operands[1];
+                            auto & op1 = gp->operands[0];
+                            auto & op2 = gp->operands[1];
                             dqubits.push_back( qubit_pair_t(op1, op2) );
                         }
                         else
@@ -623,11 +857,13 @@ static std::string ir2qisa(quantum_kernel & kernel,
                 }
             }
 
-            if( std::next(secIt) != abundle.parallel_sections.end() )
+            if( std::next(secIt) != secs.end() )
             {
                 ssinst << " | ";
             }
         }
+        // instructions setting the mask registers that the bundle uses
+        ssqisa << gMaskManager.getBundleMaskInstructions();
         if(classical_bundle)
         {
             if(iname == "fmr")
@@ -661,10 +897,14 @@ static std::string ir2qisa(quantum_kernel & kernel,
         curr_cycle+=delta;
     }
 
-    auto & lastBundle = bundles2.back();
-    int lbduration = lastBundle.duration_in_cycles;
-    if(lbduration>1)
-        ssqisa << "    qwait " << lbduration << "\n";
+    // a kernel of which all gates are not bundled (e.g. wait) has no bundles
+    if (!bundles2.empty())
+    {
+        auto & lastBundle = bundles2.back();
+        int lbduration = lastBundle.duration_in_cycles;
+        if(lbduration>1)
+            ssqisa << "    qwait " << lbduration << "\n";
+    }
 
     IOUT("Generating CC-Light QISA [Done]");
     return ssqisa.str();
@@ -781,10 +1021,10 @@ public:
         ql::report_statistics(programp, platform, "in", passname, "# ");
         ql::report_qasm(programp, platform, "in", passname);
 
-        for(auto &kernel : programp->kernels)
+        ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
         {
-	    ccl_decompose_pre_schedule_kernel(kernel, platform);
-        }
+            ccl_decompose_pre_schedule_kernel(programp->kernels[k], platform);
+        });
 
         ql::report_statistics(programp, platform, "out", passname, "# ");
         ql::report_qasm(programp, platform, "out", passname);
@@ -795,8 +1035,9 @@ public:
         ql::report_statistics(programp, platform, "in", passname, "# ");
         ql::report_qasm(programp, platform, "in", passname);
 
-        for(auto &kernel : programp->kernels)
+        ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
         {
+            ql::quantum_kernel& kernel = programp->kernels[k];
             IOUT("Decomposing meta-instructions kernel after post-scheduling: " << kernel.name);
             if (! kernel.c.empty())
             {
@@ -806,16 +1047,14 @@ public:
                 kernel.c = ql::ir::circuiter(bundles);
                 CclAssert(kernel.cycles_valid);
             }
-        }
+        });
         ql::report_statistics(programp, platform, "out", passname, "# ");
         ql::report_qasm(programp, platform, "out", passname);
     }
 
-    void ccl_decompose_post_schedule_bundles(ql::ir::bundles_t & bundles_dst,
+    void ccl_decompose_post_schedule_bundles(ql::ir::bundles_t & bundles,
         const ql::quantum_platform& platform)
     {
-        auto bundles_src = bundles_dst;
-
         IOUT("Post scheduling decomposition ...");
         if (ql::options::get("cz_mode") == "auto")
         {
@@ -854,66 +1093,70 @@ public:
                     edge_detunes_qubits[edgeNo].push_back(q);
             }
 
-            for (
-                auto bundles_src_it = bundles_src.begin(), bundles_dst_it = bundles_dst.begin();
-                bundles_src_it != bundles_src.end() && bundles_dst_it != bundles_dst.end();
-                ++bundles_src_it, ++bundles_dst_it
-                )
+            // the bundles with, after the sections of each bundle, a section for each sqf gate added to it
+            ql::ir::bundles_t bundles_dst;
+            bundles_dst.bundles.reserve(bundles.bundles.size());
+            bundles_dst.sections.reserve(bundles.sections.size());
+            bundles_dst.gates.reserve(bundles.gates.size());
+            for (ql::ir::bundle_t & abundle : bundles)
             {
-                for(auto sec_src_it = bundles_src_it->parallel_sections.begin();
-                    sec_src_it != bundles_src_it->parallel_sections.end();
-                    ++sec_src_it)
+                bundles_dst.add_bundle(abundle.start_cycle, abundle.duration_in_cycles);
+                for (auto & sec : bundles.sections_of(abundle))
                 {
-                    for(auto ins_src_it = sec_src_it->begin();
-                        ins_src_it != sec_src_it->end();
-                        ++ins_src_it )
+                    bundles_dst.add_section(sec.id);
+                    for (auto gp : bundles.gates_of(sec))
                     {
-                        std::string id = (*ins_src_it)->name;
-                        std::string operation_type = "";
-                        size_t nOperands = ((*ins_src_it)->operands).size();
-                        if(2 == nOperands)
+                        bundles_dst.add_gate(gp);
+                    }
+                }
+
+                for (auto src_gp : bundles.gates_of(abundle))
+                {
+                    std::string id = src_gp->name;
+                    std::string operation_type = "";
+                    size_t nOperands = (src_gp->operands).size();
+                    if(2 == nOperands)
+                    {
+                        auto it = platform.instruction_map.find(id);
+                        if (it != platform.instruction_map.end())
                         {
-                            auto it = platform.instruction_map.find(id);
-                            if (it != platform.instruction_map.end())
-                            {
-                                if(platform.instruction_settings[id].count("type") > 0)
-                                {
-                                    operation_type = platform.instruction_settings[id]["type"].get<std::string>();
-                                }
-                            }
-                            else
+                            if(platform.instruction_settings[id].count("type") > 0)
                             {
-                                FATAL("custom instruction not found for : " << id << " !");
+                                operation_type = platform.instruction_settings[id]["type"].get<std::string>();
                             }
+                        }
+                        else
+                        {
+                            FATAL("custom instruction not found for : " << id << " !");
+                        }
 
-                            bool is_flux_2_qubit = ( (operation_type == "flux") );
-                            if( is_flux_2_qubit )
+                        bool is_flux_2_qubit = ( (operation_type == "flux") );
+                        if( is_flux_2_qubit )
+                        {
+                            auto & q0 = src_gp->operands[0];
+                            auto & q1 = src_gp->operands[1];
+                            DOUT("found 2 qubit flux gate on " << q0 << " and " << q1);
+                            qubits_pair_t aqpair(q0, q1);
+                            auto it = qubitpair2edge.find(aqpair);
+                            if( it != qubitpair2edge.end() )
                             {
-                                auto & q0 = (*ins_src_it)->operands[0];
-                                auto & q1 = (*ins_src_it)->operands[1];
-                                DOUT("found 2 qubit flux gate on " << q0 << " and " << q1);
-                                qubits_pair_t aqpair(q0, q1);
-                                auto it = qubitpair2edge.find(aqpair);
-                                if( it != qubitpair2edge.end() )
+                                auto edge_no = qubitpair2edge[aqpair];
+                                DOUT("add the following sqf gates for edge: " << edge_no << ":");
+                                for( auto & q : edge_detunes_qubits[edge_no])
                                 {
-                                    auto edge_no = qubitpair2edge[aqpair];
-                                    DOUT("add the following sqf gates for edge: " << edge_no << ":");
-                                    for( auto & q : edge_detunes_qubits[edge_no])
-                                    {
-                                        DOUT("sqf q" << q);
-                                        custom_gate* g = new custom_gate("sqf q"+std::to_string(q));
-                                        g->operands.push_back(q);
-
-                                        ql::ir::section_t asec;
-                                        asec.push_back(g);
-                                        bundles_dst_it->parallel_sections.push_back(asec);
-                                    }
+                                    DOUT("sqf q" << q);
+                                    custom_gate* g = new custom_gate("sqf q"+std::to_string(q));
+                                    g->operands.push_back(q);
+
+                                    bundles_dst.add_section();
+                                    bundles_dst.add_gate(g);
                                 }
                             }
                         }
                     }
                 }
             }
+            bundles = std::move(bundles_dst);
         }
         IOUT("Post scheduling decomposition [Done]");
     }
@@ -930,19 +1173,24 @@ public:
         ql::report_statistics(programp, platform, "in", passname, "# ");
         ql::report_qasm(programp, platform, "in", passname);
 
-        Mapper mapper;  // virgin mapper creation; for role of Init functions, see comment at top of mapper.h
-        mapper.Init(&platform); // platform specifies number of real qubits, i.e. locations for virtual qubits
-
-        std::ofstream   ofs;
-        ofs = ql::report_open(programp, "out", passname);
-
-        size_t  total_swaps = 0;        // for reporting, data is mapper specific
-        size_t  total_moves = 0;        // for reporting, data is mapper specific
-        double  total_timetaken = 0.0;  // total over kernels of time taken by mapper
-        for(auto &kernel : programp->kernels)
+        // kernels are mapped independently, each by its own mapper, possibly concurrently;
+        // the kernel reports are collected and written after all kernels have been mapped, in kernel order
+        struct kernel_result_t
+        {
+            size_t      nswapsadded;
+            size_t      nmovesadded;
+            double      timetaken;
+            std::string report;
+        };
+        std::vector<kernel_result_t> results(programp->kernels.size());
+        ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
         {
+            ql::quantum_kernel& kernel = programp->kernels[k];
             IOUT("Mapping kernel: " << kernel.name);
 
+            Mapper mapper;  // virgin mapper creation; for role of Init functions, see comment at top of mapper.h
+            mapper.Init(&platform); // platform specifies number of real qubits, i.e. locations for virtual qubits
+
             // compute timetaken, start interval timer here
             double    timetaken = 0.0;
             using namespace std::chrono;
@@ -951,15 +1199,12 @@ public:
             mapper.Map(kernel);
                 // kernel.qubit_count starts off as number of virtual qubits, i.e. highest indexed qubit minus 1
                 // kernel.qubit_count is updated by Map to highest index of real qubits used minus -1
-            programp->qubit_count = platform.qubit_number;
-                // program.qubit_count is updated to platform.qubit_number
 
             // computing timetaken, stop interval timer
             high_resolution_clock::time_point t2 = high_resolution_clock::now();
             duration<double> time_span = t2 - t1;
             timetaken = time_span.count();
 
-            ql::report_kernel_statistics(ofs, kernel, platform, "# ");
             std::stringstream ss;
             ss << "# ----- swaps added: " << mapper.nswapsadded << "\n";
             ss << "# ----- of which moves added: " << mapper.nmovesadded << "\n";
@@ -969,14 +1214,29 @@ public:
             ss << "# ----- realqubit states before mapper:" << ql::utils::to_string(mapper.rs_in) << "\n";
             ss << "# ----- realqubit states after mapper:" << ql::utils::to_string(mapper.rs_out) << "\n";
             ss << "# ----- time taken: " << timetaken << "\n";
-            ql::report_string(ofs, ss.str());
+            results[k] = kernel_result_t{mapper.nswapsadded, mapper.nmovesadded, timetaken, ss.str()};
+        });
+        programp->qubit_count = platform.qubit_number;
+            // program.qubit_count is updated to platform.qubit_number
+
+        std::ofstream   ofs;
+        ofs = ql::report_open(programp, "out", passname);
+
+        size_t  total_swaps = 0;        // for reporting, data is mapper specific
+        size_t  total_moves = 0;        // for reporting, data is mapper specific
+        double  total_timetaken = 0.0;  // total over kernels of time taken by mapper
+        for (size_t k = 0; k < programp->kernels.size(); k++)
+        {
+            ql::quantum_kernel& kernel = programp->kernels[k];
+            ql::report_kernel_statistics(ofs, kernel, platform, "# ");
+            ql::report_string(ofs, results[k].report);
+
+            total_swaps += results[k].nswapsadded;
+            total_moves += results[k].nmovesadded;
+            total_timetaken += results[k].timetaken;
 
-            total_swaps += mapper.nswapsadded;
-            total_moves += mapper.nmovesadded;
-            total_timetaken += timetaken;
-            
             ql::get_kernel_statistics(mapStatistics, kernel, platform, "# ");
-            *mapStatistics += ss.str();
+            *mapStatistics += results[k].report;
         }
         ql::report_totals_statistics(ofs, programp->kernels, platform, "# ");
         std::stringstream ss;
@@ -1091,6 +1351,8 @@ public:
 	// this call could also have been at end of back-end-independent passes
         write_quantumsim_script(programp, platform, "write_quantumsim_script_unmapped");
 
+        ql::cancel_gates(programp, platform, "cancel_premapper");
+
         ql::clifford_optimize(programp, platform, "clifford_premapper");
 
         // map function definition must be moved to src/mapper.h and src/mapper.cc
@@ -1275,19 +1537,40 @@ public:
     // generates qisa from IR
     void qisa_code_generation(quantum_program* programp, const ql::quantum_platform& platform, std::string passname)
     {
+        // the code is generated twice, first to collect the masks used by the bundles of each kernel,
+        // then after allocating the mask registers to them, to generate it with those (see MaskManager)
         MaskManager mask_manager;
+        ql::ir::instruction_ids_t cc_light_instrs;
+        std::vector<ql::ir::bundles_t> kernel_bundles;
+        std::vector<double> weights = loop_weights(programp);
+        for(size_t k = 0; k < programp->kernels.size(); k++)
+        {
+            auto &kernel = programp->kernels[k];
+            mask_manager.startKernel(weights[k]);
+            kernel_bundles.emplace_back();
+            if (! kernel.c.empty())
+            {
+                kernel_bundles.back() = ir2bundles(kernel, platform, cc_light_instrs);
+                bundles2qisa(kernel_bundles.back(), cc_light_instrs, mask_manager);
+            }
+        }
+        mask_manager.allocate();
+
         std::stringstream ssqisa, sskernels_qisa;
         sskernels_qisa << "start:" << std::endl;
-        for(auto &kernel : programp->kernels)
+        for(size_t k = 0; k < programp->kernels.size(); k++)
         {
+            auto &kernel = programp->kernels[k];
+            mask_manager.startKernel(weights[k]);
             sskernels_qisa << "\n" << kernel.name << ":" << std::endl;
             sskernels_qisa << get_qisa_prologue(kernel);
             if (! kernel.c.empty())
             {
-                sskernels_qisa << ir2qisa(kernel, platform, mask_manager);
+                sskernels_qisa << bundles2qisa(kernel_bundles[k], cc_light_instrs, mask_manager);
             }
             sskernels_qisa << get_qisa_epilogue(kernel);
         }
+        DOUT("Mask registers set in the kernels: " << mask_manager.getBundleMaskInstructionCount() << " times");
         sskernels_qisa << "\n    br always, start" << "\n"
                   << "    nop \n"
                   << "    nop" << std::endl;
@@ -1312,6 +1595,26 @@ public:
     }
 
 private:
+    // the number of times each kernel is executed, as far as known: the product of the iterations of the for loops around it
+    std::vector<double> loop_weights(quantum_program* programp)
+    {
+        std::vector<double> weights;
+        std::vector<double> stack(1, 1.0);
+        for(auto &kernel : programp->kernels)
+        {
+            if (kernel.type == kernel_type_t::FOR_END && stack.size() > 1)
+            {
+                stack.pop_back();
+            }
+            weights.push_back(stack.back());
+            if (kernel.type == kernel_type_t::FOR_START)
+            {
+                stack.push_back(stack.back() * kernel.iterations);
+            }
+        }
+        return weights;
+    }
+
     // write cc_light scheduled bundles for quantumsim
     // when cc_light independent, it should be extracted and put in src/quantumsim.h
     void write_quantumsim_program( quantum_program* programp, size_t num_qubits, const ql::quantum_platform & platform, std::string suffix)
@@ -1501,14 +1804,14 @@ private:
                     auto bcycle = abundle.start_cycle;
 
                     std::stringstream ssqs;
-                    for( auto secIt = abundle.parallel_sections.begin(); secIt != abundle.parallel_sections.end(); ++secIt )
+                    for (auto & sec : bundles.sections_of(abundle))
                     {
                         DOUT("... adding gates, a new section in a bundle");
-                        for(auto insIt = secIt->begin(); insIt != secIt->end(); ++insIt )
+                        for (auto gp : bundles.gates_of(sec))
                         {
-                            auto & iname = (*insIt)->name;
-                            auto & operands = (*insIt)->operands;
-                            auto duration = (*insIt)->duration;     // duration in nano-seconds
+                            auto & iname = gp->name;
+                            auto & operands = gp->operands;
+                            auto duration = gp->duration;     // duration in nano-seconds
                             // size_t operation_duration = std::ceil( static_cast<float>(duration) / platform.cycle_time);
                             if( iname == "measure")
                             {
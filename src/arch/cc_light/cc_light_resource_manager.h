@@ -13,6 +13,10 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <cmath>
 #include <json.h>
 #include <resource_manager.h>
 
@@ -59,6 +63,89 @@ inline std::string ccl_get_operation_name(ql::gate *ins, const ql::quantum_platf
     return operation_name;
 }
 
+// operation types that the resources distinguish; any other type is ccl_type_other
+typedef enum {
+    ccl_type_other = 0,
+    ccl_type_mw,
+    ccl_type_flux,
+    ccl_type_readout
+} ccl_operation_type_t;
+
+// platform dependent attributes of an instruction as needed by the resources:
+// its operation type, and its operation name as an id, equal ids meaning equal operation names;
+// id 0 is not used by any instruction, so it can represent no operation
+struct ccl_operation_t
+{
+    ccl_operation_type_t    type;
+    size_t                  name_id;
+};
+
+// The attributes of all instructions in the platform's instruction_settings,
+// resolved once from the json by the resource manager so that checking and reserving resources
+// doesn't need json lookups and string compares.
+// The resources share it read-only, also with their copies (clones), so it is not copied itself.
+class ccl_operations_t
+{
+public:
+    std::unordered_map<std::string, ccl_operation_t> operations;    // instruction name to its attributes
+
+    ccl_operations_t(const ql::quantum_platform & platform)
+    {
+        std::map<std::string, size_t> name_ids;
+        for (json::const_iterator it = platform.instruction_settings.begin(); it != platform.instruction_settings.end(); ++it)
+        {
+            auto & settings = it.value();
+            std::string operation_type("cc_light_type");
+            std::string operation_name(it.key());
+            auto type_it = settings.find("type");
+            if (type_it != settings.end() && !type_it->is_null())
+            {
+                if (!type_it->is_string())
+                {
+                    continue;   // left to ccl_get_operation_type to report when the instruction is used
+                }
+                operation_type = type_it->get<std::string>();
+            }
+            auto name_it = settings.find("cc_light_instr");
+            if (name_it != settings.end() && !name_it->is_null())
+            {
+                if (!name_it->is_string())
+                {
+                    continue;   // left to ccl_get_operation_name to report when the instruction is used
+                }
+                operation_name = name_it->get<std::string>();
+            }
+
+            ccl_operation_t op;
+            op.type = (operation_type == "mw" ? ccl_type_mw
+                    : operation_type == "flux" ? ccl_type_flux
+                    : operation_type == "readout" ? ccl_type_readout
+                    : ccl_type_other);
+            auto id_it = name_ids.find(operation_name);
+            if (id_it == name_ids.end())
+            {
+                id_it = name_ids.insert(std::make_pair(operation_name, name_ids.size() + 1)).first;
+            }
+            op.name_id = id_it->second;
+            operations[it.key()] = op;
+        }
+        DOUT("resolved attributes of " << operations.size() << " instructions to " << name_ids.size() << " operation names");
+    }
+
+    const ccl_operation_t & get(ql::gate * ins, const ql::quantum_platform & platform) const
+    {
+        auto it = operations.find(ins->name);
+        if (it == operations.end())
+        {
+            // report the problem with the instruction's settings as the json lookups would
+            ccl_get_operation_type(ins, platform);
+            ccl_get_operation_name(ins, platform);
+            FATAL("Error : settings of instruction '" << ins->name << "' could not be resolved");
+        }
+        return it->second;
+    }
+};
+
 
 
 // ============ classes of resources that _may_ appear in a configuration file
@@ -89,7 +176,6 @@ public:
     bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
-        std::string operation_type = ccl_get_operation_type(ins, platform);
 
         for( auto q : ins->operands )
         {
@@ -118,12 +204,11 @@ public:
 
     void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
 
         for( auto q : ins->operands )
         {
-            state[q] = (forward_scheduling == direction ?  op_start_cycle + operation_duration : op_start_cycle );
+            set(state[q], (forward_scheduling == direction ?  op_start_cycle + operation_duration : op_start_cycle ));
             DOUT("reserved " << name << ". op_start_cycle: " << op_start_cycle << " qubit: " << q << " reserved till/from cycle: " << state[q]);
         }
     }
@@ -148,11 +233,12 @@ public:
     // but a new y must wait until the last x has finished;
     // the bug was that a new x was always ok (so also when starting earlier than cycle i)
 
-    std::vector<std::string> operations;    // with operation_name==operations[qwg]
-    std::map<size_t,size_t> qubit2qwg;      // on qwg==qubit2qwg[q]
+    std::vector<size_t> operations;         // with operation_name id==operations[qwg], 0 when none
+    std::shared_ptr<const std::vector<size_t>> qubit2qwg;  // on qwg==(*qubit2qwg)[q]; constant, shared by copies
+    std::shared_ptr<const ccl_operations_t> ops;    // attributes of the instructions
 
-    ccl_qwg_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir) : 
-        resource_t("qwgs", dir)
+    ccl_qwg_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const ccl_operations_t> operations_attributes) :
+        resource_t("qwgs", dir), ops(operations_attributes)
     {
         // DOUT("... creating " << name << " resource");
         count = platform.resources[name]["count"];
@@ -164,35 +250,42 @@ public:
         {
             fromcycle[i] = (forward_scheduling == dir ? 0 : MAX_CYCLE);
             tocycle[i] = (forward_scheduling == dir ? 0 : MAX_CYCLE);
-            operations[i] = "";
+            operations[i] = 0;
         }
+        std::vector<size_t> q2qwg(platform.qubit_number, 0);
         auto & constraints = platform.resources[name]["connection_map"];
         for (json::const_iterator it = constraints.begin(); it != constraints.end(); ++it)
         {
             // COUT(it.key() << " : " << it.value() );
             size_t qwgNo = stoi( it.key() );
             auto & connected_qubits = it.value();
-            for(auto & q : connected_qubits)
-                qubit2qwg[q] = qwgNo;
+            for(auto & c : connected_qubits)
+            {
+                size_t q = c;
+                if (q >= q2qwg.size()) q2qwg.resize(q+1, 0);
+                q2qwg[q] = qwgNo;
+            }
         }
+        qubit2qwg = std::make_shared<const std::vector<size_t>>(std::move(q2qwg));
     }
 
     bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
-        std::string operation_name = ccl_get_operation_name(ins, platform);
+        const ccl_operation_t & op = ops->get(ins, platform);
+        size_t      operation_name = op.name_id;
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
 
-        bool is_mw = (operation_type == "mw");
+        bool is_mw = (op.type == ccl_type_mw);
         if( is_mw )
         {
             for( auto q : ins->operands )
             {
-                DOUT(" available " << name << "? op_start_cycle: " << op_start_cycle << "  qwg: " << qubit2qwg[q] << " is busy from cycle: " << fromcycle[ qubit2qwg[q] ] << " to cycle: " << tocycle[qubit2qwg[q]] << " for operation: " << operations[ qubit2qwg[q] ]);
+                size_t qwg = (*qubit2qwg)[q];
+                DOUT(" available " << name << "? op_start_cycle: " << op_start_cycle << "  qwg: " << qwg << " is busy from cycle: " << fromcycle[qwg] << " to cycle: " << tocycle[qwg] << " for operation: " << operations[qwg]);
                 if (forward_scheduling == direction)
                 {
-                    if ( op_start_cycle < fromcycle[ qubit2qwg[q] ]
-                    || ( op_start_cycle < tocycle[qubit2qwg[q]] && operations[ qubit2qwg[q] ] != operation_name ) )
+                    if ( op_start_cycle < fromcycle[qwg]
+                    || ( op_start_cycle < tocycle[qwg] && operations[qwg] != operation_name ) )
                     {
                         DOUT("    " << name << " resource busy ...");
                         return false;
@@ -200,8 +293,8 @@ public:
                 }
                 else
                 {
-                    if ( op_start_cycle + operation_duration > tocycle[ qubit2qwg[q] ]
-                    || ( op_start_cycle + operation_duration > fromcycle[qubit2qwg[q]] && operations[ qubit2qwg[q] ] != operation_name ) )
+                    if ( op_start_cycle + operation_duration > tocycle[qwg]
+                    || ( op_start_cycle + operation_duration > fromcycle[qwg] && operations[qwg] != operation_name ) )
                     {
                         DOUT("    " << name << " resource busy ...");
                         return false;
@@ -215,42 +308,43 @@ public:
 
     void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
-        std::string operation_name = ccl_get_operation_name(ins, platform);
+        const ccl_operation_t & op = ops->get(ins, platform);
+        size_t      operation_name = op.name_id;
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
 
-        bool is_mw = (operation_type == "mw");
+        bool is_mw = (op.type == ccl_type_mw);
         if( is_mw )
         {
             for( auto q : ins->operands )
             {
+                size_t qwg = (*qubit2qwg)[q];
                 if (forward_scheduling == direction)
                 {
-                    if (operations[ qubit2qwg[q] ] == operation_name)
+                    if (operations[qwg] == operation_name)
                     {
-                        tocycle[ qubit2qwg[q] ]  = std::max( tocycle[qubit2qwg[q]], op_start_cycle + operation_duration);
+                        set(tocycle[qwg], std::max( tocycle[qwg], op_start_cycle + operation_duration));
                     }
                     else
                     {
-                        fromcycle[ qubit2qwg[q] ]  = op_start_cycle;
-                        tocycle[ qubit2qwg[q] ]  = op_start_cycle + operation_duration;
-                        operations[ qubit2qwg[q] ] = operation_name;
+                        set(fromcycle[qwg], op_start_cycle);
+                        set(tocycle[qwg], op_start_cycle + operation_duration);
+                        set(operations[qwg], operation_name);
                     }
                 }
                 else
                 {
-                    if (operations[ qubit2qwg[q] ] == operation_name)
+                    if (operations[qwg] == operation_name)
                     {
-                        fromcycle[ qubit2qwg[q] ]  = std::min( fromcycle[qubit2qwg[q]], op_start_cycle);
+                        set(fromcycle[qwg], std::min( fromcycle[qwg], op_start_cycle));
                     }
                     else
                     {
-                        fromcycle[ qubit2qwg[q] ]  = op_start_cycle;
-                        tocycle[ qubit2qwg[q] ]  = op_start_cycle + operation_duration;
-                        operations[ qubit2qwg[q] ] = operation_name;
+                        set(fromcycle[qwg], op_start_cycle);
+                        set(tocycle[qwg], op_start_cycle + operation_duration);
+                        set(operations[qwg], operation_name);
                     }
                 }
-                DOUT("reserved " << name << ". op_start_cycle: " << op_start_cycle << " qwg: " << qubit2qwg[q] << " reserved from cycle: " << fromcycle[ qubit2qwg[q] ] << " to cycle: " << tocycle[qubit2qwg[q]] << " for operation: " << operations[ qubit2qwg[q] ]);
+                DOUT("reserved " << name << ". op_start_cycle: " << op_start_cycle << " qwg: " << qwg << " reserved from cycle: " << fromcycle[qwg] << " to cycle: " << tocycle[qwg] << " for operation: " << operations[qwg]);
             }
         }
     }
@@ -268,10 +362,11 @@ public:
 
     std::vector<size_t> fromcycle;  // last measurement start cycle
     std::vector<size_t> tocycle;    // is busy till cycle
-    std::map<size_t,size_t> qubit2meas;
+    std::shared_ptr<const std::vector<size_t>> qubit2meas;  // on measurement unit (*qubit2meas)[q]; constant, shared by copies
+    std::shared_ptr<const ccl_operations_t> ops;    // attributes of the instructions
 
-    ccl_meas_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir) : 
-        resource_t("meas_units", dir)
+    ccl_meas_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const ccl_operations_t> operations_attributes) :
+        resource_t("meas_units", dir), ops(operations_attributes)
     {
         // DOUT("... creating " << name << " resource");
         count = platform.resources[name]["count"];
@@ -283,35 +378,42 @@ public:
             fromcycle[i] = (forward_scheduling == dir ? 0 : MAX_CYCLE);
             tocycle[i] = (forward_scheduling == dir ? 0 : MAX_CYCLE);
         }
+        std::vector<size_t> q2meas(platform.qubit_number, 0);
         auto & constraints = platform.resources[name]["connection_map"];
         for (json::const_iterator it = constraints.begin(); it != constraints.end(); ++it)
         {
             // COUT(it.key() << " : " << it.value());
             size_t measUnitNo = stoi( it.key() );
             auto & connected_qubits = it.value();
-            for(auto & q : connected_qubits)
-                qubit2meas[q] = measUnitNo;
+            for(auto & c : connected_qubits)
+            {
+                size_t q = c;
+                if (q >= q2meas.size()) q2meas.resize(q+1, 0);
+                q2meas[q] = measUnitNo;
+            }
         }
+        qubit2meas = std::make_shared<const std::vector<size_t>>(std::move(q2meas));
     }
 
     bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
+        const ccl_operation_t & op = ops->get(ins, platform);
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
 
-        bool is_measure = (operation_type == "readout");
+        bool is_measure = (op.type == ccl_type_readout);
         if( is_measure )
         {
             for(auto q : ins->operands)
             {
-                DOUT(" available " << name << "? op_start_cycle: " << op_start_cycle << "  meas: " << qubit2meas[q] << " is busy from cycle: " << fromcycle[ qubit2meas[q] ] << " to cycle: " << tocycle[qubit2meas[q]] );
+                size_t meas = (*qubit2meas)[q];
+                DOUT(" available " << name << "? op_start_cycle: " << op_start_cycle << "  meas: " << meas << " is busy from cycle: " << fromcycle[meas] << " to cycle: " << tocycle[meas] );
                 if (forward_scheduling == direction)
                 {
-	                if( op_start_cycle != fromcycle[ qubit2meas[q] ] )
+	                if( op_start_cycle != fromcycle[meas] )
 	                {
 	                    // If current measurement on same measurement-unit does not start in the
 	                    // same cycle, then it should wait for current measurement to finish
-	                    if( op_start_cycle < tocycle[ qubit2meas[q] ] )
+	                    if( op_start_cycle < tocycle[meas] )
 	                    {
 	                        DOUT("    " << name << " resource busy ...");
 	                        return false;
@@ -320,11 +422,11 @@ public:
                 }
                 else
                 {
-	                if( op_start_cycle != fromcycle[ qubit2meas[q] ] )
+	                if( op_start_cycle != fromcycle[meas] )
 	                {
 	                    // If current measurement on same measurement-unit does not start in the
 	                    // same cycle, then it should wait until it would finish at start of or earlier than current measurement
-	                    if( op_start_cycle + operation_duration > fromcycle[ qubit2meas[q] ] )
+	                    if( op_start_cycle + operation_duration > fromcycle[meas] )
 	                    {
 	                        DOUT("    " << name << " resource busy ...");
 	                        return false;
@@ -339,17 +441,18 @@ public:
 
     void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
+        const ccl_operation_t & op = ops->get(ins, platform);
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
 
-        bool is_measure = (operation_type == "readout");
+        bool is_measure = (op.type == ccl_type_readout);
         if( is_measure )
         {
             for(auto q : ins->operands)
             {
-                fromcycle[ qubit2meas[q] ] = op_start_cycle;
-                tocycle[ qubit2meas[q] ] = op_start_cycle + operation_duration;
-                DOUT("reserved " << name << ". op_start_cycle: " << op_start_cycle << " meas: " << qubit2meas[q] << " reserved from cycle: " << fromcycle[ qubit2meas[q] ] << " to cycle: " << tocycle[qubit2meas[q]] );
+                size_t meas = (*qubit2meas)[q];
+                set(fromcycle[meas], op_start_cycle);
+                set(tocycle[meas], op_start_cycle + operation_duration);
+                DOUT("reserved " << name << ". op_start_cycle: " << op_start_cycle << " meas: " << meas << " reserved from cycle: " << fromcycle[meas] << " to cycle: " << tocycle[meas] );
             }
         }
     }
@@ -375,10 +478,16 @@ public:
     // bwd: edge is busy from cycle=state[edge], i.e. all cycles >= state[edge] it is busy, i.e. start_cycle+duration must be <= state[edge]
     std::vector<size_t> state;                          // machine state recording the cycles that given edge is free/busy
     typedef std::pair<size_t,size_t> qubits_pair_t;
-    std::map< qubits_pair_t, size_t > qubits2edge;      // constant helper table to find edge between a pair of qubits
-    std::map<size_t, std::vector<size_t> > edge2edges;  // constant "edges" table from configuration file
-
-    ccl_edge_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir) : resource_t("edges", dir)
+    struct tables_t                                     // constant tables, shared by copies
+    {
+        std::map< qubits_pair_t, size_t > qubits2edge;  // helper table to find edge between a pair of qubits
+        std::vector< std::vector<size_t> > edge2edges;  // "edges" table from configuration file, indexed by edge
+    };
+    std::shared_ptr<const tables_t> tables;
+    std::shared_ptr<const ccl_operations_t> ops;        // attributes of the instructions
+
+    ccl_edge_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const ccl_operations_t> operations_attributes) :
+        resource_t("edges", dir), ops(operations_attributes)
     {
         // DOUT("... creating " << name << " resource");
         count = platform.resources[name]["count"];
@@ -389,6 +498,9 @@ public:
             state[i] = (forward_scheduling == dir ? 0 : MAX_CYCLE);
         }
 
+        std::shared_ptr<tables_t> t = std::make_shared<tables_t>();
+        auto & qubits2edge = t->qubits2edge;
+        auto & edge2edges = t->edge2edges;
         for( auto & anedge : platform.topology["edges"] )
         {
             size_t s = anedge["src"];
@@ -414,18 +526,28 @@ public:
             // COUT(it.key() << " : " << it.value() << "\n");
             size_t edgeNo = stoi( it.key() );
             auto & connected_edges = it.value();
-            for(auto & e : connected_edges)
+            for(auto & c : connected_edges)
+            {
+                size_t e = c;
+                if (e >= edge2edges.size()) edge2edges.resize(e+1);
                 edge2edges[e].push_back(edgeNo);
+            }
         }
+        for (auto & e : qubits2edge)
+        {
+            if (e.second >= edge2edges.size()) edge2edges.resize(e.second+1);
+        }
+        tables = t;
     }
 
     bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
+        const ccl_operation_t & op = ops->get(ins, platform);
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
+        const auto & qubits2edge = tables->qubits2edge;
+        const auto & edge2edges = tables->edge2edges;
 
-        auto gname = ins->name;
-        bool is_flux = (operation_type == "flux");
+        bool is_flux = (op.type == ccl_type_flux);
         if( is_flux )
         {
             auto nopers = ins->operands.size();
@@ -442,14 +564,15 @@ public:
                 auto it = qubits2edge.find(aqpair);
                 if( it != qubits2edge.end() )
                 {
-                    auto edge_no = qubits2edge[aqpair];
+                    auto edge_no = it->second;
 
                     DOUT(" available " << name << "? op_start_cycle: " << op_start_cycle << ", edge: " << edge_no << " is busy till/from cycle : " << state[edge_no] << " for operation: " << ins->name);
 
-                    std::vector<size_t> edges2check(edge2edges[edge_no]);
-                    edges2check.push_back(edge_no);
-                    for(auto & e : edges2check)
+                    // check the edge's related edges and then the edge itself
+                    auto & related_edges = edge2edges[edge_no];
+                    for(size_t i = 0; i <= related_edges.size(); i++)
                     {
+                        size_t e = (i < related_edges.size() ? related_edges[i] : edge_no);
                         if (forward_scheduling == direction)
                         {
                             if( op_start_cycle < state[e] )
@@ -484,11 +607,12 @@ public:
 
     void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
+        const ccl_operation_t & op = ops->get(ins, platform);
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
+        const auto & qubits2edge = tables->qubits2edge;
+        const auto & edge2edges = tables->edge2edges;
 
-        auto gname = ins->name;
-        bool is_flux = (operation_type == "flux");
+        bool is_flux = (op.type == ccl_type_flux);
         if( is_flux )
         {
             auto nopers = ins->operands.size();
@@ -501,21 +625,21 @@ public:
                 auto q0 = ins->operands[0];
                 auto q1 = ins->operands[1];
                 qubits_pair_t aqpair(q0, q1);
-                auto edge_no = qubits2edge[aqpair];
+                auto edge_no = qubits2edge.at(aqpair);
                 if (forward_scheduling == direction)
                 {
-                    state[edge_no] = op_start_cycle + operation_duration;
+                    set(state[edge_no], op_start_cycle + operation_duration);
                     for(auto & e : edge2edges[edge_no])
                     {
-                        state[e] = op_start_cycle + operation_duration;
+                        set(state[e], op_start_cycle + operation_duration);
                     }
                 }
                 else
                 {
-                    state[edge_no] = op_start_cycle;
+                    set(state[edge_no], op_start_cycle);
                     for(auto & e : edge2edges[edge_no])
                     {
-                        state[e] = op_start_cycle;
+                        set(state[e], op_start_cycle);
                     }
                 }
                 DOUT("reserved " << name << ". op_start_cycle: " << op_start_cycle << " edge: " << edge_no << " reserved till cycle: " << state[ edge_no ] << " for operation: " << ins->name);
@@ -559,14 +683,19 @@ public:
 
     std::vector<size_t> fromcycle;                              // qubit q is busy from cycle fromcycle[q]
     std::vector<size_t> tocycle;                                // till cycle tocycle[q]
-    std::vector<std::string> operations;                        // with an operation of operation_type==operations[q]
+    std::vector<size_t> operations;                             // with an operation of operation_type==operations[q]
 
     typedef std::pair<size_t,size_t> qubits_pair_t;
-    std::map< qubits_pair_t, size_t > qubitpair2edge;           // map: pair of qubits to edge (from grid configuration)
-    std::map<size_t, std::vector<size_t> > edge_detunes_qubits; // map: edge to vector of qubits that edge detunes (resource desc.)
-
-    ccl_detuned_qubits_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir) : 
-        resource_t("detuned_qubits", dir)
+    struct tables_t                                             // constant tables, shared by copies
+    {
+        std::map< qubits_pair_t, size_t > qubitpair2edge;       // map: pair of qubits to edge (from grid configuration)
+        std::vector< std::vector<size_t> > edge_detunes_qubits; // edge to vector of qubits that edge detunes (resource desc.)
+    };
+    std::shared_ptr<const tables_t> tables;
+    std::shared_ptr<const ccl_operations_t> ops;                // attributes of the instructions
+
+    ccl_detuned_qubits_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const ccl_operations_t> operations_attributes) :
+        resource_t("detuned_qubits", dir), ops(operations_attributes)
     {
         // DOUT("... creating " << name << " resource");
         count = platform.resources[name]["count"];
@@ -579,9 +708,13 @@ public:
         {
             fromcycle[i] = (forward_scheduling == dir ? 0 : MAX_CYCLE);
             tocycle[i] = (forward_scheduling == dir ? 0 : MAX_CYCLE);
-            operations[i] = "";
+            operations[i] = ccl_type_other;
         }
 
+        std::shared_ptr<tables_t> t = std::make_shared<tables_t>();
+        auto & qubitpair2edge = t->qubitpair2edge;
+        auto & edge_detunes_qubits = t->edge_detunes_qubits;
+
         // initialize qubitpair2edge map from json description; this is a constant map
         for(auto & anedge : platform.topology["edges"])
         {
@@ -609,20 +742,28 @@ public:
             // COUT(it.key() << " : " << it.value() << "\n");
             size_t edgeNo = stoi( it.key() );
             auto & detuned_qubits = it.value();
+            if (edgeNo >= edge_detunes_qubits.size()) edge_detunes_qubits.resize(edgeNo+1);
             for(auto & q : detuned_qubits)
                 edge_detunes_qubits[edgeNo].push_back(q);
         }
+        for (auto & e : qubitpair2edge)
+        {
+            if (e.second >= edge_detunes_qubits.size()) edge_detunes_qubits.resize(e.second+1);
+        }
+        tables = t;
     }
 
     // When a two-qubit flux gate, check whether the qubits it would detune are not busy with a rotation.
     // When a one-qubit rotation, check whether the qubit is not detuned (busy with a flux gate).
     bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
+        const ccl_operation_t & op = ops->get(ins, platform);
+        ccl_operation_type_t operation_type = op.type;
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
+        const auto & qubitpair2edge = tables->qubitpair2edge;
+        const auto & edge_detunes_qubits = tables->edge_detunes_qubits;
 
-        auto gname = ins->name;
-        bool is_flux = (operation_type == "flux");
+        bool is_flux = (operation_type == ccl_type_flux);
         if( is_flux )
         {
             auto nopers = ins->operands.size();
@@ -639,7 +780,7 @@ public:
             	auto it = qubitpair2edge.find(aqpair);
             	if( it != qubitpair2edge.end() )
             	{
-                    auto edge_no = qubitpair2edge[aqpair];
+                    auto edge_no = it->second;
 
                     for( auto & q : edge_detunes_qubits[edge_no])
                     {
@@ -676,7 +817,7 @@ public:
             }
         }
 
-        bool is_mw = (operation_type == "mw");
+        bool is_mw = (operation_type == ccl_type_mw);
         if ( is_mw )
         {
             for( auto q : ins->operands )
@@ -718,11 +859,13 @@ public:
     // A one-qubit rotation gate must set its operand qubit to busy, busy with a rotation.
     void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
     {
-        std::string operation_type = ccl_get_operation_type(ins, platform);
+        const ccl_operation_t & op = ops->get(ins, platform);
+        ccl_operation_type_t operation_type = op.type;
         size_t      operation_duration = ccl_get_operation_duration(ins, platform);
+        const auto & qubitpair2edge = tables->qubitpair2edge;
+        const auto & edge_detunes_qubits = tables->edge_detunes_qubits;
 
-        auto gname = ins->name;
-        bool is_flux = (operation_type == "flux");
+        bool is_flux = (operation_type == ccl_type_flux);
         if( is_flux )
         {
             auto nopers = ins->operands.size();
@@ -735,7 +878,7 @@ public:
                 auto q0 = ins->operands[0];
                 auto q1 = ins->operands[1];
                 qubits_pair_t aqpair(q0, q1);
-                auto edge_no = qubitpair2edge[aqpair];
+                auto edge_no = qubitpair2edge.at(aqpair);
 
                 for(auto & q : edge_detunes_qubits[edge_no])
                 {
@@ -743,14 +886,14 @@ public:
                     {
                         if (operations[q] == operation_type)
                         {
-                            tocycle[q] = std::max( tocycle[q], op_start_cycle + operation_duration);
+                            set(tocycle[q], std::max( tocycle[q], op_start_cycle + operation_duration));
                             DOUT("reserving " << name << ". for qubit: " << q << " reusing cycle: " << fromcycle[q] << " to extending tocycle: " << tocycle[q] << " for old operation: " << ins->name);
                         }
                         else
                         {
-                            fromcycle[q] = op_start_cycle;
-                            tocycle[q] = op_start_cycle + operation_duration;
-                            operations[q] = operation_type;
+                            set(fromcycle[q], op_start_cycle);
+                            set(tocycle[q], op_start_cycle + operation_duration);
+                            set(operations[q], operation_type);
                             DOUT("reserving " << name << ". for qubit: " << q << " from fromcycle: " << fromcycle[q] << " to new tocycle: " << tocycle[q] << " for new operation: " << ins->name);
                         }
                     }
@@ -758,14 +901,14 @@ public:
                     {
                         if (operations[q] == operation_type)
                         {
-                            fromcycle[q] = std::min( fromcycle[q], op_start_cycle);
+                            set(fromcycle[q], std::min( fromcycle[q], op_start_cycle));
                             DOUT("reserving " << name << ". for qubit: " << q << " from extended cycle: " << fromcycle[q] << " reusing tocycle: " << tocycle[q] << " for old operation: " << ins->name);
                         }
                         else
                         {
-                            fromcycle[q] = op_start_cycle;
-                            tocycle[q] = op_start_cycle + operation_duration;
-                            operations[q] = operation_type;
+                            set(fromcycle[q], op_start_cycle);
+                            set(tocycle[q], op_start_cycle + operation_duration);
+                            set(operations[q], operation_type);
                             DOUT("reserving " << name << ". for qubit: " << q << " from new cycle: " << fromcycle[q] << " to tocycle: " << tocycle[q] << " for new operation: " << ins->name);
                         }
                     }
@@ -777,7 +920,7 @@ public:
                 FATAL("Incorrect number of operands used in operation: " << ins->name << " !");
             }
         }
-        bool is_mw = (operation_type == "mw");
+        bool is_mw = (operation_type == ccl_type_mw);
         if ( is_mw )
         {
             for( auto q : ins->operands )
@@ -786,14 +929,14 @@ public:
                 {
                     if (operations[q] == operation_type)
                     {
-                        tocycle[q] = std::max( tocycle[q], op_start_cycle + operation_duration);
+                        set(tocycle[q], std::max( tocycle[q], op_start_cycle + operation_duration));
                         DOUT("reserving " << name << ". for qubit: " << q << " reusing cycle: " << fromcycle[q] << " to extending tocycle: " << tocycle[q] << " for old operation: " << ins->name);
                     }
                     else
                     {
-                        fromcycle[q] = op_start_cycle;
-                        tocycle[q] = op_start_cycle + operation_duration;
-                        operations[q] = operation_type;
+                        set(fromcycle[q], op_start_cycle);
+                        set(tocycle[q], op_start_cycle + operation_duration);
+                        set(operations[q], operation_type);
                         DOUT("reserving " << name << ". for qubit: " << q << " from fromcycle: " << fromcycle[q] << " to new tocycle: " << tocycle[q] << " for new operation: " << ins->name);
                     }
                 }
@@ -801,14 +944,14 @@ public:
                 {
                     if (operations[q] == operation_type)
                     {
-                        fromcycle[q] = std::min( fromcycle[q], op_start_cycle);
+                        set(fromcycle[q], std::min( fromcycle[q], op_start_cycle));
                         DOUT("reserving " << name << ". for qubit: " << q << " from extended cycle: " << fromcycle[q] << " reusing tocycle: " << tocycle[q] << " for old operation: " << ins->name);
                     }
                     else
                     {
-                        fromcycle[q] = op_start_cycle;
-                        tocycle[q] = op_start_cycle + operation_duration;
-                        operations[q] = operation_type;
+                        set(fromcycle[q], op_start_cycle);
+                        set(tocycle[q], op_start_cycle + operation_duration);
+                        set(operations[q], operation_type);
                         DOUT("reserving " << name << ". for qubit: " << q << " from new cycle: " << fromcycle[q] << " to tocycle: " << tocycle[q] << " for new operation: " << ins->name);
                     }
                 }
@@ -821,6 +964,281 @@ public:
 
 
 
+// ============ resources that fill gaps
+// With option scheduler_gapfill, the resources keep their occupation as sets of busy intervals per unit
+// (see occupancy_t) instead of the single busy window per unit of the resources above,
+// so that a gate can be reserved in a gap before gates that were reserved earlier.
+// They extend the resources above, for their constant tables; their constraints are the same,
+// but independent of the direction of scheduling, and reserving never extends the busy time of a unit
+// beyond what the gate itself uses. The state vectors of the resources above are not used.
+
+class ccl_qubit_gapfill_resource_t : public ccl_qubit_resource_t
+{
+public:
+    ccl_qubit_gapfill_resource_t* clone() const & { DOUT("Cloning/copying ccl_qubit_gapfill_resource_t"); return new ccl_qubit_gapfill_resource_t(*this);}
+    ccl_qubit_gapfill_resource_t* clone() && { DOUT("Cloning/moving ccl_qubit_gapfill_resource_t"); return new ccl_qubit_gapfill_resource_t(std::move(*this)); }
+
+    ccl_qubit_gapfill_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir) : ccl_qubit_resource_t(platform, dir)
+    {
+        occupancy.init(count);
+    }
+
+    bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+        for( auto q : ins->operands )
+        {
+            if (!occupancy.available(q, op_start_cycle, op_end_cycle, 0))
+            {
+                DOUT("    " << name << " resource busy for qubit: " << q << " in cycles: " << op_start_cycle << ".." << op_end_cycle);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+        for( auto q : ins->operands )
+        {
+            occupancy.reserve(q, op_start_cycle, op_end_cycle, 0);
+        }
+    }
+};
+
+// gates on qubits of the same qwg may overlap when they are the same operation
+class ccl_qwg_gapfill_resource_t : public ccl_qwg_resource_t
+{
+public:
+    ccl_qwg_gapfill_resource_t* clone() const & { DOUT("Cloning/copying ccl_qwg_gapfill_resource_t"); return new ccl_qwg_gapfill_resource_t(*this);}
+    ccl_qwg_gapfill_resource_t* clone() && { DOUT("Cloning/moving ccl_qwg_gapfill_resource_t"); return new ccl_qwg_gapfill_resource_t(std::move(*this)); }
+
+    ccl_qwg_gapfill_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const ccl_operations_t> operations_attributes) :
+        ccl_qwg_resource_t(platform, dir, operations_attributes)
+    {
+        occupancy.init(count);
+    }
+
+    bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        const ccl_operation_t & op = ops->get(ins, platform);
+        if (op.type == ccl_type_mw)
+        {
+            size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+            for( auto q : ins->operands )
+            {
+                size_t qwg = (*qubit2qwg)[q];
+                if (!occupancy.available(qwg, op_start_cycle, op_end_cycle, op.name_id))
+                {
+                    DOUT("    " << name << " resource busy for qwg: " << qwg << " in cycles: " << op_start_cycle << ".." << op_end_cycle);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        const ccl_operation_t & op = ops->get(ins, platform);
+        if (op.type == ccl_type_mw)
+        {
+            size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+            for( auto q : ins->operands )
+            {
+                occupancy.reserve((*qubit2qwg)[q], op_start_cycle, op_end_cycle, op.name_id);
+            }
+        }
+    }
+};
+
+// measurements on qubits of the same measurement unit may overlap when they start in the same cycle
+class ccl_meas_gapfill_resource_t : public ccl_meas_resource_t
+{
+public:
+    ccl_meas_gapfill_resource_t* clone() const & { DOUT("Cloning/copying ccl_meas_gapfill_resource_t"); return new ccl_meas_gapfill_resource_t(*this);}
+    ccl_meas_gapfill_resource_t* clone() && { DOUT("Cloning/moving ccl_meas_gapfill_resource_t"); return new ccl_meas_gapfill_resource_t(std::move(*this)); }
+
+    ccl_meas_gapfill_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const ccl_operations_t> operations_attributes) :
+        ccl_meas_resource_t(platform, dir, operations_attributes)
+    {
+        occupancy.init(count);
+    }
+
+    bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        const ccl_operation_t & op = ops->get(ins, platform);
+        if (op.type == ccl_type_readout)
+        {
+            size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+            for( auto q : ins->operands )
+            {
+                size_t meas = (*qubit2meas)[q];
+                if (!occupancy.available(meas, op_start_cycle, op_end_cycle, op_start_cycle + 1))
+                {
+                    DOUT("    " << name << " resource busy for meas: " << meas << " in cycles: " << op_start_cycle << ".." << op_end_cycle);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        const ccl_operation_t & op = ops->get(ins, platform);
+        if (op.type == ccl_type_readout)
+        {
+            size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+            for( auto q : ins->operands )
+            {
+                occupancy.reserve((*qubit2meas)[q], op_start_cycle, op_end_cycle, op_start_cycle + 1);
+            }
+        }
+    }
+};
+
+// a two-qubit flux gate occupies its edge and the edges related to it
+class ccl_edge_gapfill_resource_t : public ccl_edge_resource_t
+{
+public:
+    ccl_edge_gapfill_resource_t* clone() const & { DOUT("Cloning/copying ccl_edge_gapfill_resource_t"); return new ccl_edge_gapfill_resource_t(*this);}
+    ccl_edge_gapfill_resource_t* clone() && { DOUT("Cloning/moving ccl_edge_gapfill_resource_t"); return new ccl_edge_gapfill_resource_t(std::move(*this)); }
+
+    ccl_edge_gapfill_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const ccl_operations_t> operations_attributes) :
+        ccl_edge_resource_t(platform, dir, operations_attributes)
+    {
+        occupancy.init(state.size());
+    }
+
+    // the edge of a two-qubit flux gate, or MAX_CYCLE when it doesn't use one
+    size_t flux_edge(ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        const ccl_operation_t & op = ops->get(ins, platform);
+        if (op.type != ccl_type_flux || ins->operands.size() == 1)
+        {
+            return MAX_CYCLE;
+        }
+        if (ins->operands.size() != 2)
+        {
+            FATAL("Incorrect number of operands used in operation: " << ins->name << " !");
+        }
+        auto it = tables->qubits2edge.find(qubits_pair_t(ins->operands[0], ins->operands[1]));
+        if (it == tables->qubits2edge.end())
+        {
+            FATAL("Use of illegal edge: " << ins->operands[0] << "->" << ins->operands[1] << " in operation: " << ins->name << " !");
+        }
+        return it->second;
+    }
+
+    bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        size_t edge_no = flux_edge(ins, platform);
+        if (edge_no != MAX_CYCLE)
+        {
+            size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+            auto & related_edges = tables->edge2edges[edge_no];
+            for(size_t i = 0; i <= related_edges.size(); i++)
+            {
+                size_t e = (i < related_edges.size() ? related_edges[i] : edge_no);
+                if (!occupancy.available(e, op_start_cycle, op_end_cycle, 0))
+                {
+                    DOUT("    " << name << " resource busy for edge: " << e << " in cycles: " << op_start_cycle << ".." << op_end_cycle);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        size_t edge_no = flux_edge(ins, platform);
+        if (edge_no != MAX_CYCLE)
+        {
+            size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+            occupancy.reserve(edge_no, op_start_cycle, op_end_cycle, 0);
+            for(auto e : tables->edge2edges[edge_no])
+            {
+                occupancy.reserve(e, op_start_cycle, op_end_cycle, 0);
+            }
+        }
+    }
+};
+
+// a qubit detuned by two-qubit flux gates may be so for several of those at the same time,
+// and can be busy with several rotations at the same time, but not with both
+class ccl_detuned_qubits_gapfill_resource_t : public ccl_detuned_qubits_resource_t
+{
+public:
+    ccl_detuned_qubits_gapfill_resource_t* clone() const & { DOUT("Cloning/copying ccl_detuned_qubits_gapfill_resource_t"); return new ccl_detuned_qubits_gapfill_resource_t(*this);}
+    ccl_detuned_qubits_gapfill_resource_t* clone() && { DOUT("Cloning/moving ccl_detuned_qubits_gapfill_resource_t"); return new ccl_detuned_qubits_gapfill_resource_t(std::move(*this)); }
+
+    ccl_detuned_qubits_gapfill_resource_t(const ql::quantum_platform & platform, scheduling_direction_t dir, std::shared_ptr<const ccl_operations_t> operations_attributes) :
+        ccl_detuned_qubits_resource_t(platform, dir, operations_attributes)
+    {
+        occupancy.init(count);
+    }
+
+    // the qubits that the gate occupies: those detuned by a two-qubit flux gate, or the operands of a rotation
+    const std::vector<size_t> * occupied_qubits(ql::gate * ins, const ccl_operation_t & op)
+    {
+        if (op.type == ccl_type_mw)
+        {
+            return &ins->operands;
+        }
+        if (op.type != ccl_type_flux || ins->operands.size() == 1)
+        {
+            return nullptr;
+        }
+        if (ins->operands.size() != 2)
+        {
+            FATAL("Incorrect number of operands used in operation: " << ins->name << " !");
+        }
+        auto it = tables->qubitpair2edge.find(qubits_pair_t(ins->operands[0], ins->operands[1]));
+        if (it == tables->qubitpair2edge.end())
+        {
+            FATAL("Use of illegal edge: " << ins->operands[0] << "->" << ins->operands[1] << " in operation: " << ins->name << " !");
+        }
+        return &tables->edge_detunes_qubits[it->second];
+    }
+
+    bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        const ccl_operation_t & op = ops->get(ins, platform);
+        const std::vector<size_t> * qubits = occupied_qubits(ins, op);
+        if (qubits)
+        {
+            size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+            for( auto q : *qubits )
+            {
+                if (!occupancy.available(q, op_start_cycle, op_end_cycle, op.type))
+                {
+                    DOUT("    " << name << " resource busy for qubit: " << q << " in cycles: " << op_start_cycle << ".." << op_end_cycle);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    {
+        const ccl_operation_t & op = ops->get(ins, platform);
+        const std::vector<size_t> * qubits = occupied_qubits(ins, op);
+        if (qubits)
+        {
+            size_t      op_end_cycle = op_start_cycle + ccl_get_operation_duration(ins, platform);
+            for( auto q : *qubits )
+            {
+                occupancy.reserve(q, op_start_cycle, op_end_cycle, op.type);
+            }
+        }
+    }
+};
+
+
 // ============ platform specific resource_manager matching config file resources sections with resource classes above
 // each config file resources section must have a resource class above
 // not all resource classes above need to be actually used and specified in a config file; only those specified, are used
@@ -839,10 +1257,12 @@ public:
     // Allocate those resources that were specified in the config file.
     // Those that are not specified, are not allocatd, so are not used in scheduling/mapping.
     // The resource names tested below correspond to the names of the resources sections in the config file.
-    cc_light_resource_manager_t(const ql::quantum_platform & platform, scheduling_direction_t dir) : platform_resource_manager_t(platform, dir)
+    // With gapfill, the resources that fill gaps are allocated (see above).
+    cc_light_resource_manager_t(const ql::quantum_platform & platform, scheduling_direction_t dir, bool gapfill = false) : platform_resource_manager_t(platform, dir)
     {
         DOUT("Constructing (platform,dir) parameterized platform_resource_manager_t");
         DOUT("New one for direction " << dir << " with no of resources : " << platform.resources.size() );
+        std::shared_ptr<const ccl_operations_t> ops = std::make_shared<const ccl_operations_t>(platform);
         for (json::const_iterator it = platform.resources.begin(); it != platform.resources.end(); ++it)
         {
             // COUT(it.key() << " : " << it.value() << "\n");
@@ -851,27 +1271,27 @@ public:
             // DOUT("... about to create " << n << " resource");
             if( n == "qubits")
             {
-                resource_t * ares = new ccl_qubit_resource_t(platform, dir);
+                resource_t * ares = (gapfill ? new ccl_qubit_gapfill_resource_t(platform, dir) : new ccl_qubit_resource_t(platform, dir));
                 resource_ptrs.push_back( ares );
             }
             else if( n == "qwgs")
             {
-                resource_t * ares = new ccl_qwg_resource_t(platform, dir);
+                resource_t * ares = (gapfill ? new ccl_qwg_gapfill_resource_t(platform, dir, ops) : new ccl_qwg_resource_t(platform, dir, ops));
                 resource_ptrs.push_back( ares );
             }
             else if( n == "meas_units")
             {
-                resource_t * ares = new ccl_meas_resource_t(platform, dir);
+                resource_t * ares = (gapfill ? new ccl_meas_gapfill_resource_t(platform, dir, ops) : new ccl_meas_resource_t(platform, dir, ops));
                 resource_ptrs.push_back( ares );
             }
             else if( n == "edges")
             {
-                resource_t * ares = new ccl_edge_resource_t(platform, dir);
+                resource_t * ares = (gapfill ? new ccl_edge_gapfill_resource_t(platform, dir, ops) : new ccl_edge_resource_t(platform, dir, ops));
                 resource_ptrs.push_back( ares );
             }
             else if( n == "detuned_qubits")
             {
-                resource_t * ares = new ccl_detuned_qubits_resource_t(platform, dir);
+                resource_t * ares = (gapfill ? new ccl_detuned_qubits_gapfill_resource_t(platform, dir, ops) : new ccl_detuned_qubits_resource_t(platform, dir, ops));
                 resource_ptrs.push_back( ares );
             }
             else
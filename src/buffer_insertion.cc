@@ -12,6 +12,7 @@
 #include "circuit.h"
 #include "ir.h"
 #include "report.h"
+#include "parallel.h"
 
 #include "buffer_insertion.h"
 
@@ -66,21 +67,18 @@ namespace ql
         for(ql::ir::bundle_t & abundle : bundles)
         {
             std::vector<std::string> operations_curr_bundle;
-            for( auto secIt = abundle.parallel_sections.begin(); secIt != abundle.parallel_sections.end(); ++secIt )
+            for (auto gp : bundles.gates_of(abundle))
             {
-                for(auto insIt = secIt->begin(); insIt != secIt->end(); ++insIt )
+                auto & id = gp->name;
+                std::string op_type("none");
+                if(platform.instruction_settings.count(id) > 0)
                 {
-                    auto & id = (*insIt)->name;
-                    std::string op_type("none");
-                    if(platform.instruction_settings.count(id) > 0)
+                    if(platform.instruction_settings[id].count("type") > 0)
                     {
-                        if(platform.instruction_settings[id].count("type") > 0)
-                        {
-                            op_type = platform.instruction_settings[id]["type"].get<std::string>();
-                        }
+                        op_type = platform.instruction_settings[id]["type"].get<std::string>();
                     }
-                    operations_curr_bundle.push_back(op_type);
                 }
+                operations_curr_bundle.push_back(op_type);
             }
 
             size_t buffer_cycles = 0;
@@ -109,10 +107,10 @@ namespace ql
         ql::report_statistics(programp, platform, "in", passname, "# ");
         ql::report_qasm(programp, platform, "in", passname);
 
-        for (size_t k=0; k<programp->kernels.size(); ++k)
+        ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
         {
             insert_buffer_delays_kernel(programp->kernels[k], platform);
-        }
+        });
 
         ql::report_statistics(programp, platform, "out", passname, "# ");
         ql::report_qasm(programp, platform, "out", passname);
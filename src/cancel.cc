@@ -0,0 +1,364 @@
+/**
+ * @file   cancel.cc
+ * @brief  cancellation of pairs of inverse gates across commuting gates
+ * @date   10/2026
+ */
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+#include "utils.h"
+#include "circuit.h"
+#include "report.h"
+#include "kernel.h"
+#include "parallel.h"
+
+#include "cancel.h"
+
+
+namespace ql
+{
+class Cancel
+{
+public:
+
+    void cancel_kernel(ql::quantum_kernel& kernel, const ql::quantum_platform & platform, std::string passname)
+    {
+        DOUT("Cancel " << passname << " on kernel " << kernel.name << " ...");
+
+        /*
+        A gate g cancels an earlier gate p when p is the inverse of g, on the same qubits,
+        and g commutes with all gates on those qubits in between.
+
+        For commutation, each gate uses each of its qubit operands in one of the following ways:
+        - R:    the qubit is only read in the Z basis, i.e. the gate is diagonal in the Z basis on it;
+                these gates commute on the qubit
+        - D:    the gate is diagonal in the X basis on the qubit; these gates commute on the qubit
+        - W:    in any other way; such a gate doesn't commute on the qubit with any other gate
+        Two gates commute when they use each qubit that they share in the same way R or D.
+        How a gate uses its operands follows from its signature (see gate.h), as in the scheduler (see scheduler.h),
+        which may be set by the "signature" attribute of its instruction in the platform configuration file:
+        a gate with the cz signature Reads all its operands, and one with the cnot signature Reads its first operand
+        and Ds its other operands; gates with other signatures Write their operands.
+        Unlike the scheduler, a single-qubit gate with the default signature that is a Z or X rotation
+        Reads or Ds its operand (see single_qubit_use), so that e.g. a z commutes with a cz.
+        Gates without operands and gates with the display signature are a barrier on all qubits.
+
+        So while scanning the circuit, keep per qubit a stack of segments,
+        each being a maximal sequence of (remaining) gates using the qubit in the same way;
+        for W uses, each gate forms a segment of its own.
+        The gates in the last segment of qubit q all commute on q with a new gate that uses q in that way.
+        So a new gate g cancels an earlier gate p when p is the inverse of g
+        and p is in the last segment of each qubit of g.
+        Then both are removed; the segments left empty by this are popped,
+        so that the gates before them become candidates for cancellation again, as in h; cz; cz; h.
+        The last segment of a qubit keeps its gates by the id of their inverse and their qubits (see key_t),
+        so that finding a candidate for cancellation takes constant time.
+        */
+        nq = kernel.qubit_count;
+        segments.clear();
+        segments.resize(nq);
+        segids.clear();
+        segids.resize(kernel.c.size());
+        next_segid = 0;
+
+        std::vector<bool> removed(kernel.c.size(), false);
+        size_t ncancelled = 0;
+        for (size_t i = 0; i < kernel.c.size(); i++)
+        {
+            ql::gate * gp = kernel.c[i];
+            if (gp->operands.empty() || gp->signature == __display_signature__)
+            {
+                // classical gates and quantum gates like wait/display without operands
+                // are a barrier on all qubits
+                for (size_t q = 0; q < nq; q++)
+                {
+                    push(q, __w__, i);
+                }
+                continue;
+            }
+
+            std::vector<use_t> uses;
+            key_t gkey;
+            key_t ikey;
+            bool cancellable = keys(gp, uses, gkey, ikey);
+            const std::vector<size_t> & qubits = gkey.qubits;
+
+            size_t p;
+            if (cancellable && find(ikey, p))
+            {
+                DOUT("... cancel " << kernel.c[p]->qasm() << " with " << gp->qasm());
+                remove(ikey);
+                removed[p] = true;
+                removed[i] = true;
+                ncancelled++;
+                continue;
+            }
+            for (size_t j = 0; j < qubits.size(); j++)
+            {
+                size_t q = qubits[j];
+                if (!segments[q].empty() && uses[j] != __w__ && segments[q].back().use == uses[j])
+                {
+                    segments[q].back().live++;
+                    segids[i].push_back(segments[q].back().id);
+                }
+                else
+                {
+                    push(q, uses[j], i);
+                }
+            }
+            if (cancellable)
+            {
+                segments[qubits[0]].back().gates[gkey].push_back(i);
+            }
+        }
+
+        if (ncancelled != 0)
+        {
+            ql::circuit output_circuit;
+            for (size_t i = 0; i < kernel.c.size(); i++)
+            {
+                if (!removed[i])
+                {
+                    output_circuit.push_back(kernel.c[i]);
+                }
+            }
+            kernel.c = output_circuit;
+            kernel.cycles_valid = false;
+        }
+
+        DOUT("Cancel " << passname << " on kernel " << kernel.name << " cancelled " << ncancelled << " pairs of gates [DONE]");
+    }
+
+private:
+    typedef enum { __r__, __d__, __w__ } use_t;
+
+    // a gate that can be cancelled, by the interned id of its canonical name (see cancellable) and its qubits,
+    // which are sorted when its operands can be swapped
+    struct key_t
+    {
+        size_t              id;
+        std::vector<size_t> qubits;
+
+        bool operator==(const key_t & other) const
+        {
+            return id == other.id && qubits == other.qubits;
+        }
+    };
+
+    struct key_hash
+    {
+        size_t operator()(const key_t & key) const
+        {
+            // FNV-1a over the id and the qubits, as in instruction_table_t
+            uint64_t h = (14695981039346656037ULL ^ (uint64_t) key.id) * 1099511628211ULL;
+            for (auto q : key.qubits)
+            {
+                h = (h ^ (uint64_t) q) * 1099511628211ULL;
+            }
+            return (size_t) h;
+        }
+    };
+
+    struct segment_t
+    {
+        use_t   use;                // how the gates in the segment use the qubit
+        size_t  id;                 // unique id of the segment
+        size_t  live;               // number of gates in the segment that were not cancelled
+        std::unordered_map<key_t, std::vector<size_t>, key_hash> gates;  // indices of gates in the segment by their key,
+                                    // for gates of which this qubit is the first qubit in the key
+    };
+
+    // how a gate can be cancelled: the ids of its canonical name and of that of its inverse,
+    // and whether its operands can be swapped
+    struct inverse_t
+    {
+        size_t  id;
+        size_t  iid;
+        bool    symmetric;
+    };
+
+    size_t  nq;
+    std::vector<std::vector<segment_t>> segments;       // stack of segments per qubit
+    std::vector<std::vector<size_t>>    segids;         // per gate, the id of its segment per qubit operand, in key order
+    size_t  next_segid;
+
+    // push a new segment on qubit q with gate i in it
+    void push(size_t q, use_t use, size_t i)
+    {
+        segment_t s;
+        s.use = use;
+        s.id = next_segid++;
+        s.live = 1;
+        segments[q].push_back(s);
+        segids[i].push_back(s.id);
+    }
+
+    // the name of a gate without operands, as in "cz q0,q1"
+    static std::string base_name(const std::string& name)
+    {
+        return name.substr(0, name.find(' '));
+    }
+
+    // how the gate with the given name can be cancelled, or nullptr when it cannot be cancelled
+    static const inverse_t * cancellable(const std::string& name)
+    {
+        static const std::unordered_map<std::string, inverse_t> table = inverse_table();
+        auto it = table.find(name);
+        return (it == table.end() ? nullptr : &it->second);
+    }
+
+    // the inverse_t of each name of a gate that can be cancelled;
+    // the inverse of the inverse of a name is the canonical name of the gate itself, e.g. cz for cphase
+    // and mx90 for xm90, which are different names of the same gate in different platforms
+    static std::unordered_map<std::string, inverse_t> inverse_table()
+    {
+        const std::unordered_map<std::string, std::string> inverses = {
+            {"cnot", "cnot"}, {"cz", "cz"}, {"cphase", "cz"}, {"swap", "swap"},
+            {"x", "x"}, {"pauli_x", "x"}, {"x180", "x"}, {"rx180", "x"},
+            {"y", "y"}, {"pauli_y", "y"}, {"y180", "y"}, {"ry180", "y"},
+            {"z", "z"}, {"pauli_z", "z"}, {"h", "h"}, {"hadamard", "h"},
+            {"x90", "mx90"}, {"mx90", "x90"}, {"xm90", "x90"}, {"rx90", "mrx90"}, {"mrx90", "rx90"},
+            {"y90", "my90"}, {"my90", "y90"}, {"ym90", "y90"}, {"ry90", "mry90"}, {"mry90", "ry90"},
+            {"x45", "xm45"}, {"xm45", "x45"}, {"y45", "ym45"}, {"ym45", "y45"},
+            {"s", "sdag"}, {"sdag", "s"}, {"t", "tdag"}, {"tdag", "t"}
+        };
+        std::unordered_map<std::string, size_t> ids;
+        auto intern = [&ids](const std::string & cname)
+        {
+            return ids.insert(std::make_pair(cname, ids.size())).first->second;
+        };
+        std::unordered_map<std::string, inverse_t> table;
+        for (auto & inv : inverses)
+        {
+            const std::string & iname = inv.second;
+            const std::string & cname = inverses.at(iname);
+            table[inv.first] = inverse_t{intern(cname), intern(iname), iname == "cz" || iname == "swap"};
+        }
+        return table;
+    }
+
+    // the use of the operand of a single-qubit gate with the default signature, by its name:
+    // Z rotations Read it and X rotations D it; the scheduler doesn't distinguish these
+    // and lets all gates with the default signature Write their operands
+    static use_t single_qubit_use(const std::string& name)
+    {
+        static const std::unordered_map<std::string, use_t> uses = {
+            {"z", __r__}, {"pauli_z", __r__}, {"s", __r__}, {"sdag", __r__}, {"t", __r__}, {"tdag", __r__}, {"rz", __r__},
+            {"x", __d__}, {"pauli_x", __d__}, {"x180", __d__}, {"rx180", __d__},
+            {"x90", __d__}, {"mx90", __d__}, {"xm90", __d__}, {"rx90", __d__}, {"mrx90", __d__},
+            {"x45", __d__}, {"xm45", __d__}, {"rx", __d__}
+        };
+        auto it = uses.find(name);
+        return (it == uses.end() ? __w__ : it->second);
+    }
+
+    // how gate gp uses each of its qubit operands in key order, the keys of the gate and of its inverse,
+    // and whether it can be cancelled; when it cannot, only the qubits of the keys are set
+    bool keys(ql::gate* gp, std::vector<use_t>& uses, key_t& gkey, key_t& ikey)
+    {
+        std::string name = base_name(gp->name);
+        const inverse_t * inv = (gp->creg_operands.empty() ? cancellable(name) : nullptr);
+
+        std::vector<size_t> & qubits = gkey.qubits;
+        qubits = gp->operands;
+        if (inv && inv->symmetric)
+        {
+            std::sort(qubits.begin(), qubits.end());
+        }
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            use_t use = __w__;
+            switch (gp->signature)
+            {
+            case __cz_signature__:
+                use = __r__;
+                break;
+            case __cnot_signature__:
+                use = (gp->operands[0] == qubits[j] ? __r__ : __d__);
+                break;
+            case __default_signature__:
+                use = (gp->operands.size() == 1 && gp->creg_operands.empty() ? single_qubit_use(name) : __w__);
+                break;
+            default:
+                break;
+            }
+            uses.push_back(use);
+        }
+
+        if (!inv)
+        {
+            return false;
+        }
+        gkey.id = inv->id;
+        ikey.id = inv->iid;
+        ikey.qubits = qubits;
+        return true;
+    }
+
+    // find the gate p with key ikey that is in the last segment of each of its qubits;
+    // return whether there is one
+    bool find(const key_t& ikey, size_t& p)
+    {
+        const std::vector<size_t> & qubits = ikey.qubits;
+        if (segments[qubits[0]].empty())
+        {
+            return false;
+        }
+        auto & gates = segments[qubits[0]].back().gates;
+        auto it = gates.find(ikey);
+        if (it == gates.end() || it->second.empty())
+        {
+            return false;
+        }
+        size_t candidate = it->second.back();
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            if (segments[qubits[j]].empty() || segments[qubits[j]].back().id != segids[candidate][j])
+            {
+                return false;
+            }
+        }
+        p = candidate;
+        return true;
+    }
+
+    // remove the last gate with key pkey from the last segments of its qubits
+    // and pop the segments that are left without gates
+    void remove(const key_t& pkey)
+    {
+        segments[pkey.qubits[0]].back().gates[pkey].pop_back();
+        for (auto q : pkey.qubits)
+        {
+            segments[q].back().live--;
+            while (!segments[q].empty() && segments[q].back().live == 0)
+            {
+                segments[q].pop_back();
+            }
+        }
+    }
+};	// class Cancel
+
+
+    void cancel_gates(quantum_program* programp, const ql::quantum_platform& platform, std::string passname)
+    {
+        if (ql::options::get(passname) == "no")
+        {
+            DOUT("Cancellation on program " << programp->name << " at " << passname << " not DONE");
+            return;
+        }
+        DOUT("Cancellation on program " << programp->name << " at " << passname << " ...");
+
+        ql::report_statistics(programp, platform, "in", passname, "# ");
+        ql::report_qasm(programp, platform, "in", passname);
+
+        ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
+        {
+            Cancel cancel;
+            cancel.cancel_kernel(programp->kernels[k], platform, passname);
+        });
+
+        ql::report_statistics(programp, platform, "out", passname, "# ");
+        ql::report_qasm(programp, platform, "out", passname);
+    }
+}
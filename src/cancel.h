@@ -0,0 +1,23 @@
+/**
+ * @file   cancel.h
+ * @date   10/2026
+ * @brief  cancellation of pairs of inverse gates across commuting gates
+ */
+#ifndef CANCEL_H
+#define CANCEL_H
+
+#include "program.h"
+#include "platform.h"
+
+
+namespace ql
+{
+
+/*
+ * cancellation of pairs of inverse gates, e.g. cnot;cnot and cz;cz on the same qubits,
+ * also when separated by gates with which they commute
+ */
+    void cancel_gates(quantum_program* programp, const ql::quantum_platform& platform, std::string passname);
+}
+
+#endif // CANCEL_H
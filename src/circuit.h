@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <iostream>
+#include <sstream>
 
 #include "gate.h"
 
@@ -21,10 +22,12 @@ namespace ql
 
     inline void print(circuit& c)
     {
-        std::cout << "-------------------" << std::endl;
+        std::stringstream ss;
+        ss << "-------------------" << std::endl;
         for (size_t i=0; i<c.size(); i++)
-        	std::cout << "   " << c[i]->qasm() << std::endl;
-        std::cout << "\n-------------------" << std::endl;
+        	ss << "   " << c[i]->qasm() << std::endl;
+        ss << "\n-------------------";
+        ql::utils::logger::write_line(std::cout, ss.str());  // in one piece, also when kernels are optimized concurrently
     }
 
     /**
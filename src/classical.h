@@ -259,6 +259,7 @@ public:
         DOUT("Classical gate constructor with destination for " << oper.operation_name);
         name = oper.operation_name;
         duration = 20;
+        signature = __classical_signature__;
         creg_operands.push_back(dest.id);
         if(name == "ldi")
         {
@@ -277,6 +278,7 @@ public:
     classical(std::string operation)
     {
         DOUT("Classical gate constructor for " << operation);
+        signature = __classical_signature__;
         str::lower_case(operation);
         if((operation == "nop"))
         {
@@ -4,16 +4,97 @@
  * @date   05/2019
  * @author Hans van Someren
  */
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
 #include "utils.h"
 #include "circuit.h"
 #include "report.h"
 #include "kernel.h"
+#include "parallel.h"
 
 #include "clifford.h"
 
 
 namespace ql
 {
+/*
+ * stabilizer tableau of a clifford circuit on n qubits (see Aaronson and Gottesman, 2004):
+ * for each generator X_j and Z_j of the pauli group, the pauli with sign that the circuit maps it to;
+ * row j is the image of X_j and row n+j the image of Z_j.
+ * The bits are stored per qubit (column), packed in 64-bit words over the rows,
+ * so that applying a gate to the tableau takes a few word operations per 64 rows.
+ */
+class Tableau
+{
+public:
+    Tableau(size_t n) : n(n), nw((2*n+63)/64), xs(n*nw, 0), zs(n*nw, 0), rs(nw, 0)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            xs[j*nw + j/64] |= bit(j);          // X_j -> X_j
+            zs[j*nw + (n+j)/64] |= bit(n+j);    // Z_j -> Z_j
+        }
+    }
+
+    size_t size() const { return n; }
+
+    // x and z bit of qubit q in the given row, and the sign bit of the row
+    bool x(size_t row, size_t q) const { return (xs[q*nw + row/64] & bit(row)) != 0; }
+    bool z(size_t row, size_t q) const { return (zs[q*nw + row/64] & bit(row)) != 0; }
+    bool r(size_t row) const { return (rs[row/64] & bit(row)) != 0; }
+
+    // append a gate to the circuit of the tableau
+    void h(size_t a)
+    {
+        uint64_t * xa = &xs[a*nw];
+        uint64_t * za = &zs[a*nw];
+        for (size_t w = 0; w < nw; w++)
+        {
+            rs[w] ^= xa[w] & za[w];
+            std::swap(xa[w], za[w]);
+        }
+    }
+
+    void s(size_t a)
+    {
+        uint64_t * xa = &xs[a*nw];
+        uint64_t * za = &zs[a*nw];
+        for (size_t w = 0; w < nw; w++)
+        {
+            rs[w] ^= xa[w] & za[w];
+            za[w] ^= xa[w];
+        }
+    }
+
+    void cnot(size_t a, size_t b)
+    {
+        uint64_t * xa = &xs[a*nw];
+        uint64_t * za = &zs[a*nw];
+        uint64_t * xb = &xs[b*nw];
+        uint64_t * zb = &zs[b*nw];
+        for (size_t w = 0; w < nw; w++)
+        {
+            rs[w] ^= xa[w] & zb[w] & ~(xb[w] ^ za[w]);
+            xb[w] ^= xa[w];
+            za[w] ^= zb[w];
+        }
+    }
+
+private:
+    size_t  n;                          // number of qubits
+    size_t  nw;                         // number of words per column
+    std::vector<uint64_t>   xs;         // x bits, nw words per qubit
+    std::vector<uint64_t>   zs;         // z bits, nw words per qubit
+    std::vector<uint64_t>   rs;         // sign bits
+
+    static uint64_t bit(size_t row) { return uint64_t(1) << (row % 64); }
+};
+
 class Clifford
 {
 public:
@@ -33,7 +114,10 @@ public:
 
         cliffstate.resize(nq, 0);       // 0 is identity; for all qubits accumulated state is set to identity
         cliffcycles.resize(nq, 0);      // for all qubits, no accumulated cycles
+        regionof.resize(nq, none);      // for all qubits, not in a region of two-qubit cliffords
         total_saved = 0;                // reset saved, just for reporting
+        total_saved_2q = 0;
+        init_words();
 
         /*
         The main idea of this optimization is that there are 24 clifford gates and these form a group,
@@ -61,6 +145,18 @@ public:
         and updating cliffcycles[q].
         And when finding a gate that ends a sequence of cliffords ('synchronization point'),
         the minimal sequence corresponding to the accumulated sequence is output before the new gate.
+
+        Two-qubit clifford gates (cnot, cz) don't end these sequences but join the qubits into a region:
+        a set of qubits with the clifford gates on them since they were last synchronized,
+        joined by two-qubit clifford gates between them.
+        So while scanning, also maintain for each qubit q:
+        - regionof[q]:      the region that q is in, or none
+        and for each region its qubits and its gates, as single-qubit clifford states and two-qubit gates.
+        When a qubit of a region is synchronized, the whole region is:
+        the stabilizer tableau of its gates is computed, and from it a new circuit is synthesized;
+        when the latter has fewer two-qubit gates (or as many, but shorter single-qubit sequences)
+        and only has two-qubit gates between pairs of qubits that had one in the region before,
+        it is output instead of the region's gates.
         */
         for (auto gp: input_circuit)
         {
@@ -76,6 +172,12 @@ public:
                 sync_all(kernel);
                 kernel.c.push_back(gp);
             }
+            else if (is_clifford_2q(gp))
+            {
+                // two-qubit clifford gates like cnot/cz
+                // don't emit gate but add it to the region of its operand qubits
+                add_to_region(gp);
+            }
             else if (gp->operands.size() != 1)                      // gates like CNOT/CZ/TOFFOLI
             {
                 // non-unary quantum gates like wait/cnot/cz/toffoli
@@ -118,7 +220,7 @@ public:
         sync_all(kernel);
 	    kernel.cycles_valid = false;
 
-        DOUT("Clifford " << passname << " on kernel " << kernel.name << " saved " << total_saved << " cycles [DONE]");
+        DOUT("Clifford " << passname << " on kernel " << kernel.name << " saved " << total_saved << " cycles and " << total_saved_2q << " two-qubit gates [DONE]");
     }
 
 private:
@@ -126,7 +228,34 @@ private:
     size_t  ct;
     std::vector<int>    cliffstate;                    // current accumulated clifford state per qubit
     std::vector<size_t> cliffcycles;                   // current accumulated clifford cycles per qubit
-    size_t  total_saved;                               // total number of cycles saved per kernel
+    long    total_saved;                               // total number of cycles saved per kernel, negative when added
+    long    total_saved_2q;                            // total number of two-qubit gates saved per kernel
+
+    // a gate of a region: a single-qubit clifford cs on qubit q when cs >= 0,
+    // otherwise a two-qubit gate gp, or, when gp is NULL, a synthesized one on qubits q and q2
+    struct op_t
+    {
+        int         cs;
+        size_t      q;
+        size_t      q2;
+        ql::gate *  gp;
+    };
+
+    struct region_t
+    {
+        std::vector<size_t> qubits;                    // qubits of the region
+        std::vector<op_t>   ops;                       // gates of the region, in order
+        size_t              cycles = 0;                // accumulated cycles of its single-qubit cliffords
+        std::string         cz_name;                   // name of a cz in it, the gate to synthesize; or empty, then cnot
+    };
+
+    const size_t none = std::numeric_limits<size_t>::max();
+    std::vector<size_t>     regionof;                  // region of each qubit, or none
+    std::vector<region_t>   regions;                   // regions, indexed by regionof
+    std::vector<size_t>     free_regions;              // indices of regions that are not in use
+
+    std::vector<std::string>    words;                 // per clifford state a sequence of 'H' and 'S' implementing it
+    std::vector<int>            inverse;               // per clifford state its inverse
 
     // create gate sequences for all accumulated cliffords, output them and reset state
     void sync_all(quantum_kernel& k)
@@ -142,6 +271,11 @@ private:
     // create gate sequence for accumulated cliffords of qubit q, output it and reset state
     void sync(quantum_kernel& k, size_t q)
     {
+        if (regionof[q] != none)
+        {
+            sync_region(k, regionof[q]);
+            return;
+        }
         int csq = cliffstate[q];
         if (csq != 0)
         {
@@ -152,12 +286,435 @@ private:
             DOUT("... qubit q[" << q << "]: accumulated: " << acc_cycles << ", inserted: " << ins_cycles);
             if (acc_cycles > ins_cycles) DOUT("... qubit q[" << q << "]: saved " << (acc_cycles-ins_cycles) << " cycles");
             if (acc_cycles < ins_cycles) DOUT("... qubit q[" << q << "]: additional " << (ins_cycles-acc_cycles) << " cycles");
-            total_saved += acc_cycles-ins_cycles;
+            total_saved += long(acc_cycles) - long(ins_cycles);
+        }
+        cliffstate[q] = 0;
+        cliffcycles[q] = 0;
+    }
+
+    // name of a gate without its operands, as in "cz q0,q1"
+    static std::string base_name(const std::string& name)
+    {
+        return name.substr(0, name.find(' '));
+    }
+
+    // two-qubit clifford gates that are collected in regions
+    bool is_clifford_2q(ql::gate* gp)
+    {
+        if (gp->operands.size() != 2 || !gp->creg_operands.empty())
+        {
+            return false;
+        }
+        std::string gname = base_name(gp->name);
+        return gname == "cnot" || gname == "cz" || gname == "cphase";
+    }
+
+    // move the accumulated clifford state of qubit q into its region
+    void pend(region_t& reg, size_t q)
+    {
+        if (cliffstate[q] != 0)
+        {
+            reg.ops.push_back(op_t{cliffstate[q], q, 0, NULL});
         }
+        reg.cycles += cliffcycles[q];
         cliffstate[q] = 0;
         cliffcycles[q] = 0;
     }
 
+    // the region of qubit q, creating a new one when it isn't in one yet
+    size_t region(size_t q)
+    {
+        if (regionof[q] == none)
+        {
+            size_t r;
+            if (free_regions.empty())
+            {
+                r = regions.size();
+                regions.push_back(region_t());
+            }
+            else
+            {
+                r = free_regions.back();
+                free_regions.pop_back();
+            }
+            regions[r].qubits.push_back(q);
+            regionof[q] = r;
+        }
+        return regionof[q];
+    }
+
+    // add two-qubit clifford gate gp to the region of its operands, joining their regions
+    void add_to_region(ql::gate* gp)
+    {
+        size_t q0 = gp->operands[0];
+        size_t q1 = gp->operands[1];
+        size_t r0 = region(q0);
+        size_t r1 = region(q1);
+        pend(regions[r0], q0);
+        pend(regions[r1], q1);
+        if (r0 != r1)
+        {
+            // join the smaller region into the larger one;
+            // their gates are on different qubits so their relative order doesn't matter
+            if (regions[r0].ops.size() < regions[r1].ops.size())
+            {
+                std::swap(r0, r1);
+            }
+            region_t & to = regions[r0];
+            region_t & from = regions[r1];
+            for (auto q : from.qubits)
+            {
+                regionof[q] = r0;
+            }
+            to.qubits.insert(to.qubits.end(), from.qubits.begin(), from.qubits.end());
+            to.ops.insert(to.ops.end(), from.ops.begin(), from.ops.end());
+            to.cycles += from.cycles;
+            if (to.cz_name.empty())
+            {
+                to.cz_name = from.cz_name;
+            }
+            from = region_t();
+            free_regions.push_back(r1);
+        }
+        region_t & reg = regions[r0];
+        reg.ops.push_back(op_t{-1, q0, q1, gp});
+        std::string gname = base_name(gp->name);
+        if (reg.cz_name.empty() && gname != "cnot")
+        {
+            reg.cz_name = gname;
+        }
+    }
+
+    // create gate sequence for region r: the synthesized one when better, or else its own gates;
+    // output it and reset state
+    void sync_region(quantum_kernel& k, size_t r)
+    {
+        region_t & reg = regions[r];
+        for (auto q : reg.qubits)
+        {
+            pend(reg, q);
+            regionof[q] = none;
+        }
+
+        std::vector<op_t> orig = merge(reg, reg.ops);
+        std::vector<op_t> synth = merge(reg, synthesize(reg));
+        size_t orig_2q = count_2q(orig);
+        size_t synth_2q = count_2q(synth);
+        size_t orig_cycles = count_cycles(orig);
+        size_t synth_cycles = count_cycles(synth);
+        bool better = (synth_2q < orig_2q || (synth_2q == orig_2q && synth_cycles < orig_cycles))
+                        && same_pairs(orig, synth);
+        DOUT("... sync region of " << reg.qubits.size() << " qubits: two-qubit gates: " << orig_2q << ", synthesized: " << synth_2q
+            << "; cycles: " << orig_cycles << ", synthesized: " << synth_cycles << (better ? "; synthesized" : "; kept"));
+
+        std::vector<op_t> & ops = (better ? synth : orig);
+        for (auto & op : ops)
+        {
+            if (op.cs >= 0)
+            {
+                k.clifford(op.cs, op.q);
+            }
+            else if (op.gp != NULL)
+            {
+                k.c.push_back(op.gp);
+            }
+            else
+            {
+                k.gate(reg.cz_name.empty() ? "cnot" : reg.cz_name, {op.q, op.q2});
+            }
+        }
+        // a region with fewer two-qubit gates may take more cycles
+        total_saved += long(reg.cycles) - long(count_cycles(ops));
+        total_saved_2q += long(orig_2q) - long(count_2q(ops));
+
+        reg = region_t();
+        free_regions.push_back(r);
+    }
+
+    // merge the consecutive single-qubit cliffords on each qubit in ops into one, leaving out identities
+    std::vector<op_t> merge(const region_t& reg, const std::vector<op_t>& ops)
+    {
+        std::unordered_map<size_t, int> state;
+        std::vector<op_t> merged;
+        auto flush = [&](size_t q)
+        {
+            int cs = state[q];
+            if (cs != 0)
+            {
+                merged.push_back(op_t{cs, q, 0, NULL});
+            }
+            state[q] = 0;
+        };
+        for (auto & op : ops)
+        {
+            if (op.cs >= 0)
+            {
+                state[op.q] = clifftrans[state[op.q]][op.cs];
+            }
+            else
+            {
+                flush(op.q);
+                flush(op.q2);
+                merged.push_back(op);
+            }
+        }
+        for (auto q : reg.qubits)
+        {
+            flush(q);
+        }
+        return merged;
+    }
+
+    size_t count_2q(const std::vector<op_t>& ops)
+    {
+        size_t n = 0;
+        for (auto & op : ops)
+        {
+            n += (op.cs < 0);
+        }
+        return n;
+    }
+
+    size_t count_cycles(const std::vector<op_t>& ops)
+    {
+        size_t n = 0;
+        for (auto & op : ops)
+        {
+            n += (op.cs < 0 ? 0 : cs2cycles(op.cs));
+        }
+        return n;
+    }
+
+    // whether all pairs of qubits with a two-qubit gate in synth also have one in orig,
+    // so that synth satisfies the connectivity constraints that orig satisfies
+    bool same_pairs(const std::vector<op_t>& orig, const std::vector<op_t>& synth)
+    {
+        std::set<std::pair<size_t,size_t>> pairs;
+        for (auto & op : orig)
+        {
+            if (op.cs < 0)
+            {
+                pairs.insert(std::make_pair(std::min(op.q, op.q2), std::max(op.q, op.q2)));
+            }
+        }
+        for (auto & op : synth)
+        {
+            if (op.cs < 0 && pairs.count(std::make_pair(std::min(op.q, op.q2), std::max(op.q, op.q2))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // for each clifford state, the sequence of H and S gates that implements it, and its inverse
+    void init_words()
+    {
+        const std::map<std::string, std::string> prim2word = {
+            {"id", ""}, {"x180", "HSSH"}, {"x90", "HSH"}, {"xm90", "HSSSH"},
+            {"y180", "SSSHSSHS"}, {"y90", "SSSHSHS"}, {"ym90", "SSSHSSSHS"}
+        };
+        words.resize(24);
+        inverse.resize(24);
+        for (int cs = 0; cs < 24; cs++)
+        {
+            // cs2string(cs) is like "[x90; ym90; xm90;]"
+            std::istringstream ss(cs2string(cs).substr(1));
+            std::string prim;
+            while (std::getline(ss, prim, ';') && prim != "]")
+            {
+                prim.erase(0, prim.find_first_not_of(' '));
+                words[cs] += prim2word.at(prim);
+            }
+            for (int inv = 0; inv < 24; inv++)
+            {
+                if (clifftrans[cs][inv] == 0)
+                {
+                    inverse[cs] = inv;
+                }
+            }
+        }
+    }
+
+    // append a gate to tableau t and to log when not NULL; q and q2 are local qubit indices
+    void apply(Tableau& t, const op_t& op, std::vector<op_t>* log)
+    {
+        if (op.cs >= 0)
+        {
+            for (auto c : words[op.cs])
+            {
+                if (c == 'H') t.h(op.q); else t.s(op.q);
+            }
+        }
+        else
+        {
+            t.cnot(op.q, op.q2);
+        }
+        if (log != NULL)
+        {
+            log->push_back(op);
+        }
+    }
+
+    /*
+    Synthesis of the circuit of a region from its tableau (see e.g. Bravyi, Shaydulin, Hu and Maslov, 2021):
+    gates are appended to the circuit of the tableau until it is the identity up to a pauli;
+    the circuit of the region then is that pauli followed by the inverses of these gates in reverse order.
+    The appended gates decouple one qubit at a time, greedily taking the qubit that takes the fewest cnots.
+    Decoupling qubit q maps the images of X_q and Z_q to X_q and Z_q;
+    the images of the other generators then have the identity on q because they commute with X_q and Z_q.
+    Return the synthesized gates with the cnots expanded into h;cz;h when the region has czs.
+    */
+    std::vector<op_t> synthesize(const region_t& reg)
+    {
+        size_t n = reg.qubits.size();
+        std::unordered_map<size_t, size_t> local;
+        for (size_t j = 0; j < n; j++)
+        {
+            local[reg.qubits[j]] = j;
+        }
+
+        Tableau t(n);
+        for (auto & op : reg.ops)
+        {
+            size_t a = local[op.q];
+            if (op.cs >= 0)
+            {
+                apply(t, op_t{op.cs, a, 0, NULL}, NULL);
+                continue;
+            }
+            size_t b = local[op.q2];
+            if (base_name(op.gp->name) == "cnot")
+            {
+                t.cnot(a, b);
+            }
+            else
+            {
+                t.h(b);
+                t.cnot(a, b);
+                t.h(b);
+            }
+        }
+
+        std::vector<size_t> remaining;
+        for (size_t j = 0; j < n; j++)
+        {
+            remaining.push_back(j);
+        }
+        std::vector<op_t> log;
+        while (!remaining.empty())
+        {
+            size_t best = 0;
+            size_t best_cost = none;
+            for (size_t i = 0; i < remaining.size(); i++)
+            {
+                Tableau c = t;
+                size_t cost = decouple(c, remaining[i], remaining, NULL);
+                if (cost < best_cost)
+                {
+                    best = i;
+                    best_cost = cost;
+                }
+            }
+            decouple(t, remaining[best], remaining, &log);
+            remaining.erase(remaining.begin() + best);
+        }
+
+        std::vector<op_t> synth;
+        for (size_t j = 0; j < n; j++)
+        {
+            // the pauli that leaves the signs in the tableau: Z flips the sign of X_j, X that of Z_j
+            bool rx = t.r(j);
+            bool rz = t.r(n+j);
+            if (rx || rz)
+            {
+                synth.push_back(op_t{(rx && rz) ? 6 : (rx ? 9 : 3), reg.qubits[j], 0, NULL});
+            }
+        }
+        for (size_t i = log.size(); i-- > 0; )
+        {
+            op_t & op = log[i];
+            if (op.cs >= 0)
+            {
+                synth.push_back(op_t{inverse[op.cs], reg.qubits[op.q], 0, NULL});
+            }
+            else if (reg.cz_name.empty())
+            {
+                synth.push_back(op_t{-1, reg.qubits[op.q], reg.qubits[op.q2], NULL});
+            }
+            else
+            {
+                synth.push_back(op_t{12, reg.qubits[op.q2], 0, NULL});
+                synth.push_back(op_t{-1, reg.qubits[op.q], reg.qubits[op.q2], NULL});
+                synth.push_back(op_t{12, reg.qubits[op.q2], 0, NULL});
+            }
+        }
+        return synth;
+    }
+
+    // decouple qubit q from the other remaining qubits in tableau t, appending the gates to log when not NULL;
+    // return the number of cnots
+    size_t decouple(Tableau& t, size_t q, const std::vector<size_t>& remaining, std::vector<op_t>* log)
+    {
+        size_t n_cnots = 0;
+        size_t px = q;                                 // row of the image of X_q
+        size_t pz = t.size() + q;                      // row of the image of Z_q
+
+        // map the image of X_q to a product of X's: Z (H) and Y (sdag) to X on each qubit
+        std::vector<size_t> xq;
+        for (auto j : remaining)
+        {
+            bool x = t.x(px, j);
+            bool z = t.z(px, j);
+            if (z)
+            {
+                apply(t, op_t{x ? 23 : 12, j, 0, NULL}, log);
+            }
+            if (x || z)
+            {
+                xq.push_back(j);
+            }
+        }
+        // then to X_q: make it have an X on q, and remove the X's on the other qubits by cnots from q
+        if (!t.x(px, q))
+        {
+            apply(t, op_t{-1, xq.front(), q, NULL}, log);
+            n_cnots++;
+        }
+        for (auto j : xq)
+        {
+            if (j != q)
+            {
+                apply(t, op_t{-1, q, j, NULL}, log);
+                n_cnots++;
+            }
+        }
+
+        // map the image of Z_q to a product of Z's, leaving X_q: Y (x90) to Z on q, X (H) and Y (x90) to Z on the others
+        // (it has Z or Y on q because it anticommutes with X_q)
+        std::vector<size_t> zq;
+        for (auto j : remaining)
+        {
+            bool x = t.x(pz, j);
+            bool z = t.z(pz, j);
+            if (x)
+            {
+                apply(t, op_t{(z || j == q) ? 16 : 12, j, 0, NULL}, log);
+            }
+            if ((x || z) && j != q)
+            {
+                zq.push_back(j);
+            }
+        }
+        // then to Z_q: remove the Z's on the other qubits by cnots to q
+        for (auto j : zq)
+        {
+            apply(t, op_t{-1, j, q, NULL}, log);
+            n_cnots++;
+        }
+        return n_cnots;
+    }
+
     // clifford state transition [from state][accumulating sequence represented as state] => new state
     const int clifftrans[24][24] = {
         {  0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14,15,16,17,18,19,20,21,22,23 },
@@ -194,18 +751,22 @@ private:
         else if (gname == "pauli_x")     return 3;
         else if (gname == "x")           return 3;
         else if (gname == "rx180")       return 3;
+        else if (gname == "x180")        return 3;
         else if (gname == "pauli_y")     return 6;
         else if (gname == "y")           return 6;
         else if (gname == "ry180")       return 6;
+        else if (gname == "y180")        return 6;
         else if (gname == "pauli_z")     return 9;
         else if (gname == "z")           return 9;
         else if (gname == "hadamard")    return 12;
         else if (gname == "h")           return 12;
         else if (gname == "xm90")        return 13;
         else if (gname == "mrx90")       return 13;
+        else if (gname == "mx90")        return 13;
         else if (gname == "s")           return 14;
         else if (gname == "ym90")        return 15;
         else if (gname == "mry90")       return 15;
+        else if (gname == "my90")        return 15;
         else if (gname == "x90")         return 16;
         else if (gname == "rx90")        return 16;
         else if (gname == "y90")         return 21;
@@ -293,11 +854,11 @@ private:
         ql::report_statistics(programp, platform, "in", passname, "# ");
         ql::report_qasm(programp, platform, "in", passname);
 
-        Clifford cliff;
-        for(auto &kernel : programp->kernels)
+        ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
         {
-            cliff.clifford_optimize_kernel(kernel, platform, passname);
-        }
+            Clifford cliff;
+            cliff.clifford_optimize_kernel(programp->kernels[k], platform, passname);
+        });
 
         ql::report_statistics(programp, platform, "out", passname, "# ");
         ql::report_qasm(programp, platform, "out", passname);
@@ -26,6 +26,8 @@ quantum_compiler::quantum_compiler(std::string n): name(n)
     /**
      * @brief   Compiles the program passed as parameter
      * @param   quantum_program   Object reference to the program to be compiled
+     * @note    with the options and the gate arena that the caller makes current,
+     *          and releasing the gates as the caller does (see quantum_program::compile_modular)
      */
 void quantum_compiler::compile(ql::quantum_program *program)
 {
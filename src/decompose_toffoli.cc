@@ -6,6 +6,7 @@
 #include "utils.h"
 #include "circuit.h"
 #include "kernel.h"
+#include "parallel.h"
 #include "decompose_toffoli.h"
 
 
@@ -23,6 +24,7 @@ namespace ql
 
             ql::quantum_kernel toff_kernel("toff_kernel");
             toff_kernel.instruction_map = kernel.instruction_map;
+            toff_kernel.instruction_table = kernel.instruction_table;
             toff_kernel.qubit_count = kernel.qubit_count;
             toff_kernel.cycle_time = kernel.cycle_time;
 
@@ -56,10 +58,10 @@ namespace ql
         if( tdopt == "AM" || tdopt == "NC" )
         {
             IOUT("Decomposing Toffoli ...");
-            for (size_t k=0; k<programp->kernels.size(); ++k)
+            ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
             {
                 decompose_toffoli_kernel(programp->kernels[k], platform);
-            }
+            });
         }
         else if( tdopt == "no" )
         {
@@ -16,6 +16,7 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <memory>
 
 #include <compile_options.h>
 #include <matrix.h>
@@ -23,6 +24,7 @@
 #include <exception.h>
 #include <utils.h>
 #include <gate_visual.h>
+#include <gate_arena.h>
 
 using json = nlohmann::json;
 
@@ -69,6 +71,43 @@ typedef enum __gate_type_t
     __classical_gate__
 } gate_type_t;
 
+// operand signatures: how a gate uses its operands in dependence graph construction (see scheduler.h);
+// a gate's signature is resolved once, when its class or its platform instruction is created,
+// so that dependence graph construction needn't inspect the gate's name
+typedef enum __signature_t
+{
+    __default_signature__,      // Read+Write on each qubit and each classical operand
+    __measure_signature__,      // Read+Write on each qubit operand, Write on each classical operand
+    __display_signature__,      // Read+Write on all qubits and classical registers, i.e. a barrier
+    __classical_signature__,    // Read+Write on each classical operand only
+    __cnot_signature__,         // Read on the first (control) operand, D on the other (target) operands
+    __cz_signature__            // Read on all operands
+} signature_t;
+
+// signature of a gate from its name, which may be followed by operands, e.g. "cz q0,q1";
+// the default for custom gates that don't specify one in the platform configuration file
+inline signature_t signature_from_name(const std::string & name)
+{
+    std::string n = name.substr(0, name.find(" "));
+    if (n == "measure")                 return __measure_signature__;
+    if (n == "display")                 return __display_signature__;
+    if (n == "cnot")                    return __cnot_signature__;
+    if (n == "cz" || n == "cphase")     return __cz_signature__;
+    return __default_signature__;
+}
+
+// signature named by the "signature" attribute of an instruction in the platform configuration file
+inline signature_t signature_from_string(const std::string & s)
+{
+    if (s == "default")     return __default_signature__;
+    if (s == "measure")     return __measure_signature__;
+    if (s == "display")     return __display_signature__;
+    if (s == "classical")   return __classical_signature__;
+    if (s == "cnot")        return __cnot_signature__;
+    if (s == "cz")          return __cz_signature__;
+    throw ql::exception("[x] error : ql::signature_from_string() : unknown signature '" + s + "' (expected one of: default, measure, display, classical, cnot, cz) !", false);
+}
+
 #define sqrt_2  (1.4142135623730950488016887242096980785696718753769480731766797379f)
 #define rsqrt_2 (0.7071067811865475244008443621048490392848359376884740365883398690f)
 
@@ -197,13 +236,24 @@ public:
     std::vector<size_t> operands;
     std::vector<size_t> creg_operands;
     int int_operand;
+    signature_t signature = __default_signature__;  // use of operands in dependence graph construction
     size_t duration;
     double angle;                            // for arbitrary rotations
     size_t  cycle = MAX_CYCLE;               // cycle after scheduling; MAX_CYCLE indicates undefined
     virtual instruction_t qasm()       = 0;
     virtual gate_type_t   type()       = 0;
     virtual cmat_t        mat()        = 0;  // to do : change cmat_t type to avoid stack smashing on 2 qubits gate operations
-	GateVisual gateVisual = { {{ 255, 255, 255 }}, std::vector<Node>() }; // contains the visualization parameters
+    virtual ~gate() {}
+
+    // gates are allocated in the current gate arena, if any (see gate_arena.h)
+    static void * operator new(size_t size)
+    {
+        return gate_arena::allocate_gate(size);
+    }
+    static void operator delete(void * p)
+    {
+        gate_arena::deallocate_gate(p);
+    }
 };
 
 
@@ -217,8 +267,7 @@ public:
 class identity : public gate
 {
 public:
-    cmat_t m;
-    identity(size_t q) : m(identity_c)
+    identity(size_t q)
     {
         name = "i";
         duration = 40;
@@ -237,7 +286,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(identity_c);
     }
 };
 
@@ -247,8 +296,7 @@ public:
 class hadamard : public gate
 {
 public:
-    cmat_t m;
-    hadamard(size_t q) : m(hadamard_c)
+    hadamard(size_t q)
     {
         name = "h";
         duration = 40;
@@ -267,7 +315,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(hadamard_c);
     }
 };
 
@@ -278,9 +326,8 @@ public:
 class phase : public gate
 {
 public:
-    cmat_t m;
 
-    phase(size_t q) : m(phase_c)
+    phase(size_t q)
     {
         name = "s";
         duration = 40;
@@ -299,7 +346,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(phase_c);
     }
 };
 
@@ -309,9 +356,8 @@ public:
 class phasedag : public gate
 {
 public:
-    cmat_t m;
 
-    phasedag(size_t q) : m(phasedag_c)
+    phasedag(size_t q)
     {
         name = "sdag";
         duration = 40;
@@ -330,7 +376,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(phasedag_c);
     }
 };
 
@@ -341,18 +387,12 @@ public:
 class rx : public gate
 {
 public:
-    cmat_t m;
-
     rx(size_t q, double theta)
     {
         name = "rx";
         duration = 40;
         angle = theta;
         operands.push_back(q);
-        m(0,0) = cos(angle/2);
-        m(0,1) = complex_t(0,-sin(angle/2));
-        m(1,0) = complex_t(0,-sin(angle/2));
-        m(1,1) = cos(angle/2);
     }
 
     instruction_t qasm()
@@ -367,6 +407,11 @@ public:
 
     cmat_t mat()
     {
+        cmat_t m;
+        m(0,0) = cos(angle/2);
+        m(0,1) = complex_t(0,-sin(angle/2));
+        m(1,0) = complex_t(0,-sin(angle/2));
+        m(1,1) = cos(angle/2);
         return m;
     }
 };
@@ -378,18 +423,12 @@ public:
 class ry : public gate
 {
 public:
-    cmat_t m;
-
     ry(size_t q, double theta)
     {
         name = "ry";
         duration = 40;
         angle = theta;
         operands.push_back(q);
-        m(0,0) = cos(angle/2);
-        m(0,1) = -sin(angle/2);
-        m(1,0) = sin(angle/2);
-        m(1,1) = cos(angle/2);
     }
 
     instruction_t qasm()
@@ -404,6 +443,11 @@ public:
 
     cmat_t mat()
     {
+        cmat_t m;
+        m(0,0) = cos(angle/2);
+        m(0,1) = -sin(angle/2);
+        m(1,0) = sin(angle/2);
+        m(1,1) = cos(angle/2);
         return m;
     }
 };
@@ -415,18 +459,12 @@ public:
 class rz : public gate
 {
 public:
-    cmat_t m;
-
     rz(size_t q, double theta)
     {
         name = "rz";
         duration = 40;
         angle = theta;
         operands.push_back(q);
-        m(0,0) = complex_t(cos(-angle/2), sin(-angle/2));
-        m(0,1) = 0;
-        m(1,0) = 0;
-        m(1,1) =  complex_t(cos(angle/2), sin(angle/2));
     }
 
     instruction_t qasm()
@@ -441,6 +479,11 @@ public:
 
     cmat_t mat()
     {
+        cmat_t m;
+        m(0,0) = complex_t(cos(-angle/2), sin(-angle/2));
+        m(0,1) = 0;
+        m(1,0) = 0;
+        m(1,1) =  complex_t(cos(angle/2), sin(angle/2));
         return m;
     }
 };
@@ -453,9 +496,8 @@ public:
 class t : public gate
 {
 public:
-    cmat_t m;
 
-    t(size_t q) : m(t_c)
+    t(size_t q)
     {
         name = "t";
         duration = 40;
@@ -474,7 +516,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(t_c);
     }
 };
 
@@ -484,9 +526,8 @@ public:
 class tdag : public gate
 {
 public:
-    cmat_t m;
 
-    tdag(size_t q) : m(tdag_c)
+    tdag(size_t q)
     {
         name = "tdag";
         duration = 40;
@@ -505,7 +546,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(tdag_c);
     }
 };
 
@@ -516,9 +557,8 @@ class pauli_x : public gate
 
 {
 public:
-    cmat_t m;
 
-    pauli_x(size_t q) : m(pauli_x_c)
+    pauli_x(size_t q)
     {
         name = "x";
         duration = 40;
@@ -537,7 +577,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(pauli_x_c);
     }
 };
 
@@ -548,9 +588,8 @@ public:
 class pauli_y : public gate
 {
 public:
-    cmat_t m;
 
-    pauli_y(size_t q) : m(pauli_y_c)
+    pauli_y(size_t q)
     {
         name = "y";
         duration = 40;
@@ -569,7 +608,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(pauli_y_c);
     }
 };
 
@@ -580,9 +619,8 @@ public:
 class pauli_z : public gate
 {
 public:
-    cmat_t m;
 
-    pauli_z(size_t q) : m(pauli_z_c)
+    pauli_z(size_t q)
     {
         name = "z";
         duration = 40;
@@ -601,7 +639,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(pauli_z_c);
     }
 };
 
@@ -612,9 +650,8 @@ public:
 class rx90 : public gate
 {
 public:
-    cmat_t m;
 
-    rx90(size_t q) : m(rx90_c)
+    rx90(size_t q)
     {
         name = "x90";
         duration = 40;
@@ -633,7 +670,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(rx90_c);
     }
 };
 
@@ -644,9 +681,8 @@ public:
 class mrx90 : public gate
 {
 public:
-    cmat_t m;
 
-    mrx90(size_t q) : m(mrx90_c)
+    mrx90(size_t q)
     {
         name = "mx90";
         duration = 40;
@@ -665,7 +701,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(mrx90_c);
     }
 };
 
@@ -675,9 +711,8 @@ public:
 class rx180 : public gate
 {
 public:
-    cmat_t m;
 
-    rx180(size_t q) : m(rx180_c)
+    rx180(size_t q)
     {
         name = "x180";
         duration = 40;
@@ -696,7 +731,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(rx180_c);
     }
 };
 
@@ -707,9 +742,8 @@ public:
 class ry90 : public gate
 {
 public:
-    cmat_t m;
 
-    ry90(size_t q) : m(ry90_c)
+    ry90(size_t q)
     {
         name = "y90";
         duration = 40;
@@ -728,7 +762,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(ry90_c);
     }
 };
 
@@ -739,9 +773,8 @@ public:
 class mry90 : public gate
 {
 public:
-    cmat_t m;
 
-    mry90(size_t q) : m(mry90_c)
+    mry90(size_t q)
     {
         name = "my90";
         duration = 40;
@@ -760,7 +793,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(mry90_c);
     }
 };
 
@@ -770,9 +803,8 @@ public:
 class ry180 : public gate
 {
 public:
-    cmat_t m;
 
-    ry180(size_t q) : m(ry180_c)
+    ry180(size_t q)
     {
         name = "y180";
         duration = 40;
@@ -791,7 +823,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(ry180_c);
     }
 };
 
@@ -802,18 +834,19 @@ public:
 class measure : public gate
 {
 public:
-    cmat_t m;
 
-    measure(size_t q) : m(identity_c)
+    measure(size_t q)
     {
         name = "measure";
+        signature = __measure_signature__;
         duration = 40;
         operands.push_back(q);
     }
 
-    measure(size_t q, size_t c) : m(identity_c)
+    measure(size_t q, size_t c)
     {
         name = "measure";
+        signature = __measure_signature__;
         duration = 40;
         operands.push_back(q);
         creg_operands.push_back(c);
@@ -837,7 +870,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(identity_c);
     }
 };
 
@@ -847,9 +880,8 @@ public:
 class prepz : public gate
 {
 public:
-    cmat_t m;
 
-    prepz(size_t q) : m(identity_c)
+    prepz(size_t q)
     {
         name = "prep_z";
         duration = 40;
@@ -868,7 +900,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(identity_c);
     }
 };
 
@@ -878,11 +910,11 @@ public:
 class cnot : public gate
 {
 public:
-    cmat_t m;
 
-    cnot(size_t q1, size_t q2) : m(cnot_c)
+    cnot(size_t q1, size_t q2)
     {
         name = "cnot";
+        signature = __cnot_signature__;
         duration = 80;
         operands.push_back(q1);
         operands.push_back(q2);
@@ -901,7 +933,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(cnot_c);
     }
 };
 
@@ -911,11 +943,11 @@ public:
 class cphase : public gate
 {
 public:
-    cmat_t m;
 
-    cphase(size_t q1, size_t q2) : m(cphase_c)
+    cphase(size_t q1, size_t q2)
     {
         name = "cz";
+        signature = __cz_signature__;
         duration = 80;
         operands.push_back(q1);
         operands.push_back(q2);
@@ -934,7 +966,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(cphase_c);
     }
 };
 
@@ -944,9 +976,8 @@ public:
 class toffoli : public gate
 {
 public:
-    cmat_t m;
 
-    toffoli(size_t q1, size_t q2, size_t q3) : m(ctoffoli_c)
+    toffoli(size_t q1, size_t q2, size_t q3)
     {
         name = "toffoli";
         duration = 160;
@@ -969,16 +1000,15 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(ctoffoli_c);
     }
 };
 
 class nop : public gate
 {
 public:
-    cmat_t m;
 
-    nop() : m(nop_c)
+    nop()
     {
         name = "wait";
         duration = 20;
@@ -996,7 +1026,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(nop_c);
     }
 };
 
@@ -1004,9 +1034,8 @@ public:
 class swap : public gate
 {
 public:
-    cmat_t m;
 
-    swap(size_t q1, size_t q2) : m(swap_c)
+    swap(size_t q1, size_t q2)
     {
         name = "swap";
         duration = 80;
@@ -1027,7 +1056,7 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(swap_c);
     }
 };
 
@@ -1039,10 +1068,9 @@ public:
 class wait : public gate
 {
 public:
-    cmat_t m;
     size_t duration_in_cycles;
 
-    wait(std::vector<size_t> qubits, size_t d, size_t dc) : m(nop_c)
+    wait(std::vector<size_t> qubits, size_t d, size_t dc)
     {
         name = "wait";
         duration = d;
@@ -1065,16 +1093,15 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(nop_c);
     }
 };
 
 class SOURCE : public gate
 {
 public:
-    cmat_t m;
 
-    SOURCE() : m(nop_c)
+    SOURCE()
     {
         name = "SOURCE";
         duration = 1;
@@ -1092,16 +1119,15 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(nop_c);
     }
 };
 
 class SINK : public gate
 {
 public:
-    cmat_t m;
 
-    SINK() : m(nop_c)
+    SINK()
     {
         name = "SINK";
         duration = 1;
@@ -1119,18 +1145,18 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(nop_c);
     }
 };
 
 class display : public gate
 {
 public:
-    cmat_t m;
 
-    display() : m(nop_c)
+    display()
     {
         name = "display";
+        signature = __display_signature__;
         duration = 0;
     }
 
@@ -1146,11 +1172,24 @@ public:
 
     cmat_t mat()
     {
-        return m;
+        return cmat_t(nop_c);
     }
 };
 
 
+/**
+ * the attributes of a custom gate's instruction that don't vary per gate;
+ * immutable once loaded, and shared by the instruction's custom_gate in the platform
+ * and all gates copied from it, so that a gate doesn't carry its own copy
+ */
+class instruction_definition_t
+{
+public:
+    cmat_t              m;                    // matrix representation
+    std::string         arch_operation_name;  // name of instruction in the architecture (e.g. cc_light_instr)
+    GateVisual          gateVisual = { {{ 255, 255, 255 }}, std::vector<Node>() }; // contains the visualization parameters
+};
+
 /**
  * custom gate support
  */
@@ -1158,34 +1197,29 @@ public:
 class custom_gate : public gate
 {
 public:
-    cmat_t              m;                // matrix representation
-    std::string         arch_operation_name;  // name of instruction in the architecture (e.g. cc_light_instr)
+    std::shared_ptr<const instruction_definition_t> definition;    // set by load(), shared by copies
 
 public:
 
     /**
      * ctor
      */
-    custom_gate(string_t name)
+    custom_gate(string_t name) : definition(empty_definition())
     {
         this->name = name;  // just remember name, e.g. "x", "x %0" or "x q0", expansion is done by add_custom_gate_if_available().
         // FIXME: no syntax check is performed
+        signature = signature_from_name(name);  // may be overridden by load()
     }
 
     /**
      * copy ctor
      */
-    custom_gate(const custom_gate& g)
+    custom_gate(const custom_gate& g) : definition(g.definition)
     {
-        DOUT("Custom gate copy constructor for " << g.name);
         name = g.name;
         creg_operands = g.creg_operands;
         duration  = g.duration;
-		gateVisual = g.gateVisual;
-        m.m[0] = g.m.m[0];
-        m.m[1] = g.m.m[1];
-        m.m[2] = g.m.m[2];
-        m.m[3] = g.m.m[3];
+        signature = g.signature;
     }
 
 
@@ -1233,6 +1267,7 @@ public:
     void load(json& instr)
     {
         DOUT("loading instruction '" << name << "'...");
+        instruction_definition_t def(*definition);
         std::string l_attr = "(none)";
         try
         {
@@ -1256,10 +1291,10 @@ public:
             // FIXME: make matrix optional, default to NaN
             auto mat = instr["matrix"];
             DOUT("matrix: " << instr["matrix"]);
-            m.m[0] = complex_t(mat[0][0], mat[0][1]);
-            m.m[1] = complex_t(mat[1][0], mat[1][1]);
-            m.m[2] = complex_t(mat[2][0], mat[2][1]);
-            m.m[3] = complex_t(mat[3][0], mat[3][1]);
+            def.m.m[0] = complex_t(mat[0][0], mat[0][1]);
+            def.m.m[1] = complex_t(mat[1][0], mat[1][1]);
+            def.m.m[2] = complex_t(mat[2][0], mat[2][1]);
+            def.m.m[3] = complex_t(mat[3][0], mat[3][1]);
 			
 			// Load the visual parameters of the instruction if provided.
             l_attr = "visual";
@@ -1271,13 +1306,13 @@ public:
 				
 				// Load the connection color.
 				json connectionColor = visual["connectionColor"];
-				gateVisual.connectionColor[0] = connectionColor[0];
-				gateVisual.connectionColor[1] = connectionColor[1];
-				gateVisual.connectionColor[2] = connectionColor[2];
+				def.gateVisual.connectionColor[0] = connectionColor[0];
+				def.gateVisual.connectionColor[1] = connectionColor[1];
+				def.gateVisual.connectionColor[2] = connectionColor[2];
  				DOUT("Connection color: [" 
-					<< (int)gateVisual.connectionColor[0] << ","
-					<< (int)gateVisual.connectionColor[1] << ","
-					<< (int)gateVisual.connectionColor[2] << "]");
+					<< (int)def.gateVisual.connectionColor[0] << ","
+					<< (int)def.gateVisual.connectionColor[1] << ","
+					<< (int)def.gateVisual.connectionColor[2] << "]");
 				
  				// Load the individual nodes.
 				json nodes = visual["nodes"];
@@ -1313,24 +1348,24 @@ public:
 						outlineColor
 					};
 					
-					gateVisual.nodes.push_back(loadedNode);
+					def.gateVisual.nodes.push_back(loadedNode);
 					
  					DOUT("[type: " << node["type"] << "] "
-						<< "[radius: " << gateVisual.nodes.at(i).radius << "] "
-						<< "[displayName: " << gateVisual.nodes.at(i).displayName << "] "
-						<< "[fontHeight: " << gateVisual.nodes.at(i).fontHeight << "] "
+						<< "[radius: " << def.gateVisual.nodes.at(i).radius << "] "
+						<< "[displayName: " << def.gateVisual.nodes.at(i).displayName << "] "
+						<< "[fontHeight: " << def.gateVisual.nodes.at(i).fontHeight << "] "
 						<< "[fontColor: "
-							<< (int)gateVisual.nodes.at(i).fontColor[0] << ","
-							<< (int)gateVisual.nodes.at(i).fontColor[1] << ","
-							<< (int)gateVisual.nodes.at(i).fontColor[2] << "] "
+							<< (int)def.gateVisual.nodes.at(i).fontColor[0] << ","
+							<< (int)def.gateVisual.nodes.at(i).fontColor[1] << ","
+							<< (int)def.gateVisual.nodes.at(i).fontColor[2] << "] "
 						<< "[backgroundColor: "
-							<< (int)gateVisual.nodes.at(i).backgroundColor[0] << ","
-							<< (int)gateVisual.nodes.at(i).backgroundColor[1] << ","
-							<< (int)gateVisual.nodes.at(i).backgroundColor[2] << "] "
+							<< (int)def.gateVisual.nodes.at(i).backgroundColor[0] << ","
+							<< (int)def.gateVisual.nodes.at(i).backgroundColor[1] << ","
+							<< (int)def.gateVisual.nodes.at(i).backgroundColor[2] << "] "
 						<< "[outlineColor: "
-							<< (int)gateVisual.nodes.at(i).outlineColor[0] << ","
-							<< (int)gateVisual.nodes.at(i).outlineColor[1] << ","
-							<< (int)gateVisual.nodes.at(i).outlineColor[2] << "]");
+							<< (int)def.gateVisual.nodes.at(i).outlineColor[0] << ","
+							<< (int)def.gateVisual.nodes.at(i).outlineColor[1] << ","
+							<< (int)def.gateVisual.nodes.at(i).outlineColor[2] << "]");
 				}
 			}
 			else
@@ -1344,11 +1379,19 @@ public:
             throw ql::exception("[x] error : ql::custom_gate() : error while loading instruction '" + name + "' : attribute '" + l_attr + "' : \n\t" + e.what(), false);
         }
 
+        if ( instr.count("signature") > 0)
+        {
+            signature = signature_from_string(instr["signature"].get<std::string>());
+            DOUT("signature: " << instr["signature"]);
+        }
+
         if ( instr.count("cc_light_instr") > 0)
         {
-            arch_operation_name = instr["cc_light_instr"].get<std::string>();
+            def.arch_operation_name = instr["cc_light_instr"].get<std::string>();
             DOUT("cc_light_instr: " << instr["cc_light_instr"]);
         }
+
+        definition = std::make_shared<const instruction_definition_t>(std::move(def));
     }
 
     void print_info()
@@ -1357,6 +1400,7 @@ public:
         println("    |- name     : " << name);
         utils::print_vector(operands,"[openql]     |- qubits   :"," , ");
         println("    |- duration : " << duration);
+        const cmat_t & m = definition->m;
         println("    |- matrix   : [" << m.m[0] << ", " << m.m[1] << ", " << m.m[2] << ", " << m.m[3] << "]");
     }
 
@@ -1416,9 +1460,16 @@ public:
      */
     cmat_t mat()
     {
-        return m;
+        return definition->m;
     }
 
+private:
+    // the definition of gates that weren't loaded
+    static std::shared_ptr<const instruction_definition_t> empty_definition()
+    {
+        static const std::shared_ptr<const instruction_definition_t> empty = std::make_shared<const instruction_definition_t>();
+        return empty;
+    }
 };
 
 /**
@@ -1427,7 +1478,6 @@ public:
 class composite_gate : public custom_gate
 {
 public:
-    cmat_t m;
     std::vector<gate *> gs;
 
     composite_gate(std::string name) : custom_gate(name)
@@ -1458,11 +1508,6 @@ public:
     {
         return __composite_gate__;
     }
-
-    cmat_t mat()
-    {
-        return m;   // FIXME: never initialized
-    }
 };
 
 } // end ql namespace
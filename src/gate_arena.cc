@@ -0,0 +1,235 @@
+/**
+ * @file   gate_arena.cc
+ * @date   10/2026
+ * @brief  arena in which the gates of the kernels of a program are allocated
+ */
+
+#include <gate_arena.h>
+
+#include <new>
+#include <map>
+#include <gate.h>
+
+namespace ql
+{
+
+// a block of memory that one thread fills with gates at a time,
+// with a bit per unit of alignment bytes for whether a gate that was not deleted starts there
+struct gate_arena::block_t
+{
+    char *      begin;
+    size_t      size;
+    size_t      used;           // by the thread filling it
+    size_t      nwords;
+    std::unique_ptr<std::atomic<uint64_t>[]> live;
+
+    explicit block_t(size_t bsize)
+        : begin(static_cast<char *>(::operator new(bsize))), size(bsize), used(0),
+          nwords((bsize / alignment + 63) / 64), live(new std::atomic<uint64_t>[nwords])
+    {
+        for (size_t w = 0; w < nwords; w++)
+        {
+            live[w].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ~block_t()
+    {
+        ::operator delete(begin);
+    }
+
+    bool contains(const void * p) const
+    {
+        return begin <= static_cast<const char *>(p) && static_cast<const char *>(p) < begin + size;
+    }
+
+    // set or clear the bit of the gate at p; return whether it was set
+    bool mark(const void * p, bool is_live)
+    {
+        size_t unit = size_t(static_cast<const char *>(p) - begin) / alignment;
+        uint64_t bit = uint64_t(1) << (unit % 64);
+        uint64_t old = (is_live ? live[unit / 64].fetch_or(bit) : live[unit / 64].fetch_and(~bit));
+        return (old & bit) != 0;
+    }
+};
+
+struct gate_arena::registry_t
+{
+    std::mutex                          mutex;
+    std::map<const char *, block_t *>   blocks;     // by end
+};
+
+struct gate_arena::thread_block_t
+{
+    gate_arena *    arena = nullptr;
+    uint64_t        generation = 0;
+    block_t *       block = nullptr;
+};
+
+gate_arena::gate_arena() : generation(next_generation())
+{
+}
+
+gate_arena::~gate_arena()
+{
+    release();
+}
+
+gate_arena * & gate_arena::current()
+{
+    static thread_local gate_arena * arenap = nullptr;
+    return arenap;
+}
+
+gate_arena::thread_block_t & gate_arena::thread_block()
+{
+    static thread_local thread_block_t tb;
+    return tb;
+}
+
+gate_arena::registry_t & gate_arena::registry()
+{
+    static registry_t r;
+    return r;
+}
+
+uint64_t gate_arena::next_generation()
+{
+    static std::atomic<uint64_t> counter(0);
+    return ++counter;
+}
+
+gate_arena::block_t * gate_arena::new_block(size_t size)
+{
+    std::unique_ptr<block_t> b(new block_t(size > block_size ? size : size_t(block_size)));
+    block_t * bp = b.get();
+    {
+        registry_t & r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.blocks[bp->begin + bp->size] = bp;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    blocks.push_back(std::move(b));
+    return bp;
+}
+
+void * gate_arena::allocate(size_t size)
+{
+    size_t needed = (size + alignment - 1) / alignment * alignment;
+
+    thread_block_t & tb = thread_block();
+    uint64_t gen = generation.load(std::memory_order_acquire);
+    if (tb.arena != this || tb.generation != gen || tb.block->size - tb.block->used < needed)
+    {
+        tb.arena = this;
+        tb.generation = gen;
+        tb.block = new_block(needed);
+    }
+    block_t & b = *tb.block;
+    char * p = b.begin + b.used;
+    b.used += needed;
+    b.mark(p, true);
+    return p;
+}
+
+void * gate_arena::allocate_gate(size_t size)
+{
+    gate_arena * arenap = current();
+    if (arenap)
+    {
+        return arenap->allocate(size);
+    }
+    return ::operator new(size);
+}
+
+void gate_arena::deallocate_gate(void * p)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+
+    // mostly, a gate is deleted by the thread that created it, while its block is still being filled
+    gate_arena * arenap = current();
+    thread_block_t & tb = thread_block();
+    if (arenap != nullptr && tb.arena == arenap && tb.generation == arenap->generation.load(std::memory_order_acquire)
+        && tb.block->contains(p))
+    {
+        tb.block->mark(p, false);   // destroyed; the memory is freed with the arena
+        return;
+    }
+
+    {
+        registry_t & r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto it = r.blocks.upper_bound(static_cast<const char *>(p));
+        if (it != r.blocks.end() && it->second->contains(p))
+        {
+            it->second->mark(p, false);
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+// the gates are destroyed block by block, in order of allocation within each block;
+// they stay in the registry meanwhile, in case destroying a gate deletes another one
+void gate_arena::release()
+{
+    std::vector<std::unique_ptr<block_t>> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released.swap(blocks);
+        generation.store(next_generation(), std::memory_order_release);
+    }
+    for (auto & b : released)
+    {
+        for (size_t unit = 0; unit * alignment < b->used; unit++)
+        {
+            char * p = b->begin + unit * alignment;
+            if ((b->live[unit / 64].load(std::memory_order_relaxed) >> (unit % 64)) & 1)
+            {
+                b->mark(p, false);
+                reinterpret_cast<gate *>(p)->~gate();
+            }
+        }
+    }
+    {
+        registry_t & r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto & b : released)
+        {
+            r.blocks.erase(b->begin + b->size);
+        }
+    }
+}
+
+size_t gate_arena::gate_count()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (auto & b : blocks)
+    {
+        for (size_t w = 0; w < b->nwords; w++)
+        {
+            for (uint64_t bits = b->live[w].load(std::memory_order_relaxed); bits != 0; bits &= bits - 1)
+            {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+size_t gate_arena::memory_size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t size = 0;
+    for (auto & b : blocks)
+    {
+        size += b->size + b->nwords * sizeof(uint64_t);
+    }
+    return size;
+}
+
+} // namespace ql
@@ -0,0 +1,107 @@
+/**
+ * @file   gate_arena.h
+ * @date   10/2026
+ * @brief  arena in which the gates of the kernels of a program are allocated
+ */
+
+#ifndef QL_GATE_ARENA_H
+#define QL_GATE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace ql
+{
+
+class gate;
+
+/*
+ * gate_arena owns the gates allocated in it: it allocates them by bumping a pointer through large blocks,
+ * and on release (and destruction) destroys the gates that were not deleted and frees the blocks;
+ * gates are allocated (see gate::operator new) in the arena that is current in the calling thread,
+ * and on the heap as before when there is none, so that code creating gates needn't know about arenas;
+ * deleting a gate of an arena only destroys it, its memory is reclaimed when the arena is released;
+ * each thread bumps through a block of its own, so that the threads compiling the kernels of a program
+ * can share its arena without locking per gate; a lock is only taken to get a new block;
+ * a gate carries no header: each block keeps a bit per allocation unit for whether a live gate starts there,
+ * and a gate is told to be of an arena by looking up the block that contains its address
+ */
+class gate_arena
+{
+public:
+    gate_arena();
+    ~gate_arena();
+
+    gate_arena(const gate_arena&) = delete;
+    gate_arena& operator=(const gate_arena&) = delete;
+
+    // destroy all gates still in the arena and free its memory; the arena can be used again afterwards
+    void release();
+
+    // number of gates allocated in the arena and not deleted; walks the arena
+    size_t gate_count();
+
+    // bytes of memory held by the arena
+    size_t memory_size();
+
+    // memory for a gate of size bytes, in the current arena or else on the heap; see gate::operator new
+    static void * allocate_gate(size_t size);
+    // destroyed gate's memory back: freed when from the heap, kept until release when from an arena
+    static void deallocate_gate(void * p);
+
+    // the arena in which this thread allocates gates; nullptr: on the heap
+    static gate_arena * & current();
+
+    /*
+     * makes arenap the current arena of this thread for the lifetime of the scope;
+     * the previously current one is restored at the end
+     */
+    class scope
+    {
+    public:
+        scope(gate_arena * arenap) : saved(current())
+        {
+            current() = arenap;
+        }
+        ~scope()
+        {
+            current() = saved;
+        }
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+    private:
+        gate_arena * saved;
+    };
+
+private:
+    struct block_t;         // see gate_arena.cc
+    struct registry_t;
+    struct thread_block_t;
+
+    static const size_t alignment = alignof(std::max_align_t);
+    static const size_t block_size = 256 * 1024;
+
+    void * allocate(size_t size);
+    block_t * new_block(size_t size);
+
+    // the blocks of all arenas by their end, to find the block of a gate when it is deleted
+    static registry_t & registry();
+    // the block that this thread is filling, with its arena and generation
+    static thread_block_t & thread_block();
+    // a new value for generation, unique over all arenas
+    static uint64_t next_generation();
+
+    std::mutex                              mutex;      // of blocks; taken to add a block, not per gate
+    std::vector<std::unique_ptr<block_t>>   blocks;     // in order of being taken by a thread
+    std::atomic<uint64_t>                   generation; // changes on release, so that threads take new blocks
+};
+
+} // namespace ql
+
+#endif // QL_GATE_ARENA_H
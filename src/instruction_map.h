@@ -11,6 +11,14 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <limits>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <cctype>
 
 #include <compile_options.h>
 #include "utils.h"
@@ -20,6 +28,258 @@ namespace ql
 {
 typedef std::map<std::string, ql::custom_gate *> instruction_map_t;
 
+// interned id of the name of a gate, e.g. of "cz" for the instructions "cz", "cz q0,q3" and "cz %0,%1"
+typedef size_t gate_id_t;
+const gate_id_t no_gate_id = std::numeric_limits<gate_id_t>::max();
+
+// a subinstruction of a composite gate, parsed once when the instruction table is created
+class sub_instruction_t
+{
+public:
+    std::string         name;       // as in the decomposition, e.g. "x q3" or "x %0"
+    std::string         gname;      // name of the gate, e.g. "x"
+    std::vector<size_t> args;       // the numbers of its operands: qubits ("q3") or parameter indices ("%0")
+    bool                defined;    // whether name is in the instruction map
+    bool                valid;      // whether all operands have a number
+};
+
+// an instruction of an instruction map, with the subinstructions when it is a composite gate
+class instruction_entry_t
+{
+public:
+    custom_gate *                   gate;
+    std::vector<sub_instruction_t>  decomposition;
+};
+
+// index of an instruction_map_t by gate id and operands, for the lookups of quantum_kernel::gate();
+// for a gate with id and qubits, the instructions of the map that these find are:
+// - specialized(id, qubits):   "cz q0,q3", i.e. the gate specialized for exactly these qubits
+// - parameterized(id):         "cz", i.e. the gate for any operands
+// - parameterized(id, n):      "cz %0,%1", i.e. the gate with n parameters in order
+// these find nothing for instructions with other forms, like the string lookups they replace;
+// the instruction map must not change while the table is in use
+class instruction_table_t
+{
+public:
+    explicit instruction_table_t(const instruction_map_t & instruction_map)
+    {
+        entries.reserve(instruction_map.size());
+        for (auto & mi : instruction_map)
+        {
+            const std::string & key = mi.first;
+            size_t space = key.find(' ');
+            gate_id_t gid = intern(key.substr(0, space));
+            size_t e = entries.size();
+            entries.push_back(instruction_entry_t{mi.second, parse_decomposition(mi.second, instruction_map)});
+
+            if (space == std::string::npos)
+            {
+                gates[gid].parameterized = e;
+                continue;
+            }
+            std::vector<std::string> tokens = split(key.substr(space+1), ',');
+            bool is_specialized = true;
+            bool is_parameterized = true;
+            std::vector<size_t> qubits;
+            for (size_t i = 0; i < tokens.size(); i++)
+            {
+                size_t n;
+                is_specialized = is_specialized && number(tokens[i], 'q', n);
+                qubits.push_back(n);
+                is_parameterized = is_parameterized && tokens[i] == "%" + std::to_string(i);
+            }
+            if (is_specialized)
+            {
+                specialized_entries.insert(std::make_pair(hash(gid, qubits), specialized_entry_t{gid, qubits, e}));
+            }
+            else if (is_parameterized)
+            {
+                auto & by_count = gates[gid].parameterized_by_count;
+                if (by_count.size() <= tokens.size())
+                {
+                    by_count.resize(tokens.size() + 1, size_t(no_entry));
+                }
+                by_count[tokens.size()] = e;
+            }
+        }
+    }
+
+    // the id of a gate name, or no_gate_id when no instruction has that name
+    gate_id_t id(const std::string & gname) const
+    {
+        auto it = ids.find(gname);
+        return it == ids.end() ? no_gate_id : it->second;
+    }
+
+    const instruction_entry_t * specialized(gate_id_t gid, const std::vector<size_t> & qubits) const
+    {
+        if (gid == no_gate_id || qubits.empty())
+        {
+            return nullptr;
+        }
+        auto range = specialized_entries.equal_range(hash(gid, qubits));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second.gid == gid && it->second.qubits == qubits)
+            {
+                return &entries[it->second.entry];
+            }
+        }
+        return nullptr;
+    }
+
+    const instruction_entry_t * parameterized(gate_id_t gid) const
+    {
+        if (gid == no_gate_id)
+        {
+            return nullptr;
+        }
+        return find(gates[gid].parameterized);
+    }
+
+    const instruction_entry_t * parameterized(gate_id_t gid, size_t nparameters) const
+    {
+        if (gid == no_gate_id || nparameters == 0)
+        {
+            return nullptr;
+        }
+        auto & by_count = gates[gid].parameterized_by_count;
+        return nparameters < by_count.size() ? find(by_count[nparameters]) : nullptr;
+    }
+
+private:
+    static const size_t no_entry = std::numeric_limits<size_t>::max();
+
+    class gate_entries_t
+    {
+    public:
+        size_t              parameterized = no_entry;
+        std::vector<size_t> parameterized_by_count;     // by number of parameters
+    };
+
+    class specialized_entry_t
+    {
+    public:
+        gate_id_t           gid;
+        std::vector<size_t> qubits;
+        size_t              entry;
+    };
+
+    std::vector<instruction_entry_t>    entries;
+    std::unordered_map<std::string, gate_id_t> ids;
+    std::vector<gate_entries_t>         gates;          // by gate id
+    std::unordered_multimap<size_t, specialized_entry_t> specialized_entries;  // by hash of gate id and qubits
+
+    const instruction_entry_t * find(size_t e) const
+    {
+        return e == no_entry ? nullptr : &entries[e];
+    }
+
+    gate_id_t intern(const std::string & gname)
+    {
+        auto it = ids.find(gname);
+        if (it == ids.end())
+        {
+            it = ids.insert(std::make_pair(gname, gates.size())).first;
+            gates.emplace_back();
+        }
+        return it->second;
+    }
+
+    static size_t hash(gate_id_t gid, const std::vector<size_t> & qubits)
+    {
+        // FNV-1a over the gate id and the qubits
+        uint64_t h = (14695981039346656037ULL ^ (uint64_t) gid) * 1099511628211ULL;
+        for (auto q : qubits)
+        {
+            h = (h ^ (uint64_t) q) * 1099511628211ULL;
+        }
+        return (size_t) h;
+    }
+
+    static std::vector<std::string> split(const std::string & s, char separator)
+    {
+        std::vector<std::string> tokens;
+        size_t begin = 0;
+        for (size_t end = s.find(separator); end != std::string::npos; end = s.find(separator, begin))
+        {
+            tokens.push_back(s.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        tokens.push_back(s.substr(begin));
+        return tokens;
+    }
+
+    // whether token is prefix followed by the number n, written as std::to_string(n) writes it
+    static bool number(const std::string & token, char prefix, size_t & n)
+    {
+        n = 0;
+        if (token.size() < 2 || token[0] != prefix || (token[1] == '0' && token.size() > 2))
+        {
+            return false;
+        }
+        for (size_t i = 1; i < token.size(); i++)
+        {
+            if (!std::isdigit(token[i]))
+            {
+                return false;
+            }
+            n = 10*n + (token[i] - '0');
+        }
+        return true;
+    }
+
+    // the subinstructions of a composite gate; as before, the operands of a subinstruction are separated
+    // by commas or spaces and the number of an operand is what follows its first character
+    static std::vector<sub_instruction_t> parse_decomposition(custom_gate * g, const instruction_map_t & instruction_map)
+    {
+        std::vector<sub_instruction_t> decomposition;
+        if (g->type() != __composite_gate__)
+        {
+            return decomposition;
+        }
+        for (auto & agate : ((composite_gate *) g)->gs)
+        {
+            sub_instruction_t sub;
+            sub.name = agate->name;
+            sub.defined = instruction_map.find(sub.name) != instruction_map.end();
+            sub.valid = true;
+
+            std::string sub_ins = sub.name;
+            std::replace(sub_ins.begin(), sub_ins.end(), ',', ' ');
+            std::istringstream iss(sub_ins);
+            std::vector<std::string> tokens{ std::istream_iterator<std::string>{iss},
+                                             std::istream_iterator<std::string>{} };
+            if (!tokens.empty())
+            {
+                sub.gname = tokens[0];
+            }
+            for (size_t i = 1; i < tokens.size(); i++)
+            {
+                size_t n = 0;
+                sub.valid = sub.valid && parse_size(tokens[i].substr(1), n);
+                sub.args.push_back(n);
+            }
+            decomposition.push_back(sub);
+        }
+        return decomposition;
+    }
+
+    // whether s starts with a number, as std::stoi reads it
+    static bool parse_size(const std::string & s, size_t & n)
+    {
+        try
+        {
+            n = std::stoi(s);
+            return true;
+        }
+        catch (std::exception &)
+        {
+            return false;
+        }
+    }
+};
+
 
 namespace utils
 {
@@ -11,6 +11,10 @@
 #include "gate.h"
 
 #include <vector>
+#include <string>
+#include <unordered_map>
+#include <limits>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <list>
@@ -20,31 +24,165 @@ namespace ql
 {
     namespace ir
     {
-        typedef std::list<ql::gate *>section_t;
+        // interned id of the kind of instruction of a section;
+        // sections of a bundle with the same id can be combined into one, see combine_sections()
+        typedef size_t instruction_id_t;
+        const instruction_id_t no_instruction_id = std::numeric_limits<instruction_id_t>::max();
+
+        // dense instruction ids for names of instructions, in order of first use
+        class instruction_ids_t
+        {
+        public:
+            instruction_id_t id(const std::string & name)
+            {
+                auto it = ids.find(name);
+                if (it == ids.end())
+                {
+                    it = ids.insert(std::make_pair(name, names.size())).first;
+                    names.push_back(name);
+                }
+                return it->second;
+            }
+
+            const std::string & name(instruction_id_t id) const
+            {
+                return names[id];
+            }
+
+            size_t size() const
+            {
+                return names.size();
+            }
+
+        private:
+            std::unordered_map<std::string, instruction_id_t> ids;
+            std::vector<std::string> names;
+        };
+
+        // a parallel section: the gates [begin_gate, end_gate) of bundles_t::gates
+        class section_t
+        {
+        public:
+            size_t begin_gate;
+            size_t end_gate;
+            instruction_id_t id;                        // no_instruction_id when not to be combined
+        };
+
+        // a bundle: the sections [begin_section, end_section) of bundles_t::sections
         class bundle_t
         {
         public:
-            size_t start_cycle;                         // start cycle for all gates in parallel_sections
-            size_t duration_in_cycles;                  // the maximum gate duration in parallel_sections
-            std::list<section_t> parallel_sections;
+            size_t start_cycle;                         // start cycle for all gates in its sections
+            size_t duration_in_cycles;                  // the maximum gate duration in its sections
+            size_t begin_section;
+            size_t end_section;
+        };
+
+        // contiguous range of the sections of a bundle, or of the gates of a section or bundle
+        template <class T>
+        class range_t
+        {
+        public:
+            range_t(T * b, T * e) : b(b), e(e) {}
+            T * begin() const { return b; }
+            T * end() const { return e; }
+            size_t size() const { return e - b; }
+            bool empty() const { return b == e; }
+            T & front() const { return *b; }
+            T & back() const { return *(e - 1); }
+        private:
+            T * b;
+            T * e;
         };
 
-        typedef std::list<bundle_t>bundles_t;           // note that subsequent bundles can overlap in time
+        // the bundles of a circuit, stored flat: the gates of all sections of all bundles are in one vector,
+        // in the order of the bundles and of their sections, the sections of all bundles in another,
+        // so that creating and traversing bundles does not allocate per bundle, section or gate;
+        // iterating over bundles_t iterates over its bundles;
+        // note that subsequent bundles can overlap in time
+        class bundles_t
+        {
+        public:
+            std::vector<bundle_t>   bundles;
+            std::vector<section_t>  sections;
+            std::vector<ql::gate *> gates;
+
+            std::vector<bundle_t>::iterator begin() { return bundles.begin(); }
+            std::vector<bundle_t>::iterator end() { return bundles.end(); }
+            std::vector<bundle_t>::const_iterator begin() const { return bundles.begin(); }
+            std::vector<bundle_t>::const_iterator end() const { return bundles.end(); }
+            size_t size() const { return bundles.size(); }
+            bool empty() const { return bundles.empty(); }
+            bundle_t & front() { return bundles.front(); }
+            bundle_t & back() { return bundles.back(); }
+            const bundle_t & front() const { return bundles.front(); }
+            const bundle_t & back() const { return bundles.back(); }
+
+            range_t<section_t> sections_of(const bundle_t & b)
+            {
+                return range_t<section_t>(sections.data() + b.begin_section, sections.data() + b.end_section);
+            }
+
+            range_t<const section_t> sections_of(const bundle_t & b) const
+            {
+                return range_t<const section_t>(sections.data() + b.begin_section, sections.data() + b.end_section);
+            }
+
+            range_t<ql::gate * const> gates_of(const section_t & s) const
+            {
+                return range_t<ql::gate * const>(gates.data() + s.begin_gate, gates.data() + s.end_gate);
+            }
+
+            // the gates of all sections of a bundle, which are contiguous also when its sections were reordered
+            range_t<ql::gate * const> gates_of(const bundle_t & b) const
+            {
+                if (b.begin_section == b.end_section)
+                {
+                    return range_t<ql::gate * const>(gates.data(), gates.data());
+                }
+                size_t begin_gate = sections[b.begin_section].begin_gate;
+                size_t end_gate = sections[b.begin_section].end_gate;
+                for (size_t s = b.begin_section + 1; s < b.end_section; s++)
+                {
+                    begin_gate = std::min(begin_gate, sections[s].begin_gate);
+                    end_gate = std::max(end_gate, sections[s].end_gate);
+                }
+                return range_t<ql::gate * const>(gates.data() + begin_gate, gates.data() + end_gate);
+            }
+
+            // append a new empty bundle
+            void add_bundle(size_t start_cycle, size_t duration_in_cycles)
+            {
+                bundles.push_back(bundle_t{start_cycle, duration_in_cycles, sections.size(), sections.size()});
+            }
+
+            // append a new empty section to the last bundle
+            void add_section(instruction_id_t id = no_instruction_id)
+            {
+                sections.push_back(section_t{gates.size(), gates.size(), id});
+                bundles.back().end_section = sections.size();
+            }
+
+            // append a gate to the last section of the last bundle
+            void add_gate(ql::gate * gp)
+            {
+                gates.push_back(gp);
+                sections.back().end_gate = gates.size();
+            }
+        };
 
         // create a circuit with valid cycle values from the bundled internal representation
         inline ql::circuit circuiter(bundles_t & bundles)
         {
             ql::circuit circ;
+            circ.reserve(bundles.gates.size());
 
             for (bundle_t & abundle : bundles)
             {
-                for( auto sec_it = abundle.parallel_sections.begin(); sec_it != abundle.parallel_sections.end(); ++sec_it )
+                for (auto gp : bundles.gates_of(abundle))
                 {
-                    for ( auto gp : (*sec_it))
-                    {
-                        gp->cycle = abundle.start_cycle;
-                        circ.push_back(gp);
-                    }
+                    gp->cycle = abundle.start_cycle;
+                    circ.push_back(gp);
                 }
             }
             // the bundles are in increasing order of their start_cycle
@@ -75,23 +213,17 @@ namespace ql
                 // else
                 //   ssqasm << '\n';
 
-                auto ngates = 0;
-                for( auto sec_it = abundle.parallel_sections.begin(); sec_it != abundle.parallel_sections.end(); ++sec_it )
-                {
-                    ngates += sec_it->size();
-                }
+                auto bundle_gates = bundles.gates_of(abundle);
+                auto ngates = bundle_gates.size();
                 ssqasm << "    ";
                 if (ngates > 1) ssqasm << "{ ";
                 auto isfirst = 1;
-                for( auto sec_it = abundle.parallel_sections.begin(); sec_it != abundle.parallel_sections.end(); ++sec_it )
+                for (auto gp : bundle_gates)
                 {
-                    for ( auto gp : (*sec_it))
-                    {
-                        if (isfirst == 0)
-                            ssqasm << " | ";
-                        ssqasm << gp->qasm();
-                        isfirst = 0;
-                    }
+                    if (isfirst == 0)
+                        ssqasm << " | ";
+                    ssqasm << gp->qasm();
+                    isfirst = 0;
                 }
                 if (ngates > 1) ssqasm << " }";
                 curr_cycle+=delta;
@@ -113,23 +245,19 @@ namespace ql
         //
         // assumes gatep->cycle attribute reflects the cycle assignment;
         // assumes circuit being a vector of gate pointers is ordered by this cycle value;
-        // create bundles in a single scan over the circuit, using currBundle and currCycle as state:
-        // - currBundle: bundle that is being put together; currBundle copied into output bundles when the bundle has been done
-        // - currCycle: cycle at which currBundle will be put; equals cycle value of all contained gates
+        // create bundles in a single scan over the circuit, appending each gate in a section of its own
+        // to the last bundle when it is at the same cycle, or else to a new bundle at its cycle;
+        // the sections have no_instruction_id, see combine_sections() for combining them
         //
         // FIXME HvS cycles_valid must be true before each call to this bundler
         inline bundles_t bundler(ql::circuit& circ, size_t cycle_time)
         {
             bundles_t bundles;          // result bundles
-        
-            bundle_t    currBundle;     // current bundle at currCycle that is being filled
-            size_t      currCycle = 0;  // cycle at which bundle is to be scheduled
-    
-            currBundle.start_cycle = currCycle; // starts off as empty bundle starting at currCycle
-            currBundle.duration_in_cycles = 0;
-    
+            bundles.gates.reserve(circ.size());
+            bundles.sections.reserve(circ.size());
+
             DOUT("bundler ...");
-    
+
             for (auto & gp: circ)
             {
                 DOUT(". adding gate(@" << gp->cycle << ")  " << gp->qasm());
@@ -141,58 +269,23 @@ namespace ql
                     continue;
                 }
                 size_t newCycle = gp->cycle;        // taking cycle values from circuit, so excludes SOURCE and SINK!
-                if (newCycle < currCycle)
+                if (!bundles.empty() && newCycle < bundles.back().start_cycle)
                 {
                     FATAL("Error: circuit not ordered by cycle value");
                 }
-                if (newCycle > currCycle)
+                if (bundles.empty() || newCycle > bundles.back().start_cycle)
                 {
-                    if (!currBundle.parallel_sections.empty())
-                    {
-                        // finish currBundle at currCycle
-                        // DOUT(".. bundle at cycle " << currCycle << " duration in cycles: " << currBundle.duration_in_cycles);
-                        // for (auto &s : currBundle.parallel_sections)
-                        // {
-                        //     for (auto &sgp: s)
-                        //     {
-                        //         DOUT("... with gate(@" << sgp->cycle << ")  " << sgp->qasm());
-                        //     }
-                        // }
-                        bundles.push_back(currBundle);
-                        DOUT(".. ready with bundle at cycle " << currCycle);
-                        currBundle.parallel_sections.clear();
-                    }
-    
-                    // new empty currBundle at newCycle
-                    currCycle = newCycle;
-                    // DOUT(".. bundling at cycle: " << currCycle);
-                    currBundle.start_cycle = currCycle;
-                    currBundle.duration_in_cycles = 0;
+                    // new empty bundle at newCycle
+                    bundles.add_bundle(newCycle, 0);
                 }
-    
-                // add gp to currBundle
-                section_t asec;
-                asec.push_back(gp);
-                currBundle.parallel_sections.push_back(asec);
-                // DOUT("... gate: " << gp->qasm() << " in private parallel section");
-                currBundle.duration_in_cycles = std::max(currBundle.duration_in_cycles, (gp->duration+cycle_time-1)/cycle_time); 
-            }
-            if (!currBundle.parallel_sections.empty())
-            {
-                // finish currBundle (which is last bundle) at currCycle
-                // DOUT("... bundle at cycle " << currCycle << " duration in cycles: " << currBundle.duration_in_cycles);
-                // for (auto &s : currBundle.parallel_sections)
-                // {
-                //     for (auto &sgp: s)
-                //     {
-                //         DOUT("... with gate(@" << sgp->cycle << ")  " << sgp->qasm());
-                //     }
-                // }
-                bundles.push_back(currBundle);
-                DOUT(".. ready with bundle at cycle " << currCycle);
-            }
-    
-            // currCycle == cycle of last gate of circuit scheduled
+
+                // add gp to the last bundle, in a private parallel section
+                bundles.add_section();
+                bundles.add_gate(gp);
+                bundles.back().duration_in_cycles = std::max(bundles.back().duration_in_cycles, (gp->duration+cycle_time-1)/cycle_time);
+            }
+
+            // the last bundle's start_cycle == cycle of last gate of circuit scheduled
             // duration_in_cycles later the system starts idling
             // depth is the difference between the cycle in which it starts idling and the cycle it started execution
             if (bundles.empty())
@@ -201,23 +294,90 @@ namespace ql
             }
             else
             {
-                DOUT("Depth: " << currCycle + currBundle.duration_in_cycles - bundles.front().start_cycle);
+                DOUT("Depth: " << bundles.back().start_cycle + bundles.back().duration_in_cycles - bundles.front().start_cycle);
             }
             DOUT("bundler [DONE]");
             return bundles;
         }
 
+        // combine the sections of each bundle that have the same instruction id into a single section,
+        // at the place of the first of them, keeping the order of the gates;
+        // sections with no_instruction_id are not combined;
+        // linear in the number of gates, using a slot per instruction id that is valid for the current bundle only
+        inline void combine_sections(bundles_t & bundles)
+        {
+            bundles_t combined;
+            combined.bundles.reserve(bundles.bundles.size());
+            combined.sections.reserve(bundles.sections.size());
+            combined.gates.resize(bundles.gates.size());
+
+            std::vector<size_t> slot;           // by instruction id: its combined section, if in current bundle
+            std::vector<size_t> target;         // by section of the current bundle: its combined section
+            size_t ngates = 0;
+            for (bundle_t & abundle : bundles)
+            {
+                combined.add_bundle(abundle.start_cycle, abundle.duration_in_cycles);
+                size_t first = combined.sections.size();
+
+                // find the combined section of each section, counting its gates in end_gate
+                target.clear();
+                for (auto & sec : bundles.sections_of(abundle))
+                {
+                    size_t t = MAX_CYCLE;
+                    if (sec.id != no_instruction_id)
+                    {
+                        if (sec.id >= slot.size())
+                        {
+                            slot.resize(sec.id + 1, MAX_CYCLE);
+                        }
+                        t = slot[sec.id];
+                    }
+                    if (t == MAX_CYCLE || t < first)
+                    {
+                        t = combined.sections.size();
+                        combined.sections.push_back(section_t{0, 0, sec.id});
+                        if (sec.id != no_instruction_id)
+                        {
+                            slot[sec.id] = t;
+                        }
+                    }
+                    combined.sections[t].end_gate += sec.end_gate - sec.begin_gate;
+                    target.push_back(t);
+                }
+                combined.bundles.back().end_section = combined.sections.size();
+
+                // lay out the combined sections, and then move the gates into them
+                for (size_t t = first; t < combined.sections.size(); t++)
+                {
+                    size_t n = combined.sections[t].end_gate;
+                    combined.sections[t].begin_gate = ngates;
+                    combined.sections[t].end_gate = ngates;
+                    ngates += n;
+                }
+                size_t s = 0;
+                for (auto & sec : bundles.sections_of(abundle))
+                {
+                    section_t & csec = combined.sections[target[s++]];
+                    for (auto gp : bundles.gates_of(sec))
+                    {
+                        combined.gates[csec.end_gate++] = gp;
+                    }
+                }
+            }
+            bundles = std::move(combined);
+        }
+
         // print the bundles with an indication (taken from 'at') from where this function was called
         inline void DebugBundles(std::string at, bundles_t& bundles)
         {
             DOUT("DebugBundles at: " << at << " showing " << bundles.size() << " bundles");
             for (bundle_t & abundle : bundles)
             {
-                DOUT("... bundle with nsections: " << abundle.parallel_sections.size());
-                for( auto secIt = abundle.parallel_sections.begin(); secIt != abundle.parallel_sections.end(); ++secIt )
+                DOUT("... bundle with nsections: " << bundles.sections_of(abundle).size());
+                for (auto & sec : bundles.sections_of(abundle))
                 {
-                    DOUT("... section with ngates: " << secIt->size());
-                    for ( auto gp : (*secIt))
+                    DOUT("... section with ngates: " << bundles.gates_of(sec).size());
+                    for (auto gp : bundles.gates_of(sec))
                     {
                         // auto n = get_cc_light_instruction_name(gp->name, platform);
                         DOUT("... ... gate: " << gp->qasm() << " name: " << gp->name << " cc_light_iname: " << "?");
@@ -13,6 +13,7 @@
 #include <sstream>
 #include <algorithm>
 #include <iterator>
+#include <memory>
 
 
 #define K_PI 3.141592653589793238462643383279502884197169399375105820974944592307816406L
@@ -26,9 +27,29 @@
 #include "unitary.h"
 #include "platform.h"
 
+class Scheduler;    // dependence graph, see scheduler.h
 
 namespace ql
 {
+/**
+ * holds the dependence graph of a kernel's circuit that the schedulers keep between passes
+ * to update it incrementally (see Scheduler::update); it is not copied with the kernel,
+ * so that each copy of a kernel creates its own
+ */
+class dependence_graph_holder
+{
+public:
+    std::shared_ptr<Scheduler> graph;
+
+    dependence_graph_holder() {}
+    dependence_graph_holder(const dependence_graph_holder&) {}
+    dependence_graph_holder& operator=(const dependence_graph_holder&)
+    {
+        graph.reset();
+        return *this;
+    }
+};
+
 enum class kernel_type_t
 {
     STATIC,
@@ -54,6 +75,8 @@ public: // FIXME: should be private
     operation     br_condition;
     size_t        cycle_time;   // FIXME HvS just a copy of platform.cycle_time
     instruction_map_t instruction_map;
+    std::shared_ptr<const instruction_table_t> instruction_table;  // see get_instruction_table()
+    dependence_graph_holder ddg;        // kept by the schedulers, see scheduler.h
 
 public:
     quantum_kernel(std::string name) :
@@ -65,6 +88,7 @@ public:
         creg_count(ccount), type(kernel_type_t::STATIC)
     {
         instruction_map = platform.instruction_map;
+        instruction_table = platform.instruction_table;
         cycle_time = platform.cycle_time;
         cycles_valid = true;
         // FIXME: check qubit_count and creg_count against platform
@@ -611,98 +635,107 @@ private:
         return result;
     }
 
+    // the index of instruction_map by gate id and operands; normally the platform's,
+    // created from instruction_map when the kernel was not created for a platform
+    const instruction_table_t & get_instruction_table()
+    {
+        if (!instruction_table)
+        {
+            instruction_table = std::make_shared<const instruction_table_t>(instruction_map);
+        }
+        return *instruction_table;
+    }
+
+    // add a copy of custom gate definition g to circuit, with the given operands
+    void add_custom_gate(const custom_gate * g, const std::vector<size_t> & qubits,
+                         const std::vector<size_t> & cregs, size_t duration, double angle)
+    {
+        custom_gate* ng = new custom_gate(*g);
+        ng->operands = qubits;
+        ng->creg_operands.insert(ng->creg_operands.end(), cregs.begin(), cregs.end());
+        if(duration>0) ng->duration = duration;
+        ng->angle = angle;
+        c.push_back(ng);
+    }
+
     // if a specialized custom gate ("e.g. cz q0,q4") is available, add it to circuit and return true
     // if a parameterized custom gate ("e.g. cz") is available, add it to circuit and return true
     //
     // note that there is no check for the found gate being a composite gate
-    bool add_custom_gate_if_available(std::string & gname, std::vector<size_t> qubits,
-                                      std::vector<size_t> cregs = {}, size_t duration=0, double angle=0.0)
+    bool add_custom_gate_if_available(const std::string & gname, const std::vector<size_t> & qubits,
+                                      const std::vector<size_t> & cregs = {}, size_t duration=0, double angle=0.0)
     {
-        bool added = false;
 #if OPT_DECOMPOSE_WAIT_BARRIER  // hack to skip wait/barrier
         if(gname=="wait" || gname=="barrier")
         {
-            return added;   // return, so a default gate will be attempted
+            return false;   // return, so a default gate will be attempted
         }
 #endif
-        // construct canonical name
-        std::string instr = gname + " ";
-        if(qubits.size() > 0)
-        {
-            for (size_t i=0; i<(qubits.size()-1); ++i)
-                instr += "q" + std::to_string(qubits[i]) + ",";
-            if(qubits.size() >= 1) // to make if work with gates without operands
-                instr += "q" + std::to_string(qubits[qubits.size()-1]);
-        }
-
-        // first check if a specialized custom gate is available
-        instruction_map_t::iterator it = instruction_map.find(instr);
-        if (it != instruction_map.end())
-        {
-            // a specialized custom gate is of the form: "cz q0 q3"
-            custom_gate* g = new custom_gate(*(it->second));
-            for(auto & qubit : qubits)
-                g->operands.push_back(qubit);
-            for(auto & cop : cregs)
-                g->creg_operands.push_back(cop);
-            if(duration>0) g->duration = duration;
-            g->angle = angle;
-            added = true;
-            c.push_back(g);
-        }
-        else
-        {
-            // otherwise, check if there is a parameterized custom gate (i.e. not specialized for arguments)
-            // this one is of the form: "cz", i.e. just the gate's name
-            instruction_map_t::iterator it = instruction_map.find(gname);
-            if (it != instruction_map.end())
-            {
-                // FIXME: body identical to above, just perform two finds with single body
-                custom_gate* g = new custom_gate(*(it->second));
-                for(auto & qubit : qubits)
-                    g->operands.push_back(qubit);
-                for(auto & cop : cregs)
-                    g->creg_operands.push_back(cop);
-                if(duration>0) g->duration = duration;
-                g->angle = angle;
-                added = true;
-                c.push_back(g);
-            }
-        }
+        const instruction_table_t & table = get_instruction_table();
+        gate_id_t gid = table.id(gname);
 
-        if(added)
+        // first check if a specialized custom gate is available, of the form: "cz q0,q3";
+        // otherwise, check if there is a parameterized custom gate (i.e. not specialized for arguments),
+        // of the form: "cz", i.e. just the gate's name
+        const instruction_entry_t * entry = table.specialized(gid, qubits);
+        if (!entry)
         {
-            DOUT("custom gate added for " << gname);
+            entry = table.parameterized(gid);
         }
-        else
+
+        if (!entry)
         {
             DOUT("custom gate not added for " << gname);
+            return false;
         }
+        add_custom_gate(entry->gate, qubits, cregs, duration, angle);
+        DOUT("custom gate added for " << gname);
+        return true;
+    }
 
-        return added;
+    // add a subinstruction of a decomposition as custom gate, or else as default gate when these are enabled;
+    // fail when neither is available
+    void add_sub_instruction(const sub_instruction_t & sub, const std::vector<size_t> & this_gate_qubits,
+                             const std::vector<size_t> & cregs)
+    {
+        // custom gate check
+        // when found, custom_added is true, and the expanded subinstruction was added to the circuit
+        bool custom_added = add_custom_gate_if_available(sub.gname, this_gate_qubits, cregs);
+        if(!custom_added)
+        {
+            if(ql::options::get("use_default_gates") == "yes")
+            {
+                // default gate check
+                DOUT("adding default gate for " << sub.gname);
+                bool default_available = add_default_gate_if_available(sub.gname, this_gate_qubits, cregs);
+                if( default_available )
+                {
+                    WOUT("added default gate '" << sub.gname << "' with " << ql::utils::to_string(this_gate_qubits,"qubits") );
+                    return;
+                }
+            }
+            EOUT("unknown gate '" << sub.gname << "' with " << ql::utils::to_string(this_gate_qubits,"qubits") );
+            throw ql::exception("[x] error : ql::kernel::gate() : the gate '"+sub.gname+"' with " +ql::utils::to_string(this_gate_qubits,"qubits")+" is not supported by the target platform !",false);
+        }
     }
 
-    // FIXME: move to class composite_gate?
-    // return the subinstructions of a composite gate
-    // while doing, test whether the subinstructions have a definition (so they cannot be specialized or default ones!)
-    void get_decomposed_ins( ql::composite_gate * gptr, std::vector<std::string> & sub_instructons )
+    // the subinstructions of a composite gate, checking that they have a definition
+    // (so they cannot be specialized or default ones!)
+    const std::vector<sub_instruction_t> & get_decomposed_ins(const instruction_entry_t & entry)
     {
-        auto & sub_gates = gptr->gs;
-        DOUT("composite ins: " << gptr->name);
-        for(auto & agate : sub_gates)
+        DOUT("composite ins: " << entry.gate->name);
+        for(auto & sub : entry.decomposition)
         {
-            std::string & sub_ins = agate->name;
-            DOUT("  sub ins: " << sub_ins);
-            auto it = instruction_map.find(sub_ins);
-            if( it != instruction_map.end() )
+            if( !sub.defined )
             {
-                sub_instructons.push_back(sub_ins);
+                throw ql::exception("[x] error : ql::kernel::gate() : gate decomposition not available for '"+sub.name+"'' in the target platform !",false);
             }
-            else
+            if( !sub.valid )
             {
-                throw ql::exception("[x] error : ql::kernel::gate() : gate decomposition not available for '"+sub_ins+"'' in the target platform !",false);
+                throw ql::exception("[x] error : ql::kernel::gate() : invalid operand in subinstruction '"+sub.name+"' of '"+entry.gate->name+"' !",false);
             }
         }
+        return entry.decomposition;
     }
 
     // if specialized composed gate: "e.g. cz q0,q3" available, with composition of subinstructions, return true
@@ -711,107 +744,33 @@ private:
     // don't add anything to circuit
     //
     // add specialized decomposed gate, example JSON definition: "cl_14 q1": ["rx90 %0", "rym90 %0", "rxm90 %0"]
-    bool add_spec_decomposed_gate_if_available(std::string gate_name,
-            std::vector<size_t> all_qubits, std::vector<size_t> cregs = {})
+    bool add_spec_decomposed_gate_if_available(const std::string & gate_name,
+            const std::vector<size_t> & all_qubits, const std::vector<size_t> & cregs = {})
     {
-        bool added = false;
         DOUT("Checking if specialized decomposition is available for " << gate_name);
-
-        // construct canonical name
-        std::string instr_parameterized = gate_name + " ";
-        size_t i;
-        if(all_qubits.size() > 0)
+        const instruction_table_t & table = get_instruction_table();
+        const instruction_entry_t * entry = table.specialized(table.id(gate_name), all_qubits);
+        if( !entry )
         {
-            for(i=0; i<all_qubits.size()-1; i++)
-            {
-                instr_parameterized += "q" + std::to_string(all_qubits[i]) + ",";
-            }
-            if(all_qubits.size() >= 1)
-            {
-                instr_parameterized += "q" + std::to_string(all_qubits[i]);
-            }
+            DOUT("composite gate not found for " << gate_name << " with " << ql::utils::to_string(all_qubits,"qubits"));
+            return false;
         }
-        DOUT("specialized instruction name: " << instr_parameterized);
 
-        // find the name
-        auto it = instruction_map.find(instr_parameterized);
-        if( it != instruction_map.end() )
+        // check gate type
+        DOUT("specialized composite gate found for " << entry->gate->name);
+        if( __composite_gate__ != entry->gate->type() )
         {
-            // check gate type
-            DOUT("specialized composite gate found for " << instr_parameterized);
-            composite_gate * gptr = (composite_gate *)(it->second);
-            if( __composite_gate__ == gptr->type() )
-            {
-                DOUT("composite gate type");
-            }
-            else
-            {
-                DOUT("not a composite gate type");
-                return false;
-            }
-
-            // perform decomposition
-            std::vector<std::string> sub_instructons;
-            get_decomposed_ins( gptr, sub_instructons );
-            for(auto & sub_ins : sub_instructons)
-            {
-                // extract name and qubits
-                DOUT("Adding sub ins: " << sub_ins);
-                std::replace( sub_ins.begin(), sub_ins.end(), ',', ' ');    // FIXME: perform all conversions in sanitize_instruction_name()
-                DOUT(" after comma removal, sub ins: " << sub_ins);
-                std::istringstream iss(sub_ins);
-
-                std::vector<std::string> tokens{ std::istream_iterator<std::string>{iss},
-                                                 std::istream_iterator<std::string>{} };
-
-                std::vector<size_t> this_gate_qubits;
-                std::string & sub_ins_name = tokens[0];
-
-                for(size_t i=1; i<tokens.size(); i++)
-                {
-                    DOUT("tokens[i] : " << tokens[i]);
-                    auto sub_str_token = tokens[i].substr(1);
-                    DOUT("sub_str_token[i] : " << sub_str_token);
-                    this_gate_qubits.push_back( stoi( tokens[i].substr(1) ) );
-                }
-
-                DOUT( ql::utils::to_string<size_t>(this_gate_qubits, "actual qubits of this gate:") );
-
-                // custom gate check
-                // when found, custom_added is true, and the expanded subinstruction was added to the circuit
-                bool custom_added = add_custom_gate_if_available(sub_ins_name, this_gate_qubits, cregs);
-                if(!custom_added)
-                {
-                    if(ql::options::get("use_default_gates") == "yes")
-                    {
-                        // default gate check
-                        DOUT("adding default gate for " << sub_ins_name);
-                        bool default_available = add_default_gate_if_available(sub_ins_name, this_gate_qubits, cregs);
-                        if( default_available )
-                        {
-                            WOUT("added default gate '" << sub_ins_name << "' with " << ql::utils::to_string(this_gate_qubits,"qubits") );
-                        }
-                        else
-                        {
-                            EOUT("unknown gate '" << sub_ins_name << "' with " << ql::utils::to_string(this_gate_qubits,"qubits") );
-                            throw ql::exception("[x] error : ql::kernel::gate() : the gate '"+sub_ins_name+"' with " +ql::utils::to_string(this_gate_qubits,"qubits")+" is not supported by the target platform !",false);
-                        }
-                    }
-                    else
-                    {
-                        EOUT("unknown gate '" << sub_ins_name << "' with " << ql::utils::to_string(this_gate_qubits,"qubits") );
-                        throw ql::exception("[x] error : ql::kernel::gate() : the gate '"+sub_ins_name+"' with " +ql::utils::to_string(this_gate_qubits,"qubits")+" is not supported by the target platform !",false);
-                    }
-                }
-            }
-            added = true;
+            DOUT("not a composite gate type");
+            return false;
         }
-        else
+
+        // perform decomposition; the operands of the subinstructions are the qubits themselves
+        for(auto & sub : get_decomposed_ins(*entry))
         {
-            DOUT("composite gate not found for " << instr_parameterized);
+            DOUT("Adding sub ins: " << sub.name);
+            add_sub_instruction(sub, sub.args, cregs);
         }
-
-        return added;
+        return true;
     }
 
     // if composite gate: "e.g. cz %0 %1" available, return true;
@@ -820,110 +779,45 @@ private:
     // don't add anything to circuit
     //
     // add parameterized decomposed gate, example JSON definition: "cl_14 %0": ["rx90 %0", "rym90 %0", "rxm90 %0"]
-    bool add_param_decomposed_gate_if_available(std::string gate_name,
-            std::vector<size_t> all_qubits, std::vector<size_t> cregs = {})
+    bool add_param_decomposed_gate_if_available(const std::string & gate_name,
+            const std::vector<size_t> & all_qubits, const std::vector<size_t> & cregs = {})
     {
-        bool added = false;
         DOUT("Checking if parameterized composite gate is available for " << gate_name);
-
-        // construct instruction name from gate_name and actual qubit parameters
-        std::string instr_parameterized = gate_name + " ";
-        size_t i;
-        if(all_qubits.size() > 0)
+        const instruction_table_t & table = get_instruction_table();
+        const instruction_entry_t * entry = table.parameterized(table.id(gate_name), all_qubits.size());
+        if( !entry )
         {
-            for(i=0; i<all_qubits.size()-1; i++)
-            {
-                instr_parameterized += "%" + std::to_string(i) + ",";
-            }
-            if(all_qubits.size() >= 1)
-            {
-                instr_parameterized += "%" + std::to_string(i);
-            }
+            DOUT("composite gate not found for " << gate_name << " with " << all_qubits.size() << " parameters");
+            return false;
         }
-        DOUT("parameterized instruction name: " << instr_parameterized);
 
-        // check for composite ins
-        auto it = instruction_map.find(instr_parameterized);
-        if( it != instruction_map.end() )
+        DOUT("parameterized gate found for " << entry->gate->name);
+        if( __composite_gate__ != entry->gate->type() )
         {
-            DOUT("parameterized gate found for " << instr_parameterized);
-            composite_gate * gptr = (composite_gate *)(it->second);
-            if( __composite_gate__ == gptr->type() )
-            {
-                DOUT("composite gate type");
-            }
-            else
-            {
-                DOUT("Not a composite gate type");
-                return false;
-            }
+            DOUT("Not a composite gate type");
+            return false;
+        }
 
-            std::vector<std::string> sub_instructons;
-            get_decomposed_ins( gptr, sub_instructons );
-            for(auto & sub_ins : sub_instructons)
+        // perform decomposition; the operands of the subinstructions are indices in all_qubits
+        std::vector<size_t> this_gate_qubits;
+        for(auto & sub : get_decomposed_ins(*entry))
+        {
+            DOUT("Adding sub ins: " << sub.name);
+            this_gate_qubits.clear();
+            for(auto qubit_idx : sub.args)
             {
-                DOUT("Adding sub ins: " << sub_ins);
-                std::replace( sub_ins.begin(), sub_ins.end(), ',', ' ');
-                DOUT(" after comma removal, sub ins: " << sub_ins);
-
-                // tokenize sub_ins into sub_ins_name and this_gate_qubits
-                // FIXME: similar code in add_spec_decomposed_gate_if_available()
-                std::istringstream iss(sub_ins);
-                std::vector<std::string> tokens{ std::istream_iterator<std::string>{iss},
-                                                 std::istream_iterator<std::string>{} };
-
-                std::vector<size_t> this_gate_qubits;
-                std::string & sub_ins_name = tokens[0];
-
-                for(size_t i=1; i<tokens.size(); i++)
-                {
-                    auto sub_str_token = tokens[i].substr(1);   // example: tokens[i] equals "%1" -> sub_str_token equals "1"
-                    size_t qubit_idx = stoi(sub_str_token);
-                    if(qubit_idx >= all_qubits.size()) {
-                        FATAL("Illegal qubit parameter index " << sub_str_token
-                              << " exceeds actual number of parameters given (" << all_qubits.size()
-                              << ") while adding sub ins '" << sub_ins
-                              << "' in parameterized instruction '" << instr_parameterized << "'");
-                    }
-                    this_gate_qubits.push_back( all_qubits[qubit_idx] );
-                }
-                DOUT( ql::utils::to_string<size_t>(this_gate_qubits, "actual qubits of this gate:") );
-
-                // FIXME: following code block exists several times in this file
-                // custom gate check
-                // when found, custom_added is true, and the expanded subinstruction was added to the circuit
-                bool custom_added = add_custom_gate_if_available(sub_ins_name, this_gate_qubits, cregs);
-                if(!custom_added)
-                {
-                    if(ql::options::get("use_default_gates") == "yes")
-                    {
-                        // default gate check
-                        DOUT("adding default gate for " << sub_ins_name);
-                        bool default_available = add_default_gate_if_available(sub_ins_name, this_gate_qubits, cregs);
-                        if( default_available )
-                        {
-                            WOUT("added default gate '" << sub_ins_name << "' with " << ql::utils::to_string(this_gate_qubits,"qubits") );
-                        }
-                        else
-                        {
-                            EOUT("unknown gate '" << sub_ins_name << "' with " << ql::utils::to_string(this_gate_qubits,"qubits") );
-                            throw ql::exception("[x] error : ql::kernel::gate() : the gate '"+sub_ins_name+"' with " +ql::utils::to_string(this_gate_qubits,"qubits")+" is not supported by the target platform !",false);
-                        }
-                    }
-                    else
-                    {
-                        EOUT("unknown gate '" << sub_ins_name << "' with " << ql::utils::to_string(this_gate_qubits,"qubits") );
-                        throw ql::exception("[x] error : ql::kernel::gate() : the gate '"+sub_ins_name+"' with " +ql::utils::to_string(this_gate_qubits,"qubits")+" is not supported by the target platform !",false);
-                    }
+                if(qubit_idx >= all_qubits.size()) {
+                    FATAL("Illegal qubit parameter index " << qubit_idx
+                          << " exceeds actual number of parameters given (" << all_qubits.size()
+                          << ") while adding sub ins '" << sub.name
+                          << "' in parameterized instruction '" << entry->gate->name << "'");
                 }
+                this_gate_qubits.push_back( all_qubits[qubit_idx] );
             }
-            added = true;
+            DOUT( ql::utils::to_string<size_t>(this_gate_qubits, "actual qubits of this gate:") );
+            add_sub_instruction(sub, this_gate_qubits, cregs);
         }
-        else
-        {
-            DOUT("composite gate not found for " << instr_parameterized);
-        }
-        return added;
+        return true;
     }
 
 /************************************************************************\
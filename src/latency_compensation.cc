@@ -12,6 +12,7 @@
 #include "circuit.h"
 #include "ir.h"
 #include "report.h"
+#include "parallel.h"
 
 #include "latency_compensation.h"
 
@@ -80,10 +81,10 @@ namespace ql
         ql::report_statistics(programp, platform, "in", passname, "# ");
         ql::report_qasm(programp, platform, "in", passname);
 
-        for (size_t k=0; k<programp->kernels.size(); ++k)
+        ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
         {
             latency_compensation_kernel(programp->kernels[k], platform);
-        }
+        });
 
         ql::report_statistics(programp, platform, "out", passname, "# ");
         ql::report_qasm(programp, platform, "out", passname);
@@ -481,8 +481,7 @@ void PlaceBody( ql::circuit& circ, Virt2Real& v2r, ipr_t &result, double& iptime
         DOUT("... end loop body over nfac");
     }
 
-    auto mapinitone2oneopt = ql::options::get("mapinitone2one");
-    if ("yes" == mapinitone2oneopt)
+    if (ql::options::current().mapinitone2one)
     {
         DOUT("... correct location of unused mapped virtual qubits to be an unused location");
         v2r.DPRINT("... result Virt2Real map of InitialPlace before mapping unused mapped virtual qubits ");
@@ -556,9 +555,12 @@ bool PlaceWrapper( ql::circuit& circ, Virt2Real& v2r, ipr_t& result, double& ipt
     }
     iptimetaken = waitseconds;    // pessimistic, in case of timeout, otherwise it is corrected
 
-    // v2r and result are allocated on stack of main thread by some ancestor so be careful with threading
-    std::thread t([&cv, this, &circ, &v2r, &result, &iptimetaken]()
+    // v2r and result are allocated on stack of main thread by some ancestor so be careful with threading;
+    // the subthread may outlive the compilation when detached after a timeout, so it gets its own copy of the options
+    std::shared_ptr<const ql::compile_options_t> options = std::make_shared<const ql::compile_options_t>(ql::options::current());
+    std::thread t([&cv, this, &circ, &v2r, &result, &iptimetaken, options]()
         {
+            ql::options::scope options_scope(options);
             DOUT("InitialPlace.PlaceWrapper subthread about to call PlaceBody");
             PlaceBody(circ, v2r, result, iptimetaken);
             DOUT("InitialPlace.PlaceBody returned in subthread; about to signal the main thread");
@@ -12,6 +12,10 @@
 #include <chrono>
 #include <ctime>
 #include <ratio>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <algorithm>
 #include "utils.h"
 #include "platform.h"
 #include "kernel.h"
@@ -19,6 +23,7 @@
 #include "gate.h"
 #include "scheduler.h"
 #include "metrics.h"
+#include "parallel.h"
 
 // Note on the use of constructors and Init functions for classes of the mapper
 // -----------------------------------------------------------------------------
@@ -43,6 +48,47 @@ static void assert_fail(const char *f, int l, const char *s)
 }
 #define MapperAssert(condition)   { if (!(condition)) { assert_fail(__FILE__, __LINE__, #condition); } }
 
+// =========================================================================================
+// cow_t: copy-on-write holder of a T
+//
+// copies share the T until one of them modifies it (through mut), which then first gets its own copy;
+// this makes copying mapper state for evaluating alternatives cheap,
+// while the alternatives only copy what they really change
+template<class T>
+class cow_t
+{
+private:
+    std::shared_ptr<T>  p;
+
+public:
+    cow_t()
+    {
+    }
+
+    explicit cow_t(const T& value) : p(std::make_shared<T>(value))
+    {
+    }
+
+    const T& operator*() const
+    {
+        return *p;
+    }
+
+    const T* operator->() const
+    {
+        return p.get();
+    }
+
+    T& mut()
+    {
+        if (p.use_count() != 1)
+        {
+            p = std::make_shared<T>(*p);
+        }
+        return *p;
+    }
+};
+
 
 
 // =========================================================================================
@@ -144,11 +190,10 @@ void SetRs(size_t q, realstate_t rsvalue)
 // the rs initializations are done only once, for a whole program
 void Init(size_t n)
 {
-    auto mapinitone2oneopt = ql::options::get("mapinitone2one");
-    auto mapassumezeroinitstate = ql::options::get("mapassumezeroinitstate");
+    const ql::compile_options_t & options = ql::options::current();
 
     nq = n;
-    if ("yes" == mapinitone2oneopt)
+    if (options.mapinitone2one)
     {
         DOUT("Virt2Real::Init(n=" << nq << "), initializing 1-1 mapping");
     }
@@ -156,7 +201,7 @@ void Init(size_t n)
     {
         DOUT("Virt2Real::Init(n=" << nq << "), initializing on demand mapping");
     }
-    if ("yes" == mapassumezeroinitstate)
+    if (options.mapassumezeroinitstate)
     {
         DOUT("Virt2Real::Init(n=" << nq << "), assume all qubits in initialized state");
     }
@@ -168,7 +213,7 @@ void Init(size_t n)
     rs.resize(nq);
     for (size_t i=0; i<nq; i++)
     {
-        if ("yes" == mapinitone2oneopt)
+        if (options.mapinitone2one)
         {
             v2rMap[i] = i;
         }
@@ -176,7 +221,7 @@ void Init(size_t n)
         {
             v2rMap[i] = UNDEFINED_QUBIT;
         }
-        if ("yes" == mapassumezeroinitstate)
+        if (options.mapassumezeroinitstate)
         {
             rs[i] = rs_wasinited;
         }
@@ -414,7 +459,8 @@ private:
     size_t                  nq;      // size of the map; after initialization, will always be the same
     size_t                  ct;      // multiplication factor from cycles to nano-seconds (unit of duration)
     std::vector<size_t>     fcv;     // fcv[real qubit index i]: qubit i is free from this cycle on
-    ql::arch::resource_manager_t rm;  // actual resources occupied by scheduled gates
+    cow_t<ql::arch::resource_manager_t> rm;  // actual resources occupied by scheduled gates, shared by copies until reserved in
+    std::vector<size_t>     savedfcv;   // fcv at the Checkpoint
 
 
 // access free cycle value of qubit i
@@ -428,7 +474,7 @@ public:
 // explicit FreeCycle constructor
 // needed for virgin construction
 // default constructor was deleted because it cannot construct resource_manager_t without parameters
-FreeCycle()
+FreeCycle() : platformp(NULL), nq(0), ct(0)
 {
     DOUT("Constructing FreeCycle");
 }
@@ -445,20 +491,20 @@ void Init(const ql::quantum_platform *p)
     fcv.clear();
     fcv.resize(nq, 1);   // this 1 implies that cycle of first gate will be 1 and not 0; OpenQL convention!?!?
     DOUT("... about to copy FreeCycle Init local resource_manager to FreeCycle member rm");
-    rm = lrm;
+    rm = cow_t<ql::arch::resource_manager_t>(lrm);
     DOUT("... done copy FreeCycle Init local resource_manager to FreeCycle member rm");
 }
 
 // depth of the FreeCycle map
 // equals the max of all entries minus the min of all entries
 // not used yet; would be used to compute the max size of a top window on the past
-size_t Depth()
+size_t Depth() const
 {
     return Max() - Min();
 }
 
 // min of the FreeCycle map equals the min of all entries;
-size_t Min()
+size_t Min() const
 {
     size_t  minFreeCycle = MAX_CYCLE;
     for (auto& v : fcv)
@@ -472,7 +518,7 @@ size_t Min()
 }
 
 // max of the FreeCycle map equals the max of all entries;
-size_t Max()
+size_t Max() const
 {
     size_t  maxFreeCycle = 0;
     for (auto& v : fcv)
@@ -524,8 +570,7 @@ bool IsFirstOperandEarlier(size_t r0, size_t r1)
 // is really a short-cut ignoring config file and perhaps several other details
 bool IsFirstSwapEarliest(size_t fr0, size_t fr1, size_t sr0, size_t sr1)
 {
-    std::string mapreverseswapopt = ql::options::get("mapreverseswap");
-    if ("yes" == mapreverseswapopt)
+    if (ql::options::current().mapreverseswap)
     {
         if (fcv[fr0] < fcv[fr1])
         {
@@ -546,9 +591,9 @@ bool IsFirstSwapEarliest(size_t fr0, size_t fr1, size_t sr0, size_t sr1)
 // when we would schedule gate g, what would be its start cycle? return it
 // gate operands are real qubit indices
 // is purely functional, doesn't affect state
-size_t StartCycleNoRc(ql::gate *g)
+size_t StartCycleNoRc(ql::gate *g) const
 {
-    auto&       q = g->operands;
+    const auto& q = g->operands;
     size_t      operandCount = q.size();
 
     size_t      startCycle;
@@ -568,19 +613,18 @@ size_t StartCycleNoRc(ql::gate *g)
 // when we would schedule gate g, what would be its start cycle? return it
 // gate operands are real qubit indices
 // is purely functional, doesn't affect state
-size_t StartCycle(ql::gate *g)
+size_t StartCycle(ql::gate *g) const
 {
     size_t      startCycle = StartCycleNoRc(g);
     
-    auto        mapopt = ql::options::get("mapper");
-    if (mapopt == "baserc" || mapopt == "minextendrc")
+    if (ql::options::current().maprc)
     {
         size_t      baseStartCycle = startCycle;
 
         while (startCycle < MAX_CYCLE)
         {
             // DOUT("Startcycle for " << g->qasm() << ": available? at startCycle=" << startCycle);
-            if (rm.available(startCycle, g, *platformp))
+            if (rm->available(startCycle, g, *platformp))
             {
                 // DOUT(" ... [" << startCycle << "] resources available for " << g->qasm());
                 break;
@@ -630,16 +674,143 @@ void Add(ql::gate *g, size_t startCycle)
 {
     AddNoRc(g, startCycle);
 
-    auto        mapopt = ql::options::get("mapper");
-    if (mapopt == "baserc" || mapopt == "minextendrc")
+    if (ql::options::current().maprc)
+    {
+        rm.mut().reserve(startCycle, g, *platformp);
+    }
+}
+
+// speculatively schedule gates without copying the map and the resource manager:
+// after Checkpoint, gates are added as usual, and Rollback restores the state at the Checkpoint;
+// there can be only one Checkpoint at a time
+void Checkpoint()
+{
+    savedfcv = fcv;
+    if (ql::options::current().maprc)
     {
-        rm.reserve(startCycle, g, *platformp);
+        rm.mut().checkpoint();
+    }
+}
+
+void Rollback()
+{
+    fcv.swap(savedfcv);
+    savedfcv.clear();
+    if (ql::options::current().maprc)
+    {
+        rm.mut().rollback();
     }
 }
 
 };  // end class FreeCycle
 
 
+// =========================================================================================
+// PastGates: list of the gates of a Past, in the order of their start cycle in that Past
+//
+// a Past is copied for each alternative that is evaluated, after which only a few gates are added to the copy;
+// so the list is persistent: it is a chain of nodes from the last gate back to the first one,
+// and copies of the list share the nodes that they have in common;
+// a gate is inserted as late as possible in cycle order, which is near the end of the list,
+// so only the nodes of the few gates after it are copied
+class PastGates
+{
+private:
+    typedef ql::gate *      gate_p;
+
+    struct node_t
+    {
+        gate_p                                  gp;
+        size_t                                  cycle;  // start cycle of gp in this Past
+        mutable std::shared_ptr<const node_t>   prev;   // node of the previous gate in the list
+
+        node_t(gate_p g, size_t c, std::shared_ptr<const node_t> p) : gp(g), cycle(c), prev(p)
+        {
+        }
+
+        // release the nodes that only this one refers to one by one,
+        // since releasing the chain recursively would exhaust the stack for long lists
+        ~node_t()
+        {
+            std::shared_ptr<const node_t> p = std::move(prev);
+            while (p && p.use_count() == 1)
+            {
+                std::shared_ptr<const node_t> pp = std::move(p->prev);
+                p = std::move(pp);
+            }
+        }
+    };
+
+    std::shared_ptr<const node_t>   last;   // node of the last gate in the list
+    size_t                          count;  // number of gates in the list
+
+public:
+
+PastGates() : count(0)
+{
+}
+
+bool empty() const
+{
+    return count == 0;
+}
+
+size_t size() const
+{
+    return count;
+}
+
+void clear()
+{
+    last.reset();
+    count = 0;
+}
+
+// insert gp with the given start cycle, as late as possible in cycle order,
+// i.e. just after the last gate with a cycle less than or equal to it
+void Insert(gate_p gp, size_t startCycle)
+{
+    std::vector<const node_t*>      after;  // nodes of the gates to come after gp, last one first
+    std::shared_ptr<const node_t>   n = last;
+    while (n && n->cycle > startCycle)
+    {
+        after.push_back(n.get());
+        n = n->prev;
+    }
+    std::shared_ptr<const node_t>   res = std::make_shared<const node_t>(gp, startCycle, n);
+    for (auto ia = after.rbegin(); ia != after.rend(); ia++)
+    {
+        res = std::make_shared<const node_t>((*ia)->gp, (*ia)->cycle, res);
+    }
+    last = res;
+    count++;
+}
+
+// the gates in the list, in order
+std::list<gate_p> Gates() const
+{
+    std::list<gate_p>   gates;
+    for (const node_t* n = last.get(); n != nullptr; n = n->prev.get())
+    {
+        gates.push_front(n->gp);
+    }
+    return gates;
+}
+
+// the start cycles of the gates in the list, in order
+std::list<size_t> Cycles() const
+{
+    std::list<size_t>   cycles;
+    for (const node_t* n = last.get(); n != nullptr; n = n->prev.get())
+    {
+        cycles.push_front(n->cycle);
+    }
+    return cycles;
+}
+
+};  // end class PastGates
+
+
 // =========================================================================================
 // Past: state of the mapper while somewhere in the mapping process
 //
@@ -656,6 +827,9 @@ void Add(ql::gate *g, size_t startCycle)
 // and beyond are mapped and have real qubits as operands.
 // While experimenting with path alternatives, a clone is made of the main past,
 // to insert swaps and evaluate the latency effects; note that inserting swaps changes the mapping.
+// Such clones are cheap: the list of gates, the output list and the resource state are shared
+// with the past that was cloned, and copied only as far as the clone changes them (see PastGates and cow_t);
+// the v2r and FreeCycle maps have the size of the number of qubits and are copied.
 //
 // On arrival of a quantum gate(s):
 // - [isempty(waitinglg)]
@@ -686,23 +860,25 @@ private:
                                         //        waitinglg only contains gates from Add and final Schedule call
                                         //        when evaluating alternatives, it is empty when Past is cloned; so no state
 public:
-    std::list<gate_p>       lg;         // state: list of q gates in this Past, scheduled by their (start) cycle values
+    PastGates               lg;         // state: list of q gates in this Past, scheduled by their (start) cycle values
                                         //        so this is the result list of this Past, to compare with other Alters
-private:
-    std::list<gate_p>       outlg;      // . . .  list of gates flushed out of this Past, not yet put in outCirc
-                                        //        when evaluating alternatives, outlg stays constant; so no state
-    std::map<gate_p,size_t> cycle;      // state: gate to cycle map, startCycle value of each past gatecycle[gp]
-                                        //        cycle[gp] can be different for each gp for each past
+                                        //        with the startCycle value of each gate in this past,
+                                        //        which can be different for each gate for each past
                                         //        gp->cycle is not used by MapGates
                                         //        although updated by set_cycle called from MakeAvailable/TakeAvailable
+private:
+    cow_t<std::list<gate_p>> outlg;     // . . .  list of gates flushed out of this Past, not yet put in outCirc
+                                        //        when evaluating alternatives, outlg stays constant; so no state
     size_t                  nswapsadded;// number of swaps (including moves) added to this past
     size_t                  nmovesadded;// number of moves added to this past
+    bool                    withfidelity;       // whether fa is maintained and _prim gates are generated, i.e. with mapper==maxfidelity, or beam with mapbeamrank==fidelity
+    ql::fidelity_accumulator_t  fa;     // state: estimated fidelity of the gates in lg, updated when a gate is added to it
 
 public:
 
 // explicit Past constructor
 // needed for virgin construction
-Past()
+Past() : nq(0), ct(0), platformp(NULL), kernelp(NULL), nswapsadded(0), nmovesadded(0), withfidelity(false)
 {
     DOUT("Constructing Past");
 }
@@ -722,10 +898,24 @@ void Init(const ql::quantum_platform *p, ql::quantum_kernel *k)
     fc.Init(platformp);         // fc starts off with all qubits free, is updated after schedule of each gate
     waitinglg.clear();          // no gates pending to be scheduled in; Add of gate to past entered here
     lg.clear();                 // no gates scheduled yet in this past; after schedule of gate, it gets here
-    outlg.clear();              // no gates output yet by flushing from or bypassing this past
+    outlg = cow_t<std::list<gate_p>>(std::list<gate_p>());  // no gates output yet by flushing from or bypassing this past
     nswapsadded = 0;            // no swaps or moves added yet to this past; AddSwap adds one here
     nmovesadded = 0;            // no moves added yet to this past; AddSwap may add one here
-    cycle.clear();              // no gates have cycles assigned in this past; scheduling gate updates this
+    const ql::compile_options_t & options = ql::options::current();
+    withfidelity = (ql::mapper_t::MAXFIDELITY == options.mapper
+        || (ql::mapper_t::BEAM == options.mapper && ql::mapbeamrank_t::FIDELITY == options.mapbeamrank));
+    if (withfidelity)
+    {
+        fa.Init(nq, ql::fidelity_parameters(*platformp));   // fa keeps track of the estimated fidelity of lg
+    }
+}
+
+// let new_gate create the gates using kernel k from now on;
+// alternatives that are evaluated concurrently each need their own kernel for this
+void SetKernel(ql::quantum_kernel *k)
+{
+    MapperAssert(k->c.empty());
+    kernelp = k;
 }
 
 // import Past's v2r from v2r_value
@@ -756,9 +946,11 @@ void Print(std::string s)
     v2r.Print("");
     fc.Print("");
     // DOUT("... list of gates in past");
-    for ( auto & gp: lg)
+    std::list<size_t> cycles = lg.Cycles();
+    auto ic = cycles.begin();
+    for ( auto & gp: lg.Gates())
     {
-        DOUT("[" << cycle[gp] << "] " << gp->qasm());
+        DOUT("[" << *ic++ << "] " << gp->qasm());
     }
 }
 
@@ -781,56 +973,50 @@ void Schedule()
         // IMPORTANT: this assumes that the waitinglg gates list is in topological order,
         // which is ok because the pair of swap lists use distict qubits and
         // the gates of each are added to the back of the list in the order of execution.
-        // Using tryfc.Add, the tryfc (try FreeCycle map) reflects the earliest startCycle per qubit,
+        // Using fc.Add, fc (the FreeCycle map) reflects the earliest startCycle per qubit,
         // and so dependences are respected, so we can find the gate that can start first ...
-        // Note that tryfc includes the free cycle vector AND the resource map,
-        // so using tryfc.StartCycle/tryfc.Add we get a realistic ASAP rc schedule.
-        // We use a copy of fc and not fc itself, since the latter reflects the really scheduled gates
-        // and that shouldn't be changed.
+        // Note that fc includes the free cycle vector AND the resource map,
+        // so using fc.StartCycle/fc.Add we get a realistic ASAP rc schedule.
+        // Since fc reflects the really scheduled gates, these tries are rolled back afterwards;
+        // this doesn't copy fc and its resource map.
+        // With only one gate waiting, it is the one.
         //
         // This search is really a hack to avoid
         // the construction of a dependence graph and a set of schedulable gates
-        FreeCycle   tryfc = fc;
-        for (auto & trygp : waitinglg)
+        if (waitinglg.size() == 1)
         {
-            size_t tryStartCycle = tryfc.StartCycle(trygp);
-            tryfc.Add(trygp, tryStartCycle);
-
-            if (tryStartCycle < startCycle)
+            gp = waitinglg.front();
+            startCycle = fc.StartCycle(gp);
+        }
+        else
+        {
+            fc.Checkpoint();
+            for (auto & trygp : waitinglg)
             {
-                startCycle = tryStartCycle;
-                gp = trygp;
+                size_t tryStartCycle = fc.StartCycle(trygp);
+                fc.Add(trygp, tryStartCycle);
+
+                if (tryStartCycle < startCycle)
+                {
+                    startCycle = tryStartCycle;
+                    gp = trygp;
+                }
             }
+            fc.Rollback();
         }
 
         // add this gate to the maps, scheduling the gate (doing the cycle assignment)
         // DOUT("... add " << gp->qasm() << " startcycle=" << startCycle << " cycles=" << ((gp->duration+ct-1)/ct) );
         fc.Add(gp, startCycle);
-        cycle[gp] = startCycle; // cycle[gp] is private to this past but gp->cycle is private to gp
-        gp->cycle = startCycle; // so gp->cycle gets assigned for each alter' Past and finally definitively for mainPast
+        gp->cycle = startCycle; // startCycle in lg is private to this past but gp->cycle is private to gp
+                                // so gp->cycle gets assigned for each alter' Past and finally definitively for mainPast
         // DOUT("... set " << gp->qasm() << " at cycle " << startCycle);
     
-        // insert gate gp in lg, the list of gates, in cycle[gp] order, and inside this order, as late as possible
-        //
-        // reverse iterate because the insertion is near the end of the list
-        // insert so that cycle values are in order afterwards and the new one is nearest to the end
-        std::list<gate_p>::reverse_iterator rigp = lg.rbegin();
-        for (; rigp != lg.rend(); rigp++)
+        // insert gate gp in lg, the list of gates, in startCycle order, and inside this order, as late as possible
+        lg.Insert(gp, startCycle);
+        if (withfidelity)
         {
-            if (cycle[*rigp] <= startCycle)
-            {
-                // rigp.base() because insert doesn't work with reverse iteration
-                // rigp.base points after the element that rigp is pointing at
-                // which is lucky because insert only inserts before the given element
-                // the end effect is inserting after rigp
-                lg.insert(rigp.base(), gp);
-                break;
-            }
-        }
-        // when list was empty or no element was found, just put it in front
-        if (rigp == lg.rend())
-        {
-            lg.push_front(gp);
+            fa.Add(gp, startCycle);
         }
     
         // having added it to the main list, remove it from the waiting list
@@ -948,8 +1134,7 @@ void GenMove(ql::circuit& circ, size_t& r0, size_t& r1)
 
     // first (optimistically) create the move circuit and add it to circ
     bool created;
-    auto mapperopt = ql::options::get("mapper");
-    if ("maxfidelity" == mapperopt)
+    if (withfidelity)
     {
         created = new_gate(circ, "move_prim", {r0,r1});    // gates implementing move returned in circ
     }
@@ -984,16 +1169,7 @@ void GenMove(ql::circuit& circ, size_t& r0, size_t& r1)
         // when difference in extending circuit after scheduling initcirc+circ or just circ
         // is less equal than threshold cycles (0 would mean scheduling initcirc was for free),
         // commit to it, otherwise abort
-        int threshold;
-        std::string mapusemovesopt = ql::options::get("mapusemoves");
-        if ("yes" == mapusemovesopt)
-        {
-            threshold = 0;
-        }
-        else
-        {
-            threshold = atoi(mapusemovesopt.c_str());
-        }
+        int threshold = ql::options::current().mapusemoves_threshold;
         if (InsertionCost(initcirc, circ) <= threshold)
         {
             // so we go for it!
@@ -1044,8 +1220,7 @@ void AddSwap(size_t r0, size_t r1)
     }
 
     ql::circuit circ;   // current kernel copy, clear circuit
-    std::string mapusemovesopt = ql::options::get("mapusemoves");
-    if ("no" != mapusemovesopt && (v2r.GetRs(r0)!=rs_hasstate || v2r.GetRs(r1)!=rs_hasstate))
+    if (ql::options::current().mapusemoves && (v2r.GetRs(r0)!=rs_hasstate || v2r.GetRs(r1)!=rs_hasstate))
     {
         GenMove(circ, r0, r1);
         created = circ.size()!=0;
@@ -1066,8 +1241,7 @@ void AddSwap(size_t r0, size_t r1)
     if (!created)
     {
         // no move generated so do swap
-        std::string mapreverseswapopt = ql::options::get("mapreverseswap");
-        if ("yes" == mapreverseswapopt)
+        if (ql::options::current().mapreverseswap)
         {
             // swap(r0,r1) is about to be generated
             // it is functionally symmetrical,
@@ -1080,8 +1254,7 @@ void AddSwap(size_t r0, size_t r1)
                 DOUT("... reversed swap to become swap(q" << r0 << ",q" << r1 << ") ...");
             }
         }
-        auto mapperopt = ql::options::get("mapper");
-        if ("maxfidelity" == mapperopt)
+        if (withfidelity)
         {
             created = new_gate(circ, "swap_prim", {r0,r1});    // gates implementing swap returned in circ
         }
@@ -1174,8 +1347,7 @@ void MakeReal(ql::gate* gp, ql::circuit& circ)
     for (auto& qi : real_qubits)
     {
         qi = MapQubit(qi);          // and now they are real
-        auto mapprepinitsstateopt = ql::options::get("mapprepinitsstate");
-        if (mapprepinitsstateopt == "yes" && (gname == "prepz" || gname == "Prepz"))
+        if (ql::options::current().mapprepinitsstate && (gname == "prepz" || gname == "Prepz"))
         {
             v2r.SetRs(qi, rs_wasinited);
         }
@@ -1185,11 +1357,10 @@ void MakeReal(ql::gate* gp, ql::circuit& circ)
         }
     }
 
-    auto mapperopt = ql::options::get("mapper");
     std::string real_gname = gname;
-    if ("maxfidelity" == mapperopt)
+    if (withfidelity)
     {
-        DOUT("MakeReal: with mapper==maxfidelity generate _prim");
+        DOUT("MakeReal: when estimating fidelity generate _prim");
         real_gname.append("_prim");
     }
     else
@@ -1230,11 +1401,18 @@ void MakePrimitive(ql::gate* gp, ql::circuit& circ)
     DOUT("... MakePrimtive: new gate created for: " << prim_gname << " or " << gname);
 }
 
-size_t MaxFreeCycle()
+size_t MaxFreeCycle() const
 {
     return fc.Max();
 }
 
+// estimated fidelity score of the gates in lg, as -Metrics::bounded_fidelity of lg.Gates() but without walking lg;
+// the lower, the better
+double FidelityScore() const
+{
+    return fa.Score();
+}
+
 // nonq and q gates follow separate flows through Past:
 // - q gates are put in waitinglg when added and then scheduled; and then ordered by cycle into lg
 //      in lg they are waiting to be inspected and scheduled, until [too many are there,] a nonq comes or end-of-circuit
@@ -1242,11 +1420,16 @@ size_t MaxFreeCycle()
 // all gates in outlg are out of view for scheduling/mapping optimization and can be taken out to elsewhere
 void FlushAll()
 {
-    for( auto & gp : lg )
+    std::list<gate_p>& out = outlg.mut();
+    for( auto & gp : lg.Gates() )
     {
-        outlg.push_back(gp);
+        out.push_back(gp);
     }
     lg.clear();         // so effectively, lg's content was moved to outlg
+    if (withfidelity)
+    {
+        fa.clear();
+    }
 
     // fc.Init(platformp); // needed?
     // cycle.clear();      // needed?
@@ -1261,17 +1444,17 @@ void ByPass(ql::gate* gp)
     {
         FlushAll();
     }
-    outlg.push_back(gp);
+    outlg.mut().push_back(gp);
 }
 
 // mainPast flushes outlg to parameter oc
 void Out(ql::circuit& oc)
 {
-    for( auto & gp : outlg )
+    for( auto & gp : *outlg )
     {
         oc.push_back(gp);
     }
-    outlg.clear();
+    outlg.mut().clear();
 }
 
 };  // end class Past
@@ -1345,7 +1528,7 @@ void Init(const ql::quantum_platform* p, ql::quantum_kernel* k)
     nq = platformp->qubit_number;
     ct = platformp->cycle_time;
     // total, fromSource and fromTarget start as empty vectors
-    past.Init(platformp, kernelp);      // initializes past to empty
+    // past starts as empty; Extend makes it a copy of the past that the alternative extends
     didscore = false;                   // will not print score for now
 }
 
@@ -1461,22 +1644,15 @@ void Print(std::string s, std::list<Alter> & la)
     }
 }
 
-// add a node to the path in front, extending its length with one
-void Add2Front(size_t q)
-{
-    total.insert(total.begin(), q); // hopelessly inefficient
-}
-
 // add to a max of maxnumbertoadd swap gates for the current path to the given past
 // this past can be a path-local one or the main past
 // after having added them, schedule the result into that past
-void AddSwaps(Past & past, std::string mapselectswapsopt)
+void AddSwaps(Past & past, ql::mapselectswaps_t mapselectswapsopt)
 {
-    // DOUT("Addswaps " << mapselectswapsopt);
-    if ("one"==mapselectswapsopt || "all"==mapselectswapsopt)
+    if (ql::mapselectswaps_t::ONE == mapselectswapsopt || ql::mapselectswaps_t::ALL == mapselectswapsopt)
     {
         size_t  numberadded = 0;
-        size_t  maxnumbertoadd = ("one"==mapselectswapsopt ? 1 : MAX_CYCLE);
+        size_t  maxnumbertoadd = (ql::mapselectswaps_t::ONE == mapselectswapsopt ? 1 : MAX_CYCLE);
 
         size_t  fromSourceQ;
         size_t  toSourceQ;
@@ -1502,7 +1678,7 @@ void AddSwaps(Past & past, std::string mapselectswapsopt)
     }
     else
     {
-        MapperAssert("earliest"==mapselectswapsopt);
+        MapperAssert(ql::mapselectswaps_t::EARLIEST == mapselectswapsopt);
         if (fromSource.size() >= 2 && fromTarget.size() >= 2)
         {
             if (past.IsFirstSwapEarliest(fromSource[0], fromSource[1], fromTarget[0], fromTarget[1]))
@@ -1539,18 +1715,17 @@ void AddSwaps(Past & past, std::string mapselectswapsopt)
 // keep this resulting past in the current alternative (for later use);
 // compute the total extension of all pasts relative to the base past
 // and store this extension in the alternative's score for later use
-void Extend(Past currPast, Past basePast)
+void Extend(const Past& currPast, const Past& basePast)
 {
     // DOUT("... clone past, add swaps, compute overall score and keep it all in current alternative");
-    past = currPast;   // explicitly clone currPast to an alternative-local copy of it, Alter.past
+    past = currPast;   // explicitly clone currPast to an alternative-local copy of it, Alter.past, sharing most of it
     // DOUT("... adding swaps to alternative-local past ...");
-    AddSwaps(past, "all");
+    AddSwaps(past, ql::mapselectswaps_t::ALL);
     // DOUT("... done adding/scheduling swaps to alternative-local past");
 
-    auto mapperopt = ql::options::get("mapper");
-    if ("maxfidelity" == mapperopt)
+    if (ql::mapper_t::MAXFIDELITY == ql::options::current().mapper)
     {
-        score = ql::quick_fidelity(past.lg);
+        score = past.FidelityScore();
     }
     else
     {
@@ -1635,7 +1810,7 @@ void Split(std::list<Alter> & resla)
 // Grid public members (apart from nq):
 //  form:               how presence of neighbors relates to x/y coordinates of qubits
 //  Distance(qi,qj):    distance in physical connection hops from real qubit qi to real qubit qj;
-//                      - computing it relies on nbs (and Floyd-Warshall)
+//                      - computing it relies on nbs (and breadth-first search)
 //                      - in a fully assigned regular topology it could be defined by a formula (not supported)
 //  nbs[qi]:            list of neighbor real qubits of real qubit qi
 //                      - nbs can be derived from topology.edges or
@@ -1677,7 +1852,27 @@ public:
     std::map<size_t,neighbors_t> nbs;   // nbs[i] is list of neighbor qubits of qubit i
     std::map<size_t,int> x;             // x[i] is x coordinate of qubit i
     std::map<size_t,int> y;             // y[i] is y coordinate of qubit i
-    std::vector<std::vector<size_t>>  dist; // dist[i][j] is computed distance between qubits i and j;
+    typedef std::uint16_t distance_t;   // compact type of the distances, to keep dist small for large grids
+    enum : distance_t { UNREACHABLE = 0xffff }; // distance when there is no path
+    std::vector<distance_t> dist;       // dist[i*nq+j] is computed distance between qubits i and j;
+
+    // which shortest paths ShortestPaths generates
+    typedef
+    enum {
+        wp_all_shortest,            // all shortest paths
+        wp_left_shortest,           // only the shortest along the left side of the rectangle of src and tgt
+        wp_right_shortest,          // only the shortest along the right side of the rectangle of src and tgt
+        wp_leftright_shortest       // both the left and right shortest
+    } whichpaths_t;
+    typedef std::vector<size_t> path_t; // qubits along a path, from source to target
+    typedef std::vector<path_t> paths_t;
+
+private:
+    std::mutex              nexthops_mutex; // guards nexthops and hops, which concurrently evaluated alternatives share
+    std::vector<std::uint32_t> nexthops;    // nexthops[src*nq+tgt]: 0 when not computed yet, else 1+index in hops of
+    std::vector<size_t>     hops;           //   the count, followed by that many next hops from src towards tgt
+
+public:
 
 // Grid initializer
 // initialize mapper internal grid maps from configuration
@@ -1719,6 +1914,8 @@ void Init(const ql::quantum_platform* p)
     InitNbs();
     AngleSortNbs();
     ComputeDist();
+    nexthops.assign(nq*nq, 0);
+    hops.clear();
     DPRINTGrid();
 }
 
@@ -1726,10 +1923,119 @@ void Init(const ql::quantum_platform* p)
 // formulae for convex (hole free) topologies with underlying grid and with bidirectional edges:
 //      gf_cross:   std::max( std::abs( x[to_realqi] - x[from_realqi] ), std::abs( y[to_realqi] - y[from_realqi] ))
 //      gf_plus:    std::abs( x[to_realqi] - x[from_realqi] ) + std::abs( y[to_realqi] - y[from_realqi] )
-// when the neighbor relation is defined (topology.edges in config file), Floyd-Warshall is used, which currently is always
+// when the neighbor relation is defined (topology.edges in config file), breadth-first search is used, which currently is always
 size_t Distance(size_t from_realqi, size_t to_realqi)
 {
-    return dist[from_realqi][to_realqi];
+    distance_t d = dist[from_realqi*nq + to_realqi];
+    return (d == UNREACHABLE ? MAX_CYCLE : d);
+}
+
+// the neighbors of src that continue a shortest path from src to tgt (src != tgt),
+// rotated by Normalize, so that those along the left and right side of the rectangle of src and tgt are front and back;
+// these next hops are computed once for each src and tgt and then kept for reuse;
+// unlike the paths themselves, of which there can be exponentially many in their length,
+// they take at most nq*nq times the number of neighbors of a qubit
+neighbors_t NextHops(size_t src, size_t tgt)
+{
+    size_t key = src*nq + tgt;
+    {
+        std::lock_guard<std::mutex> lock(nexthops_mutex);
+        size_t index = nexthops[key];
+        if (index != 0)
+        {
+            auto from = hops.begin() + index;
+            return neighbors_t(from, from + hops[index-1]);
+        }
+    }
+
+    // assume that distance is not approximate but exact and can be met
+    size_t d = Distance(src, tgt);
+    MapperAssert (d >= 1);
+
+    // reduce neighbors nbs to those continuing a shortest path
+    neighbors_t nbl = nbs.at(src);
+    nbl.remove_if( [this,d,tgt](const size_t& n) { return Distance(n,tgt) >= d; } );
+
+    // rotate neighbor list nbl such that largest difference between angles of adjacent elements is beyond back()
+    Normalize(src, nbl);
+
+    // another thread may have computed them meanwhile, then keep those, they are the same
+    std::lock_guard<std::mutex> lock(nexthops_mutex);
+    if (nexthops[key] == 0)
+    {
+        hops.push_back(nbl.size());
+        nexthops[key] = hops.size();
+        hops.insert(hops.end(), nbl.begin(), nbl.end());
+    }
+    return nbl;
+}
+
+// size in bytes of the next hops that have been computed
+size_t NextHopsSize()
+{
+    std::lock_guard<std::mutex> lock(nexthops_mutex);
+    return nexthops.size() * sizeof(std::uint32_t) + hops.size() * sizeof(size_t);
+}
+
+// the shortest paths between src and tgt, bounded by a particular strategy (which),
+// each starting with src and ending with tgt;
+// they are generated by following the next hops from src, so the next hops are reused but the paths are not kept
+paths_t ShortestPaths(size_t src, size_t tgt, whichpaths_t which)
+{
+    paths_t resp;
+    path_t  prefix;
+    prefix.reserve(Distance(src, tgt) + 1);
+    AddShortestPaths(prefix, src, tgt, which, resp);
+    return resp;
+}
+
+// add to resp the shortest paths from src to tgt, bounded by which, each after a copy of prefix
+void AddShortestPaths(path_t& prefix, size_t src, size_t tgt, whichpaths_t which, paths_t& resp)
+{
+    prefix.push_back(src);
+    if (src == tgt)
+    {
+        // found target: prefix ends with a distance 0 path with one qubit, src
+        resp.push_back(prefix);
+    }
+    else
+    {
+        neighbors_t nbl = NextHops(src, tgt);
+        // subset to those neighbors that continue in direction(s) we want
+        if (which == wp_left_shortest)
+        {
+            nbl.remove_if( [nbl](const size_t& n) { return n != nbl.front(); } );
+        }
+        else if (which == wp_right_shortest)
+        {
+            nbl.remove_if( [nbl](const size_t& n) { return n != nbl.back(); } );
+        }
+        else if (which == wp_leftright_shortest)
+        {
+            nbl.remove_if( [nbl](const size_t& n) { return n != nbl.front() && n != nbl.back(); } );
+        }
+
+        // for all resulting neighbors, find all continuations of a shortest path
+        for (auto & n : nbl)
+        {
+            whichpaths_t newwhich = which;
+            // but for each neighbor only look in desired direction, if any
+            if (which == wp_leftright_shortest && nbl.size() != 1)
+            {
+                // when looking both left and right still, and there is a choice now, split into left and right
+                if (n == nbl.front())
+                {
+                    newwhich = wp_left_shortest;
+                }
+                else
+                {
+                    newwhich = wp_right_shortest;
+                }
+            }
+            AddShortestPaths(prefix, n, tgt, newwhich, resp);
+        }
+    }
+    prefix.pop_back();
 }
 
 // return clockwise angle around (cx,cy) of (x,y) wrt vertical y axis with angle 0 at 12:00, 0<=angle<2*pi
@@ -1749,8 +2055,7 @@ void Normalize( size_t src, neighbors_t& nbl )
     if (form == gf_irregular)
     {
         // there no implicit/explicit x/y coordinates defined per qubit, so no sense of nearness
-        std::string mappathselectopt = ql::options::get("mappathselect");
-        MapperAssert ("borders" != mappathselectopt);
+        MapperAssert (ql::mappathselect_t::BORDERS != ql::options::current().mappathselect);
         return;
     }
 
@@ -1771,10 +2076,10 @@ void Normalize( size_t src, neighbors_t& nbl )
     // for all indices in and its next one inx compute angle difference and find largest of these
     for (neighbors_t::iterator in = nbl.begin(); in != nbl.end(); in++)
     {
-        double a_in = Angle(x[src], y[src], x[*in], y[*in]);
+        double a_in = Angle(x.at(src), y.at(src), x.at(*in), y.at(*in));
 
         neighbors_t::iterator inx = std::next(in); if (inx == nbl.end()) inx = nbl.begin();
-        double a_inx = Angle(x[src], y[src], x[*inx], y[*inx]);
+        double a_inx = Angle(x.at(src), y.at(src), x.at(*inx), y.at(*inx));
 
         int diff = a_inx - a_in; if (diff < 0) diff += 2*pi;
         if (diff > maxdiff)
@@ -1800,31 +2105,40 @@ void Normalize( size_t src, neighbors_t& nbl )
     // for (auto dn : nbl) { std::cout << dn << " "; } std::cout << std::endl;
 }
 
-// Floyd-Warshall dist[i][j] = shortest distances between all nq qubits i and j
+// breadth-first search from each qubit i, dist[i*nq+j] = shortest distances between all nq qubits i and j;
+// the edges are unweighted, so this takes O(nq*edges) instead of the O(nq^3) of Floyd-Warshall
 void ComputeDist()
 {
-    // initialize all distances to maximum value, to neighbors to 1, to itself to 0
-    dist.resize(nq); for (size_t i=0; i<nq; i++) dist[i].resize(nq, MAX_CYCLE);
+    if (nq >= UNREACHABLE)
+    {
+        FATAL(" number of qubits in platform (" << nq << ") is too large for the mapper, it should be less than " << size_t(UNREACHABLE));
+    }
+    std::vector<std::vector<size_t>> adj(nq);   // adj[i] is nbs[i], for fast iteration
     for (size_t i=0; i<nq; i++)
     {
-        dist[i][i] = 0;
-        for (size_t j: nbs[i])
-        {
-            dist[i][j] = 1;
-        }
+        adj[i].assign(nbs[i].begin(), nbs[i].end());
     }
 
-    // find shorter distances by gradually including more qubits (k) in path
-    for (size_t k=0; k<nq; k++)
+    // initialize all distances to unreachable, then find the qubits at distance 1, 2, ... of each qubit
+    dist.assign(nq*nq, UNREACHABLE);
+    std::vector<size_t> queue(nq);      // qubits in order of distance from i, those from head on not yet visited
+    for (size_t i=0; i<nq; i++)
     {
-        for (size_t i=0; i<nq; i++)
+        distance_t* disti = &dist[i*nq];
+        size_t head = 0;
+        size_t tail = 0;
+        disti[i] = 0;
+        queue[tail++] = i;
+        while (head < tail)
         {
-            for (size_t j=0; j<nq; j++)
+            size_t k = queue[head++];
+            for (size_t j : adj[k])
             {
-               if (dist[i][j] > dist[i][k] + dist[k][j])
-               {
-                   dist[i][j] = dist[i][k] + dist[k][j];
-               }
+                if (disti[j] == UNREACHABLE)
+                {
+                    disti[j] = disti[k] + 1;
+                    queue[tail++] = j;
+                }
             }
         }
     }
@@ -1835,11 +2149,11 @@ void ComputeDist()
         {
             if (form == gf_cross)
             {
-                MapperAssert (dist[i][j] == (std::max( std::abs( x[i] - x[j] ), std::abs( y[i] - y[j] ))) );
+                MapperAssert (Distance(i,j) == (std::max( std::abs( x[i] - x[j] ), std::abs( y[i] - y[j] ))) );
             }
             else if (form == gf_plus)
             {
-                MapperAssert (dist[i][j] == (std::abs( x[i] - x[j] ) + std::abs( y[i] - y[j] )) );
+                MapperAssert (Distance(i,j) == (std::abs( x[i] - x[j] ) + std::abs( y[i] - y[j] )) );
             }
 
         }
@@ -2008,15 +2322,19 @@ public:
     Scheduler                       *schedp;        // a pointer, since dependence graph doesn't change
     ql::circuit                     input_gatepv;   // input circuit when not using scheduler based avlist
 
-    std::map<ql::gate*,bool>        scheduled;      // state: has gate been scheduled, here: done from future?
-    std::list<ListDigraph::Node>    avlist;         // state: which nodes/gates are available for mapping now?
+    std::vector<bool>               scheduled;      // state: has node been scheduled, here: done from future?
+    std::list<Scheduler::Node>      avlist;         // state: which nodes/gates are available for mapping now?
     ql::circuit::iterator           input_gatepp;   // state: alternative iterator in input_gatepv
+    bool                            setcycles;      // whether DoneGate updates the cycle attribute of the gates made available;
+                                                    // not in the copies used to evaluate alternatives, that may do so concurrently
+                                                    // while this future sets the same values later anyway
 
 // just program wide initialization
 void Init( const ql::quantum_platform *p)
 {
     // DOUT("Future::Init ...");
     platformp = p;
+    setcycles = true;
     // DOUT("Future::Init [DONE]");
 }
 
@@ -2027,8 +2345,7 @@ void SetCircuit(ql::quantum_kernel& kernel, Scheduler& sched, size_t nq, size_t
 {
     DOUT("Future::SetCircuit ...");
     schedp = &sched;
-    std::string maplookaheadopt = ql::options::get("maplookahead");
-    if ("no" == maplookaheadopt)
+    if (ql::maplookahead_t::NO == ql::options::current().maplookahead)
     {
         input_gatepv = kernel.c;                                // copy to free original circuit to allow outputing to
         input_gatepp = input_gatepv.begin();                    // iterator set to start of input circuit copy
@@ -2037,17 +2354,12 @@ void SetCircuit(ql::quantum_kernel& kernel, Scheduler& sched, size_t nq, size_t
     {
         schedp->init(kernel.c, *platformp, nq, nc);             // fills schedp->graph (dependence graph) from all of circuit
                                                                 // and so also the original circuit can be output to after this
-        for( auto & gp : kernel.c )
-        {
-            scheduled[gp] = false;   // none were scheduled
-        }
-        scheduled[schedp->instruction[schedp->s]] = false;      // also the dummy nodes not
-        scheduled[schedp->instruction[schedp->t]] = false;
+        scheduled.assign(schedp->instruction.size(), false);   // none were scheduled, also the dummy nodes not
         avlist.clear();
         avlist.push_back(schedp->s);
         schedp->set_remaining(ql::forward_scheduling);          // to know criticality
 
-        if (ql::options::get("print_dot_graphs") == "yes")
+        if (ql::options::current().print_dot_graphs)
         {
             std::string     map_dot;
             std::stringstream fname;
@@ -2068,8 +2380,7 @@ void SetCircuit(ql::quantum_kernel& kernel, Scheduler& sched, size_t nq, size_t
 bool GetNonQuantumGates(std::list<ql::gate*>& nonqlg)
 {
     nonqlg.clear();
-    std::string maplookaheadopt = ql::options::get("maplookahead");
-    if ("no" == maplookaheadopt)
+    if (ql::maplookahead_t::NO == ql::options::current().maplookahead)
     {
         ql::gate*   gp = *input_gatepp;
         if (input_gatepp != input_gatepv.end())
@@ -2103,8 +2414,7 @@ bool GetNonQuantumGates(std::list<ql::gate*>& nonqlg)
 bool GetGates(std::list<ql::gate*>& qlg)
 {
     qlg.clear();
-    std::string maplookaheadopt = ql::options::get("maplookahead");
-    if ("no" == maplookaheadopt)
+    if (ql::maplookahead_t::NO == ql::options::current().maplookahead)
     {
         if (input_gatepp != input_gatepv.end())
         {
@@ -2135,14 +2445,13 @@ bool GetGates(std::list<ql::gate*>& qlg)
 // and its successors can be made available
 void DoneGate(ql::gate* gp)
 {
-    std::string maplookaheadopt = ql::options::get("maplookahead");
-    if ("no" == maplookaheadopt)
+    if (ql::maplookahead_t::NO == ql::options::current().maplookahead)
     {
         input_gatepp = std::next(input_gatepp);
     }
     else
     {
-        schedp->TakeAvailable(schedp->node[gp], avlist, scheduled, ql::forward_scheduling);
+        schedp->TakeAvailable(schedp->node.at(gp), avlist, scheduled, ql::forward_scheduling, setcycles);
     }
 }
 
@@ -2150,8 +2459,7 @@ void DoneGate(ql::gate* gp)
 // This is used in tiebreak, when every other option has failed to make a distinction.
 ql::gate* MostCriticalIn(std::list<ql::gate*>& lag)
 {
-    std::string maplookaheadopt = ql::options::get("maplookahead");
-    if ("no" == maplookaheadopt)
+    if (ql::maplookahead_t::NO == ql::options::current().maplookahead)
     {
         return lag.front();
     }
@@ -2254,6 +2562,7 @@ public:
                                     // Passed back by Mapper::Map to caller for reporting
     size_t          nswapsadded;    // number of swaps added (including moves)
     size_t          nmovesadded;    // number of moves added
+    size_t          nroutings;      // number of times that an alternative was selected and committed to route a 2q gate
     std::vector<size_t> v2r_in;     // v2r[virtual qubit index] -> real qubit index | UNDEFINED_QUBIT
     std::vector<int>    rs_in;      // rs[real qubit index] -> {nostate|wasinited|hasstate}
     std::vector<size_t> v2r_ip;     // v2r[virtual qubit index] -> real qubit index | UNDEFINED_QUBIT
@@ -2266,117 +2575,21 @@ public:
 
 private:
 
-// initial path finder
-// generate paths with source src and target tgt as a list of path into resla;
-// this result list resla is allocated by caller and is empty on the call;
-// which indicates which paths are generated; see below the enum whichpaths;
-// on top of this, the other mapper options apply
-typedef
-enum {
-    wp_all_shortest,            // all shortest paths
-    wp_left_shortest,           // only the shortest along the left side of the rectangle of src and tgt
-    wp_right_shortest,          // only the shortest along the right side of the rectangle of src and tgt
-    wp_leftright_shortest       // both the left and right shortest
-} whichpaths_t;
-
-// Find shortest paths between src and tgt in the grid, bounded by a particular strategy (which)
-void GenShortestPaths(ql::gate* gp, size_t src, size_t tgt, std::list<Alter> & resla, whichpaths_t which)
-{
-    std::list<Alter> genla;    // list that will get the result of a recursive Gen call
-
-    // DOUT("GenShortestPaths: " << "src=" << src << " tgt=" << tgt << " which=" << which);
-    MapperAssert (resla.empty());
-
-    if (src == tgt) {
-        // found target
-        // create a virgin Alter and initialize it to become an empty path
-        // add src to this path (so that it becomes a distance 0 path with one qubit, src)
-        // and add the Alter to the result list 
-        Alter  a;
-        a.Init(platformp, kernelp);
-        a.targetgp = gp;
-        a.Add2Front(src);
-        resla.push_back(a);
-        // a.DPRINT("... empty path after adding to result list");
-        // Alter::DPRINT("... result list after adding empty path", resla);
-        // DOUT("... will return now");
-        return;
-    }
-
-    // start looking around at neighbors for serious paths
-    // assume that distance is not approximate but exact and can be met
-    size_t d = grid.Distance(src, tgt);
-    MapperAssert (d >= 1);
-
-    // reduce neighbors nbs to those continuing a shortest path
-    auto nbl = grid.nbs[src];
-    nbl.remove_if( [this,d,tgt](const size_t& n) { return grid.Distance(n,tgt) >= d; } );
-
-    // rotate neighbor list nbl such that largest difference between angles of adjacent elements is beyond back()
-    grid.Normalize(src, nbl);
-    // subset to those neighbors that continue in direction(s) we want
-    if (which == wp_left_shortest)
-    {
-        nbl.remove_if( [nbl](const size_t& n) { return n != nbl.front(); } );
-    }
-    else if (which == wp_right_shortest)
-    {
-        nbl.remove_if( [nbl](const size_t& n) { return n != nbl.back(); } );
-    }
-    else if (which == wp_leftright_shortest)
-    {
-        nbl.remove_if( [nbl](const size_t& n) { return n != nbl.front() && n != nbl.back(); } );
-    }
-
-    // std::cout << "... before iterating, nbl: ";
-    // for (auto dn : nbl) { std::cout << dn << " "; } std::cout << std::endl;
-
-    // for all resulting neighbors, find all continuations of a shortest path
-    for (auto & n : nbl)
-    {
-        whichpaths_t newwhich = which;
-        // but for each neighbor only look in desired direction, if any
-        if (which == wp_leftright_shortest && nbl.size() != 1)
-        {
-            // when looking both left and right still, and there is a choice now, split into left and right
-            if (n == nbl.front())
-            {
-                newwhich = wp_left_shortest;
-            }
-            else
-            {
-                newwhich = wp_right_shortest;
-            }
-        }
-        GenShortestPaths(gp, n, tgt, genla, newwhich);  // get list of possible paths from n to tgt in genla
-        resla.splice(resla.end(), genla);           // moves all of genla to resla; makes genla empty
-    }
-    // resla contains all paths starting from a neighbor of src, to tgt
-
-    // add src to front of all to-be-returned paths from src's neighbors to tgt
-    for (auto & a : resla)
-    {
-        // DOUT("... GenShortestPaths, about to add src=" << src << "in front of path");
-        a.Add2Front(src);
-    }
-    // DOUT("... GenShortestPaths, returning from call of: " << "src=" << src << " tgt=" << tgt << " which=" << which);
-}
-
-// Generate shortest paths in the grid
+// Generate shortest paths in the grid, each as an alternative to make gp NN, into resla
 void GenShortestPaths(ql::gate* gp, size_t src, size_t tgt, std::list<Alter> & resla)
 {
-    std::string mappathselectopt = ql::options::get("mappathselect");
-    if ("all" == mappathselectopt)
+    Grid::whichpaths_t which = Grid::wp_all_shortest;
+    if (ql::mappathselect_t::ALL != ql::options::current().mappathselect)
     {
-        GenShortestPaths(gp, src, tgt, resla, wp_all_shortest);
+        which = Grid::wp_leftright_shortest;
     }
-    else if ("borders" == mappathselectopt)
+    for (auto & p : grid.ShortestPaths(src, tgt, which))
     {
-        GenShortestPaths(gp, src, tgt, resla, wp_leftright_shortest);
-    }
-    else
-    {
-        FATAL("Unknown value of mapppathselect option " << mappathselectopt);
+        Alter  a;
+        a.Init(platformp, kernelp);
+        a.targetgp = gp;
+        a.total = p;
+        resla.push_back(a);
     }
 }
 
@@ -2417,8 +2630,7 @@ void GenAltersGate(ql::gate* gp, std::list<Alter>& la, Past& past)
 // Depending on maplookahead only take first (most critical) gate or take all gates.
 void GenAlters(std::list<ql::gate*> lg, std::list<Alter>& la, Past& past)
 {
-    std::string maplookaheadopt = ql::options::get("maplookahead");
-    if ("all" == maplookaheadopt)
+    if (ql::maplookahead_t::ALL == ql::options::current().maplookahead)
     {
         // create alternatives for each gate in lg
         // DOUT("GenAlters, " << lg.size() << " 2q gates; create an alternative for each");
@@ -2438,28 +2650,36 @@ void GenAlters(std::list<ql::gate*> lg, std::list<Alter>& la, Past& past)
     }
 }
 
-// start the random generator with a seed
-// that is unique to the microsecond
+// start the random generator with the seed given by option mapseed,
+// or when that is "time", with a seed that is unique to the microsecond
 void RandomInit()
 {
-    auto ts = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-    // DOUT("Seeding random generator with " << ts );
-    gen.seed(ts);
+    const ql::compile_options_t & options = ql::options::current();
+    if (options.mapseedtime)
+    {
+        auto ts = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        // DOUT("Seeding random generator with " << ts );
+        gen.seed(ts);
+    }
+    else
+    {
+        gen.seed(options.mapseed);
+    }
 }
 
 // if the maptiebreak option indicates so,
-// generate a random int number in range 0..count-1 and use
+// generate a random int number in range 0..count-1 using rgen and use
 // that to index in list of alternatives and to return that one,
 // otherwise return a fixed one (front, back or first most critical one
-Alter ChooseAlter(std::list<Alter>& la, Future& future)
+Alter ChooseAlter(std::list<Alter>& la, Future& future, std::mt19937& rgen)
 {
     if (la.size() == 1)
     {
         return la.front();
     }
 
-    std::string maptiebreakopt = ql::options::get("maptiebreak");
-    if ("critical" == maptiebreakopt)
+    ql::maptiebreak_t maptiebreakopt = ql::options::current().maptiebreak;
+    if (ql::maptiebreak_t::CRITICAL == maptiebreakopt)
     {
         std::list<ql::gate*> lag;
         for (auto& a : la)
@@ -2478,11 +2698,11 @@ Alter ChooseAlter(std::list<Alter>& la, Future& future)
         }
         return la.front();
     }
-    if ("random" == maptiebreakopt)
+    if (ql::maptiebreak_t::RANDOM == maptiebreakopt)
     {
         Alter res;
         std::uniform_int_distribution<> dis(0, (la.size()-1));
-        size_t choice = dis(gen);
+        size_t choice = dis(rgen);
         size_t i = 0;
         for (auto& a : la)
         {
@@ -2496,12 +2716,12 @@ Alter ChooseAlter(std::list<Alter>& la, Future& future)
         // DOUT(" ... took random draw " << choice << " from 0.." << (la.size()-1));
         return res;
     }
-    if ("last" == maptiebreakopt)
+    if (ql::maptiebreak_t::LAST == maptiebreakopt)
     {
         // DOUT(" ... took last " << " from 0.." << (la.size()-1));
         return la.back();
     }
-    if ("first" == maptiebreakopt)
+    if (ql::maptiebreak_t::FIRST == maptiebreakopt)
     {
         // DOUT(" ... took first " << " from 0.." << (la.size()-1));
         return la.front();
@@ -2535,8 +2755,7 @@ void CommitAlter(Alter& resa, Future& future, Past& past)
     ql::gate*  resgp = resa.targetgp;   // and the 2q target gate then in resgp
     resa.DPRINT("... CommitAlter, alternative to commit, will add swaps and then map target 2q gate");
 
-    std::string mapselectswapsopt = ql::options::get("mapselectswaps");
-    resa.AddSwaps(past, mapselectswapsopt);
+    resa.AddSwaps(past, ql::options::current().mapselectswaps);
 
     // when only some swaps were added, the resgp might not yet be NN, so recheck
     auto&   q = resgp->operands;
@@ -2677,15 +2896,68 @@ bool MapMappableGates(Future& future, Past& past, std::list<ql::gate*>& lg, bool
     }
 }
 
+// number of threads on which SelectAlter evaluates the alternatives at the given level of recursion;
+// only those at level 0 are evaluated concurrently, each going through its deeper levels sequentially
+size_t SelectThreads(int level)
+{
+    if (level != 0)
+    {
+        return 1;
+    }
+    size_t nthreads = ql::options::current().mapselectthreads;
+    if (nthreads == 0)
+    {
+        nthreads = std::thread::hardware_concurrency();
+    }
+    return (nthreads == 0 ? 1 : nthreads);
+}
+
+// call fn(a, apast, i) for each alternative a in la, i being its index, on nthreads threads;
+// apast is past itself when running sequentially, but when running concurrently,
+// it is a copy of past with a kernel of its own, since new_gate creates the gates in the kernel's circuit;
+// fn must only modify a and the copies that it makes of apast and of other state;
+// afterwards the Past that a may have copied from apast creates its gates in the mapper's kernel again
+template<class Fn>
+void ForEachAlter(std::list<Alter>& la, const Past& past, size_t nthreads, Fn fn)
+{
+    std::vector<Alter*> lap;
+    for (auto & a : la)
+    {
+        lap.push_back(&a);
+    }
+    if (nthreads > lap.size())
+    {
+        nthreads = lap.size();
+    }
+    if (nthreads <= 1)
+    {
+        for (size_t i = 0; i < lap.size(); i++)
+        {
+            fn(*lap[i], past, i);
+        }
+        return;
+    }
+    ql::utils::parallel_for(lap.size(), nthreads, [&](size_t i)
+    {
+        ql::quantum_kernel  akernel(*kernelp);
+        Past                apast = past;
+        apast.SetKernel(&akernel);
+        fn(*lap[i], apast, i);
+        lap[i]->past.SetKernel(kernelp);
+    });
+}
+
 // select Alter determined by strategy defined by mapper options
 // - if base[rc], select from whole list of Alters, of which all 'remain'
 // - if minextend[rc], select Alter from list of Alters with minimal cycle extension of given past
 //   when several remain with equal minimum extension, recurse to reduce this set of remaining ones
 //   - level: level of recursion at which SelectAlter is called: 0 is base, 1 is 1st, etc.
 //   - option mapselectmaxlevel: max level of recursion to use, where inf indicates no maximum
-// - maptiebreak option indicates which one to take when several (still) remain
+// - maptiebreak option indicates which one to take when several (still) remain,
+//   when random, drawing from a random generator seeded with seed, and deeper levels with seeds drawn from it,
+//   so that the result does not depend on whether alternatives are evaluated concurrently (option mapselectthreads)
 // result is returned in resa
-void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past, Past& basePast, int level)
+void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past, Past& basePast, int level, std::mt19937::result_type seed)
 {
                                 // la are all alternatives we enter with
     MapperAssert(!la.empty());  // so there is always a result Alter
@@ -2694,24 +2966,26 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
     std::list<Alter> bla;       // best alternative subset of gla, suitable to choose result from
 
     DOUT("SelectAlter ENTRY level=" << level << " from " << la.size() << " alternatives");
-    auto mapperopt = ql::options::get("mapper");
-    if (mapperopt == "base"|| mapperopt == "baserc")
+    const ql::compile_options_t & options = ql::options::current();
+    std::mt19937 rgen(seed);
+    size_t nthreads = SelectThreads(level);
+    if (ql::mapper_t::BASE == options.mapper || ql::mapper_t::BASERC == options.mapper)
     {
         Alter::DPRINT("... SelectAlter base (equally good/best) alternatives:", la);
-        resa = ChooseAlter(la, future);
+        resa = ChooseAlter(la, future, rgen);
         resa.DPRINT("... the selected Alter is");
         // DOUT("SelectAlter DONE level=" << level << " from " << la.size() << " alternatives");
         return;
     }
-    MapperAssert(mapperopt == "minextend" || mapperopt == "minextendrc" || mapperopt == "maxfidelity");
+    MapperAssert(ql::mapper_t::MINEXTEND == options.mapper || ql::mapper_t::MINEXTENDRC == options.mapper || ql::mapper_t::MAXFIDELITY == options.mapper);
 
     // Compute a.score of each alternative relative to basePast, and sort la on it, minimum first
-    for (auto & a : la)
+    ForEachAlter(la, past, nthreads, [&](Alter& a, const Past& apast, size_t)
     {
         a.DPRINT("Considering extension by alternative: ...");
-        a.Extend(past, basePast);           // locally here, past will be cloned and kept in alter
+        a.Extend(apast, basePast);          // locally here, past will be cloned and kept in alter
                                             // and the extension stored into the a.score
-    }
+    });
     la.sort([this](const Alter &a1, const Alter &a2) { return a1.score < a2.score; });
     Alter::DPRINT("... SelectAlter sorted all entry alternatives after extension:", la);
 
@@ -2724,23 +2998,23 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
     gla.remove_if( [this,la](const Alter& a) { return a.score != la.front().score; } );
     size_t  las = la.size();
     size_t  glas = gla.size();
-    auto mapselectmaxwidthopt = ql::options::get("mapselectmaxwidth");
-    if ("min" != mapselectmaxwidthopt)
+    ql::mapselectmaxwidth_t mapselectmaxwidthopt = options.mapselectmaxwidth;
+    if (ql::mapselectmaxwidth_t::MIN != mapselectmaxwidthopt)
     {
         size_t  keep = 1;
-        if ( "minplusone" == mapselectmaxwidthopt)
+        if (ql::mapselectmaxwidth_t::MINPLUSONE == mapselectmaxwidthopt)
         {
             keep = glas+1;
         }
-        else if ("minplushalfmin" == mapselectmaxwidthopt)
+        else if (ql::mapselectmaxwidth_t::MINPLUSHALFMIN == mapselectmaxwidthopt)
         {
             keep = glas+glas/2;
         }
-        else if ( "minplusmin" == mapselectmaxwidthopt)
+        else if (ql::mapselectmaxwidth_t::MINPLUSMIN == mapselectmaxwidthopt)
         {
             keep = glas*2;
         }
-        else if ( "all" == mapselectmaxwidthopt)
+        else if (ql::mapselectmaxwidth_t::ALL == mapselectmaxwidthopt)
         {
             keep = las;
         }
@@ -2757,13 +3031,11 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
             gla = la;
         }
     }
-    // DOUT("SelectAlter mapselectmaxwidth=" << mapselectmaxwidthopt << " level=" << level << " reduced la to gla");
     Alter::DPRINT("... SelectAlter good alternatives before recursion:", gla);
 
     // Prepare for recursion;
     // option mapselectmaxlevel indicates the maximum level of recursion (0 is no recursion)
-    auto mapselectmaxlevelstring = ql::options::get("mapselectmaxlevel");
-    int  mapselectmaxlevel = ("inf" == mapselectmaxlevelstring) ?  MAX_CYCLE : atoi(mapselectmaxlevelstring.c_str());
+    int  mapselectmaxlevel = options.mapselectmaxlevel;
 
     // When maxlevel has been reached, stop the recursion, and choose from the best minextend/maxfidelity alternatives
     if (level >= mapselectmaxlevel)
@@ -2773,7 +3045,7 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
         bla = gla;
         bla.remove_if( [this,gla](const Alter& a) { return a.score != gla.front().score; } );
         Alter::DPRINT("... SelectAlter reduced to best alternatives to choose result from:", bla);
-        resa = ChooseAlter(bla, future);
+        resa = ChooseAlter(bla, future, rgen);
         resa.DPRINT("... the selected Alter (STOPPING RECURSION) is");
         // DOUT("SelectAlter DONE level=" << level << " from " << bla.size() << " best alternatives");
         return;
@@ -2799,18 +3071,22 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
     // This means that recursion always goes to maxlevel or end-of-circuit.
     // This anomaly may need correction.
     // DOUT("... SelectAlter level=" << level << " entering recursion with " << gla.size() << " good alternatives");
-    for (auto& a : gla)
+    std::vector<std::mt19937::result_type> seeds;
+    for (size_t i = 0; i < gla.size(); i++)
+    {
+        seeds.push_back(rgen());
+    }
+    ForEachAlter(gla, past, nthreads, [&](Alter& a, const Past& apast, size_t i)
     {
         a.DPRINT("... ... considering alternative:");
         Future future_copy = future;            // copy!
-        Past   past_copy = past;                // copy!
+        future_copy.setcycles = false;
+        Past   past_copy = apast;               // copy!
         CommitAlter(a, future_copy, past_copy);
         a.DPRINT("... ... committed this alternative first before recursion:");
 
         bool    havegates;                  // are there still non-NN 2q gates to map?
         std::list<ql::gate*> lg;            // list of non-NN 2q gates taken from avlist, as returned from MapMappableGates
-        std::string maplookaheadopt = ql::options::get("maplookahead");
-        std::string maprecNN2qopt = ql::options::get("maprecNN2q");
         // In recursion, look at option maprecNN2q:
         // - MapMappableGates with alsoNN2q==true is greedy and immediately maps each 1q and NN 2q gate
         // - MapMappableGates with alsoNN2q==false is not greedy, maps all 1q gates but not the (NN) 2q gates
@@ -2820,7 +3096,7 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
         // This creates more clear recursion: one 2q at a time instead of a possible empty set of NN2qs followed by a nonNN2q;
         // also when a NN2q is found, this is perfect; this is not seen when immediately mapping all NN2qs.
         // So goal is to prove that maprecNN2q should be no at this place, in the recursion step, but not at level 0!
-        bool alsoNN2q = ("yes" == maprecNN2qopt) && ( "noroutingfirst" == maplookaheadopt || "all" == maplookaheadopt );
+        bool alsoNN2q = options.maprecNN2q && (ql::maplookahead_t::NOROUTINGFIRST == options.maplookahead || ql::maplookahead_t::ALL == options.maplookahead);
         havegates = MapMappableGates(future_copy, past_copy, lg, alsoNN2q); // map all easy gates; remainder returned in lg
 
         if (havegates)
@@ -2830,7 +3106,7 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
             GenAlters(lg, la, past_copy);       // gen all possible variations to make gates in lg NN, in current past.v2r mapping
             // DOUT("... ... SelectAlter level=" << level << ", generated for these 2q gates " << la.size() << " alternatives; RECURSE ... ");
             Alter resa;                         // result alternative selected and returned by next SelectAlter call
-            SelectAlter(la, resa, future_copy, past_copy, basePast, level+1); // recurse, best in resa ...
+            SelectAlter(la, resa, future_copy, past_copy, basePast, level+1, seeds[i]); // recurse, best in resa ...
             resa.DPRINT("... ... SelectAlter, generated for these 2q gates ... ; RECURSE DONE; resulting alternative ");
             a.score = resa.score;               // extension of deep recursion is treated as extension at current level,
                                                 // by this an alternative started bad may be compensated by deeper alts
@@ -2838,10 +3114,9 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
         else
         {
             // DOUT("... ... SelectAlter level=" << level << ", no gates to evaluate next; RECURSION BOTTOM");
-            auto mapperopt = ql::options::get("mapper");
-            if ("maxfidelity" == mapperopt)
+            if (ql::mapper_t::MAXFIDELITY == options.mapper)
             {
-                a.score = ql::quick_fidelity(past_copy.lg);
+                a.score = past_copy.FidelityScore();
             }
             else
             {
@@ -2850,7 +3125,7 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
             a.DPRINT("... ... SelectAlter, after committing this alternative, mapped easy gates, no gates to evaluate next; RECURSION BOTTOM");
         }
         a.DPRINT("... ... DONE considering alternative:");
-    }
+    });
     // Sort list of good alternatives (gla) on score resulting after recursion
     gla.sort([this](const Alter &a1, const Alter &a2) { return a1.score < a2.score; });
     Alter::DPRINT("... SelectAlter sorted alternatives after recursion:", gla);
@@ -2860,7 +3135,7 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
     bla = gla;
     bla.remove_if( [this,gla](const Alter& a) { return a.score != gla.front().score; } );
     Alter::DPRINT("... SelectAlter equally best alternatives on return of RECURSION:", bla);
-    resa = ChooseAlter(bla, future);
+    resa = ChooseAlter(bla, future, rgen);
     resa.DPRINT("... the selected Alter is");
     // DOUT("... SelectAlter level=" << level << " selecting from " << bla.size() << " equally good alternatives above DONE");
     DOUT("SelectAlter DONE level=" << level << " from " << la.size() << " alternatives");
@@ -2874,8 +3149,8 @@ void SelectAlter(std::list<Alter>& la, Alter & resa, Future& future, Past& past,
 void MapGates(Future& future, Past& past, Past& basePast)
 {
     std::list<ql::gate*>   lg;              // list of non-mappable gates taken from avlist, as returned from MapMappableGates
-    std::string maplookaheadopt = ql::options::get("maplookahead");
-    bool alsoNN2q = ( "noroutingfirst" == maplookaheadopt || "all" == maplookaheadopt );
+    ql::maplookahead_t maplookaheadopt = ql::options::current().maplookahead;
+    bool alsoNN2q = (ql::maplookahead_t::NOROUTINGFIRST == maplookaheadopt || ql::maplookahead_t::ALL == maplookaheadopt);
     while (MapMappableGates(future, past, lg, alsoNN2q))  // returns false when no gates remain
     {
         // all gates in lg are two-qubit quantum gates that cannot be mapped
@@ -2888,13 +3163,139 @@ void MapGates(Future& future, Past& past, Past& basePast)
     
         // select best one
         Alter resa;
-        SelectAlter(la, resa, future, past, basePast, 0);
+        SelectAlter(la, resa, future, past, basePast, 0, gen());
                                             // select one according to strategy specified by options; result in resa
     
         // commit to best one
         // add all or just one swap, as described by resa, to THIS past, and schedule them/it in
         CommitAlter(resa, future, past);
+        nroutings++;
+    }
+}
+
+// state of the beam search: a partially mapped circuit
+struct BeamState
+{
+    Future  future;
+    Past    past;
+    size_t  nroutings;      // number of routings done to get here
+    bool    done;           // no gates remain to be mapped
+};
+
+// Map the gates as MapGates does, but instead of committing to the best alternative of each routing,
+// keep the option mapbeamwidth best partially mapped circuits (the beam) and route each of these;
+// of all their alternatives, the mapbeamwidth with the best rank make the next beam,
+// the alternatives of the first circuit in the beam coming first when equal, and so on;
+// with option mapbeamrank=extension, the rank is the cycle extension relative to past,
+// with mapbeamrank=fidelity, it is the estimated fidelity score of the partially mapped circuit;
+// circuits that have been mapped completely stay in the beam with their rank;
+// when all circuits in the beam have been mapped completely, the first one with the best rank
+// is the result, in future and past.
+// When mapping takes longer than option mapbeamtime (when not 0), only the first circuit of the beam is continued with,
+// so that with a beam width of 1, the result is the same as that of minextendrc with maptiebreak=first.
+void MapGatesBeam(Future& future, Past& past)
+{
+    const ql::compile_options_t & options = ql::options::current();
+    bool alsoNN2q = (ql::maplookahead_t::NOROUTINGFIRST == options.maplookahead || ql::maplookahead_t::ALL == options.maplookahead);
+    std::chrono::steady_clock::time_point starttime = std::chrono::steady_clock::now();
+    size_t beamwidth = options.mapbeamwidth;
+    bool byfidelity = (ql::mapbeamrank_t::FIDELITY == options.mapbeamrank);
+
+    // rank of a partially mapped circuit: the lower, the better
+    auto rank = [&](const Past& p) -> double
+    {
+        return (byfidelity ? p.FidelityScore() : double(p.MaxFreeCycle() - past.MaxFreeCycle()));
+    };
+
+    std::vector<BeamState> beam(1, BeamState{future, past, 0, false});
+    while (true)
+    {
+        // map all mappable gates in each circuit; those that have no gates left are done
+        std::vector<std::list<ql::gate*>> lgs(beam.size());
+        bool alldone = true;
+        for (size_t i = 0; i < beam.size(); i++)
+        {
+            BeamState& bs = beam[i];
+            if (!bs.done)
+            {
+                bs.done = !MapMappableGates(bs.future, bs.past, lgs[i], alsoNN2q);
+            }
+            alldone = alldone && bs.done;
+        }
+        if (alldone)
+        {
+            break;
+        }
+
+        if (beamwidth > 1 && options.mapbeamtime != 0
+            && std::chrono::steady_clock::now() - starttime > std::chrono::milliseconds(options.mapbeamtime))
+        {
+            IOUT("Mapping with beam search exceeded its time of " << options.mapbeamtime << " ms, continuing with beam width 1");
+            beamwidth = 1;
+        }
+
+        // generate and extend the alternatives for each circuit that isn't done;
+        // the candidates for the next beam are those alternatives and the circuits that are done
+        struct candidate_t
+        {
+            double  score;  // rank of the circuit routed with the alternative
+            size_t  state;  // index in beam of the circuit
+            Alter*  ap;     // alternative to route it with; NULL when the circuit is done
+        };
+        std::vector<candidate_t> candidates;
+        std::vector<std::list<Alter>> las(beam.size());
+        for (size_t i = 0; i < beam.size(); i++)
+        {
+            BeamState& bs = beam[i];
+            if (bs.done)
+            {
+                candidates.push_back(candidate_t{rank(bs.past), i, NULL});
+                continue;
+            }
+            GenAlters(lgs[i], las[i], bs.past);
+            ForEachAlter(las[i], bs.past, SelectThreads(0), [&](Alter& a, const Past& apast, size_t)
+            {
+                a.Extend(apast, past);
+            });
+            for (auto & a : las[i])
+            {
+                candidates.push_back(candidate_t{(byfidelity ? rank(a.past) : a.score), i, &a});
+            }
+        }
+        std::stable_sort(candidates.begin(), candidates.end(),
+            [](const candidate_t& c1, const candidate_t& c2) { return c1.score < c2.score; });
+        if (candidates.size() > beamwidth)
+        {
+            candidates.resize(beamwidth);
+        }
+
+        // make the next beam from the best candidates, routing each with its alternative
+        std::vector<BeamState> nextbeam;
+        for (auto & c : candidates)
+        {
+            nextbeam.push_back(beam[c.state]);
+            if (c.ap != NULL)
+            {
+                BeamState& bs = nextbeam.back();
+                CommitAlter(*c.ap, bs.future, bs.past);
+                bs.nroutings++;
+            }
+        }
+        DOUT("MapGatesBeam: beam of " << nextbeam.size() << " from " << candidates.size() << " candidates, best rank " << candidates.front().score);
+        beam.swap(nextbeam);
+    }
+
+    size_t best = 0;
+    for (size_t i = 1; i < beam.size(); i++)
+    {
+        if (rank(beam[i].past) < rank(beam[best].past))
+        {
+            best = i;
+        }
     }
+    future = beam[best].future;
+    past = beam[best].past;
+    nroutings += beam[best].nroutings;
 }
 
 // Map the circuit's gates in the provided context (v2r maps), updating circuit and v2r maps
@@ -2912,8 +3313,16 @@ void MapCircuit(ql::quantum_kernel& kernel, Virt2Real& v2r)
     mainPast.Init(platformp, kernelp);  // mainPast and Past clones inside Alters ready for generating output schedules into
     mainPast.ImportV2r(v2r);    // give it the current mapping/state
     // mainPast.DPRINT("start mapping");
+    nroutings = 0;
 
-    MapGates(future, mainPast, mainPast);
+    if (ql::mapper_t::BEAM == ql::options::current().mapper)
+    {
+        MapGatesBeam(future, mainPast);
+    }
+    else
+    {
+        MapGates(future, mainPast, mainPast);
+    }
     mainPast.FlushAll();                // all output to mainPast.outlg, the output window of mainPast
 
     // mainPast.DPRINT("end mapping");
@@ -45,6 +45,48 @@ void my_print(std::vector<T> const &input, const char *id_name)
 namespace ql
 {
 
+// Parameters of the bounded_fidelity estimator.
+// The defaults are the values that were hardcoded before;
+// a platform can override them in its configuration file, see fidelity_parameters below.
+struct fidelity_parameters_t
+{
+	double gatefid_1 = 0.999;			// fidelity of a single-qubit gate
+	double gatefid_2 = 0.99;			// fidelity of a two-qubit gate
+	double decoherence_time = 3000.0/CYCLE_TIME;	// in cycles
+	size_t cycle_time = CYCLE_TIME;		// in ns, to convert gate durations to cycles
+};
+
+// Get the estimator parameters of a platform from the optional hardware_settings
+// "gate_fidelity_1q", "gate_fidelity_2q" and "decoherence_time" (in ns) of its configuration file.
+inline fidelity_parameters_t fidelity_parameters(const ql::quantum_platform& platform)
+{
+	fidelity_parameters_t params;
+	const json& hw = platform.hardware_settings;
+	params.cycle_time = platform.cycle_time;
+	if (hw.count("gate_fidelity_1q") > 0)
+	{
+		params.gatefid_1 = hw["gate_fidelity_1q"];
+	}
+	if (hw.count("gate_fidelity_2q") > 0)
+	{
+		params.gatefid_2 = hw["gate_fidelity_2q"];
+	}
+	if (hw.count("decoherence_time") > 0)
+	{
+		double t = hw["decoherence_time"];
+		params.decoherence_time = t / params.cycle_time;
+	}
+	else
+	{
+		params.decoherence_time = 3000.0 / params.cycle_time;
+	}
+	if (params.gatefid_1 <= 0 || params.gatefid_1 > 1 || params.gatefid_2 <= 0 || params.gatefid_2 > 1 || params.decoherence_time <= 0)
+	{
+		FATAL("Invalid gate_fidelity_1q, gate_fidelity_2q or decoherence_time in hardware_settings of the configuration file");
+	}
+	return params;
+}
+
 class Metrics {
 
 private:
@@ -52,6 +94,7 @@ private:
 	double gatefid_1 = 0.999; //Hardcoded for testing purposes
 	double gatefid_2 = 0.99; //Hardcoded for testing purposes
 	double decoherence_time = 4500.0/20; //Hardcoded for testing purposes
+	size_t cycle_time = CYCLE_TIME;
 	std::string fidelity_estimator;
 	std::string output_mode;
 	json qubit_attributes;
@@ -116,6 +159,12 @@ public:
 		this->decoherence_time = decoherence_time;
 	}
 
+	Metrics(size_t Nqubits, const fidelity_parameters_t& params, std::string output_mode = "average")
+		: Metrics(Nqubits, params.gatefid_1, params.gatefid_2, params.decoherence_time, "bounded_fidelity", output_mode)
+	{
+		cycle_time = params.cycle_time;
+	}
+
 	void Init(size_t Nqubits, ql::quantum_platform* platform)
 	{
 		this->Nqubits = Nqubits;
@@ -234,11 +283,11 @@ public:
 			{
 				size_t qubit = gate->operands[0]; 
 				fids[qubit] = 1.0;
-				last_op_endtime[qubit] = gate->cycle + gate->duration / CYCLE_TIME;
+				last_op_endtime[qubit] = gate->cycle + gate->duration / cycle_time;
 				continue;
 			}
 			
-			if (gate->duration > CYCLE_TIME*2 && gate->name!="prep_z" && gate->name!="measure" )
+			if (gate->duration > cycle_time*2 && gate->name!="prep_z" && gate->name!="measure" )
 			{
 				EOUT("Gate with duration larger than CYCLE_TIME*20 detected! Non primitive?: " << gate->name );
     			throw ql::exception("Check for non primitive gates at cycle "  + std::to_string(gate->cycle) + "!", false);
@@ -253,7 +302,7 @@ public:
 				IOUT("Gate " + gate->name + "("+ std::to_string(gate->operands[0]) +") at cycle " + std::to_string(gate->cycle) + " with duration " + std::to_string(gate->duration));
 				size_t idled_time = gate->cycle - last_time; //get idlying time to introduce decoherence. This assumes "cycle" starts at zero, otherwise gate->cycle-> (gate->cycle - 1)
 				
-				last_op_endtime[qubit] = gate->cycle  + gate->duration / CYCLE_TIME; //This assumes "cycle" starts at zero, otherwise gate->cycle-> (gate->cycle - 1)
+				last_op_endtime[qubit] = gate->cycle  + gate->duration / cycle_time; //This assumes "cycle" starts at zero, otherwise gate->cycle-> (gate->cycle - 1)
 				
 				IOUT("Idled time:" + std::to_string(idled_time));
 
@@ -274,8 +323,8 @@ public:
 				size_t last_time_t = last_op_endtime[qubit_t];
 				size_t idled_time_c = gate->cycle - last_time_c;
 				size_t idled_time_t = gate->cycle - last_time_t; //get idlying time to introduce decoherence. This assumes "cycle" starts at zero, otherwise gate->cycle-> (gate->cycle - 1)
-				last_op_endtime[qubit_c] = gate->cycle  + gate->duration / CYCLE_TIME; //This assumes "cycle" starts at zero, otherwise gate->cycle-> (gate->cycle - 1)
-				last_op_endtime[qubit_t] = gate->cycle  + gate->duration / CYCLE_TIME ; //This assumes "cycle" starts at zero, otherwise gate->cycle-> (gate->cycle - 1)
+				last_op_endtime[qubit_c] = gate->cycle  + gate->duration / cycle_time; //This assumes "cycle" starts at zero, otherwise gate->cycle-> (gate->cycle - 1)
+				last_op_endtime[qubit_t] = gate->cycle  + gate->duration / cycle_time ; //This assumes "cycle" starts at zero, otherwise gate->cycle-> (gate->cycle - 1)
 				
 				IOUT("Gate " + gate->name + "("+ std::to_string(gate->operands[0]) + ", " + std::to_string(gate->operands[1]) +") at cycle " + std::to_string(gate->cycle) + " with duration " + std::to_string(gate->duration));
 				IOUT("Idled time q_c:" + std::to_string(idled_time_c));
@@ -298,10 +347,10 @@ public:
 				IOUT("\n NEXT GATE");
 
 		}
-		size_t end_cycle = circ.back()->cycle + circ.back()->duration/CYCLE_TIME; 
+		size_t end_cycle = circ.back()->cycle + circ.back()->duration/cycle_time; 
 		for (size_t i=0; i < Nqubits; i++ )
 		{
-			size_t idled_time_final = end_cycle - last_op_endtime[i];
+			size_t idled_time_final = (end_cycle > last_op_endtime[i] ? end_cycle - last_op_endtime[i] : 0); // a qubit can still be busy at the end of the last gate
 			fids[i] *= std::exp(-(double) idled_time_final/decoherence_time);
 		}
 
@@ -319,34 +368,117 @@ public:
 }; //class end
 
 
-	static double quick_fidelity(std::list< ql::gate * > gate_list )
+// Incremental version of Metrics::bounded_fidelity with output mode "average",
+// for scoring many alternative extensions of a scheduled circuit, as the maxfidelity mapper does.
+// Gates are added one by one with their start cycle instead of passing the whole circuit each time;
+// per qubit, gates must be added in the order of their start cycles,
+// but gates of different qubits may be added in any order.
+// Adding a gate and computing the score then take O(1) and O(Nqubits) respectively,
+// and give the same result as bounded_fidelity on the circuit of the added gates ordered by start cycle.
+class fidelity_accumulator_t
+{
+private:
+	fidelity_parameters_t	params;
+	std::vector<double>		fids;				// fidelity of each qubit at its last_op_endtime
+	std::vector<size_t>		last_op_endtime;	// end cycle of the last gate of each qubit
+	size_t					last_cycle;			// start cycle of the last gate of the circuit
+	size_t					end_cycle;			// end cycle of that gate
+	size_t					count;				// number of gates added
+
+public:
+	fidelity_accumulator_t() : last_cycle(0), end_cycle(0), count(0)
+	{
+	}
+
+	void Init(size_t Nqubits, const fidelity_parameters_t& p)
 	{
-		ql::Metrics estimator(17);
-		std::vector<double> previous_fids;
-		ql::circuit circuit;
-		std::copy(std::begin(gate_list), std::end(gate_list), std::back_inserter(circuit));
-		double fidelity = estimator.bounded_fidelity(circuit, previous_fids);
-		fidelity =- fidelity; //Symmetric value because lower score is considered better in mapper.h
-		return fidelity;
+		params = p;
+		fids.assign(Nqubits, 1.0);
+		last_op_endtime.assign(Nqubits, 1);	//First cycle has index 1
+		last_cycle = 0;
+		end_cycle = 0;
+		count = 0;
 	}
 
-    static double quick_fidelity_circuit(ql::circuit circuit )
+	// forget the added gates
+	void clear()
 	{
-		ql::Metrics estimator(17);
-		std::vector<double> previous_fids;
-		double fidelity = estimator.bounded_fidelity(circuit, previous_fids);
-		fidelity =- fidelity; //Symmetric value because lower score is considered better in mapper.h
-		return fidelity;
+		Init(fids.size(), params);
+	}
+
+	void Add(const ql::gate* gate, size_t cycle)
+	{
+		size_t end = cycle + gate->duration / params.cycle_time;
+
+		// the circuit is ordered by start cycle and a gate is put after those with the same start cycle
+		if (count == 0 || cycle >= last_cycle)
+		{
+			last_cycle = cycle;
+			end_cycle = end;
+		}
+		count++;
+
+		if (gate->name == "measure")
+			return;
+		if (gate->name == "prepz")
+		{
+			size_t qubit = gate->operands[0];
+			fids[qubit] = 1.0;
+			last_op_endtime[qubit] = end;
+			return;
+		}
+		if (gate->duration > params.cycle_time*2 && gate->name!="prep_z")
+		{
+			EOUT("Gate with duration larger than CYCLE_TIME*20 detected! Non primitive?: " << gate->name );
+			throw ql::exception("Check for non primitive gates at cycle "  + std::to_string(cycle) + "!", false);
+		}
+
+		if (gate->operands.size() == 1)
+		{
+			size_t qubit = gate->operands[0];
+			size_t idled_time = cycle - last_op_endtime[qubit];
+			last_op_endtime[qubit] = end;
+			fids[qubit] *= std::exp(-((double)idled_time)/params.decoherence_time);
+			fids[qubit] *= params.gatefid_1;
+		}
+		else if (gate->operands.size() == 2)
+		{
+			size_t qubit_c = gate->operands[0];
+			size_t qubit_t = gate->operands[1];
+			size_t idled_time_c = cycle - last_op_endtime[qubit_c];
+			size_t idled_time_t = cycle - last_op_endtime[qubit_t];
+			last_op_endtime[qubit_c] = end;
+			last_op_endtime[qubit_t] = end;
+			fids[qubit_c] *= std::exp(-(double) idled_time_c/params.decoherence_time);
+			fids[qubit_t] *= std::exp(-(double)idled_time_t/params.decoherence_time);
+			fids[qubit_c] *= fids[qubit_t] * params.gatefid_2;
+			fids[qubit_t] = fids[qubit_c];
+		}
+	}
+
+	// average fidelity of the qubits at the end of the circuit, including their idling until then
+	double Fidelity() const
+	{
+		double sum = 0;
+		for (size_t i = 0; i < fids.size(); i++)
+		{
+			double fid = fids[i];
+			if (count != 0)
+			{
+				size_t idled_time_final = (end_cycle > last_op_endtime[i] ? end_cycle - last_op_endtime[i] : 0);
+				fid *= std::exp(-(double) idled_time_final/params.decoherence_time);
+			}
+			sum += fid;
+		}
+		return sum / fids.size();
 	}
 
-    static double quick_fidelity(ql::circuit circuit )
+	// score for the mapper: lower is better
+	double Score() const
 	{
-		ql::Metrics estimator(17);
-		std::vector<double> previous_fids;
-		double fidelity = estimator.bounded_fidelity(circuit, previous_fids);
-		fidelity =- fidelity; //Symmetric value because lower score is considered better in mapper.h
-		return fidelity;
+		return -Fidelity();
 	}
+};
 
 
 // const unsigned char transition_matrix[4][4]  = {{ 0, 1, 2, 3 },  //[input_state][new_error]
@@ -135,6 +135,10 @@ public:
     static bool is_decompose_support_enabled() {
         return ql::unitary::is_decompose_support_enabled();
     }
+
+    static void clear_decomposition_cache() {
+        ql::unitary::clear_decomposition_cache();
+    }
 };
 
 /**
@@ -362,6 +366,11 @@ public:
         return program->sweep_points;
     }
 
+    void set_option(std::string option_name, std::string option_value)
+    {
+        program->set_option(option_name, option_value);
+    }
+
     void add_kernel(Kernel& k)
     {
         program->add( *(k.kernel));
@@ -497,7 +506,7 @@ public:
     void compile(Program program) 
     {
         DOUT(" Compiler " << name << " compiles program  " << program.name); 
-        compiler->compile(program.program);
+        program.program->compile_modular(*compiler);
     }
     
     void add_pass_alias(std::string realPassName, std::string symbolicPassName)
@@ -8,6 +8,7 @@
 #include "utils.h"
 #include "circuit.h"
 #include "kernel.h"
+#include "parallel.h"
 #include "optimizer.h"
 
 
@@ -24,145 +25,167 @@ public:
 
 /**
  * rotation fuser
+ *
+ * walks the circuit once, keeping for each qubit the run of single-qubit gates
+ * since the last gate on it that is not a single-qubit rotation (a multi-qubit gate, a measurement, ...);
+ * with each gate added to a run, the product of the run's unitaries is updated,
+ * and when the gates at the end of the run turn out to make up the identity, they are removed;
+ * these gates are found by comparing the product up to the new gate with the products up to the earlier gates,
+ * for at most max_window earlier gates and the start of the run, so that this takes linear time
  */
 class rotations_merging : public optimizer
 {
 public:
 
-    circuit optimize(circuit& ic /*, bool verbose=false */)
+    circuit optimize(circuit& c /*, bool verbose=false */)
     {
-        circuit c=ic;
-        // if (verbose) COUT("optimizing circuit...");
-        for (size_t i=c.size(); i>1; i--)
+        size_t qubit_count = 0;
+        for (auto & g : c)
         {
-            // println("window size : " << i);
-            c = optimize_sliding_window(c,i);
-            if (c.size()<i) break;
+            for (auto q : g->operands)
+            {
+                qubit_count = std::max(qubit_count, q+1);
+            }
         }
 
-        if (c.size()>1)
-            c = optimize_sliding_window(c,2);
+        std::vector<std::vector<pending_t>> runs(qubit_count);  // per qubit its run of gates that may be removed
+        std::vector<bool> removed(c.size(), false);
+        for (size_t i=0; i<c.size(); ++i)
+        {
+            ql::gate * g = c[i];
+            if (!is_rotation(g))
+            {
+                // g ends the runs of its qubits; a gate without qubit operands ends all runs
+                if (g->operands.empty())
+                {
+                    for (auto & run : runs)
+                        run.clear();
+                }
+                for (auto q : g->operands)
+                {
+                    runs[q].clear();
+                }
+                continue;
+            }
+
+            std::vector<pending_t> & run = runs[g->operands[0]];
+            ql::cmat_t m = g->mat();
+            ql::cmat_t prefix = (run.empty() ? m : fuse(m, run.back().prefix));
 
-        // if (verbose) COUT("optimization done.");
+            // find the latest earlier gate of the run after which the gates up to g make up the identity,
+            // i.e. with a product equal to prefix; a single gate is never removed
+            size_t keep = run.size();   // number of gates of the run that stay
+            size_t last = (run.size() > max_window ? run.size() - max_window : 0);
+            for (size_t k=run.size(); k-- > last; )
+            {
+                if (is_id(k == 0 ? prefix : fuse(prefix, dagger(run[k-1].prefix))))
+                {
+                    keep = k;
+                    break;
+                }
+            }
+            if (keep == run.size() && last > 0 && is_id(prefix))
+            {
+                keep = 0;
+            }
+
+            if (keep < run.size())
+            {
+                for (size_t k=keep; k<run.size(); k++)
+                {
+                    removed[run[k].index] = true;
+                }
+                removed[i] = true;
+                run.resize(keep);
+            }
+            else
+            {
+                run.push_back(pending_t{i, prefix});
+            }
+        }
 
-        return c;
+        circuit oc;
+        for (size_t i=0; i<c.size(); ++i)
+        {
+            if (!removed[i])
+                oc.push_back(c[i]);
+        }
+        return oc;
     }
 
 protected:
 
-    ql::cmat_t fuse(ql::cmat_t& m1, ql::cmat_t& m2)
+    // number of earlier gates in a run that is looked back at for an identity, besides the start of the run
+    static const size_t max_window = 32;
+
+    struct pending_t
+    {
+        size_t      index;      // index of the gate in the circuit
+        ql::cmat_t  prefix;     // product of the unitaries of the run up to and including this gate
+    };
+
+    // m1 x m2
+    ql::cmat_t fuse(const ql::cmat_t& m1, const ql::cmat_t& m2)
     {
         ql::cmat_t      res;
-        ql::complex_t * x = m1.m;
-        ql::complex_t * y = m2.m;
+        const ql::complex_t * x = m1.m;
+        const ql::complex_t * y = m2.m;
         ql::complex_t * r = res.m;
 
-        // m1.dump();
-        // m2.dump();
-
         r[0] = x[0]*y[0] + x[1]*y[2];
         r[1] = x[0]*y[1] + x[1]*y[3];
         r[2] = x[2]*y[0] + x[3]*y[2];
         r[3] = x[2]*y[1] + x[3]*y[3];
 
-        // res.dump();
+        return res;
+    }
 
+    // conjugate transpose, the inverse of a unitary
+    ql::cmat_t dagger(const ql::cmat_t& mat)
+    {
+        ql::cmat_t      res;
+        res.m[0] = std::conj(mat.m[0]);
+        res.m[1] = std::conj(mat.m[2]);
+        res.m[2] = std::conj(mat.m[1]);
+        res.m[3] = std::conj(mat.m[3]);
         return res;
     }
 
 #define __epsilon__ (1e-4)
 
-    bool is_id(ql::cmat_t& mat)
+    // the identity up to a global phase of -1
+    bool is_id(const ql::cmat_t& mat)
     {
-        // mat.dump();
-        ql::complex_t * m = mat.m;
+        const ql::complex_t * m = mat.m;
         if ((std::abs(std::abs(m[0].real())-1.0))>__epsilon__) return false;
         if ((std::abs(m[0].imag())  )>__epsilon__) return false;
         if ((std::abs(m[1].real())  )>__epsilon__) return false;
         if ((std::abs(m[1].imag())  )>__epsilon__) return false;
         if ((std::abs(m[2].real())  )>__epsilon__) return false;
         if ((std::abs(m[2].imag())  )>__epsilon__) return false;
-        if ((std::abs(std::abs(m[3].real())-1.0))>__epsilon__) return false;
+        if ((std::abs(m[3].real()-m[0].real()))>__epsilon__) return false;   // not Z
         if ((std::abs(m[3].imag())  )>__epsilon__) return false;
         return true;
     }
 
-
-
-    bool is_identity(ql::circuit& c)
+    bool is_unitary(const ql::cmat_t& mat)
     {
-        if (c.size()==1)
-            return false;
-        ql::cmat_t m = c[0]->mat();
-        for (size_t i=1; i<c.size(); ++i)
-        {
-            ql::cmat_t m2 = c[i]->mat();
-            m = fuse(m,m2);
-        }
-        return (is_id(m));
+        return is_id(fuse(mat, dagger(mat)));
     }
 
-    ql::circuit optimize_sliding_window(ql::circuit& c, size_t window_size)
+    // a gate that can be part of a run: a unitary on one qubit
+    bool is_rotation(ql::gate * g)
     {
-        ql::circuit oc;
-        std::vector<int> id_pos;
-        for (size_t i=0; i<c.size()-window_size+1; ++i)
-        {
-            ql::circuit w;
-            w.insert(w.begin(),c.begin()+i,c.begin()+i+window_size);
-            if (is_identity(w))
-                id_pos.push_back(i);
-        }
-        if (id_pos.empty())
-        {
-            return ql::circuit(c);
-        }
-        // println("id pos:");
-        // for (size_t i=0; i<id_pos.size(); i++)
-        // println(id_pos[i]);
-
-        if (id_pos.size()==1)
-        {
-            // COUT("rotations cancelling...");
-            size_t pos = id_pos[0];
-            size_t i=0;
-            while (i<c.size())
-            {
-                if (i==pos)
-                    i+=window_size;
-                else
-                {
-                    oc.push_back(c[i]);
-                    i++;
-                }
-            }
-            return oc;
-        }
-
-        // COUT("removing overlapping windows...");
-        std::vector<int> pid;
-        // int prev = id_pos[0];
-        // COUT("rotation cancelling...");
-        size_t pos = id_pos[0];
-        size_t ip  = 0;
-        size_t i=0;
-        while (i<c.size())
-        {
-            if (i==pos)
-            {
-                i+=window_size;
-                ip++;
-                if (ip<id_pos.size())
-                    pos=id_pos[ip];
-            }
-            else
-            {
-                oc.push_back(c[i]);
-                i++;
-            }
-        }
-
-        return oc;
+        if (g->operands.size() != 1 || !g->creg_operands.empty())
+            return false;
+        gate_type_t t = g->type();
+        if (t == __measure_gate__ || t == __prepz_gate__ || t == __wait_gate__ || t == __display__ || t == __classical_gate__ || t == __nop_gate__ || t == __dummy_gate__)
+            return false;
+        // custom gates have no type of their own, so custom measurements and preparations are recognized by their name
+        const std::string & n = g->name;
+        if (n.compare(0, 4, "meas") == 0 || n.compare(0, 4, "prep") == 0 || n.compare(0, 7, "display") == 0)
+            return false;
+        return is_unitary(g->mat());
     }
 
 };
@@ -170,39 +193,15 @@ protected:
     inline void rotation_optimize_kernel(ql::quantum_kernel& kernel, const ql::quantum_platform & platform)
     {
         DOUT("kernel " << kernel.name << " optimize_kernel(): circuit before optimizing: ");
-        print(kernel.c);
+        if (ql::utils::logger::LOG_LEVEL >= ql::utils::logger::log_level_t::LOG_DEBUG)
+            print(kernel.c);
         DOUT("... end circuit");
         ql::rotations_merging rm;
-        if (contains_measurements(kernel.c))
-        {
-            DOUT("kernel contains measurements ...");
-            // decompose the circuit
-            std::vector<circuit*> cs = split_circuit(kernel.c);
-            std::vector<circuit > cs_opt;
-            for (size_t i=0; i<cs.size(); ++i)
-            {
-                if (!contains_measurements(*cs[i]))
-                {
-                    circuit opt = rm.optimize(*cs[i]);
-                    cs_opt.push_back(opt);
-                }
-                else
-                    cs_opt.push_back(*cs[i]);
-            }
-            // for (int i=0; i<cs_opt.size(); ++i)
-            // print(cs_opt[i]);
-            kernel.c.clear( );
-            for (size_t i=0; i<cs_opt.size(); ++i)
-                for (size_t j=0; j<cs_opt[i].size(); j++)
-                    kernel.c.push_back(cs_opt[i][j]);
-        }
-        else
-        {
-            kernel.c = rm.optimize(kernel.c);
-        }
+        kernel.c = rm.optimize(kernel.c);
         kernel.cycles_valid = false;
         DOUT("kernel " << kernel.name << " rotation_optimize(): circuit after optimizing: ");
-        print(kernel.c);
+        if (ql::utils::logger::LOG_LEVEL >= ql::utils::logger::log_level_t::LOG_DEBUG)
+            print(kernel.c);
         DOUT("... end circuit");
     }
 
@@ -212,8 +211,10 @@ protected:
         if( ql::options::get("optimize") == "yes" )
         {
             IOUT("optimizing quantum kernels...");
-            for (size_t k=0; k<programp->kernels.size(); ++k)
+            ql::utils::parallel_for(programp->kernels.size(), [&](size_t k)
+            {
                 rotation_optimize_kernel(programp->kernels[k], platform);
+            });
         }
     }
 }
@@ -11,15 +11,190 @@
 #include <utils.h>
 #include <exception.h>
 #include <CLI/CLI.hpp>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <map>
+#include <string>
 //#include <iostream>
 
 namespace ql
 {
+  // typed values of the options that are tested often, e.g. in the inner loops of the mapper
+  enum class scheduler_t { ASAP, ALAP };
+  enum class mapper_t { NO, BASE, BASERC, MINEXTEND, MINEXTENDRC, MAXFIDELITY, BEAM };
+  enum class maplookahead_t { NO, ONEQFIRST, NOROUTINGFIRST, ALL };
+  enum class mappathselect_t { ALL, BORDERS };
+  enum class mapselectswaps_t { ONE, ALL, EARLIEST };
+  enum class mapselectmaxwidth_t { MIN, MINPLUSONE, MINPLUSHALFMIN, MINPLUSMIN, ALL };
+  enum class maptiebreak_t { FIRST, LAST, RANDOM, CRITICAL };
+  enum class mapbeamrank_t { EXTENSION, FIDELITY };
+
+  /*
+   * the option values of one compilation;
+   * it is created when the compilation starts (see ql::options::snapshot) and is not modified after that,
+   * so that it can be read by concurrent passes and is not affected by options set during the compilation
+   * or by other compilations;
+   * next to the string value of each option (get), the options that are tested often are available as typed members,
+   * parsed once at creation
+   */
+  class compile_options_t
+  {
+  private:
+      std::map<std::string, std::string> values;
+
+      const std::string & value(const std::string & opt_name) const
+      {
+          auto it = values.find(opt_name);
+          if (it == values.end())
+          {
+              FATAL("Un-known option: " << opt_name);
+          }
+          return it->second;
+      }
+
+      bool parse_yesno(const std::string & opt_name) const
+      {
+          const std::string & v = value(opt_name);
+          if (v != "yes" && v != "no")
+          {
+              FATAL("Not supported " << opt_name << " option: " << opt_name << "=" << v);
+          }
+          return v == "yes";
+      }
+
+      template<class E>
+      E parse_enum(const std::string & opt_name, const std::map<std::string, E> & name2value) const
+      {
+          const std::string & v = value(opt_name);
+          auto it = name2value.find(v);
+          if (it == name2value.end())
+          {
+              FATAL("Not supported " << opt_name << " option: " << opt_name << "=" << v);
+          }
+          return it->second;
+      }
+
+      unsigned long parse_count(const std::string & opt_name) const
+      {
+          const std::string & v = value(opt_name);
+          if (v.empty() || v.find_first_not_of("0123456789") != std::string::npos)
+          {
+              FATAL("Not supported " << opt_name << " option: " << opt_name << "=" << v);
+          }
+          return std::stoul(v);
+      }
+
+      void parse()
+      {
+          scheduler = parse_enum<scheduler_t>("scheduler", {{"ASAP", scheduler_t::ASAP}, {"ALAP", scheduler_t::ALAP}});
+          scheduler_commute = parse_yesno("scheduler_commute");
+          scheduler_gapfill = parse_yesno("scheduler_gapfill");
+          print_dot_graphs = parse_yesno("print_dot_graphs");
+
+          mapper = parse_enum<mapper_t>("mapper", {{"no", mapper_t::NO}, {"base", mapper_t::BASE}, {"baserc", mapper_t::BASERC},
+              {"minextend", mapper_t::MINEXTEND}, {"minextendrc", mapper_t::MINEXTENDRC}, {"maxfidelity", mapper_t::MAXFIDELITY},
+              {"beam", mapper_t::BEAM}});
+          maprc = (mapper == mapper_t::BASERC || mapper == mapper_t::MINEXTENDRC || mapper == mapper_t::BEAM);
+          maplookahead = parse_enum<maplookahead_t>("maplookahead", {{"no", maplookahead_t::NO}, {"1qfirst", maplookahead_t::ONEQFIRST},
+              {"noroutingfirst", maplookahead_t::NOROUTINGFIRST}, {"all", maplookahead_t::ALL}});
+          mappathselect = parse_enum<mappathselect_t>("mappathselect", {{"all", mappathselect_t::ALL}, {"borders", mappathselect_t::BORDERS}});
+          mapselectswaps = parse_enum<mapselectswaps_t>("mapselectswaps", {{"one", mapselectswaps_t::ONE}, {"all", mapselectswaps_t::ALL},
+              {"earliest", mapselectswaps_t::EARLIEST}});
+          mapselectmaxwidth = parse_enum<mapselectmaxwidth_t>("mapselectmaxwidth", {{"min", mapselectmaxwidth_t::MIN},
+              {"minplusone", mapselectmaxwidth_t::MINPLUSONE}, {"minplushalfmin", mapselectmaxwidth_t::MINPLUSHALFMIN},
+              {"minplusmin", mapselectmaxwidth_t::MINPLUSMIN}, {"all", mapselectmaxwidth_t::ALL}});
+          maptiebreak = parse_enum<maptiebreak_t>("maptiebreak", {{"first", maptiebreak_t::FIRST}, {"last", maptiebreak_t::LAST},
+              {"random", maptiebreak_t::RANDOM}, {"critical", maptiebreak_t::CRITICAL}});
+          const std::string & maxlevel = value("mapselectmaxlevel");
+          mapselectmaxlevel = ("inf" == maxlevel ? MAX_CYCLE : atoi(maxlevel.c_str()));
+          mapselectthreads = parse_count("mapselectthreads");
+          unitary_decomposition_threads = parse_count("unitary_decomposition_threads");
+          mapseedtime = ("time" == value("mapseed"));
+          mapseed = (mapseedtime ? 0 : parse_count("mapseed"));
+          mapbeamwidth = parse_count("mapbeamwidth");
+          if (mapbeamwidth == 0)
+          {
+              FATAL("Not supported mapbeamwidth option: mapbeamwidth=0");
+          }
+          mapbeamtime = parse_count("mapbeamtime");
+          mapbeamrank = parse_enum<mapbeamrank_t>("mapbeamrank", {{"extension", mapbeamrank_t::EXTENSION}, {"fidelity", mapbeamrank_t::FIDELITY}});
+          const std::string & usemoves = value("mapusemoves");
+          mapusemoves = ("no" != usemoves);
+          mapusemoves_threshold = ("yes" == usemoves ? 0 : atoi(usemoves.c_str()));
+          mapinitone2one = parse_yesno("mapinitone2one");
+          mapassumezeroinitstate = parse_yesno("mapassumezeroinitstate");
+          mapprepinitsstate = parse_yesno("mapprepinitsstate");
+          mapreverseswap = parse_yesno("mapreverseswap");
+          maprecNN2q = parse_yesno("maprecNN2q");
+      }
+
+  public:
+      scheduler_t         scheduler;
+      bool                scheduler_commute;
+      bool                scheduler_gapfill;
+      bool                print_dot_graphs;
+
+      mapper_t            mapper;
+      bool                maprc;                  // mapper is baserc, minextendrc or beam
+      maplookahead_t      maplookahead;
+      mappathselect_t     mappathselect;
+      mapselectswaps_t    mapselectswaps;
+      mapselectmaxwidth_t mapselectmaxwidth;
+      maptiebreak_t       maptiebreak;
+      int                 mapselectmaxlevel;      // "inf" is MAX_CYCLE
+      size_t              mapselectthreads;       // 0 is one per hardware thread
+      size_t              unitary_decomposition_threads;  // 0 is one per hardware thread
+      bool                mapseedtime;            // mapseed is "time"
+      unsigned long       mapseed;                // 0 when mapseedtime
+      size_t              mapbeamwidth;
+      unsigned long       mapbeamtime;            // in milliseconds; 0 is no limit
+      mapbeamrank_t       mapbeamrank;
+      bool                mapusemoves;
+      int                 mapusemoves_threshold;  // "yes" is 0
+      bool                mapinitone2one;
+      bool                mapassumezeroinitstate;
+      bool                mapprepinitsstate;
+      bool                mapreverseswap;
+      bool                maprecNN2q;
+
+      compile_options_t(const std::map<std::string, std::string> & opt_name2opt_val) : values(opt_name2opt_val)
+      {
+          parse();
+      }
+
+      std::string get(const std::string & opt_name) const
+      {
+          auto it = values.find(opt_name);
+          if (it == values.end())
+          {
+              EOUT("Un-known option:"<< opt_name);
+              return "UNKNOWN";
+          }
+          return it->second;
+      }
+
+      // a copy of these options with the given ones set to other values
+      std::shared_ptr<const compile_options_t> with(const std::map<std::string, std::string> & opt_name2opt_val) const
+      {
+          std::map<std::string, std::string> new_values = values;
+          for (auto & nv : opt_name2opt_val)
+          {
+              value(nv.first);    // checks existence
+              new_values[nv.first] = nv.second;
+          }
+          return std::make_shared<const compile_options_t>(new_values);
+      }
+  };
+
   class Options
   {
   private:
       CLI::App * app;
       std::map<std::string, std::string> opt_name2opt_val;
+      mutable std::mutex mutex;     // serializes set, reset_options, snapshot and get
+      std::shared_ptr<const compile_options_t> typed;   // the current values, typed; replaced by each set
+      std::atomic<unsigned long> typed_generation{0};   // incremented each time typed is replaced
       
       void set_defaults()
       {
@@ -29,23 +204,32 @@ namespace ql
           opt_name2opt_val["unique_output"] = "no";
           opt_name2opt_val["write_qasm_files"] = "no";
           opt_name2opt_val["write_report_files"] = "no";
+          opt_name2opt_val["compile_threads"] = "1";
+          opt_name2opt_val["release_gates"] = "no";
 
           opt_name2opt_val["optimize"] = "no";
           opt_name2opt_val["use_default_gates"] = "yes";
           opt_name2opt_val["decompose_toffoli"] = "no";
+          opt_name2opt_val["unitary_decomposition_cache"] = "yes";
+          opt_name2opt_val["unitary_decomposition_threads"] = "1";
           opt_name2opt_val["quantumsim"] = "no";
           opt_name2opt_val["issue_skip_319"] = "no";
 
           opt_name2opt_val["scheduler"] = "ALAP";
           opt_name2opt_val["scheduler_uniform"] = "no";
           opt_name2opt_val["scheduler_commute"] = "no";
+          opt_name2opt_val["scheduler_gapfill"] = "no";
           opt_name2opt_val["prescheduler"] = "yes";
           opt_name2opt_val["scheduler_post179"] = "yes";
           opt_name2opt_val["backend_cc_map_input_file"] = "";
+          opt_name2opt_val["backend_cc_rcscheduler"] = "no";
 
           opt_name2opt_val["cz_mode"] = "manual";
           opt_name2opt_val["print_dot_graphs"] = "no";
 
+          opt_name2opt_val["cancel_prescheduler"] = "no";
+          opt_name2opt_val["cancel_premapper"] = "no";
+
           opt_name2opt_val["clifford_prescheduler"] = "no";
           opt_name2opt_val["clifford_postscheduler"] = "no";
           opt_name2opt_val["clifford_premapper"] = "no";
@@ -63,6 +247,11 @@ namespace ql
           opt_name2opt_val["mapselectmaxlevel"] = "0";
           opt_name2opt_val["mapselectmaxwidth"] = "min";
           opt_name2opt_val["mapselectswaps"] = "all";
+          opt_name2opt_val["mapselectthreads"] = "1";
+          opt_name2opt_val["mapseed"] = "time";
+          opt_name2opt_val["mapbeamwidth"] = "4";
+          opt_name2opt_val["mapbeamtime"] = "0";
+          opt_name2opt_val["mapbeamrank"] = "extension";
           opt_name2opt_val["maptiebreak"] = "random";
           opt_name2opt_val["mapusemoves"] = "yes";
           opt_name2opt_val["mapreverseswap"] = "yes";
@@ -78,19 +267,27 @@ namespace ql
           app->add_set_ignore_case("--scheduler", opt_name2opt_val["scheduler"], {"ASAP", "ALAP"}, "scheduler type", true);
           app->add_set_ignore_case("--scheduler_uniform", opt_name2opt_val["scheduler_uniform"], {"yes", "no"}, "Do uniform scheduling or not", true);
           app->add_set_ignore_case("--scheduler_commute", opt_name2opt_val["scheduler_commute"], {"yes", "no"}, "Commute gates when possible, or not", true);
+          app->add_set_ignore_case("--scheduler_gapfill", opt_name2opt_val["scheduler_gapfill"], {"yes", "no"}, "Resource-constrained scheduler fills gaps before gates scheduled earlier, or not", true);
           app->add_set_ignore_case("--use_default_gates", opt_name2opt_val["use_default_gates"], {"yes", "no"}, "Use default gates or not", true);
           app->add_set_ignore_case("--optimize", opt_name2opt_val["optimize"], {"yes", "no"}, "optimize or not", true);
+          app->add_set_ignore_case("--cancel_prescheduler", opt_name2opt_val["cancel_prescheduler"], {"yes", "no"}, "cancel pairs of inverse gates before prescheduler yes or not", true);
+          app->add_set_ignore_case("--cancel_premapper", opt_name2opt_val["cancel_premapper"], {"yes", "no"}, "cancel pairs of inverse gates before mapping yes or not", true);
           app->add_set_ignore_case("--clifford_prescheduler", opt_name2opt_val["clifford_prescheduler"], {"yes", "no"}, "clifford optimize before prescheduler yes or not", true);
           app->add_set_ignore_case("--clifford_postscheduler", opt_name2opt_val["clifford_postscheduler"], {"yes", "no"}, "clifford optimize after prescheduler yes or not", true);
           app->add_set_ignore_case("--clifford_premapper", opt_name2opt_val["clifford_premapper"], {"yes", "no"}, "clifford optimize before mapping yes or not", true);
           app->add_set_ignore_case("--clifford_postmapper", opt_name2opt_val["clifford_postmapper"], {"yes", "no"}, "clifford optimize after mapping yes or not", true);
           app->add_set_ignore_case("--decompose_toffoli", opt_name2opt_val["decompose_toffoli"], {"no", "NC", "AM"}, "Type of decomposition used for toffoli", true);
+          app->add_set_ignore_case("--unitary_decomposition_cache", opt_name2opt_val["unitary_decomposition_cache"], {"no", "yes", "disk"}, "Reuse unitary decompositions of the same matrix: not, in memory, or also on disk in output_dir", true);
+          app->add_option("--unitary_decomposition_threads", opt_name2opt_val["unitary_decomposition_threads"], "Number of threads on which independent parts of a unitary are decomposed concurrently; 1: sequentially, 0: one per hardware thread", true);
           app->add_set_ignore_case("--quantumsim", opt_name2opt_val["quantumsim"], {"no", "yes", "qsoverlay"}, "Produce quantumsim output, and of which kind", true);
           app->add_set_ignore_case("--issue_skip_319", opt_name2opt_val["issue_skip_319"], {"no", "yes"}, "Issue skip instead of wait in bundles", true);
+          app->add_option("--compile_threads", opt_name2opt_val["compile_threads"], "Number of threads on which kernels are compiled concurrently; 1: sequentially, 0: one per hardware thread", true);
+          app->add_set_ignore_case("--release_gates", opt_name2opt_val["release_gates"], {"no", "yes"}, "Release the gates created by a compilation at its end, leaving the kernels of the program empty", true);
           app->add_option("--backend_cc_map_input_file", opt_name2opt_val["backend_cc_map_input_file"], "Name of CC input map file", true);
+          app->add_set_ignore_case("--backend_cc_rcscheduler", opt_name2opt_val["backend_cc_rcscheduler"], {"no", "yes"}, "Reschedule with the resource constraints of the CC's instruments", true);
           app->add_set_ignore_case("--cz_mode", opt_name2opt_val["cz_mode"], {"manual", "auto"}, "CZ mode", true);
 
-          app->add_set_ignore_case("--mapper", opt_name2opt_val["mapper"], {"no", "base", "baserc", "minextend", "minextendrc", "maxfidelity"}, "Mapper heuristic", true);
+          app->add_set_ignore_case("--mapper", opt_name2opt_val["mapper"], {"no", "base", "baserc", "minextend", "minextendrc", "maxfidelity", "beam"}, "Mapper heuristic", true);
           app->add_set_ignore_case("--mapinitone2one", opt_name2opt_val["mapinitone2one"], {"no", "yes"}, "Initialize mapping of virtual qubits one to one to real qubits", true);
           app->add_set_ignore_case("--mapprepinitsstate", opt_name2opt_val["mapprepinitsstate"], {"no", "yes"}, "Prep gate leaves qubit in zero state", true);
           app->add_set_ignore_case("--mapassumezeroinitstate", opt_name2opt_val["assumezeroinitstate"], {"no", "yes"}, "Assume that qubits are initialized to zero state", true);
@@ -102,6 +299,11 @@ namespace ql
           app->add_set_ignore_case("--maprecNN2q", opt_name2opt_val["maprecNN2q"], {"no","yes"}, "Recursing also on NN 2q gate?", true);
           app->add_set_ignore_case("--mapselectmaxlevel", opt_name2opt_val["mapselectmaxlevel"], {"0","1","2","3","4","5","6","7","8","9","10","inf"}, "Maximum recursion in selecting alternatives on minimum extension", true);
           app->add_set_ignore_case("--mapselectmaxwidth", opt_name2opt_val["mapselectmaxwidth"], {"min","minplusone","minplushalfmin","minplusmin","all"}, "Maximum width number of alternatives to enter recursion with", true);
+          app->add_option("--mapselectthreads", opt_name2opt_val["mapselectthreads"], "Number of threads on which alternatives are evaluated concurrently; 1: sequentially, 0: one per hardware thread", true);
+          app->add_option("--mapseed", opt_name2opt_val["mapseed"], "Seed of the random tie break; time: a different one each run", true);
+          app->add_option("--mapbeamwidth", opt_name2opt_val["mapbeamwidth"], "Number of partially mapped circuits that mapper beam keeps", true);
+          app->add_option("--mapbeamtime", opt_name2opt_val["mapbeamtime"], "Time in milliseconds per kernel after which mapper beam continues with one partially mapped circuit; 0: no limit", true);
+          app->add_set_ignore_case("--mapbeamrank", opt_name2opt_val["mapbeamrank"], {"extension", "fidelity"}, "Rank the partially mapped circuits of mapper beam by cycle extension or by estimated fidelity", true);
           app->add_set_ignore_case("--maptiebreak", opt_name2opt_val["maptiebreak"], {"first", "last", "random", "critical"}, "Tie break method", true);
           app->add_set_ignore_case("--mapusemoves", opt_name2opt_val["mapusemoves"], {"no", "yes", "0","1","2","3","4","5","6","7","8","9","10","11","12","13","14","15","16","17","18","19","20"}, "Use unused qubit to move thru", true);
           app->add_set_ignore_case("--mapreverseswap", opt_name2opt_val["mapreverseswap"], {"no", "yes"}, "Reverse swap operands when better", true);
@@ -110,29 +312,45 @@ namespace ql
           app->add_set_ignore_case("--write_report_files", opt_name2opt_val["write_report_files"], {"yes", "no"}, "write report files on circuit characteristics and pass results", true);
       }
 
+      // assigns the values one by one, keeping the elements of opt_name2opt_val to which app is bound
+      void restore(const std::map<std::string, std::string> & values)
+      {
+          for (auto & nv : values)
+          {
+              opt_name2opt_val[nv.first] = nv.second;
+          }
+      }
+
   public:
       Options(std::string app_name="testApp")
       {
           app = new CLI::App(app_name);
           
           set_defaults();
+          typed = std::make_shared<const compile_options_t>(opt_name2opt_val);
       }
 
       void print_current_values()
       {
+          std::lock_guard<std::mutex> lock(mutex);
           std::cout << "log_level: " << opt_name2opt_val["log_level"] << std::endl
                     << "output_dir: " << opt_name2opt_val["output_dir"] << std::endl
                     << "unique_output: " << opt_name2opt_val["unique_output"] << std::endl
                     << "optimize: " << opt_name2opt_val["optimize"] << std::endl
                     << "use_default_gates: " << opt_name2opt_val["use_default_gates"] << std::endl
                     << "decompose_toffoli: " << opt_name2opt_val["decompose_toffoli"] << std::endl
+                    << "unitary_decomposition_cache: " << opt_name2opt_val["unitary_decomposition_cache"] << std::endl
+                    << "unitary_decomposition_threads: " << opt_name2opt_val["unitary_decomposition_threads"] << std::endl
                     << "quantumsim: " << opt_name2opt_val["quantumsim"] << std::endl
                     << "issue_skip_319: " << opt_name2opt_val["issue_skip_319"] << std::endl
+                    << "cancel_prescheduler: " << opt_name2opt_val["cancel_prescheduler"] << std::endl
                     << "clifford_prescheduler: " << opt_name2opt_val["clifford_prescheduler"] << std::endl
                     << "prescheduler: " << opt_name2opt_val["prescheduler"] << std::endl
                     << "scheduler: " << opt_name2opt_val["scheduler"] << std::endl
                     << "scheduler_uniform: " << opt_name2opt_val["scheduler_uniform"] << std::endl
+                    << "backend_cc_rcscheduler: " << opt_name2opt_val["backend_cc_rcscheduler"] << std::endl
                     << "clifford_postscheduler: " << opt_name2opt_val["clifford_postscheduler"] << std::endl
+                    << "cancel_premapper: " << opt_name2opt_val["cancel_premapper"] << std::endl
                     << "clifford_premapper: " << opt_name2opt_val["clifford_premapper"] << std::endl
                     << "mapper: "           << opt_name2opt_val["mapper"] << std::endl
                     << "mapinitone2one: "   << opt_name2opt_val["mapinitone2one"] << std::endl
@@ -144,21 +362,32 @@ namespace ql
                     << "mapusemoves: "      << opt_name2opt_val["mapusemoves"] << std::endl
                     << "mapreverseswap: "   << opt_name2opt_val["mapreverseswap"] << std::endl
                     << "mapselectswaps: "   << opt_name2opt_val["mapselectswaps"] << std::endl
+                    << "mapselectthreads: " << opt_name2opt_val["mapselectthreads"] << std::endl
+                    << "mapseed: "          << opt_name2opt_val["mapseed"] << std::endl
+                    << "mapbeamwidth: "     << opt_name2opt_val["mapbeamwidth"] << std::endl
+                    << "mapbeamtime: "      << opt_name2opt_val["mapbeamtime"] << std::endl
+                    << "mapbeamrank: "      << opt_name2opt_val["mapbeamrank"] << std::endl
                     << "clifford_postmapper: " << opt_name2opt_val["clifford_postmapper"] << std::endl
                     << "scheduler_post179: " << opt_name2opt_val["scheduler_post179"] << std::endl
                     << "scheduler_commute: " << opt_name2opt_val["scheduler_commute"] << std::endl
+                    << "scheduler_gapfill: " << opt_name2opt_val["scheduler_gapfill"] << std::endl
                     << "cz_mode: " << opt_name2opt_val["cz_mode"] << std::endl
                     << "write_qasm_files: " << opt_name2opt_val["write_qasm_files"] << std::endl
                     << "write_report_files: " << opt_name2opt_val["write_report_files"] << std::endl
+                    << "compile_threads: " << opt_name2opt_val["compile_threads"] << std::endl
+                    << "release_gates: " << opt_name2opt_val["release_gates"] << std::endl
                     << "print_dot_graphs: " << opt_name2opt_val["print_dot_graphs"] << std::endl;
           // FIXME: incomplete, function seems unused
       }
 
       void reset_options()
       {
+          std::lock_guard<std::mutex> lock(mutex);
           app = new CLI::App("testApp");
           
           set_defaults();
+          typed = std::make_shared<const compile_options_t>(opt_name2opt_val);
+          typed_generation++;
       }
       
       void help()
@@ -166,34 +395,54 @@ namespace ql
           std::cout << app->help() << std::endl;
       }
 
+      /*
+       * app parses into opt_name2opt_val, to which its options are bound;
+       * the new values are validated by creating their typed options from a copy,
+       * and only when that succeeds they are kept, otherwise the previous values are restored
+       */
       void set(std::string opt_name, std::string opt_value)
       {
+          std::lock_guard<std::mutex> lock(mutex);
+          std::map<std::string, std::string> previous = opt_name2opt_val;
+          std::map<std::string, std::string> values;
           try
           {
             std::vector<std::string> opts = {opt_value, "--"+opt_name};
             app->parse(opts);
+            values = opt_name2opt_val;
           }
           catch (const std::exception &e)
           {
             app->reset();
+            restore(previous);
             EOUT("Un-known option:"<< e.what());
             throw ql::exception("Error parsing options. "+std::string(e.what())+" !",false);
           }
           app->reset();
+          restore(previous);
+
+          std::shared_ptr<const compile_options_t> validated = std::make_shared<const compile_options_t>(values);  // may fail
+          restore(values);
+          typed = validated;
+          typed_generation++;
       }
 
-      std::string get(std::string opt_name)
+      // changes when the current values change, so that a snapshot of them needn't be taken again until then
+      unsigned long generation() const
       {
-        std::string opt_value("UNKNOWN");
-        if( opt_name2opt_val.find(opt_name) != opt_name2opt_val.end() )
-        {
-            opt_value = opt_name2opt_val[opt_name];
-        }
-        else
-        {
-            EOUT("Un-known option:"<< opt_name);
-        }
-        return opt_value;
+          return typed_generation.load();
+      }
+
+      // the current values, typed; these are not affected by later sets
+      std::shared_ptr<const compile_options_t> snapshot() const
+      {
+          std::lock_guard<std::mutex> lock(mutex);
+          return typed;
+      }
+
+      std::string get(std::string opt_name) const
+      {
+          return snapshot()->get(opt_name);
       }
   };
 
@@ -201,6 +450,77 @@ namespace ql
   {
 //      static ql::Options ql_options("OpenQL Options");
       OPENQL_DECLSPEC extern ql::Options ql_options;
+
+      // the options of the compilation that the calling thread is doing, if any (see scope)
+      inline const compile_options_t * & thread_options()
+      {
+          static thread_local const compile_options_t * optionsp = nullptr;
+          return optionsp;
+      }
+
+      /*
+       * the options of the compilation that the calling thread is doing,
+       * or when not compiling, a snapshot of the current values of the global options,
+       * which this thread holds on to until it calls current after these have been set;
+       * passes test these in their inner loops, instead of calling get
+       */
+      inline const compile_options_t & current()
+      {
+          const compile_options_t * optionsp = thread_options();
+          if (optionsp)
+          {
+              return *optionsp;
+          }
+          static thread_local std::shared_ptr<const compile_options_t> held;
+          static thread_local unsigned long held_generation = 0;
+          unsigned long generation = ql_options.generation();
+          if (!held || generation != held_generation)
+          {
+              held = ql_options.snapshot();
+              held_generation = generation;
+          }
+          return *held;
+      }
+
+      // the current values of the global options, for a compilation to take
+      inline std::shared_ptr<const compile_options_t> snapshot()
+      {
+          return ql_options.snapshot();
+      }
+
+      /*
+       * makes the given options those of the compilation that the calling thread is doing (current and get),
+       * for the lifetime of the scope object; scopes nest;
+       * a compilation creates one for its options, and so does each thread that it starts
+       * with the options of the thread that started it (see parallel.h)
+       */
+      class scope
+      {
+      private:
+          std::shared_ptr<const compile_options_t> options;
+          const compile_options_t * previous;
+
+          scope(const scope &) = delete;
+          scope & operator=(const scope &) = delete;
+
+      public:
+          explicit scope(std::shared_ptr<const compile_options_t> opts) : options(opts), previous(thread_options())
+          {
+              thread_options() = options.get();
+          }
+
+          // without taking ownership, e.g. in a thread started by the one that owns them
+          explicit scope(const compile_options_t * optionsp) : previous(thread_options())
+          {
+              thread_options() = optionsp;
+          }
+
+          ~scope()
+          {
+              thread_options() = previous;
+          }
+      };
+
       inline void print()
       {
           ql_options.help();
@@ -220,7 +540,8 @@ namespace ql
       }
       inline std::string get(std::string opt_name)
       {
-          return ql_options.get(opt_name);
+          const compile_options_t * optionsp = thread_options();
+          return (optionsp ? optionsp->get(opt_name) : ql_options.get(opt_name));
       }
       inline void reset_options()
       {
@@ -0,0 +1,161 @@
+/**
+ * @file   parallel.h
+ * @date   10/2026
+ * @brief  running the kernel-local part of a pass concurrently on a pool of threads
+ */
+
+#ifndef QL_PARALLEL_H
+#define QL_PARALLEL_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <exception>
+
+#include <utils.h>
+#include <options.h>
+#include <gate_arena.h>
+
+namespace ql
+{
+    namespace utils
+    {
+        /*
+         * number of threads that parallel_for uses, from option compile_threads:
+         * 1 (the default) means that everything is done sequentially by the calling thread,
+         * 0 means one thread per hardware thread
+         */
+        inline size_t compile_threads()
+        {
+            std::string threadsopt = ql::options::get("compile_threads");
+            if (threadsopt.empty() || threadsopt.find_first_not_of("0123456789") != std::string::npos)
+            {
+                FATAL("Not supported compile_threads option: compile_threads=" << threadsopt);
+            }
+            size_t nthreads = std::stoul(threadsopt);
+            if (nthreads == 0)
+            {
+                nthreads = std::thread::hardware_concurrency();
+            }
+            return (nthreads == 0 ? 1 : nthreads);
+        }
+
+        /*
+         * call fn(i) for i in 0..count-1, on nthreads threads including the calling one;
+         * the i are divided round-robin over the threads' work queues;
+         * a thread takes work from the front of its own queue and when that is empty,
+         * steals it from the back of the queue of one of the others;
+         * fn must only modify state that is private to i (e.g. kernel i of a program),
+         * so that the result does not depend on nthreads nor on the order in which the i were done;
+         * the threads read the options of the compilation that the calling thread is doing
+         * and allocate gates in its current gate arena;
+         * when calls throw, the exception of the lowest i is rethrown,
+         * which is the one that sequential execution would have thrown;
+         * on more than one thread, the other i are all done still before rethrowing
+         */
+        template<class Fn>
+        void parallel_for(size_t count, size_t nthreads, Fn fn)
+        {
+            if (nthreads > count)
+            {
+                nthreads = count;
+            }
+            if (nthreads <= 1)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    fn(i);
+                }
+                return;
+            }
+
+            struct work_queue_t
+            {
+                std::mutex          mutex;
+                std::deque<size_t>  work;
+            };
+            std::vector<work_queue_t> queues(nthreads);
+            for (size_t i = 0; i < count; i++)
+            {
+                queues[i % nthreads].work.push_back(i);
+            }
+            std::vector<std::exception_ptr> errors(count);
+
+            const compile_options_t * optionsp = ql::options::thread_options();
+            gate_arena * arenap = gate_arena::current();
+
+            // no work is added while working, so a thread that finds all queues empty can stop
+            auto next = [&](size_t t, size_t& i) -> bool
+            {
+                for (size_t n = 0; n < nthreads; n++)
+                {
+                    work_queue_t& q = queues[(t + n) % nthreads];
+                    std::lock_guard<std::mutex> lock(q.mutex);
+                    if (!q.work.empty())
+                    {
+                        if (n == 0)
+                        {
+                            i = q.work.front();
+                            q.work.pop_front();
+                        }
+                        else
+                        {
+                            i = q.work.back();
+                            q.work.pop_back();
+                        }
+                        return true;
+                    }
+                }
+                return false;
+            };
+            auto worker = [&](size_t t)
+            {
+                ql::options::scope options_scope(optionsp);
+                gate_arena::scope arena_scope(arenap);
+                size_t i;
+                while (next(t, i))
+                {
+                    try
+                    {
+                        fn(i);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (size_t t = 1; t < nthreads; t++)
+            {
+                threads.emplace_back(worker, t);
+            }
+            worker(0);
+            for (auto& th : threads)
+            {
+                th.join();
+            }
+
+            for (auto& e : errors)
+            {
+                if (e)
+                {
+                    std::rethrow_exception(e);
+                }
+            }
+        }
+
+        // same, on the number of threads given by option compile_threads
+        template<class Fn>
+        void parallel_for(size_t count, Fn fn)
+        {
+            parallel_for(count, compile_threads(), fn);
+        }
+    } // utils namespace
+} // ql namespace
+
+#endif // QL_PARALLEL_H
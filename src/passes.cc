@@ -11,6 +11,7 @@
 #include "report.h"
 #include "optimizer.h"
 #include "clifford.h"
+#include "cancel.h"
 #include "decompose_toffoli.h"
 #include "cqasm/cqasm_reader.h"
 #include "latency_compensation.h"
@@ -67,19 +68,6 @@ namespace ql
 #include "arch/cbox/cbox_eqasm_compiler.h"
 #include "arch/cc/eqasm_backend_cc.h"
 
-// JvS: this does not belong here *at all*. All header files should have their
-// own CC file with their defs. But only putting the globals in a new
-// corresponding CC file for now breaks linkage on MSVC, because annoyingly CC
-// files are treated as unused and not linked when none of their *functions*
-// are used.
-namespace ql {
-namespace arch {
-size_t CurrSRegCount = 0;
-size_t CurrTRegCount = 0;
-} // namespace arch
-} // namespace ql
-
-
 namespace ql
 {
 
@@ -162,27 +150,16 @@ void AbstractPass::initPass(ql::quantum_program *program)
 {
     if(getPassOptions()->getOption("write_qasm_files") == "yes")
     {
-        //temporary store old value 
-        ///@note-rn: this is only needed to overwrite global option set for old program flow for compatibility reasons ==> This should be deprecated when we remove old code
-        std::string writeQasmLocal = ql::options::get("write_qasm_files");
-        ql::options::set("write_qasm_files", "yes");
-        
+        // the pass option overrides the option of the compilation while reporting
+        ql::options::scope pass_scope(ql::options::current().with({{"write_qasm_files", "yes"}}));
         ql::report_qasm(program, program->platform, "in", getPassName());
-        
-        ql::options::set("write_qasm_files", writeQasmLocal);
-        
     }
     
     if(getPassOptions()->getOption("write_report_files") == "yes")
     {
-        //temporary store old value 
-        ///@note-rn: this is only needed to overwrite global option set for old program flow for compatibility reasons ==> This should be deprecated when we remove old code
-        std::string writeReportLocal = ql::options::get("write_report_files");
-        ql::options::set("write_report_files", "yes");
-        
+        // the pass option overrides the option of the compilation while reporting
+        ql::options::scope pass_scope(ql::options::current().with({{"write_report_files", "yes"}}));
         ql::report_statistics(program, program->platform, "in", getPassName(), "# ");
-        
-        ql::options::set("write_report_files", writeReportLocal);
     }
 }
 
@@ -193,26 +170,16 @@ void AbstractPass::finalizePass(ql::quantum_program *program)
 {
     if(getPassOptions()->getOption("write_qasm_files") == "yes")
     {
-        //temporary store old value 
-        ///@note-rn: this is only needed to overwrite global option set for old program flow for compatibility reasons ==> This should be deprecated when we remove old code
-        std::string writeQasmLocal = ql::options::get("write_qasm_files");
-        ql::options::set("write_qasm_files", "yes");
-        
+        // the pass option overrides the option of the compilation while reporting
+        ql::options::scope pass_scope(ql::options::current().with({{"write_qasm_files", "yes"}}));
         ql::report_qasm(program, program->platform, "out", getPassName());
-        
-        ql::options::set("write_qasm_files", writeQasmLocal);
     }
     
     if(getPassOptions()->getOption("write_report_files") == "yes")
     {
-        //temporary store old value 
-        ///@note-rn: this is only needed to overwrite global option set for old program flow for compatibility reasons ==> This should be deprecated when we remove old code
-        std::string writeReportLocal = ql::options::get("write_report_files");
-        ql::options::set("write_report_files", "yes");
-        
+        // the pass option overrides the option of the compilation while reporting
+        ql::options::scope pass_scope(ql::options::current().with({{"write_report_files", "yes"}}));
         ql::report_statistics(program, program->platform, "out", getPassName(), "# ", getPassStatistics());
-        
-        ql::options::set("write_report_files", writeReportLocal);
     }
     
     resetStatistics();
@@ -393,6 +360,15 @@ void WriteQuantumSimPass::runOnProgram(ql::quantum_program *program)
     ccl_backend_compiler.reset();
 }
 
+    /**
+     * @brief  Cancellation of pairs of inverse gates
+     * @param  Program object in which gates are cancelled
+     */
+void CancelGatesPass::runOnProgram(ql::quantum_program *program)
+{
+    ql::cancel_gates(program, program->platform, getPassName());
+}
+
     /**
      * @brief  Clifford optimizer
      * @param  Program object to be clifford optimized
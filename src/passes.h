@@ -208,6 +208,21 @@ public:
     void runOnProgram(ql::quantum_program *program);
 };
 
+/**
+ * Gate Cancellation Pass
+ */
+class CancelGatesPass: public AbstractPass
+{
+public:
+    /**
+     * @brief  Gate Cancellation pass constructor
+     * @param  Name of the cancellation pass (prescheduler or premapper)
+     */
+    CancelGatesPass(std::string name):AbstractPass(name){};
+
+    void runOnProgram(ql::quantum_program *program);
+};
+
 /**
  * Clifford Optimizer Pass 
  */
@@ -100,6 +100,7 @@ AbstractPass* PassManager::createPass(std::string passName, std::string aliasNam
     if (passName == "CCLPrepCodeGeneration") {pass = new CCLPrepCodeGeneration(aliasName); passfound = true;}
     if (passName == "CCLDecomposePreSchedule") {pass = new CCLDecomposePreSchedule(aliasName); passfound = true;}
     if (passName == "WriteQuantumSim") {pass = new WriteQuantumSimPass(aliasName); passfound = true;}
+    if (passName == "CancelGates") {pass = new CancelGatesPass(aliasName); passfound = true;}
     if (passName == "CliffordOptimize") {pass = new CliffordOptimizePass(aliasName); passfound = true;}
     if (passName == "Map") {pass = new MapPass(aliasName); passfound = true;}
     if (passName == "RCSchedule") {pass = new RCSchedulePass(aliasName); passfound = true;}
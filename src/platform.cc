@@ -16,6 +16,7 @@
 
 namespace ql { namespace utils { namespace logger {
     log_level_t LOG_LEVEL;
+    std::mutex LOG_MUTEX;
 }}}
 namespace ql { namespace options {
     ql::Options ql_options("OpenQL Options");
@@ -29,6 +30,7 @@ quantum_platform::quantum_platform(std::string name, std::string configuration_f
 {
     ql::hardware_configuration hwc(configuration_file_name);
     hwc.load(instruction_map, instruction_settings, hardware_settings, resources, topology, aliases);
+    instruction_table = std::make_shared<const ql::instruction_table_t>(instruction_map);
     eqasm_compiler_name = hwc.eqasm_compiler_name;
     DOUT("eqasm_compiler_name= " << eqasm_compiler_name);
 
@@ -9,6 +9,7 @@
 
 #include <string>
 #include <tuple>
+#include <memory>
 
 #include <compile_options.h>
 #include <json.h>
@@ -26,6 +27,7 @@ public:
     size_t                  cycle_time;               // in [ns]
     std::string             configuration_file_name;  // configuration file name
     ql::instruction_map_t   instruction_map;          // supported operations
+    std::shared_ptr<const ql::instruction_table_t> instruction_table;    // index of instruction_map, shared by the kernels
     json                    instruction_settings;     // instruction settings (to use by the eqasm backend)
     json                    hardware_settings;        // additional hardware settings (to use by the eqasm backend)
 
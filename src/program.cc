@@ -16,6 +16,7 @@
 #include <optimizer.h>
 #include <decompose_toffoli.h>
 #include <clifford.h>
+#include <cancel.h>
 #include <write_sweep_points.h>
 #include <arch/cbox/cbox_eqasm_compiler.h>
 #include <arch/cc_light/cc_light_eqasm_compiler.h>
@@ -31,14 +32,14 @@ namespace ql
      * @param   n   Name of the program
      */
 quantum_program::quantum_program(std::string n)
-    : name(n)
+    : arena(std::make_shared<gate_arena>()), name(n)
 {
     platformInitialized = false;
     DOUT("Constructor for quantum_program:  " << n);
 }
     
 quantum_program::quantum_program(std::string n, quantum_platform platf, size_t nqubits, size_t ncregs)
-        : name(n), platform(platf), qubit_count(nqubits), creg_count(ncregs)
+        : arena(std::make_shared<gate_arena>()), name(n), platform(platf), qubit_count(nqubits), creg_count(ncregs)
 {
     default_config = true;
     needs_backend_compiler = true;
@@ -331,6 +332,37 @@ void quantum_program::set_platform(quantum_platform & platform)
     this->platform = platform;
 }
 
+/**
+ * sets an option for the compilation of this program only, overriding the global value;
+ * with this, programs can be compiled concurrently with different options
+ */
+void quantum_program::set_option(std::string opt_name, std::string opt_value)
+{
+    ql::options::snapshot()->with({{opt_name, opt_value}});   // fails on unknown option or value
+    option_values[opt_name] = opt_value;
+}
+
+/**
+ * the options of a compilation of this program:
+ * the current values of the global options, overridden by those set for this program
+ */
+std::shared_ptr<const compile_options_t> quantum_program::compile_options()
+{
+    std::shared_ptr<const compile_options_t> opts = ql::options::snapshot();
+    if (!option_values.empty())
+    {
+        opts = opts->with(option_values);
+        if (option_values.count("output_dir"))
+        {
+            ql::utils::make_output_dir(option_values["output_dir"]);
+        }
+    }
+    return opts;
+}
+
+/**
+ * compiles the program with the passes of the hard coded compiler, as compile does
+ */
 int quantum_program::compile_modular()
 {
     IOUT("compiling " << name << " ...");
@@ -348,6 +380,7 @@ int quantum_program::compile_modular()
     compiler->addPass("Writer", "initialqasmwriter");
     compiler->addPass("RotationOptimizer", "rotation_optimize");
     compiler->addPass("DecomposeToffoli", "decompose_toffoli");
+    compiler->addPass("CancelGates", "cancel_prescheduler");
     compiler->addPass("CliffordOptimize", "clifford_prescheduler");
     compiler->addPass("Scheduler", "prescheduler");
     compiler->addPass("CliffordOptimize", "clifford_postscheduler");
@@ -369,6 +402,7 @@ int quantum_program::compile_modular()
         compiler->addPass("CCLPrepCodeGeneration", "ccl_prep_code_generation"); 
         compiler->addPass("CCLDecomposePreSchedule", "ccl_decompose_pre_schedule");
         compiler->addPass("WriteQuantumSim", "write_quantumsim_script_unmapped"); 
+        compiler->addPass("CancelGates", "cancel_premapper");
         compiler->addPass("CliffordOptimize", "clifford_premapper");
         compiler->addPass("Map", "mapper");
         compiler->addPass("CliffordOptimize", "clifford_postmapper");
@@ -394,7 +428,7 @@ int quantum_program::compile_modular()
     }
 
     //compile with program    
-    compiler->compile(this);
+    compile_modular(*compiler);
     
     IOUT("compilation of program '" << name << "' done.");
     
@@ -405,8 +439,27 @@ int quantum_program::compile_modular()
     return 0;
 }
 
+/**
+ * compiles the program with the passes of the given compiler,
+ * with the options of this program (see compile_options) and creating the gates in its arena, as compile does
+ */
+int quantum_program::compile_modular(ql::quantum_compiler & compiler)
+{
+    ql::options::scope options_scope(compile_options());   // the options of this compilation
+    ql::gate_arena::scope arena_scope(arena.get());         // which owns the gates it creates
+
+    compiler.compile(this);
+
+    release_gates();
+
+    return 0;
+}
+
 int quantum_program::compile()
 {
+    ql::options::scope options_scope(compile_options());   // the options of this compilation
+    ql::gate_arena::scope arena_scope(arena.get());         // which owns the gates it creates
+
     IOUT("compiling " << name << " ...");
     WOUT("compiling " << name << " ...");
     if (kernels.empty())
@@ -425,6 +478,9 @@ int quantum_program::compile()
     // decompose_toffoli pass
     ql::decompose_toffoli(this, platform, "decompose_toffoli");
 
+    // cancellation of pairs of inverse gates
+    ql::cancel_gates(this, platform, "cancel_prescheduler");
+
     // clifford optimize
     ql::clifford_optimize(this, platform, "clifford_prescheduler");
 
@@ -442,11 +498,13 @@ int quantum_program::compile()
     if (!needs_backend_compiler)
     {
         WOUT("The eqasm compiler attribute indicated that no backend passes are needed.");
+        release_gates();
         return 0;
     }
     if (backend_compiler == NULL)
     {
         EOUT("No known eqasm compiler has been specified in the configuration file.");
+        release_gates();
         return 0;
     }
     else
@@ -459,6 +517,8 @@ int quantum_program::compile()
     // generate sweep_points file
     ql::write_sweep_points(this, platform, "write_sweep_points");
 
+    release_gates();
+
     IOUT("compilation of program '" << name << "' done.");
     
     ql::options::reset_options();
@@ -466,6 +526,26 @@ int quantum_program::compile()
     return 0;
 }
 
+/**
+ * with option release_gates, at the end of a compilation, when its output has been written:
+ * release the gates that were created while compiling the program,
+ * and leave its kernels empty, not referring to them
+ */
+void quantum_program::release_gates()
+{
+    if (ql::options::get("release_gates") != "yes")
+    {
+        return;
+    }
+    DOUT("releasing the gates of program '" << name << "'");
+    for (auto & k : kernels)
+    {
+        k.c.clear();
+        k.ddg.graph.reset();
+    }
+    arena->release();
+}
+
 void quantum_program::print_interaction_matrix()
 {
     IOUT("printing interaction matrix...");
@@ -12,11 +12,13 @@
 #include <compile_options.h>
 #include <platform.h>
 #include <kernel.h>
+#include <gate_arena.h>
 
 namespace ql
 {
 
 class eqasm_compiler;
+class quantum_compiler;
 
 /**
  * quantum_program_
@@ -26,6 +28,7 @@ class quantum_program
 public:
     bool                        default_config;
     std::string                 config_file_name;
+    std::shared_ptr<gate_arena> arena;      // the gates created while compiling the program; destroyed after kernels
     std::vector<quantum_kernel> kernels;
     std::string           name;
     std::string           unique_name;
@@ -37,6 +40,7 @@ public:
     std::string           eqasm_compiler_name;
     bool                  needs_backend_compiler;
     ql::eqasm_compiler *  backend_compiler;
+    std::map<std::string, std::string> option_values;  // options set for this program only (set_option)
 
 
 public:
@@ -60,8 +64,13 @@ public:
 
     int bump_unique_file_version();
 
+    void set_option(std::string opt_name, std::string opt_value);
+    std::shared_ptr<const compile_options_t> compile_options();
+
     int compile();
     int compile_modular();
+    int compile_modular(ql::quantum_compiler & compiler);
+    void release_gates();
 
     void print_interaction_matrix();
     void write_interaction_matrix();
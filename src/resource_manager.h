@@ -14,6 +14,9 @@
 
 #include <vector>
 #include <string>
+#include <utility>
+#include <map>
+#include <iterator>
 
 #include <platform.h>
 
@@ -26,12 +29,150 @@ namespace ql
 
     namespace arch
     {
+        class occupancy_t;
         class resource_t;
         class platform_resource_manager_t;
         class resource_manager_t;
     }
 }
 
+// Occupancy of the units of a resource (e.g. of each qubit, or of each qwg) as sets of busy intervals,
+// used by the resources that fill gaps (see option scheduler_gapfill):
+// a gate can be reserved in any interval in which its units are free, so also before gates reserved earlier,
+// and the direction of scheduling doesn't matter.
+// Each busy interval [from,to) has a key; reservations may overlap only when their keys are equal and not 0,
+// e.g. a qwg can control several qubits at the same time when these perform the same operation;
+// overlapping reservations are merged into one interval, so the intervals of a unit are disjoint.
+// Like resource_t, it supports checkpoint/rollback/commit; a copy starts without checkpoints.
+class ql::arch::occupancy_t
+{
+public:
+    occupancy_t() {}
+
+    occupancy_t(const occupancy_t& org) : units(org.units)
+    {
+    }
+
+    occupancy_t& operator=(const occupancy_t& rhs)
+    {
+        units = rhs.units;
+        undo_log.clear();
+        checkpoints.clear();
+        return *this;
+    }
+
+    void init(size_t count)
+    {
+        units.assign(count, std::map<size_t, busy_t>());
+    }
+
+    // is unit free in [from,to) for a reservation with the given key?
+    bool available(size_t unit, size_t from, size_t to, size_t key) const
+    {
+        if (from >= to)
+        {
+            return true;
+        }
+        const std::map<size_t, busy_t> & busy = units[unit];
+        auto it = busy.upper_bound(from);
+        if (it != busy.begin() && std::prev(it)->second.to > from)
+        {
+            --it;
+        }
+        for (; it != busy.end() && it->first < to; ++it)
+        {
+            if (key == 0 || it->second.key != key)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // reserve [from,to) of unit with the given key, merging it with the intervals it overlaps
+    void reserve(size_t unit, size_t from, size_t to, size_t key)
+    {
+        if (from >= to)
+        {
+            return;
+        }
+        std::map<size_t, busy_t> & busy = units[unit];
+        undo_t undo;
+        undo.unit = unit;
+        auto it = busy.upper_bound(from);
+        if (it != busy.begin() && std::prev(it)->second.to > from)
+        {
+            --it;
+        }
+        size_t merged_from = from;
+        size_t merged_to = to;
+        while (it != busy.end() && it->first < to)
+        {
+            merged_from = std::min(merged_from, it->first);
+            merged_to = std::max(merged_to, it->second.to);
+            if (!checkpoints.empty())
+            {
+                undo.removed.push_back(*it);
+            }
+            it = busy.erase(it);
+        }
+        busy_t b;
+        b.to = merged_to;
+        b.key = key;
+        busy.insert(it, std::make_pair(merged_from, b));
+        if (!checkpoints.empty())
+        {
+            undo.inserted = merged_from;
+            undo_log.push_back(undo);
+        }
+    }
+
+    void checkpoint()
+    {
+        checkpoints.push_back(undo_log.size());
+    }
+
+    void rollback()
+    {
+        size_t mark = checkpoints.back();
+        checkpoints.pop_back();
+        while (undo_log.size() > mark)
+        {
+            undo_t & undo = undo_log.back();
+            std::map<size_t, busy_t> & busy = units[undo.unit];
+            busy.erase(undo.inserted);
+            busy.insert(undo.removed.begin(), undo.removed.end());
+            undo_log.pop_back();
+        }
+    }
+
+    void commit()
+    {
+        checkpoints.pop_back();
+        if (checkpoints.empty())
+        {
+            undo_log.clear();
+        }
+    }
+
+private:
+    struct busy_t
+    {
+        size_t  to;             // busy till cycle to, not inclusive
+        size_t  key;            // reservations with the same key may overlap, unless 0
+    };
+    std::vector<std::map<size_t, busy_t>>   units;      // per unit, the busy intervals by from cycle
+
+    struct undo_t
+    {
+        size_t  unit;
+        size_t  inserted;                                   // from cycle of the interval inserted by reserve
+        std::vector<std::pair<size_t, busy_t>>  removed;    // intervals it replaced
+    };
+    std::vector<undo_t>     undo_log;
+    std::vector<size_t>     checkpoints;    // undo log size at each checkpoint
+};
+
 class ql::arch::resource_t
 {
 public:
@@ -44,17 +185,85 @@ public:
         DOUT("constructing resource: " << n << " for direction (0:fwd,1:bwd): " << dir);
     }
 
+    // a copy starts without checkpoints; the undo log of the original refers to the original's state
+    resource_t(const resource_t& org) : name(org.name), count(org.count), direction(org.direction), occupancy(org.occupancy)
+    {
+    }
+
+    resource_t& operator=(const resource_t& rhs)
+    {
+        name = rhs.name;
+        count = rhs.count;
+        direction = rhs.direction;
+        occupancy = rhs.occupancy;
+        undo_log.clear();
+        checkpoints.clear();
+        return *this;
+    }
+
     virtual bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform) = 0;
     virtual void reserve(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform) = 0;
     virtual ~resource_t() {}
     virtual resource_t* clone() const & = 0;
     virtual resource_t* clone() && = 0;
 
+    // Speculative reservation: after a checkpoint, reserve logs the state that it changes,
+    // so that rollback can restore the state of the checkpoint, without copying the resource;
+    // commit keeps the reservations done since the checkpoint.
+    // Checkpoints nest: rollback and commit apply to the last one that was made.
+    void checkpoint()
+    {
+        checkpoints.push_back(undo_log.size());
+        occupancy.checkpoint();
+    }
+
+    void rollback()
+    {
+        size_t mark = checkpoints.back();
+        checkpoints.pop_back();
+        while (undo_log.size() > mark)
+        {
+            *undo_log.back().first = undo_log.back().second;
+            undo_log.pop_back();
+        }
+        occupancy.rollback();
+    }
+
+    void commit()
+    {
+        checkpoints.pop_back();
+        if (checkpoints.empty())
+        {
+            undo_log.clear();
+        }
+        occupancy.commit();
+    }
+
     void Print(std::string s)
     {
         DOUT(s);
         DOUT("resource name=" << name << "; count=" << count);
     }
+
+protected:
+    // set an element of the resource state, logging its old value when there is a checkpoint;
+    // reserve must change the state only through this
+    void set(size_t & location, size_t value)
+    {
+        if (!checkpoints.empty())
+        {
+            undo_log.push_back(std::make_pair(&location, location));
+        }
+        location = value;
+    }
+
+    // the state of the resources that fill gaps, instead of the state changed through set;
+    // it is empty in the other resources
+    occupancy_t occupancy;
+
+private:
+    std::vector<std::pair<size_t*,size_t>>  undo_log;       // changed state elements with their old values
+    std::vector<size_t>                     checkpoints;    // undo log size at each checkpoint
 };
 
 class ql::arch::platform_resource_manager_t
@@ -144,6 +353,31 @@ public:
         // DOUT("all resources reserved for: " << ins->qasm());
     }
 
+    // see resource_t::checkpoint
+    void checkpoint()
+    {
+        for(auto rptr : resource_ptrs)
+        {
+            rptr->checkpoint();
+        }
+    }
+
+    void rollback()
+    {
+        for(auto rptr : resource_ptrs)
+        {
+            rptr->rollback();
+        }
+    }
+
+    void commit()
+    {
+        for(auto rptr : resource_ptrs)
+        {
+            rptr->commit();
+        }
+    }
+
     // destructor destroying deep resource_t's
     // runs before shallow destruction which is done by synthesized platform_resource_manager_t destructor
     virtual ~platform_resource_manager_t()
@@ -157,35 +391,43 @@ public:
 };
 
 #include "arch/cc_light/cc_light_resource_manager.h"
-// #include "arch/cc/cc_resource_manager.h"
+#include "arch/cc/cc_resource_manager.h"
 
 class ql::arch::resource_manager_t
 {
 public:
 
     platform_resource_manager_t  *platform_resource_manager_ptr;     // pointer to specific platform_resource_manager
+    bool                         gapfill;                           // its resources fill gaps
 
     resource_manager_t()
     {
         // DOUT("Constructing virgin resource_manager_t");
         platform_resource_manager_ptr = NULL;
+        gapfill = false;
     }
 
     // (platform,dir) parameterized resource_manager_t
-    // dynamically allocating platform specific platform_resource_manager_t depending on platform
-    resource_manager_t(const ql::quantum_platform & platform, scheduling_direction_t dir)
+    // dynamically allocating platform specific platform_resource_manager_t depending on platform;
+    // with gapfill, its resources keep their occupation as busy intervals so that gates can be reserved in gaps
+    // (see occupancy_t and option scheduler_gapfill)
+    resource_manager_t(const ql::quantum_platform & platform, scheduling_direction_t dir, bool gapfill = false) : gapfill(gapfill)
     {
         // DOUT("Constructing (platform,dir) parameterized resource_manager_t");
         std::string eqasm_compiler_name = platform.eqasm_compiler_name;
 
         if (eqasm_compiler_name == "cc_light_compiler" )
         {
-            platform_resource_manager_ptr = new ql::arch::cc_light_resource_manager_t(platform, dir);
+            platform_resource_manager_ptr = new ql::arch::cc_light_resource_manager_t(platform, dir, gapfill);
+        }
+        else if (eqasm_compiler_name == "eqasm_backend_cc" )
+        {
+            if (gapfill)
+            {
+                FATAL("scheduler_gapfill is not supported by the '" << eqasm_compiler_name << "' eqasm compiler backend !");
+            }
+            platform_resource_manager_ptr = new ql::arch::cc_resource_manager_t(platform, dir);
         }
-//      else if (eqasm_compiler_name == "cc_compiler" )
-//      {
-//          platform_resource_manager_ptr = new ql::arch::cc_resource_manager_t(platform, dir);
-//      }
         else
         {
             FATAL("the '" << eqasm_compiler_name << "' eqasm compiler backend is not supported !");
@@ -195,7 +437,7 @@ public:
     // copy constructor doing a deep copy
     // *org_resource_manager.platform_resource_manager_ptr->clone() does the trick
     //      to create a copy of the actual derived class' object
-    resource_manager_t(const resource_manager_t& org_resource_manager)
+    resource_manager_t(const resource_manager_t& org_resource_manager) : gapfill(org_resource_manager.gapfill)
     {
         // DOUT("Copy constructing resource_manager_t");
         platform_resource_manager_ptr =  org_resource_manager.platform_resource_manager_ptr->clone();
@@ -214,11 +456,12 @@ public:
         delete platform_resource_manager_ptr;
         // DOUT("... and then assign the cloned copy platform_resource_manager_t to the this resource_manager contained one");
         platform_resource_manager_ptr = new_resource_manager_ptr;
+        gapfill = rhs.gapfill;
         // DOUT("... having done this, copy the copied resource_manager_t to the lhs");
         return *this;
     }
 
-    bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform)
+    bool available(size_t op_start_cycle, ql::gate * ins, const ql::quantum_platform & platform) const
     {
         // DOUT("resource_manager.available()");
         return platform_resource_manager_ptr->available(op_start_cycle, ins, platform);
@@ -230,6 +473,24 @@ public:
         platform_resource_manager_ptr->reserve(op_start_cycle, ins, platform);
     }
 
+    // speculative reservation without copying the resource manager:
+    // after checkpoint, reserve as usual, and then either rollback to the state at the checkpoint
+    // or commit to keep the reservations; see resource_t::checkpoint
+    void checkpoint()
+    {
+        platform_resource_manager_ptr->checkpoint();
+    }
+
+    void rollback()
+    {
+        platform_resource_manager_ptr->rollback();
+    }
+
+    void commit()
+    {
+        platform_resource_manager_ptr->commit();
+    }
+
     // destructor destroying deep platform_resource_managert_t
     // runs before shallow destruction which is done by synthesized resource_manager_t destructor
     ~resource_manager_t()
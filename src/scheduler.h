@@ -18,7 +18,7 @@
     The schedulers modify the order of gates in the circuit, initialize the cycle field of each gate,
     and generate/return the bundles, a list of bundles in which gates starting in the same cycle are grouped.
 
-    The dependence graph (represented by the graph field below) is created in the Init method,
+    The dependence graph (represented by the instruction, arc and adjacency vectors below) is created in the Init method,
     and the graph is constructed from and referring to the gates in the sequence of gates in the kernel's circuit.
     In this graph, the nodes refer to the gates in the circuit, and the edges represent the dependences between two gates.
     Init scans the gates of the circuit from start to end, inspects their parameters, and for each gate
@@ -47,6 +47,12 @@
     the respective commutatable gates are sequentialized according to the original circuit's order.
     With all 'no's replaced by '/', all event types become equivalent (i.e. as if they were Write).
 
+    The dependence graph is kept with the kernel between passes (see quantum_kernel::ddg).
+    When gates have been inserted, deleted, modified or reordered in the circuit since, the Update method
+    brings the graph up to date by recreating only the dependences of those qubits/cregs of which the sequence of events changed,
+    and only between the Writes surrounding the change; the cycle values (set_cycle) and remaining values (set_remaining)
+    that were computed from the graph before, are then only recomputed for the nodes that are affected by the change.
+
     Schedulers come essentially in the following forms:
     - ASAP: a plain forward scheduler using dependences only, aiming at execution each gate as soon as possible
     - ASAP with resource constraints: similar but taking resource constraints of the gates of the platform into account
@@ -60,11 +66,11 @@
     It is enabled by option "scheduler_commute".
  */
 
-#include <lemon/list_graph.h>
-#include <lemon/lgf_reader.h>
-#include <lemon/lgf_writer.h>
-#include <lemon/dijkstra.h>
-#include <lemon/connectivity.h>
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <unordered_map>
 
 #include "utils.h"
 #include "gate.h"
@@ -73,74 +79,310 @@
 #include "ir.h"
 #include "resource_manager.h"
 #include "report.h"
+#include "parallel.h"
 
 using namespace std;
-using namespace lemon;
 
 // see above/below for the meaning of R, W, and D events and their relation to dependences
 enum DepTypes{RAW, WAW, WAR, RAR, RAD, DAR, DAD, WAD, DAW};
 const string DepTypesNames[] = {"RAW", "WAW", "WAR", "RAR", "RAD", "DAR", "DAD", "WAD", "DAW"};
 
+// the events; RZ is the R event of CZ, which creates its RAR dependences before its RAW dependence
+enum EventTypes{W_EVENT, R_EVENT, RZ_EVENT, D_EVENT};
+
 class Scheduler
 {
 public:
     // dependence graph is constructed (see Init) once from the sequence of gates in a kernel's circuit
-    // it can be reused as often as needed as long as no gates are added/deleted; it doesn't modify those gates
-    ListDigraph graph;
+    // it can be reused as often as needed as long as no gates are added/deleted; it doesn't modify those gates;
+    // after gates have been added/deleted, Update brings it up to date
+    //
+    // the graph is flat and index based:
+    // - nodes are numbered in order of creation: s is 0, then the gates in the order of the circuit, t is last;
+    //   since a dependence always is from an earlier to a later gate, this numbering is a topological order
+    // - arcs are numbered in order of creation; their attributes are vectors indexed by arc
+    // - the in-arcs and the out-arcs of each node are stored contiguously (compressed sparse row form),
+    //   the most recently created arc first
+    typedef size_t  Node;
+    typedef size_t  Arc;
 
     // conversion between gate* (pointer to the gate in the circuit) and node (of the dependence graph)
-    ListDigraph::NodeMap<ql::gate*> instruction;// instruction[n] == gate*
-    std::map<ql::gate*,ListDigraph::Node>  node;// node[gate*] == n
-
-    // attributes
-    ListDigraph::NodeMap<std::string> name;     // name[n] == qasm string
-    ListDigraph::ArcMap<int> weight;            // number of cycles of dependence
-    ListDigraph::ArcMap<int> cause;             // qubit/creg index of dependence
-    ListDigraph::ArcMap<int> depType;           // RAW, WAW, ...
+    std::vector<ql::gate*>  instruction;        // instruction[n] == gate*
+    std::unordered_map<ql::gate*,Node>  node;   // node[gate*] == n
+
+    // arc attributes
+    std::vector<Node>   source;                 // source[arc] == n
+    std::vector<Node>   target;                 // target[arc] == n
+    std::vector<int>    weight;                 // number of cycles of dependence
+    std::vector<int>    cause;                  // qubit/creg index of dependence
+    std::vector<int>    depType;                // RAW, WAW, ...
+    std::vector<size_t> eventNo;                // index of the event of the target's gate that created the arc
+    std::vector<size_t> depNo;                  // index of the arc among those created by that event
+
+    // adjacency: the in-arcs of node n are in_arcs[in_offset[n]] .. in_arcs[in_offset[n+1]-1]
+    // and similarly for the out-arcs
+    std::vector<size_t> in_offset;
+    std::vector<Arc>    in_arcs;
+    std::vector<size_t> out_offset;
+    std::vector<Arc>    out_arcs;
 
     // s and t nodes are the top and bottom of the dependence graph
-    ListDigraph::Node s, t;                     // instruction[s]==SOURCE, instruction[t]==SINK
+    Node            s, t;                       // instruction[s]==SOURCE, instruction[t]==SINK
+    std::shared_ptr<ql::gate>   source_gate;    // the SOURCE and SINK gates, not in the circuit, are owned here
+    std::shared_ptr<ql::gate>   sink_gate;
 
     // parameters of dependence graph construction
     size_t          cycle_time;                 // to convert durations to cycles as weight of dependence
     size_t          qubit_count;                // number of qubits, to check/represent qubit as cause of dependence
     size_t          creg_count;                 // number of cregs, to check/represent creg as cause of dependence
+    bool            commute;                    // whether RAR and DAD dependences were left out ("scheduler_commute")
     ql::circuit*    circp;                      // current and result circuit, passed from Init to each scheduler
 
+    // the event of a gate on one of its operands (see get_events)
+    struct Event
+    {
+        size_t      operand;                    // in qubit_creg combined index space
+        EventTypes  type;
+    };
+
+    // the events on each operand by the nodes, in order of the nodes: uses[operand] == list of uses,
+    // starting with the Write by s and ending with the Write by t; kept for Update
+    struct Use
+    {
+        Node        node;
+        size_t      eventNo;                    // index of the event in the events of the node's gate
+        EventTypes  type;
+    };
+    std::vector<std::vector<Use>>   uses;
+
     // scheduler support
-    std::map<ListDigraph::Node,size_t>  remaining;  // remaining[node] == cycles until end; critical path representation
+    std::vector<size_t> remaining;              // remaining[node] == cycles until end; critical path representation
+    std::vector<Node>   critdep;                // critdep[node] == most deep-critical depending node
+    std::vector<size_t> critcount;              // critcount[node] == number of depending nodes as critical as critdep[node]
+    std::vector<Node>   depnodes;               // depending nodes, in set_critical_dep
+
+    // the values computed by set_cycle and set_remaining are kept with the direction they were computed for,
+    // so that after Update they are only recomputed for the nodes that are affected by the change;
+    // *_dirty[node] == the node's dependences changed since, so that its value must be recomputed
+    std::vector<size_t> depcycle;               // depcycle[node] == cycle from dependences, before readjusting
+    bool                depcycle_valid = false;
+    ql::scheduling_direction_t depcycle_dir;
+    std::vector<bool>   cycle_dirty;
+    bool                remaining_valid = false;
+    ql::scheduling_direction_t remaining_dir;
+    std::vector<bool>   remaining_dirty;
+
+    // RC scheduler state: the avlist as two heaps (see init_available)
+    std::vector<bool>   available;              // available[node] == node has been made available
+    std::vector<size_t> avorder;                // avorder[node] == rank in order of being made available
+    size_t              avcount;                // number of nodes made available so far
+    std::vector<Node>   readyheap;              // available nodes that have completed their dependences
+    std::vector<Node>   waitheap;               // available nodes waiting for their dependences to complete
+    std::vector<Node>   resblocked;             // ready nodes waiting for resources, in SelectAvailable
 
 
 public:
-    Scheduler(): instruction(graph), name(graph), weight(graph),
-        cause(graph), depType(graph) {}
+    Scheduler() {}
 
-    // ins->name may contain parameters, so must be stripped first before checking it for gate's name
-    void stripname(std::string& name)
+    // add a node to the dependence graph for gate gp
+    Node add_node(ql::gate* gp)
     {
-        size_t p = name.find(" ");
-        if (p != std::string::npos)
-        {
-            name = name.substr(0,p);
-        }
+        Node n = instruction.size();
+        instruction.push_back(gp);
+        node[gp] = n;
+        return n;
+    }
+
+    // weight of a dependence from node srcNode: the number of cycles its gate takes
+    int dep_weight(Node srcNode)
+    {
+        return int(std::ceil( static_cast<float>(instruction[srcNode]->duration) / cycle_time));
+        // return (instruction[srcNode]->duration + cycle_time -1)/cycle_time;
     }
 
     // factored out code from Init to add a dependence between two nodes
     // operand is in qubit_creg combined index space
-    void add_dep(int srcID, int tgtID, enum DepTypes deptype, int operand)
-    {
-        DOUT(".. adddep ... from srcID " << srcID << " to tgtID " << tgtID << "   opnd=" << operand << ", dep=" << DepTypesNames[deptype]);
-        ListDigraph::Node srcNode = graph.nodeFromId(srcID);
-        ListDigraph::Node tgtNode = graph.nodeFromId(tgtID);
-        ListDigraph::Arc arc = graph.addArc(srcNode,tgtNode);
-        weight[arc] = int(std::ceil( static_cast<float>(instruction[srcNode]->duration) / cycle_time));
-        // weight[arc] = (instruction[srcNode]->duration + cycle_time -1)/cycle_time;
-        cause[arc] = operand;
-        depType[arc] = deptype;
-        DOUT("... dep " << name[srcNode] << " -> " << name[tgtNode] << " (opnd=" << operand << ", dep=" << DepTypesNames[deptype] << ", wght=" << weight[arc] << ")");
+    void add_dep(Node srcNode, Node tgtNode, enum DepTypes deptype, int operand, size_t eventnr, size_t depnr)
+    {
+        DOUT(".. adddep ... from srcID " << srcNode << " to tgtID " << tgtNode << "   opnd=" << operand << ", dep=" << DepTypesNames[deptype]);
+        Arc arc = source.size();
+        source.push_back(srcNode);
+        target.push_back(tgtNode);
+        weight.push_back(dep_weight(srcNode));
+        cause.push_back(operand);
+        depType.push_back(deptype);
+        eventNo.push_back(eventnr);
+        depNo.push_back(depnr);
+        DOUT("... dep " << instruction[srcNode]->qasm() << " -> " << instruction[tgtNode]->qasm() << " (opnd=" << operand << ", dep=" << DepTypesNames[deptype] << ", wght=" << weight[arc] << ")");
+    }
+
+    // the events of gate gp on its operands, in the order in which its dependences are created;
+    // each type of gate has a different 'signature' of events (see Init)
+    void get_events(ql::gate* gp, std::vector<Event>& events)
+    {
+        events.clear();
+        switch(gp->signature)
+        {
+        case ql::__display_signature__:
+            // no operands, display all qubits and cregs
+            // Read+Write each operand
+            for (size_t operand = 0; operand < qubit_count + creg_count; operand++)
+            {
+                events.push_back(Event{operand, W_EVENT});
+            }
+            break;
+        case ql::__classical_signature__:
+            // Read+Write each classical operand
+            for (auto coperand : gp->creg_operands)
+            {
+                events.push_back(Event{qubit_count+coperand, W_EVENT});
+            }
+            break;
+        case ql::__cnot_signature__:
+            // CNOTs Read the first operands, and Ds the second operand
+            for (size_t operandNo = 0; operandNo < gp->operands.size(); operandNo++)
+            {
+                events.push_back(Event{gp->operands[operandNo], operandNo == 0 ? R_EVENT : D_EVENT});
+            }
+            break;
+        case ql::__cz_signature__:
+            // CZs Read all operands
+            for (auto operand : gp->operands)
+            {
+                events.push_back(Event{operand, RZ_EVENT});
+            }
+            break;
+#ifdef HAVEGENERALCONTROLUNITARIES
+        case ql::__cu_signature__:
+            // a Control Unitary in general
+            // Read on all operands, Write on last operand
+            // before implementing it, check whether all commutativity on Reads above hold for this Control Unitary
+            for (auto operand : gp->operands)
+            {
+                events.push_back(Event{operand, R_EVENT});
+            }
+            if (!gp->operands.empty())
+            {
+                events.push_back(Event{gp->operands.back(), W_EVENT});
+            }
+            break;
+#endif  // HAVEGENERALCONTROLUNITARIES
+        case ql::__measure_signature__:
+            // Read+Write each qubit operand + Write corresponding creg
+        case ql::__default_signature__:
+        default:
+            // Read+Write on each quantum operand
+            // Read+Write on each classical operand
+            for (auto operand : gp->operands)
+            {
+                events.push_back(Event{operand, W_EVENT});
+            }
+            for (auto coperand : gp->creg_operands)
+            {
+                events.push_back(Event{qubit_count+coperand, W_EVENT});
+            }
+            break;
+        }
+    }
+
+    // add the dependences of event number eventnr of node n, from the previous uses of its operand:
+    // writer, the one that Wrote it last, readers, those that Read it since, and ds, those that D it since;
+    // see Init for the rules
+    void add_event_deps(Node n, size_t eventnr, const Event& ev,
+        Node writer, const std::vector<Node>& readers, const std::vector<Node>& ds)
+    {
+        size_t  depnr = 0;
+        int     operand = ev.operand;
+        switch(ev.type)
+        {
+        case W_EVENT:
+            add_dep(writer, n, WAW, operand, eventnr, depnr++);
+            for (auto readerID : readers) add_dep(readerID, n, WAR, operand, eventnr, depnr++);
+            for (auto readerID : ds) add_dep(readerID, n, WAD, operand, eventnr, depnr++);
+            break;
+        case R_EVENT:
+            add_dep(writer, n, RAW, operand, eventnr, depnr++);
+            if (!commute)
+            {
+                for (auto readerID : readers) add_dep(readerID, n, RAR, operand, eventnr, depnr++);
+            }
+            for (auto readerID : ds) add_dep(readerID, n, RAD, operand, eventnr, depnr++);
+            break;
+        case RZ_EVENT:
+            if (!commute)
+            {
+                for (auto readerID : readers) add_dep(readerID, n, RAR, operand, eventnr, depnr++);
+            }
+            add_dep(writer, n, RAW, operand, eventnr, depnr++);
+            for (auto readerID : ds) add_dep(readerID, n, RAD, operand, eventnr, depnr++);
+            break;
+        case D_EVENT:
+            add_dep(writer, n, DAW, operand, eventnr, depnr++);
+            if (!commute)
+            {
+                for (auto readerID : ds) add_dep(readerID, n, DAD, operand, eventnr, depnr++);
+            }
+            for (auto readerID : readers) add_dep(readerID, n, DAR, operand, eventnr, depnr++);
+            break;
+        }
+    }
+
+    // update the previous uses of an operand with an event of type evtype of node n on it:
+    // a Write clears the Reads and Ds, a Read clears the Ds, and a D clears the Reads
+    static void add_event_use(Node n, EventTypes evtype, Node& writer, std::vector<Node>& readers, std::vector<Node>& ds)
+    {
+        switch(evtype)
+        {
+        case W_EVENT:
+            writer = n;
+            readers.clear();
+            ds.clear();
+            break;
+        case R_EVENT:
+        case RZ_EVENT:
+            readers.push_back(n);
+            ds.clear();
+            break;
+        case D_EVENT:
+            ds.push_back(n);
+            readers.clear();
+            break;
+        }
+    }
+
+    // compute in_offset/in_arcs and out_offset/out_arcs from the source and target of all arcs;
+    // a counting sort over the arcs in reverse order of creation, so that in each node's range,
+    // the most recently created arc comes first
+    void set_adjacency()
+    {
+        size_t  node_count = instruction.size();
+        size_t  arc_count = source.size();
+
+        in_offset.assign(node_count+1, 0);
+        out_offset.assign(node_count+1, 0);
+        for (Arc arc = 0; arc < arc_count; arc++)
+        {
+            in_offset[target[arc]+1]++;
+            out_offset[source[arc]+1]++;
+        }
+        for (Node n = 0; n < node_count; n++)
+        {
+            in_offset[n+1] += in_offset[n];
+            out_offset[n+1] += out_offset[n];
+        }
+
+        std::vector<size_t> in_next(in_offset.begin(), in_offset.end()-1);
+        std::vector<size_t> out_next(out_offset.begin(), out_offset.end()-1);
+        in_arcs.resize(arc_count);
+        out_arcs.resize(arc_count);
+        for (Arc arc = arc_count; arc-- > 0; )
+        {
+            in_arcs[in_next[target[arc]]++] = arc;
+            out_arcs[out_next[source[arc]]++] = arc;
+        }
     }
 
-    // fill the dependence graph ('graph') with nodes from the circuit and adding arcs for their dependences
+    // fill the dependence graph with nodes from the circuit and adding arcs for their dependences
     void init(ql::circuit& ckt, ql::quantum_platform platform, size_t qcount, size_t ccount)
     {
         DOUT("Dependence graph creation ... #qubits = " << platform.qubit_number);
@@ -151,13 +393,25 @@ public:
         cycle_time = platform.cycle_time;
         circp = &ckt;
 
+        instruction.clear();
+        node.clear();
+        source.clear();
+        target.clear();
+        weight.clear();
+        cause.clear();
+        depType.clear();
+        eventNo.clear();
+        depNo.clear();
+        instruction.reserve(ckt.size()+2);
+        node.reserve(ckt.size()+2);
+
         // dependences are created with a current gate as target
         // and with those previous gates as source that have an operand match:
         // - the previous gates that Read r in LastReaders[r]; this is a list
         // - the previous gates that D qubit q in LastDs[q]; this is a list
         // - the previous gate that Wrote r in LastWriter[r]; this can only be one
         // operands can be a qubit or a classical register
-        typedef vector<int> ReadersListType;
+        typedef vector<Node> ReadersListType;
 
         vector<ReadersListType> LastReaders;
         LastReaders.resize(qubit_creg_count);
@@ -168,16 +422,22 @@ public:
         // start filling the dependence graph by creating the s node, the top of the graph
         {
             // add dummy source node
-            ListDigraph::Node srcNode = graph.addNode();
-            instruction[srcNode] = new ql::SOURCE();    // so SOURCE is defined as instruction[s], not unique in itself
-            node[instruction[srcNode]] = srcNode;
-            name[srcNode] = instruction[srcNode]->qasm();
-            s=srcNode;
+            source_gate.reset(new ql::SOURCE());
+            s = add_node(source_gate.get());    // so SOURCE is defined as instruction[s], not unique in itself
+        }
+        Node srcID = s;
+        vector<Node> LastWriter(qubit_creg_count,srcID);     // it implicitly writes to all qubits and class. regs
+        uses.assign(qubit_creg_count, std::vector<Use>());
+        for (size_t operand = 0; operand < qubit_creg_count; operand++)
+        {
+            uses[operand].push_back(Use{s, operand, W_EVENT});
         }
-        int srcID = graph.id(s);
-        vector<int> LastWriter(qubit_creg_count,srcID);     // it implicitly writes to all qubits and class. regs
+
+        // RAR and DAD dependences are only created when commutation is not exploited
+        commute = ql::options::current().scheduler_commute;
 
         // for each gate pointer ins in the circuit, add a node and add dependences from previous gates to it
+        std::vector<Event> events;
         for( auto ins : ckt )
         {
             DOUT("Current instruction's name: `" << ins->name << "'");
@@ -185,15 +445,8 @@ public:
             for( auto operand : ins->operands ) DOUT(".. Operand: `" << operand << "'");
             for( auto coperand : ins->creg_operands ) DOUT(".. Classical operand: `" << coperand << "'");
 
-            auto iname = ins->name; // copy!!!!
-            stripname(iname);
-
             // Add node
-            ListDigraph::Node consNode = graph.addNode();
-            int consID = graph.id(consNode);
-            instruction[consNode] = ins;
-            node[ins] = consNode;
-            name[consNode] = ins->qasm();
+            Node consID = add_node(ins);
 
             // Add edges (arcs)
             // In quantum computing there are no real Reads and Writes on qubits because they cannot be cloned.
@@ -252,309 +505,27 @@ public:
             // of gates available for being scheduled because they are not blocked by dependences on non-scheduled gates.
             // Therefore, the schedulers are able to select the best one from a set of commutable gates.
 
-            // TODO: define signature in .json file similar to how gcc defines instructions
-            // and then have a signature interpreter here; then we don't have this long if-chain
-            // and, more importantly, we don't have the knowledge of particular gates here;
-            // the default signature would be that of a default gate, modifying each qubit operand.
-
-            // each type of gate has a different 'signature' of events; switch out to each one
-            if(iname == "measure")
+            // Which events a gate has on its operands is given by its signature (see gate.h).
+            // It is resolved when the gate's class or platform instruction is created,
+            // by default from the gate's name, or from the instruction's "signature" attribute in the platform's
+            // configuration file; so there is no knowledge of particular gates here.
+            // The default signature is that of a default gate, modifying each qubit operand.
+
+            // each type of gate has a different 'signature' of events (see get_events);
+            // first add the dependences of all events, and then update the previous uses of the operands,
+            // so that events of the same gate don't depend on each other
+            get_events(ins, events);
+            for (size_t eventnr = 0; eventnr < events.size(); eventnr++)
             {
-                DOUT(". considering " << name[consNode] << " as measure");
-                // Read+Write each qubit operand + Write corresponding creg
-                auto operands = ins->operands;
-                for( auto operand : operands )
-                {
-                    DOUT(".. Operand: " << operand);
-                    add_dep(LastWriter[operand], consID, WAW, operand);
-                    for(auto & readerID : LastReaders[operand])
-                    {
-                        add_dep(readerID, consID, WAR, operand);
-                    }
-                    for(auto & readerID : LastDs[operand])
-                    {
-                        add_dep(readerID, consID, WAD, operand);
-                    }
-                }
-
-                for( auto coperand : ins->creg_operands )
-                {
-                    DOUT(".. Classical operand: " << coperand);
-                    add_dep(LastWriter[qubit_count+coperand], consID, WAW, qubit_count+coperand);
-                    for(auto & readerID : LastReaders[qubit_count+coperand])
-                    {
-                        add_dep(readerID, consID, WAR, qubit_count+coperand);
-                    }
-                }
-
-                // update LastWriter and so clear LastReaders
-                for( auto operand : operands )
-                {
-                    DOUT(".. Update LastWriter for operand: " << operand);
-                    LastWriter[operand] = consID;
-                    DOUT(".. Clearing LastReaders for operand: " << operand);
-                    LastReaders[operand].clear();
-                    LastDs[operand].clear();
-                    DOUT(".. Update LastWriter done");
-                }
-                for( auto coperand : ins->creg_operands )
-                {
-                    DOUT(".. Update LastWriter for coperand: " << coperand);
-                    LastWriter[qubit_count+coperand] = consID;
-                    DOUT(".. Clearing LastReaders for coperand: " << coperand);
-                    LastReaders[qubit_count+coperand].clear();
-                    DOUT(".. Update LastWriter done");
-                }
-                DOUT(". measure done");
-            }
-            else if(iname == "display")
-            {
-                DOUT(". considering " << name[consNode] << " as display");
-                // no operands, display all qubits and cregs
-                // Read+Write each operand
-                std::vector<size_t> qubits(qubit_creg_count);
-                std::iota(qubits.begin(), qubits.end(), 0);
-                for( auto operand : qubits )
-                {
-                    DOUT(".. Operand: " << operand);
-                    add_dep(LastWriter[operand], consID, WAW, operand);
-                    for(auto & readerID : LastReaders[operand])
-                    {
-                        add_dep(readerID, consID, WAR, operand);
-                    }
-                    for(auto & readerID : LastDs[operand])
-                    {
-                        add_dep(readerID, consID, WAD, operand);
-                    }
-                }
-
-                // now update LastWriter and so clear LastReaders/LastDs
-                for( auto operand : qubits )
-                {
-                    LastWriter[operand] = consID;
-                    LastReaders[operand].clear();
-                    LastDs[operand].clear();
-                }
+                auto & ev = events[eventnr];
+                DOUT(".. Operand: " << ev.operand);
+                add_event_deps(consID, eventnr, ev, LastWriter[ev.operand], LastReaders[ev.operand], LastDs[ev.operand]);
+                uses[ev.operand].push_back(Use{consID, eventnr, ev.type});
             }
-            else if(ins->type() == ql::gate_type_t::__classical_gate__)
+            for (auto & ev : events)
             {
-                DOUT(". considering " << name[consNode] << " as classical gate");
-                // Read+Write each classical operand
-                for( auto coperand : ins->creg_operands )
-                {
-                    DOUT("... Classical operand: " << coperand);
-                    add_dep(LastWriter[qubit_count+coperand], consID, WAW, qubit_count+coperand);
-                    for(auto & readerID : LastReaders[qubit_count+coperand])
-                    {
-                        add_dep(readerID, consID, WAR, qubit_count+coperand);
-                    }
-                    for(auto & readerID : LastDs[qubit_count+coperand])
-                    {
-                        add_dep(readerID, consID, WAD, qubit_count+coperand);
-                    }
-                }
-
-                // now update LastWriter and so clear LastReaders/LastDs
-                for( auto coperand : ins->creg_operands )
-                {
-                    LastWriter[qubit_count+coperand] = consID;
-                    LastReaders[qubit_count+coperand].clear();
-                    LastDs[qubit_count+coperand].clear();
-                }
-            }
-            else if (  iname == "cnot"
-                    )
-            {
-                DOUT(". considering " << name[consNode] << " as cnot");
-                // CNOTs Read the first operands, and Ds the second operand
-                size_t operandNo=0;
-                auto operands = ins->operands;
-                for( auto operand : operands )
-                {
-                    DOUT(".. Operand: " << operand);
-                    if( operandNo == 0)
-                    {
-                        add_dep(LastWriter[operand], consID, RAW, operand);
-	                    if (ql::options::get("scheduler_commute") == "no")
-                        {
-                            for(auto & readerID : LastReaders[operand])
-                            {
-                                add_dep(readerID, consID, RAR, operand);
-                            }
-                        }
-                        for(auto & readerID : LastDs[operand])
-                        {
-                            add_dep(readerID, consID, RAD, operand);
-                        }
-                    }
-                    else
-                    {
-                        add_dep(LastWriter[operand], consID, DAW, operand);
-	                    if (ql::options::get("scheduler_commute") == "no")
-                        {
-                            for(auto & readerID : LastDs[operand])
-                            {
-                                add_dep(readerID, consID, DAD, operand);
-                            }
-                        }
-                        for(auto & readerID : LastReaders[operand])
-                        {
-                            add_dep(readerID, consID, DAR, operand);
-                        }
-                    }
-                    operandNo++;
-                } // end of operand for
-
-                // now update LastWriter and so clear LastReaders
-                operandNo=0;
-                for( auto operand : operands )
-                {
-                    if( operandNo == 0)
-                    {
-                        // update LastReaders for this operand 0
-                        LastReaders[operand].push_back(consID);
-                        LastDs[operand].clear();
-                    }
-                    else
-                    {
-                        LastDs[operand].push_back(consID);
-	                    LastReaders[operand].clear();
-                    }
-                    operandNo++;
-                }
-            }
-            else if (  iname == "cz"
-                    || iname == "cphase"
-                    )
-            {
-                DOUT(". considering " << name[consNode] << " as cz");
-                // CZs Read all operands
-                size_t operandNo=0;
-                auto operands = ins->operands;
-                for( auto operand : operands )
-                {
-                    DOUT(".. Operand: " << operand);
-                    if (ql::options::get("scheduler_commute") == "no")
-                    {
-                        for(auto & readerID : LastReaders[operand])
-                        {
-                            add_dep(readerID, consID, RAR, operand);
-                        }
-                    }
-                    add_dep(LastWriter[operand], consID, RAW, operand);
-                    for(auto & readerID : LastDs[operand])
-                    {
-                        add_dep(readerID, consID, RAD, operand);
-                    }
-                    operandNo++;
-                } // end of operand for
-
-                // update LastReaders etc.
-                operandNo=0;
-                for( auto operand : operands )
-                {
-                    LastDs[operand].clear();
-                    LastReaders[operand].push_back(consID);
-                    operandNo++;
-                }
-            }
-#ifdef HAVEGENERALCONTROLUNITARIES
-            else if (
-                    // or is a Control Unitary in general
-                    // Read on all operands, Write on last operand
-                    // before implementing it, check whether all commutativity on Reads above hold for this Control Unitary
-                    )
-            {
-                DOUT(". considering " << name[consNode] << " as Control Unitary");
-                // Control Unitaries Read all operands, and Write the last operand
-                size_t operandNo=0;
-                auto operands = ins->operands;
-                size_t op_count = operands.size();
-                for( auto operand : operands )
-                {
-                    DOUT(".. Operand: " << operand);
-                    add_dep(LastWriter[operand], consID, RAW, operand);
-                    if (ql::options::get("scheduler_commute") == "no")
-                    {
-                        for(auto & readerID : LastReaders[operand])
-                        {
-                            add_dep(readerID, consID, RAR, operand);
-                        }
-                    }
-                    for(auto & readerID : LastDs[operand])
-                    {
-                        add_dep(readerID, consID, RAD, operand);
-                    }
-
-                    if( operandNo < op_count-1 )
-                    {
-                        LastReaders[operand].push_back(consID);
-                        LastDs[operand].clear();
-                    }
-                    else
-                    {
-                        add_dep(LastWriter[operand], consID, WAW, operand);
-                        for(auto & readerID : LastReaders[operand])
-                        {
-                            add_dep(readerID, consID, WAR, operand);
-                        }
-                        for(auto & readerID : LastDs[operand])
-                        {
-                            add_dep(readerID, consID, WAD, operand);
-                        }
-
-                        LastWriter[operand] = consID;
-                        LastReaders[operand].clear();
-                        LastDs[operand].clear();
-                    }
-                    operandNo++;
-                } // end of operand for
+                add_event_use(consID, ev.type, LastWriter[ev.operand], LastReaders[ev.operand], LastDs[ev.operand]);
             }
-#endif  // HAVEGENERALCONTROLUNITARIES
-            else
-            {
-                DOUT(". considering " << name[consNode] << " as no special gate (catch-all, generic rules)");
-                // Read+Write on each quantum operand
-                // Read+Write on each classical operand
-                auto operands = ins->operands;
-                for( auto operand : operands )
-                {
-                    DOUT(".. Operand: " << operand);
-                    add_dep(LastWriter[operand], consID, WAW, operand);
-                    for(auto & readerID : LastReaders[operand])
-                    {
-                        add_dep(readerID, consID, WAR, operand);
-                    }
-                    for(auto & readerID : LastDs[operand])
-                    {
-                        add_dep(readerID, consID, WAD, operand);
-                    }
-
-                    LastWriter[operand] = consID;
-                    LastReaders[operand].clear();
-                    LastDs[operand].clear();
-                } // end of operand for
-
-                // Read+Write each classical operand
-                for( auto coperand : ins->creg_operands )
-                {
-                    DOUT("... Classical operand: " << coperand);
-                    add_dep(LastWriter[qubit_count+coperand], consID, WAW, qubit_count+coperand);
-                    for(auto & readerID : LastReaders[qubit_count+coperand])
-                    {
-                        add_dep(readerID, consID, WAR, qubit_count+coperand);
-                    }
-                    for(auto & readerID : LastDs[qubit_count+coperand])
-                    {
-                        add_dep(readerID, consID, WAD, qubit_count+coperand);
-                    }
-
-                    // now update LastWriter and so clear LastReaders/LastDs
-                    LastWriter[qubit_count+coperand] = consID;
-                    LastReaders[qubit_count+coperand].clear();
-                    LastDs[qubit_count+coperand].clear();
-                } // end of coperand for
-            } // end of if/else
             DOUT(". instruction done: " << ins->qasm());
         } // end of instruction for
 
@@ -562,12 +533,9 @@ public:
         // finish filling the dependence graph by creating the t node, the bottom of the graph
         {
 	        // add dummy target node
-	        ListDigraph::Node consNode = graph.addNode();
-	        int consID = graph.id(consNode);
-	        instruction[consNode] = new ql::SINK();    // so SINK is defined as instruction[t], not unique in itself
-	        node[instruction[consNode]] = consNode;
-	        name[consNode] = instruction[consNode]->qasm();
-	        t=consNode;
+	        sink_gate.reset(new ql::SINK());
+	        Node consID = add_node(sink_gate.get());   // so SINK is defined as instruction[t], not unique in itself
+	        t=consID;
 
 	        // add deps to the dummy target node to close the dependence chains
 	        // it behaves as a W to every qubit and creg
@@ -580,56 +548,412 @@ public:
 	        // guaranteed that on a jump and on start of target circuit, the source circuit completed).
             //
             // note that there always is a LastWriter: the dummy source node wrote to every qubit and class. reg
-	        std::vector<size_t> operands(qubit_creg_count);
-	        std::iota(operands.begin(), operands.end(), 0);
-	        for( auto operand : operands )
+	        for (size_t operand = 0; operand < qubit_creg_count; operand++)
 	        {
 	            DOUT(".. Sink operand, adding dep: " << operand);
-	            add_dep(LastWriter[operand], consID, WAW, operand);
-	            for(auto & readerID : LastReaders[operand])
-	            {
-	                add_dep(readerID, consID, WAR, operand);
-	            }
-	            for(auto & readerID : LastDs[operand])
-	            {
-	                add_dep(readerID, consID, WAD, operand);
-	            }
-	        }
-
-            // useless because there is nothing after t but destruction
-	        for( auto operand : operands )
-	        {
-	            DOUT(".. Sink operand, clearing: " << operand);
-	            LastWriter[operand] = consID;
-	            LastReaders[operand].clear();
-	            LastDs[operand].clear();
+	            add_event_deps(consID, operand, Event{operand, W_EVENT}, LastWriter[operand], LastReaders[operand], LastDs[operand]);
+	            uses[operand].push_back(Use{consID, operand, W_EVENT});
 	        }
         }
 
-        // useless as well because by construction, there cannot be cycles
+        set_adjacency();
+        depcycle_valid = false;
+        remaining_valid = false;
+
+        // useless as well because by construction, there cannot be cycles:
+        // each arc goes from a lower numbered node to a higher numbered one;
         // but when afterwards dependences are added, cycles may be created,
         // and after doing so (a copy of) this test should certainly be done because
         // a cyclic dependence graph cannot be scheduled;
         // this test here is a kind of debugging aid whether dependence creation was done well
-        if( !dag(graph) )
+        for (Arc arc = 0; arc < source.size(); arc++)
+        {
+            if (source[arc] >= target[arc])
+            {
+                DOUT("The dependence graph is not a DAG.");
+                EOUT("The dependence graph is not a DAG.");
+                break;
+            }
+        }
+        DOUT("Dependence graph creation Done.");
+    }
+
+    // renumber the arcs to the order in which Init creates them,
+    // i.e. on target node, then on the event that created them, and then in order of creation by that event
+    void sort_arcs()
+    {
+        size_t  node_count = instruction.size();
+        size_t  arc_count = source.size();
+
+        auto arc_lessthan = [this](Arc a1, Arc a2)
+        {
+            if (target[a1] != target[a2]) return target[a1] < target[a2];
+            if (eventNo[a1] != eventNo[a2]) return eventNo[a1] < eventNo[a2];
+            return depNo[a1] < depNo[a2];
+        };
+        bool sorted = true;
+        for (Arc arc = 1; arc < arc_count && sorted; arc++)
+        {
+            sorted = arc_lessthan(arc-1, arc);
+        }
+        if (sorted) return;
+
+        // a counting sort on target, and then a sort of the few arcs of each target
+        std::vector<size_t> offset(node_count+1, 0);
+        for (Arc arc = 0; arc < arc_count; arc++)
+        {
+            offset[target[arc]+1]++;
+        }
+        for (Node n = 0; n < node_count; n++)
+        {
+            offset[n+1] += offset[n];
+        }
+        std::vector<Arc> order(arc_count);
+        std::vector<size_t> next(offset.begin(), offset.end()-1);
+        for (Arc arc = 0; arc < arc_count; arc++)
+        {
+            order[next[target[arc]]++] = arc;
+        }
+        for (Node n = 0; n < node_count; n++)
+        {
+            std::sort(order.begin()+offset[n], order.begin()+offset[n+1], arc_lessthan);
+        }
+
+        permute(source, order);
+        permute(target, order);
+        permute(weight, order);
+        permute(cause, order);
+        permute(depType, order);
+        permute(eventNo, order);
+        permute(depNo, order);
+    }
+
+    // v[i] = v[order[i]] for all i
+    template<class T>
+    static void permute(std::vector<T>& v, const std::vector<size_t>& order)
+    {
+        std::vector<T> result(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            result[i] = v[order[i]];
+        }
+        v.swap(result);
+    }
+
+    // move v[n] to v[newnode[n]] for all n that have a new node, give the others the value init
+    template<class T>
+    static void renumber(std::vector<T>& v, const std::vector<Node>& newnode, size_t node_count, T init)
+    {
+        std::vector<T> result(node_count, init);
+        for (Node n = 0; n < v.size() && n < newnode.size(); n++)
+        {
+            if (newnode[n] < node_count)
+            {
+                result[newnode[n]] = v[n];
+            }
+        }
+        v.swap(result);
+    }
+
+    // bring the dependence graph up to date with ckt, after gates have been inserted, deleted, modified
+    // and/or reordered in it since it was created from it by Init (or updated by Update);
+    // the result is identical to the dependence graph that Init would create from ckt
+    // (same nodes, same arcs in the same order), but only those dependences are recreated
+    // that have an operand of which the sequence of uses changed,
+    // and only in the range from the last Write before the first changed use
+    // up to the first Write after the last changed use: outside that range the previous uses are the same;
+    // it falls back to Init when one of the parameters of dependence graph creation changed,
+    // or when most gates are new
+    void update(ql::circuit& ckt, const ql::quantum_platform& platform, size_t qcount, size_t ccount)
+    {
+        bool new_commute = ql::options::current().scheduler_commute;
+        if (instruction.empty()
+            || qcount != qubit_count
+            || ccount != creg_count
+            || platform.cycle_time != cycle_time
+            || new_commute != commute
+           )
+        {
+            init(ckt, platform, qcount, ccount);
+            return;
+        }
+        DOUT("Dependence graph update ...");
+        circp = &ckt;
+        size_t qubit_creg_count = qubit_count + creg_count;
+        const Node none = std::numeric_limits<Node>::max();
+
+        // the new nodes are s, the gates in circuit order, and t;
+        // a gate that was in the graph before keeps its node's uses and dependences when these didn't change
+        Node new_t = ckt.size()+1;
+        std::vector<Node> newnode(instruction.size(), none);    // newnode[old node] == new node, none when deleted
+        std::vector<bool> isnew(new_t+1, false);                 // isnew[new node] == gate wasn't in graph before
+        size_t new_count = 0;
+        newnode[s] = 0;
+        newnode[t] = new_t;
+        for (Node n = 1; n < new_t; n++)
+        {
+            ql::gate* gp = ckt[n-1];
+            Node old_n = none;
+            if (n < t && instruction[n] == gp)
+            {
+                old_n = n;
+            }
+            else
+            {
+                auto it = node.find(gp);
+                if (it != node.end()) old_n = it->second;
+            }
+            if (old_n == none || old_n == s || old_n == t)
+            {
+                isnew[n] = true;
+                new_count++;
+            }
+            else if (newnode[old_n] != none)
+            {
+                DOUT("... gate occurs more than once in the circuit, creating dependence graph from scratch");
+                init(ckt, platform, qcount, ccount);
+                return;
+            }
+            else
+            {
+                newnode[old_n] = n;
+            }
+        }
+        if (2*new_count > ckt.size())
+        {
+            DOUT("... most gates are new, creating dependence graph from scratch");
+            init(ckt, platform, qcount, ccount);
+            return;
+        }
+
+        // the new uses of each operand, in the new node numbering
+        std::vector<std::vector<Use>> newuses(qubit_creg_count);
+        std::vector<Event> events;
+        for (size_t operand = 0; operand < qubit_creg_count; operand++)
+        {
+            newuses[operand].reserve(uses[operand].size());
+            newuses[operand].push_back(Use{0, operand, W_EVENT});
+        }
+        for (Node n = 1; n < new_t; n++)
+        {
+            get_events(ckt[n-1], events);
+            for (size_t eventnr = 0; eventnr < events.size(); eventnr++)
+            {
+                auto & ev = events[eventnr];
+                auto & evuses = newuses[ev.operand];
+                if (evuses.back().node == n)
+                {
+                    // Init creates the dependences of such events from the same previous uses
+                    DOUT("... gate uses an operand more than once, creating dependence graph from scratch");
+                    init(ckt, platform, qcount, ccount);
+                    return;
+                }
+                evuses.push_back(Use{n, eventnr, ev.type});
+            }
+        }
+        for (size_t operand = 0; operand < qubit_creg_count; operand++)
+        {
+            newuses[operand].push_back(Use{new_t, operand, W_EVENT});
+        }
+
+        // for each operand, compare the old and new uses;
+        // when they differ, the dependences on it with the uses in the range as described above as target,
+        // are removed and will be recreated;
+        // dirty[new node] == its dependences changed, so the nodes at both ends of those arcs are marked
+        struct Range
+        {
+            size_t  operand;
+            size_t  writer;                     // index in newuses of the Write before the first changed use
+            size_t  first;                      // index in newuses of the first changed use
+            size_t  last;                       // index in newuses of the Write at or after the last changed use
+        };
+        std::vector<Range> ranges;
+        std::vector<bool> removed(source.size(), false);
+        std::vector<bool> dirty(isnew);
+        auto same = [&newnode](const Use& u1, const Use& u2)
+        {
+            return newnode[u1.node] == u2.node && u1.eventNo == u2.eventNo && u1.type == u2.type;
+        };
+        for (size_t operand = 0; operand < qubit_creg_count; operand++)
+        {
+            auto & olduses = uses[operand];
+            auto & opuses = newuses[operand];
+            size_t old_size = olduses.size();
+            size_t new_size = opuses.size();
+            size_t first = 0;
+            while (first < old_size && first < new_size && same(olduses[first], opuses[first]))
+            {
+                first++;
+            }
+            if (first == old_size && first == new_size)
+            {
+                continue;
+            }
+            size_t same_at_end = 0;
+            while (same_at_end < old_size-first && same_at_end < new_size-first
+                && same(olduses[old_size-1-same_at_end], opuses[new_size-1-same_at_end]))
+            {
+                same_at_end++;
+            }
+            // both start with a Write by s, and end with one by t, so writer and last exist
+            size_t writer = first-1;
+            while (opuses[writer].type != W_EVENT) writer--;
+            size_t last = new_size-same_at_end;
+            while (opuses[last].type != W_EVENT) last++;
+            ranges.push_back(Range{operand, writer, first, last});
+            DOUT("... operand " << operand << " changed, recreating dependences of uses " << first << " to " << last);
+
+            size_t old_last = last + old_size - new_size;
+            for (size_t i = first; i <= old_last; i++)
+            {
+                Node n = olduses[i].node;
+                for (size_t j = in_offset[n]; j < in_offset[n+1]; j++)
+                {
+                    Arc arc = in_arcs[j];
+                    if (size_t(cause[arc]) == operand && !removed[arc])
+                    {
+                        removed[arc] = true;
+                        if (newnode[source[arc]] != none) dirty[newnode[source[arc]]] = true;
+                        if (newnode[n] != none) dirty[newnode[n]] = true;
+                    }
+                }
+            }
+        }
+
+        // keep the other arcs, renumbering their nodes
+        size_t arc_count = 0;
+        for (Arc arc = 0; arc < source.size(); arc++)
+        {
+            if (removed[arc]) continue;
+            source[arc_count] = newnode[source[arc]];
+            target[arc_count] = newnode[target[arc]];
+            weight[arc_count] = weight[arc];
+            cause[arc_count] = cause[arc];
+            depType[arc_count] = depType[arc];
+            eventNo[arc_count] = eventNo[arc];
+            depNo[arc_count] = depNo[arc];
+            arc_count++;
+        }
+        source.resize(arc_count);
+        target.resize(arc_count);
+        weight.resize(arc_count);
+        cause.resize(arc_count);
+        depType.resize(arc_count);
+        eventNo.resize(arc_count);
+        depNo.resize(arc_count);
+
+        // renumber the nodes
+        for (Node n = s+1; n < t; n++)
+        {
+            if (newnode[n] == none)
+            {
+                auto it = node.find(instruction[n]);
+                if (it != node.end() && it->second == n) node.erase(it);
+            }
+        }
+        for (Node n = 1; n < new_t; n++)
+        {
+            if (n >= t || instruction[n] != ckt[n-1])
+            {
+                node[ckt[n-1]] = n;
+            }
+        }
+        ql::gate* sink = instruction[t];
+        node[sink] = new_t;
+        instruction.resize(new_t+1);
+        std::copy(ckt.begin(), ckt.end(), instruction.begin()+1);
+        instruction[new_t] = sink;
+        t = new_t;
+
+        // the weights of the kept arcs change when the duration of their source's gate was modified
+        for (Arc arc = 0; arc < arc_count; arc++)
+        {
+            int w = dep_weight(source[arc]);
+            if (w != weight[arc])
+            {
+                weight[arc] = w;
+                dirty[source[arc]] = true;
+                dirty[target[arc]] = true;
+            }
+        }
+
+        // recreate the dependences in the ranges, starting from the uses at the Write before each range
+        std::vector<Node> readers;
+        std::vector<Node> ds;
+        for (auto & r : ranges)
+        {
+            auto & opuses = newuses[r.operand];
+            Node writer = opuses[r.writer].node;
+            readers.clear();
+            ds.clear();
+            for (size_t i = r.writer+1; i <= r.last; i++)
+            {
+                auto & u = opuses[i];
+                if (i >= r.first)
+                {
+                    add_event_deps(u.node, u.eventNo, Event{r.operand, u.type}, writer, readers, ds);
+                }
+                add_event_use(u.node, u.type, writer, readers, ds);
+            }
+        }
+        for (Arc arc = arc_count; arc < source.size(); arc++)
+        {
+            dirty[source[arc]] = true;
+            dirty[target[arc]] = true;
+        }
+
+        uses.swap(newuses);
+        sort_arcs();
+        set_adjacency();
+
+        // carry the values of set_cycle and set_remaining over to the new nodes,
+        // marking the nodes with changed dependences to recompute those values from
+        if (depcycle_valid)
+        {
+            renumber(depcycle, newnode, new_t+1, size_t(0));
+            renumber(cycle_dirty, newnode, new_t+1, true);
+            for (Node n = 0; n <= new_t; n++)
+            {
+                if (dirty[n]) cycle_dirty[n] = true;
+            }
+        }
+        if (remaining_valid)
         {
-            DOUT("The dependence graph is not a DAG.");
-            EOUT("The dependence graph is not a DAG.");
+            for (auto & dn : critdep)
+            {
+                dn = (newnode[dn] == none ? s : newnode[dn]);   // deleted one only at dirty node
+            }
+            renumber(remaining, newnode, new_t+1, size_t(0));
+            renumber(critdep, newnode, new_t+1, s);
+            renumber(critcount, newnode, new_t+1, size_t(0));
+            renumber(remaining_dirty, newnode, new_t+1, true);
+            for (Node n = 0; n <= new_t; n++)
+            {
+                if (dirty[n]) remaining_dirty[n] = true;
+            }
         }
-        DOUT("Dependence graph creation Done.");
+        DOUT("Dependence graph update Done: recreated dependences of " << ranges.size() << " operands");
     }
 
     void print()
     {
         COUT("Printing Dependence Graph ");
-        digraphWriter(graph).
-        nodeMap("name", name).
-        arcMap("cause", cause).
-        arcMap("weight", weight).
-        // arcMap("depType", depType).
-        node("source", s).
-        node("target", t).
-        run();
+        // in LEMON Graph Format, as was written by lemon's digraphWriter before
+        std::cout << "@nodes" << endl << "label\tname\t" << endl;
+        for (Node n = instruction.size(); n-- > 0; )
+        {
+            std::cout << n << "\t\"" << instruction[n]->qasm() << "\"\t" << endl;
+        }
+        std::cout << "@arcs" << endl << "\t\tcause\tweight\t" << endl;
+        for (Node n = instruction.size(); n-- > 0; )
+        {
+            for (size_t i = out_offset[n]; i < out_offset[n+1]; i++)
+            {
+                Arc arc = out_arcs[i];
+                std::cout << source[arc] << "\t" << target[arc] << "\t" << cause[arc] << "\t" << weight[arc] << "\t" << endl;
+            }
+        }
+        std::cout << "@attributes" << endl << "source " << s << endl << "target " << t << endl;
     }
 
     void write_dependence_matrix()
@@ -645,17 +969,13 @@ public:
             return;
         }
 
-        size_t totalInstructions = countNodes(graph);
+        size_t totalInstructions = instruction.size();
         vector< vector<bool> > Matrix(totalInstructions, vector<bool>(totalInstructions));
 
         // now print the edges
-        for (ListDigraph::ArcIt arc(graph); arc != INVALID; ++arc)
+        for (Arc arc = 0; arc < source.size(); arc++)
         {
-            ListDigraph::Node srcNode = graph.source(arc);
-            ListDigraph::Node dstNode = graph.target(arc);
-            size_t srcID = graph.id( srcNode );
-            size_t dstID = graph.id( dstNode );
-            Matrix[srcID][dstID] = true;
+            Matrix[source[arc]][target[arc]] = true;
         }
 
         for(size_t i=1; i<totalInstructions-1;i++)
@@ -712,70 +1032,123 @@ public:
 
     // cycle assignment without RC depending on direction: forward:ASAP, backward:ALAP;
     // without RC, this is all there is to schedule, apart from forming the bundles in ql::ir::bundler()
-    // set_cycle iterates over the circuit's gates and set_cycle_gate over the dependences of each gate
-    // please note that set_cycle_gate expects a caller like set_cycle which iterates gp forward through the circuit
-    void set_cycle_gate(ql::gate* gp, ql::scheduling_direction_t dir)
+    // set_cycle iterates over the nodes of the dependence graph and set_cycle_gate over the dependences of each node
+    // please note that set_cycle_gate expects a caller like set_cycle which iterates forward through the nodes
+    void set_cycle_gate(Node currNode, ql::scheduling_direction_t dir)
+    {
+        size_t  currCycle;
+        if (ql::forward_scheduling == dir)
+        {
+            currCycle = 0;
+            for (size_t i = in_offset[currNode]; i < in_offset[currNode+1]; i++)
+            {
+                Arc arc = in_arcs[i];
+                currCycle = std::max(currCycle, instruction[source[arc]]->cycle + weight[arc]);
+            }
+        }
+        else
+        {
+            currCycle = MAX_CYCLE;
+            for (size_t i = out_offset[currNode]; i < out_offset[currNode+1]; i++)
+            {
+                Arc arc = out_arcs[i];
+                currCycle = std::min(currCycle, instruction[target[arc]]->cycle - weight[arc]);
+            }
+        }
+        instruction[currNode]->cycle = currCycle;
+    }
+
+    // as set_cycle_gate but computing depcycle[currNode] from depcycle; returns whether it changed
+    bool set_depcycle_gate(Node currNode, ql::scheduling_direction_t dir)
     {
-        ListDigraph::Node   currNode = node[gp];
         size_t  currCycle;
         if (ql::forward_scheduling == dir)
         {
             currCycle = 0;
-            for( ListDigraph::InArcIt arc(graph,currNode); arc != INVALID; ++arc )
+            for (size_t i = in_offset[currNode]; i < in_offset[currNode+1]; i++)
             {
-                currCycle = std::max(currCycle, instruction[graph.source(arc)]->cycle + weight[arc]);
+                Arc arc = in_arcs[i];
+                currCycle = std::max(currCycle, depcycle[source[arc]] + weight[arc]);
             }
         }
         else
         {
             currCycle = MAX_CYCLE;
-            for( ListDigraph::OutArcIt arc(graph,currNode); arc != INVALID; ++arc )
+            for (size_t i = out_offset[currNode]; i < out_offset[currNode+1]; i++)
             {
-                currCycle = std::min(currCycle, instruction[graph.target(arc)]->cycle - weight[arc]);
+                Arc arc = out_arcs[i];
+                currCycle = std::min(currCycle, depcycle[target[arc]] - weight[arc]);
             }
         }
-        gp->cycle = currCycle;
+        bool changed = (depcycle[currNode] != currCycle);
+        depcycle[currNode] = currCycle;
+        return changed;
     }
 
+    // set the cycle values of all nodes to their ASAP (forward) or ALAP (backward) cycle;
+    // when these were computed before for the same direction and the graph was updated since (see Update),
+    // these are only recomputed for the nodes marked in cycle_dirty and for those depending on a changed one
     void set_cycle(ql::scheduling_direction_t dir)
     {
+        size_t  node_count = instruction.size();
+        if (!depcycle_valid || depcycle_dir != dir || depcycle.size() != node_count)
+        {
+            depcycle.assign(node_count, 0);
+            cycle_dirty.assign(node_count, true);
+        }
         if (ql::forward_scheduling == dir)
         {
-            instruction[s]->cycle = 0;
-            DOUT("... set_cycle of " << instruction[s]->qasm() << " cycles " << instruction[s]->cycle);
-            // *circp is by definition in a topological order of the dependence graph
-            for ( ql::circuit::iterator gpit = circp->begin(); gpit != circp->end(); gpit++)
+            depcycle[s] = 0;
+            cycle_dirty[s] = false;
+            // the node numbering is by definition a topological order of the dependence graph
+            for (Node n = s+1; n <= t; n++)
+            {
+                if (!cycle_dirty[n]) continue;
+                cycle_dirty[n] = false;
+                if (set_depcycle_gate(n, dir))
+                {
+                    for (size_t i = out_offset[n]; i < out_offset[n+1]; i++)
+                    {
+                        cycle_dirty[target[out_arcs[i]]] = true;
+                    }
+                }
+            }
+            for (Node n = s; n <= t; n++)
             {
-                set_cycle_gate(*gpit, dir);
-                DOUT("... set_cycle of " << (*gpit)->qasm() << " cycles " << (*gpit)->cycle);
+                instruction[n]->cycle = depcycle[n];
+                DOUT("... set_cycle of " << instruction[n]->qasm() << " cycles " << instruction[n]->cycle);
             }
-            set_cycle_gate(instruction[t], dir);
-            DOUT("... set_cycle of " << instruction[t]->qasm() << " cycles " << instruction[t]->cycle);
         }
         else
         {
-            instruction[t]->cycle = ALAP_SINK_CYCLE;
-            // *circp is by definition in a topological order of the dependence graph
-            for ( ql::circuit::reverse_iterator gpit = circp->rbegin(); gpit != circp->rend(); gpit++)
+            depcycle[t] = ALAP_SINK_CYCLE;
+            cycle_dirty[t] = false;
+            // the node numbering is by definition a topological order of the dependence graph
+            for (Node n = t; n-- > s; )
             {
-                set_cycle_gate(*gpit, dir);
+                if (!cycle_dirty[n]) continue;
+                cycle_dirty[n] = false;
+                if (set_depcycle_gate(n, dir))
+                {
+                    for (size_t i = in_offset[n]; i < in_offset[n+1]; i++)
+                    {
+                        cycle_dirty[source[in_arcs[i]]] = true;
+                    }
+                }
             }
-            set_cycle_gate(instruction[s], dir);
 
             // readjust cycle values of gates so that SOURCE is at 0
-            size_t  SOURCECycle = instruction[s]->cycle;
+            size_t  SOURCECycle = depcycle[s];
             DOUT("... readjusting cycle values by -" << SOURCECycle);
 
-            instruction[t]->cycle -= SOURCECycle;
-            DOUT("... set_cycle of " << instruction[t]->qasm() << " cycles " << instruction[t]->cycle);
-            for ( auto & gp : *circp)
+            for (Node n = s; n <= t; n++)
             {
-                gp->cycle -= SOURCECycle;
-                DOUT("... set_cycle of " << gp->qasm() << " cycles " << gp->cycle);
+                instruction[n]->cycle = depcycle[n] - SOURCECycle;   // SOURCE becomes 0
+                DOUT("... set_cycle of " << instruction[n]->qasm() << " cycles " << instruction[n]->cycle);
             }
-            instruction[s]->cycle -= SOURCECycle;   // i.e. becomes 0
-            DOUT("... set_cycle of " << instruction[s]->qasm() << " cycles " << instruction[s]->cycle);
         }
+        depcycle_valid = true;
+        depcycle_dir = dir;
     }
 
     static bool cycle_lessthan(ql::gate* gp1, ql::gate* gp2)
@@ -863,62 +1236,124 @@ public:
     // This means that criticality has become independent of the direction of scheduling
     // which is easier in the core of the scheduler.
 
-    // Note that set_remaining_gate expects a caller like set_remaining that iterates gp backward over the circuit
-    void set_remaining_gate(ql::gate* gp, ql::scheduling_direction_t dir)
+    // Note that set_remaining_gate expects a caller like set_remaining that iterates backward over the nodes
+    void set_remaining_gate(Node currNode, ql::scheduling_direction_t dir)
     {
-        ListDigraph::Node   currNode = node[gp];
         size_t              currRemain = 0;
         if (ql::forward_scheduling == dir)
         {
-            for( ListDigraph::OutArcIt arc(graph,currNode); arc != INVALID; ++arc )
+            for (size_t i = out_offset[currNode]; i < out_offset[currNode+1]; i++)
             {
-                currRemain = std::max(currRemain, remaining[graph.target(arc)] + weight[arc]);
+                Arc arc = out_arcs[i];
+                currRemain = std::max(currRemain, remaining[target[arc]] + weight[arc]);
             }
         }
         else
         {
-            for( ListDigraph::InArcIt arc(graph,currNode); arc != INVALID; ++arc )
+            for (size_t i = in_offset[currNode]; i < in_offset[currNode+1]; i++)
             {
-                currRemain = std::max(currRemain, remaining[graph.source(arc)] + weight[arc]);
+                Arc arc = in_arcs[i];
+                currRemain = std::max(currRemain, remaining[source[arc]] + weight[arc]);
             }
         }
         remaining[currNode] = currRemain;
     }
 
+    // set critdep[n] and critcount[n] (see criticality_lessthan) from the depending nodes of n,
+    // for which these and the remaining values must have been set already
+    void set_critical_dep(Node n, ql::scheduling_direction_t dir)
+    {
+        depnodes.clear();
+        get_depending_nodes(n, dir, depnodes);
+        critcount[n] = 0;
+        for (auto d : depnodes)
+        {
+            if (critcount[n] == 0 || remaining[d] > remaining[critdep[n]])
+            {
+                critdep[n] = d;
+                critcount[n] = 1;
+            }
+            else if (remaining[d] == remaining[critdep[n]])
+            {
+                critcount[n]++;
+                if (criticality_lessthan(critdep[n], d, dir))
+                {
+                    critdep[n] = d;
+                }
+            }
+        }
+    }
+
+    // set the remaining values of all nodes, and their critdep and critcount values;
+    // when these were computed before for the same direction and the graph was updated since (see Update),
+    // these are only recomputed for the nodes marked in remaining_dirty and for those depending on a changed one;
+    // since criticality_lessthan follows the critdep chains, a node's value has changed
+    // also when one in its critdep chain has changed
     void set_remaining(ql::scheduling_direction_t dir)
     {
-        ql::gate*   gp;
-        remaining.clear();
+        size_t  node_count = instruction.size();
+        if (!remaining_valid || remaining_dir != dir || remaining.size() != node_count)
+        {
+            remaining.assign(node_count, 0);
+            critdep.assign(node_count, s);
+            critcount.assign(node_count, 0);
+            remaining_dirty.assign(node_count, true);
+        }
+        std::vector<bool>   changed(node_count, false);
+        auto set_remaining_node = [&](Node n)
+        {
+            size_t  old_remaining = remaining[n];
+            Node    old_critdep = critdep[n];
+            size_t  old_critcount = critcount[n];
+            remaining_dirty[n] = false;
+            set_remaining_gate(n, dir);
+            set_critical_dep(n, dir);
+            changed[n] = remaining[n] != old_remaining
+                || critdep[n] != old_critdep
+                || critcount[n] != old_critcount
+                || (critcount[n] != 0 && changed[critdep[n]]);
+            DOUT("... remaining at " << instruction[n]->qasm() << " cycles " << remaining[n]);
+        };
         if (ql::forward_scheduling == dir)
         {
             // remaining until SINK (i.e. the SINK.cycle-ALAP value)
             remaining[t] = 0;
-            // *circp is by definition in a topological order of the dependence graph
-            for ( ql::circuit::reverse_iterator gpit = circp->rbegin(); gpit != circp->rend(); gpit++)
+            remaining_dirty[t] = false;
+            // the node numbering is by definition a topological order of the dependence graph
+            for (Node n = t; n-- > s; )
             {
-                ql::gate*   gp2 = *gpit;
-                set_remaining_gate(gp2, dir);
-                DOUT("... remaining at " << gp2->qasm() << " cycles " << remaining[node[gp2]]);
+                if (!remaining_dirty[n]) continue;
+                set_remaining_node(n);
+                if (changed[n])
+                {
+                    for (size_t i = in_offset[n]; i < in_offset[n+1]; i++)
+                    {
+                        remaining_dirty[source[in_arcs[i]]] = true;
+                    }
+                }
             }
-            gp = instruction[s];
-            set_remaining_gate(gp, dir);
-            DOUT("... remaining at " << gp->qasm() << " cycles " << remaining[s]);
         }
         else
         {
             // remaining until SOURCE (i.e. the ASAP value)
             remaining[s] = 0;
-            // *circp is by definition in a topological order of the dependence graph
-            for ( ql::circuit::iterator gpit = circp->begin(); gpit != circp->end(); gpit++)
+            remaining_dirty[s] = false;
+            // the node numbering is by definition a topological order of the dependence graph
+            for (Node n = s+1; n <= t; n++)
             {
-                ql::gate*   gp2 = *gpit;
-                set_remaining_gate(gp2, dir);
-                DOUT("... remaining at " << gp2->qasm() << " cycles " << remaining[node[gp2]]);
+                if (!remaining_dirty[n]) continue;
+                set_remaining_node(n);
+                if (changed[n])
+                {
+                    for (size_t i = out_offset[n]; i < out_offset[n+1]; i++)
+                    {
+                        remaining_dirty[target[out_arcs[i]]] = true;
+                    }
+                }
             }
-            gp = instruction[t];
-            set_remaining_gate(gp, dir);
-            DOUT("... remaining at " << gp->qasm() << " cycles " << remaining[t]);
         }
+        remaining_valid = true;
+        remaining_dir = dir;
     }
 
     ql::gate* find_mostcritical(std::list<ql::gate*>& lg)
@@ -927,7 +1362,7 @@ public:
         ql::gate*   mostCriticalGate = NULL;
         for ( auto gp : lg)
         {
-            size_t gr = remaining[node[gp]];
+            size_t gr = remaining[node.at(gp)];
             if (gr > maxRemain)
             {
                 mostCriticalGate = gp;
@@ -948,6 +1383,17 @@ public:
     // The scheduler fills cycles one by one, with nodes/instructions from the avlist
     // checking before selection whether the nodes/instructions have completed execution
     // and whether the resource constraints are fulfilled.
+    //
+    // The avlist is ordered on deep-criticality (see criticality_lessthan below), highest first,
+    // and among nodes of equal deep-criticality, on the order in which these were made available.
+    // The mapper uses it as a std::list kept in this order (see MakeAvailable/TakeAvailable on a std::list below).
+    // The scheduler below represents it instead by two heaps, so that it needn't scan it each cycle:
+    // - the ready heap: the available nodes that have completed their dependences at curr_cycle,
+    //   with the first node in avlist order on top;
+    // - the wait heap: the available nodes that are still waiting for their dependences to complete,
+    //   with the node that completes first on top; it is the queue of events at which nodes become ready.
+    // When no node is ready, the scheduler jumps to the cycle of the first such event.
+    // Both representations make the same selection in each cycle.
 
     // Initialize avlist to the single starting node
     // when forward scheduling:
@@ -957,45 +1403,44 @@ public:
 
     // Set the curr_cycle of the scheduling algorithm to start at the appropriate end as well;
     // note that the cycle attributes will be shifted down to start at 1 after backward scheduling.
-    void init_available(std::list<ListDigraph::Node>& avlist, ql::scheduling_direction_t dir, size_t& curr_cycle)
+    void init_available(ql::scheduling_direction_t dir, size_t& curr_cycle)
     {
-        avlist.clear();
+        available.assign(instruction.size(), false);
+        avorder.assign(instruction.size(), 0);
+        avcount = 0;
+        readyheap.clear();
+        waitheap.clear();
+
+        Node n;
         if (ql::forward_scheduling == dir)
         {
             curr_cycle = 0;
-            instruction[s]->cycle = curr_cycle;
-            avlist.push_back(s);
+            n = s;
         }
         else
         {
             curr_cycle = ALAP_SINK_CYCLE;
-            instruction[t]->cycle = curr_cycle;
-            avlist.push_back(t);
+            n = t;
         }
+        instruction[n]->cycle = curr_cycle;
+        available[n] = true;
+        avorder[n] = avcount++;
+        readyheap.push_back(n);
     }
 
     // collect the list of directly depending nodes
     // (i.e. those necessarily scheduled after the given node) without duplicates;
     // dependences that are duplicates from the perspective of the scheduler
     // may be present in the dependence graph because the scheduler ignores dependence type and cause
-    void get_depending_nodes(ListDigraph::Node n, ql::scheduling_direction_t dir, std::list<ListDigraph::Node> & ln)
+    void get_depending_nodes(Node n, ql::scheduling_direction_t dir, std::vector<Node> & ln)
     {
         if (ql::forward_scheduling == dir)
         {
-            for (ListDigraph::OutArcIt succArc(graph,n); succArc != INVALID; ++succArc)
+            for (size_t i = out_offset[n]; i < out_offset[n+1]; i++)
             {
-                ListDigraph::Node succNode = graph.target(succArc);
+                Node succNode = target[out_arcs[i]];
                 // DOUT("...... succ of " << instruction[n]->qasm() << " : " << instruction[succNode]->qasm());
-                bool found = false;             // filter out duplicates
-                for ( auto anySuccNode : ln )
-                {
-                    if (succNode == anySuccNode)
-                    {
-                        // DOUT("...... duplicate: " << instruction[succNode]->qasm());
-                        found = true;           // duplicate found
-                    }
-                }
-                if (found == false)             // found new one
+                if (std::find(ln.begin(), ln.end(), succNode) == ln.end())  // filter out duplicates
                 {
                     ln.push_back(succNode);     // new node to ln
                 }
@@ -1004,20 +1449,11 @@ public:
         }
         else
         {
-            for (ListDigraph::InArcIt predArc(graph,n); predArc != INVALID; ++predArc)
+            for (size_t i = in_offset[n]; i < in_offset[n+1]; i++)
             {
-                ListDigraph::Node predNode = graph.source(predArc);
+                Node predNode = source[in_arcs[i]];
                 // DOUT("...... pred of " << instruction[n]->qasm() << " : " << instruction[predNode]->qasm());
-                bool found = false;             // filter out duplicates
-                for ( auto anyPredNode : ln )
-                {
-                    if (predNode == anyPredNode)
-                    {
-                        // DOUT("...... duplicate: " << instruction[predNode]->qasm());
-                        found = true;           // duplicate found
-                    }
-                }
-                if (found == false)             // found new one
+                if (std::find(ln.begin(), ln.end(), predNode) == ln.end())  // filter out duplicates
                 {
                     ln.push_back(predNode);     // new node to ln
                 }
@@ -1031,44 +1467,128 @@ public:
     // deep-criticality takes into account the criticality of depending nodes (in the right direction!);
     // this function is used to order the avlist in an order from highest deep-criticality to lowest deep-criticality;
     // it is the core of the heuristics of the critical path list scheduler.
-    bool criticality_lessthan(ListDigraph::Node n1, ListDigraph::Node n2, ql::scheduling_direction_t dir)
+    //
+    // When the remaining values are equal, the nodes are compared on:
+    // - whether they have depending nodes (the one without is less critical),
+    // - the largest remaining value of their depending nodes,
+    // - the number of their depending nodes with that largest remaining value,
+    // - and then, recursively, on the deep-criticality of the most deep-critical depending node of each;
+    // the latter two are precomputed by set_remaining (see set_critical_dep), for the direction passed to it,
+    // so that this comparison doesn't need to collect and sort depending nodes.
+    bool criticality_lessthan(Node n1, Node n2, ql::scheduling_direction_t dir)
     {
-        if (n1 == n2) return false;             // because not <
+        while (true)
+        {
+            if (n1 == n2) return false;             // because not <
 
-        if (remaining[n1] < remaining[n2]) return true;
-        if (remaining[n1] > remaining[n2]) return false;
-        // so: remaining[n1] == remaining[n2]
+            if (remaining[n1] < remaining[n2]) return true;
+            if (remaining[n1] > remaining[n2]) return false;
+            // so: remaining[n1] == remaining[n2]
 
-        std::list<ListDigraph::Node>   ln1;
-        std::list<ListDigraph::Node>   ln2;
+            if (critcount[n2] == 0) return false;   // strictly < only when n1 has no depending nodes and n2 has
+            if (critcount[n1] == 0) return true;    // so when both have none, it is equal, so not strictly <, so false
+            // so: both have depending nodes
 
-        get_depending_nodes(n1, dir, ln1);
-        get_depending_nodes(n2, dir, ln2);
-        if (ln2.empty()) return false;          // strictly < only when ln1.empty and ln2.not_empty
-        if (ln1.empty()) return true;           // so when both empty, it is equal, so not strictly <, so false
-        // so: ln1.non_empty && ln2.non_empty
+            size_t crit_dep_n1 = remaining[critdep[n1]];    // the largest remaining value of the depending nodes
+            size_t crit_dep_n2 = remaining[critdep[n2]];
 
-        ln1.sort([this](const ListDigraph::Node &d1, const ListDigraph::Node &d2) { return remaining[d1] < remaining[d2]; });
-        ln2.sort([this](const ListDigraph::Node &d1, const ListDigraph::Node &d2) { return remaining[d1] < remaining[d2]; });
+            if (crit_dep_n1 < crit_dep_n2) return true;
+            if (crit_dep_n1 > crit_dep_n2) return false;
+            // so: crit_dep_n1 == crit_dep_n2
 
-        size_t crit_dep_n1 = remaining[ln1.back()];    // the last of the list is the one with the largest remaining value
-        size_t crit_dep_n2 = remaining[ln2.back()];
+            if (critcount[n1] < critcount[n2]) return true;
+            if (critcount[n1] > critcount[n2]) return false;
+            // so: equal number of depending nodes with the largest remaining value
 
-        if (crit_dep_n1 < crit_dep_n2) return true;
-        if (crit_dep_n1 > crit_dep_n2) return false;
-        // so: crit_dep_n1 == crit_dep_n2, call this crit_dep
+            n1 = critdep[n1];
+            n2 = critdep[n2];
+        }
+    }
+
+    // ready heap order: whether node n1 comes after node n2 in the avlist
+    bool ready_lessthan(Node n1, Node n2, ql::scheduling_direction_t dir)
+    {
+        if (criticality_lessthan(n1, n2, dir)) return true;
+        if (criticality_lessthan(n2, n1, dir)) return false;
+        return avorder[n1] > avorder[n2];
+    }
 
-        ln1.remove_if([this,crit_dep_n1](ListDigraph::Node n) { return remaining[n] < crit_dep_n1; });
-        ln2.remove_if([this,crit_dep_n2](ListDigraph::Node n) { return remaining[n] < crit_dep_n2; });
-        // because both contain element with remaining == crit_dep: ln1.non_empty && ln2.non_empty
+    // wait heap order: whether node n1 completes its dependences after node n2
+    bool wait_lessthan(Node n1, Node n2, ql::scheduling_direction_t dir)
+    {
+        if (ql::forward_scheduling == dir)
+        {
+            return instruction[n1]->cycle > instruction[n2]->cycle;
+        }
+        else
+        {
+            return instruction[n1]->cycle < instruction[n2]->cycle;
+        }
+    }
 
-        if (ln1.size() < ln2.size()) return true;
-        if (ln1.size() > ln2.size()) return false;
-        // so: ln1.size() == ln2.size() >= 1
+    // have the gates on which node n depends completed at curr_cycle?
+    bool completed(Node n, ql::scheduling_direction_t dir, const size_t curr_cycle)
+    {
+        return ( ql::forward_scheduling == dir && instruction[n]->cycle <= curr_cycle)
+            || ( ql::backward_scheduling == dir && curr_cycle <= instruction[n]->cycle);
+    }
 
-        ln1.sort([this,dir](const ListDigraph::Node &d1, const ListDigraph::Node &d2) { return criticality_lessthan(d1, d2, dir); });
-        ln2.sort([this,dir](const ListDigraph::Node &d1, const ListDigraph::Node &d2) { return criticality_lessthan(d1, d2, dir); });
-        return criticality_lessthan(ln1.back(), ln2.back(), dir);
+    // call make_available(m) for each node m depending on n that has become available
+    // because n has been scheduled (as reflected in scheduled), i.e.:
+    // when forward scheduling:
+    //   for each successor node of n of which all predecessors were scheduled;
+    //   a successor node which has a predecessor which hasn't been scheduled,
+    //   will be checked here at least when that predecessor is scheduled
+    // when backward scheduling:
+    //   for each predecessor node of n of which all successors were scheduled;
+    //   a predecessor node which has a successor which hasn't been scheduled,
+    //   will be checked here at least when that successor is scheduled
+    // the same node may be passed more than once, when there are multiple arcs between n and it
+    template<class MakeAvailableFn>
+    void foreach_made_available(Node n, std::vector<bool> & scheduled, ql::scheduling_direction_t dir, MakeAvailableFn make_available)
+    {
+        if (ql::forward_scheduling == dir)
+        {
+            for (size_t i = out_offset[n]; i < out_offset[n+1]; i++)
+            {
+                Node succNode = target[out_arcs[i]];
+                bool schedulable = true;
+                for (size_t j = in_offset[succNode]; j < in_offset[succNode+1]; j++)
+                {
+                    Node predNode = source[in_arcs[j]];
+                    if (!scheduled[predNode])
+                    {
+                        schedulable = false;
+                        break;
+                    }
+                }
+                if (schedulable)
+                {
+                    make_available(succNode);
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = in_offset[n]; i < in_offset[n+1]; i++)
+            {
+                Node predNode = source[in_arcs[i]];
+                bool schedulable = true;
+                for (size_t j = out_offset[predNode]; j < out_offset[predNode+1]; j++)
+                {
+                    Node succNode = target[out_arcs[j]];
+                    if (!scheduled[succNode])
+                    {
+                        schedulable = false;
+                        break;
+                    }
+                }
+                if (schedulable)
+                {
+                    make_available(predNode);
+                }
+            }
+        }
     }
 
     // Make node n available
@@ -1076,22 +1596,24 @@ public:
     //  all its predecessors were scheduled (forward scheduling) or
     //  all its successors were scheduled (backward scheduling)
     // update its cycle attribute to reflect these dependences;
-    // avlist is initialized with s or t as first element by init_available
-    // avlist is kept ordered on deep-criticality, non-increasing (i.e. highest deep-criticality first)
-    void MakeAvailable(ListDigraph::Node n, std::list<ListDigraph::Node>& avlist, ql::scheduling_direction_t dir)
+    // this version is for the mapper, which keeps avlist as a std::list,
+    // initialized with s as first element and ordered on deep-criticality, non-increasing (i.e. highest deep-criticality first);
+    // with set_cycle false, the cycle attribute is left alone, and then the graph is only read
+    // so that the mapper can use it from several threads, each with its own avlist
+    void MakeAvailable(Node n, std::list<Node>& avlist, ql::scheduling_direction_t dir, bool set_cycle = true)
     {
         bool    already_in_avlist = false;  // check whether n is already in avlist
                                             // originates from having multiple arcs between pair of nodes
-        std::list<ListDigraph::Node>::iterator first_lower_criticality_inp;     // for keeping avlist ordered
+        std::list<Node>::iterator first_lower_criticality_inp;     // for keeping avlist ordered
         bool    first_lower_criticality_found = false;                          // for keeping avlist ordered
 
-        DOUT(".... making available node " << name[n] << " remaining: " << remaining[n]);
-        for (std::list<ListDigraph::Node>::iterator inp = avlist.begin(); inp != avlist.end(); inp++)
+        DOUT(".... making available node " << instruction[n]->qasm() << " remaining: " << remaining[n]);
+        for (std::list<Node>::iterator inp = avlist.begin(); inp != avlist.end(); inp++)
         {
             if (*inp == n)
             {
                 already_in_avlist = true;
-                DOUT("...... duplicate when making available: " << name[n]);
+                DOUT("...... duplicate when making available: " << instruction[n]->qasm());
             }
             else
             {
@@ -1104,7 +1626,7 @@ public:
                 // when a node has same criticality as n, new node n is put after it, as last one of set of same criticality,
                 // so order of calling MakeAvailable (and probably original circuit, and running other scheduler first) matters,
                 // also when all dependence sets (and so remaining values) are identical!
-                if (criticality_lessthan(*inp, n, dir) && !first_lower_criticality_found)
+                if (!first_lower_criticality_found && criticality_lessthan(*inp, n, dir))
                 {
                     first_lower_criticality_inp = inp;
                     first_lower_criticality_found = true;
@@ -1113,7 +1635,10 @@ public:
         }
         if (!already_in_avlist)
         {
-            set_cycle_gate(instruction[n], dir);        // for the schedulers to inspect whether gate has completed
+            if (set_cycle)
+            {
+                set_cycle_gate(n, dir);                 // for the schedulers to inspect whether gate has completed
+            }
             if (first_lower_criticality_found)
             {
                 // add n to avlist just before the first with lower criticality
@@ -1124,74 +1649,59 @@ public:
                 // add n to end of avlist, if none found with less criticality
                 avlist.push_back(n);
             }
-            DOUT("...... made available node(@" << instruction[n]->cycle << "): " << name[n] << " remaining: " << remaining[n]);
+            DOUT("...... made available node(@" << instruction[n]->cycle << "): " << instruction[n]->qasm() << " remaining: " << remaining[n]);
         }
     }
 
     // take node n out of avlist because it has been scheduled;
     // reflect that the node has been scheduled in the scheduled vector;
-    // having scheduled it means that its depending nodes might become available:
-    // such a depending node becomes available when all its dependent nodes have been scheduled now
-    //
-    // i.e. when forward scheduling:
-    //   this makes its successor nodes available provided all their predecessors were scheduled;
-    //   a successor node which has a predecessor which hasn't been scheduled,
-    //   will be checked here at least when that predecessor is scheduled
-    // i.e. when backward scheduling:
-    //   this makes its predecessor nodes available provided all their successors were scheduled;
-    //   a predecessor node which has a successor which hasn't been scheduled,
-    //   will be checked here at least when that successor is scheduled
+    // having scheduled it means that its depending nodes might become available (see foreach_made_available)
     //
     // update (through MakeAvailable) the cycle attribute of the nodes made available
     // because from then on that value is compared to the curr_cycle to check
     // whether a node has completed execution and thus is available for scheduling in curr_cycle
-    void TakeAvailable(ListDigraph::Node n, std::list<ListDigraph::Node>& avlist, std::map<ql::gate*,bool> & scheduled, ql::scheduling_direction_t dir)
+    void TakeAvailable(Node n, std::list<Node>& avlist, std::vector<bool> & scheduled, ql::scheduling_direction_t dir, bool set_cycle = true)
     {
-        scheduled[instruction[n]] = true;
+        scheduled[n] = true;
         avlist.remove(n);
 
-        if (ql::forward_scheduling == dir)
+        foreach_made_available(n, scheduled, dir, [&](Node m) { MakeAvailable(m, avlist, dir, set_cycle); });
+    }
+
+    // Make node n available, version for the scheduler below
+    // as above, but adding it to the ready heap when it has completed its dependences at curr_cycle
+    // and to the wait heap otherwise
+    void MakeAvailable(Node n, ql::scheduling_direction_t dir, const size_t curr_cycle)
+    {
+        if (available[n])
         {
-            for (ListDigraph::OutArcIt succArc(graph,n); succArc != INVALID; ++succArc)
-            {
-                ListDigraph::Node succNode = graph.target(succArc);
-                bool schedulable = true;
-                for (ListDigraph::InArcIt predArc(graph,succNode); predArc != INVALID; ++predArc)
-                {
-                    ListDigraph::Node predNode = graph.source(predArc);
-                    if (!scheduled[instruction[predNode]])
-                    {
-                        schedulable = false;
-                        break;
-                    }
-                }
-                if (schedulable)
-                {
-                    MakeAvailable(succNode, avlist, dir);
-                }
-            }
+            DOUT("...... duplicate when making available: " << instruction[n]->qasm());
+            return;
+        }
+        available[n] = true;
+        avorder[n] = avcount++;
+
+        set_cycle_gate(n, dir);                         // for the schedulers to inspect whether gate has completed
+        if (completed(n, dir, curr_cycle))
+        {
+            readyheap.push_back(n);
+            std::push_heap(readyheap.begin(), readyheap.end(), [this,dir](Node n1, Node n2) { return ready_lessthan(n1, n2, dir); });
         }
         else
         {
-            for (ListDigraph::InArcIt predArc(graph,n); predArc != INVALID; ++predArc)
-            {
-                ListDigraph::Node predNode = graph.source(predArc);
-                bool schedulable = true;
-                for (ListDigraph::OutArcIt succArc(graph,predNode); succArc != INVALID; ++succArc)
-                {
-                    ListDigraph::Node succNode = graph.target(succArc);
-                    if (!scheduled[instruction[succNode]])
-                    {
-                        schedulable = false;
-                        break;
-                    }
-                }
-                if (schedulable)
-                {
-                    MakeAvailable(predNode, avlist, dir);
-                }
-            }
+            waitheap.push_back(n);
+            std::push_heap(waitheap.begin(), waitheap.end(), [this,dir](Node n1, Node n2) { return wait_lessthan(n1, n2, dir); });
         }
+        DOUT("...... made available node(@" << instruction[n]->cycle << "): " << instruction[n]->qasm() << " remaining: " << remaining[n]);
+    }
+
+    // node n has been scheduled (and was taken from the ready heap by SelectAvailable);
+    // version for the scheduler below of the TakeAvailable above
+    void TakeAvailable(Node n, std::vector<bool> & scheduled, ql::scheduling_direction_t dir, const size_t curr_cycle)
+    {
+        scheduled[n] = true;
+
+        foreach_made_available(n, scheduled, dir, [&](Node m) { MakeAvailable(m, dir, curr_cycle); });
     }
 
     // advance curr_cycle
@@ -1215,15 +1725,13 @@ public:
     // and must wait until all resources required for the gate's execution are available;
     // return true when immediately schedulable
     // when returning false, isres indicates whether resource occupation was the reason or operand completion (for debugging)
-    bool immediately_schedulable(ListDigraph::Node n, ql::scheduling_direction_t dir, const size_t curr_cycle,
+    bool immediately_schedulable(Node n, ql::scheduling_direction_t dir, const size_t curr_cycle,
                                 const ql::quantum_platform& platform, ql::arch::resource_manager_t& rm, bool& isres)
     {
         ql::gate*   gp = instruction[n];
         isres = true;
         // have dependent gates completed at curr_cycle?
-        if (    ( ql::forward_scheduling == dir && gp->cycle <= curr_cycle)
-            ||  ( ql::backward_scheduling == dir && curr_cycle <= gp->cycle)
-            )
+        if (completed(n, dir, curr_cycle))
         {
             // are resources available?
             if ( n == s || n == t
@@ -1248,38 +1756,91 @@ public:
         }
     }
 
-    // select a node from the avlist
-    // the avlist is deep-ordered from high to low criticality (see criticality_lessthan above)
-    ListDigraph::Node SelectAvailable(std::list<ListDigraph::Node>& avlist, ql::scheduling_direction_t dir, const size_t curr_cycle,
+    // select a node from the avlist and take it out of the ready heap:
+    // first move the nodes that have completed their dependences at curr_cycle from the wait heap to the ready heap;
+    // then select the first node in avlist order of the ready heap of which the resources are available, if any;
+    // the ready nodes that are passed because of their resources are put back in the ready heap
+    Node SelectAvailable(ql::scheduling_direction_t dir, const size_t curr_cycle,
                                 const ql::quantum_platform& platform, ql::arch::resource_manager_t& rm, bool & success)
     {
-        success = false;                        // whether a node was found and returned
+        auto ready_cmp = [this,dir](Node n1, Node n2) { return ready_lessthan(n1, n2, dir); };
+        auto wait_cmp = [this,dir](Node n1, Node n2) { return wait_lessthan(n1, n2, dir); };
 
-        DOUT("avlist(@" << curr_cycle << "):");
-        for ( auto n : avlist)
+        while (!waitheap.empty() && completed(waitheap.front(), dir, curr_cycle))
         {
-            DOUT("...... node(@" << instruction[n]->cycle << "): " << name[n] << " remaining: " << remaining[n]);
+            std::pop_heap(waitheap.begin(), waitheap.end(), wait_cmp);
+            readyheap.push_back(waitheap.back());
+            waitheap.pop_back();
+            std::push_heap(readyheap.begin(), readyheap.end(), ready_cmp);
         }
+        DOUT("avlist(@" << curr_cycle << "): " << readyheap.size() << " ready, " << waitheap.size() << " waiting");
 
-        // select the first immediately schedulable, if any
-        // since avlist is deep-criticality ordered, highest first, the first is the most deep-critical
-        for ( auto n : avlist)
+        success = false;                        // whether a node was found and returned
+        Node selected_node = s;                 // fake return value when not found
+        resblocked.clear();
+        while (!readyheap.empty())
         {
+            std::pop_heap(readyheap.begin(), readyheap.end(), ready_cmp);
+            Node n = readyheap.back();
+            readyheap.pop_back();
+
             bool isres;
             if ( immediately_schedulable(n, dir, curr_cycle, platform, rm, isres) )
             {
-                DOUT("... node (@" << instruction[n]->cycle << "): " << name[n] << " immediately schedulable, remaining=" << remaining[n] << ", selected");
+                DOUT("... node (@" << instruction[n]->cycle << "): " << instruction[n]->qasm() << " immediately schedulable, remaining=" << remaining[n] << ", selected");
                 success = true;
-                return n;
+                selected_node = n;
+                break;
             }
-            else
+            DOUT("... node (@" << instruction[n]->cycle << "): " << instruction[n]->qasm() << " remaining=" << remaining[n] << ", waiting for " << (isres? "resource" : "dependent completion"));
+            resblocked.push_back(n);
+        }
+        for (auto n : resblocked)
+        {
+            readyheap.push_back(n);
+            std::push_heap(readyheap.begin(), readyheap.end(), ready_cmp);
+        }
+        return selected_node;
+    }
+
+    // the core of the scheduler below when the resources fill gaps (see option scheduler_gapfill):
+    // the nodes are selected in order of criticality as soon as they are available (i.e. when their dependences
+    // have been scheduled, regardless of the cycle in which these complete), and each node is put in the first cycle
+    // from its dependence cycle on (ALAP: the last one up to it) in which its resources are available;
+    // so a node can fill a gap that was left before nodes that were scheduled earlier, and cycles are not assigned in order;
+    // curr_cycle isn't used: it is passed as the end of time to MakeAvailable so that all available nodes are ready
+    void schedule_gapfill(std::vector<bool> & scheduled, ql::scheduling_direction_t dir,
+            const ql::quantum_platform& platform, ql::arch::resource_manager_t& rm)
+    {
+        auto ready_cmp = [this,dir](Node n1, Node n2) { return ready_lessthan(n1, n2, dir); };
+        size_t  end_cycle = (ql::forward_scheduling == dir ? MAX_CYCLE : 0);
+
+        DOUT("... selecting nodes in order of criticality, filling gaps");
+        while (!readyheap.empty())
+        {
+            std::pop_heap(readyheap.begin(), readyheap.end(), ready_cmp);
+            Node n = readyheap.back();
+            readyheap.pop_back();
+
+            ql::gate* gp = instruction[n];
+            size_t  cycle = gp->cycle;      // its dependence cycle, as set by MakeAvailable
+            if (n != s
+                && n != t
+                && gp->type() != ql::gate_type_t::__dummy_gate__
+                && gp->type() != ql::gate_type_t::__classical_gate__
+                && gp->type() != ql::gate_type_t::__wait_gate__
+               )
             {
-                DOUT("... node (@" << instruction[n]->cycle << "): " << name[n] << " remaining=" << remaining[n] << ", waiting for " << (isres? "resource" : "dependent completion"));
+                while (!rm.available(cycle, gp, platform))
+                {
+                    AdvanceCurrCycle(dir, cycle);
+                }
+                rm.reserve(cycle, gp, platform);
             }
+            DOUT("... selected " << gp->qasm() << " in cycle " << cycle << " (dependence cycle " << gp->cycle << ")");
+            gp->cycle = cycle;
+            TakeAvailable(n, scheduled, dir, end_cycle);
         }
-
-        success = false;
-        return s;   // fake return value
     }
 
     // ASAP/ALAP scheduler with RC
@@ -1290,39 +1851,49 @@ public:
     // - the cycle attribute of the gates will be set according to the scheduling method
     // - *circp (the original and result circuit) is sorted in the new cycle order
     // the bundles are returned, with private start/duration attributes
+    // when the resources of rm fill gaps, nodes are selected by schedule_gapfill instead of cycle by cycle
     void schedule(ql::circuit* circp, ql::scheduling_direction_t dir,
             const ql::quantum_platform& platform, ql::arch::resource_manager_t& rm, std::string& sched_dot)
     {
         DOUT("Scheduling " << (ql::forward_scheduling == dir?"ASAP":"ALAP") << " with RC ...");
 
-        // scheduled[gp] :=: whether gate *gp has been scheduled, init all false
-        std::map<ql::gate*,bool>    scheduled;
-        // avlist :=: list of schedulable nodes, initially (see below) just s or t
-        std::list<ListDigraph::Node>    avlist;
+        // scheduled[n] :=: whether node n has been scheduled, init all false
+        std::vector<bool>   scheduled;
 
         // initializations for this scheduler
         // note that dependence graph is not modified by a scheduler, so it can be reused
         DOUT("... initialization");
-        for (ListDigraph::NodeIt n(graph); n != INVALID; ++n)
-        {
-            scheduled[instruction[n]] = false;   // none were scheduled, including SOURCE/SINK
-        }
+        scheduled.assign(instruction.size(), false);    // none were scheduled, including SOURCE/SINK
         size_t  curr_cycle;         // current cycle for which instructions are sought
-        init_available(avlist, dir, curr_cycle);     // first node (SOURCE/SINK) is made available and curr_cycle set
+        init_available(dir, curr_cycle);     // first node (SOURCE/SINK) is made available and curr_cycle set
         set_remaining(dir);         // for each gate, number of cycles until end of schedule
 
+        if (rm.gapfill)
+        {
+            schedule_gapfill(scheduled, dir, platform, rm);     // empties the avlist, so the loop below is skipped
+        }
         DOUT("... loop over avlist until it is empty");
-        while (!avlist.empty())
+        while (!readyheap.empty() || !waitheap.empty())
         {
             bool success;
-            ListDigraph::Node   selected_node;
+            Node   selected_node;
 
-            selected_node = SelectAvailable(avlist, dir, curr_cycle, platform, rm, success);
+            selected_node = SelectAvailable(dir, curr_cycle, platform, rm, success);
             if (!success)
             {
                 // i.e. none from avlist was found suitable to schedule in this cycle
-                AdvanceCurrCycle(dir, curr_cycle);
-                // so try again; eventually instrs complete and machine is empty
+                if (readyheap.empty())
+                {
+                    // none has completed its dependences, so none can be scheduled
+                    // until the first one in the wait heap has completed them: go to that cycle
+                    curr_cycle = instruction[waitheap.front()]->cycle;
+                }
+                else
+                {
+                    // the ready ones wait for resources, so try again in the next cycle
+                    AdvanceCurrCycle(dir, curr_cycle);
+                }
+                // eventually instrs complete and machine is empty
                 continue;
             }
 
@@ -1339,7 +1910,7 @@ public:
             {
                 rm.reserve(curr_cycle, gp, platform);
             }
-            TakeAvailable(selected_node, avlist, scheduled, dir);   // update avlist/scheduled/cycle
+            TakeAvailable(selected_node, scheduled, dir, curr_cycle);   // update avlist/scheduled/cycle
             // more nodes that could be scheduled in this cycle, will be found in an other round of the loop
         }
 
@@ -1373,6 +1944,12 @@ public:
         DOUT("Scheduling " << (ql::forward_scheduling == dir?"ASAP":"ALAP") << " with RC [DONE]");
     }
 
+    // the number of cycles from the start of SOURCE to that of SINK, after scheduling
+    size_t depth() const
+    {
+        return instruction[t]->cycle - instruction[s]->cycle;
+    }
+
     void schedule_asap(ql::arch::resource_manager_t & rm, const ql::quantum_platform & platform, std::string& sched_dot)
     {
         DOUT("Scheduling ASAP");
@@ -1429,13 +2006,13 @@ public:
         set_remaining(ql::forward_scheduling);
 
         // DOUT("Creating gates_per_cycle");
-        // create gates_per_cycle[cycle] = for each cycle the list of gates at cycle cycle
+        // create gates_per_cycle[cycle] = for each cycle the list of nodes of the gates at cycle cycle
         // this is the basic map to be operated upon by the uniforming scheduler below;
-        std::map<size_t,std::list<ql::gate*>> gates_per_cycle;
+        std::map<size_t,std::list<Node>> gates_per_cycle;
         for ( ql::circuit::iterator gpit = circp->begin(); gpit != circp->end(); gpit++)
         {
             ql::gate*           gp = *gpit;
-            gates_per_cycle[gp->cycle].push_back(gp);
+            gates_per_cycle[gp->cycle].push_back(node[gp]);
         }
 
         // DOUT("Displaying circuit and bundle statistics");
@@ -1500,15 +2077,15 @@ public:
                 DOUT("pred_cycle=" << pred_cycle);
                 DOUT("gates_per_cycle[curr_cycle].size()=" << gates_per_cycle[curr_cycle].size());
                 size_t      min_remaining_cycle = MAX_CYCLE;
-                ql::gate*   best_predgp;
+                Node        best_pred_node = 0;
                 bool        best_predgp_found = false;
 
                 // scan bundle at pred_cycle to find suitable candidate to move forward to curr_cycle
-                for ( auto predgp : gates_per_cycle[pred_cycle] )
+                for ( auto pred_node : gates_per_cycle[pred_cycle] )
                 {
                     bool    forward_predgp = true;
                     size_t  predgp_completion_cycle;
-                    ListDigraph::Node   pred_node = node[predgp];
+                    ql::gate*   predgp = instruction[pred_node];
                     DOUT("... considering: " << predgp->qasm() << " @cycle=" << predgp->cycle << " remaining=" << remaining[pred_node]);
 
                     // candidate's result, when moved, must be ready before end-of-circuit and before used
@@ -1521,9 +2098,9 @@ public:
                     }
                     else
                     {
-                        for ( ListDigraph::OutArcIt arc(graph,pred_node); arc != INVALID; ++arc )
+                        for (size_t i = out_offset[pred_node]; i < out_offset[pred_node+1]; i++)
                         {
-                            ql::gate*   target_gp = instruction[graph.target(arc)];
+                            ql::gate*   target_gp = instruction[target[out_arcs[i]]];
                             size_t target_cycle = target_gp->cycle;
                             if(predgp_completion_cycle > target_cycle)
                             {
@@ -1539,7 +2116,7 @@ public:
                     {
                         min_remaining_cycle = remaining[pred_node];
                         best_predgp_found = true;
-                        best_predgp = predgp;
+                        best_pred_node = pred_node;
                     }
                 }
 
@@ -1549,7 +2126,9 @@ public:
                 {
                     // move predgp from pred_cycle to curr_cycle;
                     // adjust all bookkeeping that is affected by this
-                    gates_per_cycle[pred_cycle].remove(best_predgp);
+                    assert(best_pred_node != s);     // a gate of the bundle at pred_cycle
+                    ql::gate*   best_predgp = instruction[best_pred_node];
+                    gates_per_cycle[pred_cycle].remove(best_pred_node);
                     if (gates_per_cycle[pred_cycle].size() == 0)
                     {
                         // source bundle was non-empty, now it is empty
@@ -1561,13 +2140,13 @@ public:
                         non_empty_bundle_count++;
                     }
                     best_predgp->cycle = curr_cycle;        // what it is all about
-                    gates_per_cycle[curr_cycle].push_back(best_predgp);
+                    gates_per_cycle[curr_cycle].push_back(best_pred_node);
 
                     // recompute targets
                     if (non_empty_bundle_count == 0) break;     // nothing to do
                     avg_gates_per_cycle = double(gate_count)/curr_cycle;
                     avg_gates_per_non_empty_cycle = double(gate_count)/non_empty_bundle_count;
-                    DOUT("... moved " << best_predgp->qasm() << " with remaining=" << remaining[node[best_predgp]]
+                    DOUT("... moved " << best_predgp->qasm() << " with remaining=" << remaining[best_pred_node]
                         << " from cycle=" << pred_cycle << " to cycle=" << curr_cycle
                         << "; new avg_gates_per_cycle=" << avg_gates_per_cycle
                         << "; avg_gates_per_non_empty_cycle=" << avg_gates_per_non_empty_cycle
@@ -1628,23 +2207,8 @@ public:
                 )
     {
         DOUT("Get_dot");
-        Path<ListDigraph> p;
-        ListDigraph::ArcMap<bool> isInCritical(graph);
-        if(WithCritical)
-        {
-            for (ListDigraph::ArcIt a(graph); a != INVALID; ++a)
-            {
-                isInCritical[a] = false;
-                for ( Path<ListDigraph>::ArcIt ap(p); ap != INVALID; ++ap )
-                {
-                    if(a==ap)
-                    {
-                        isInCritical[a] = true;
-                        break;
-                    }
-                }
-            }
-        }
+        // the critical path is not computed (yet), so no arc is marked as being on it
+        std::vector<bool> isInCritical(source.size(), false);
 
         string NodeStyle(" fontcolor=black, style=filled, fontsize=16");
         string EdgeStyle1(" color=black");
@@ -1655,11 +2219,11 @@ public:
             << "\nedge [fontsize=16, arrowhead=vee, arrowsize=0.5];"
             << endl;
 
-        // first print the nodes
-        for (ListDigraph::NodeIt n(graph); n != INVALID; ++n)
+        // first print the nodes, most recently created first
+        for (Node n = instruction.size(); n-- > 0; )
         {
-            dotout  << "\"" << graph.id(n) << "\""
-                    << " [label=\" " << name[n] <<" \""
+            dotout  << "\"" << n << "\""
+                    << " [label=\" " << instruction[n]->qasm() <<" \""
                     << NodeStyle
                     << "];" << endl;
         }
@@ -1687,37 +2251,39 @@ public:
             dotout << ";\n}\n";
 
             // Now print ranks, as shown below
-            dotout << "{ rank=same; Cycle" << instruction[s]->cycle <<"; " << graph.id(s) << "; }\n";
+            dotout << "{ rank=same; Cycle" << instruction[s]->cycle <<"; " << s << "; }\n";
             for (auto gp : *circp)
             {
-                dotout << "{ rank=same; Cycle" << gp->cycle <<"; " << graph.id(node[gp]) << "; }\n";
+                dotout << "{ rank=same; Cycle" << gp->cycle <<"; " << node[gp] << "; }\n";
             }
-            dotout << "{ rank=same; Cycle" << instruction[t]->cycle <<"; " << graph.id(t) << "; }\n";
+            dotout << "{ rank=same; Cycle" << instruction[t]->cycle <<"; " << t << "; }\n";
         }
 
-        // now print the edges
-        for (ListDigraph::ArcIt arc(graph); arc != INVALID; ++arc)
-        {
-            ListDigraph::Node srcNode = graph.source(arc);
-            ListDigraph::Node dstNode = graph.target(arc);
-            int srcID = graph.id( srcNode );
-            int dstID = graph.id( dstNode );
-
-            if(WithCritical)
-                EdgeStyle = ( isInCritical[arc]==true ) ? EdgeStyle2 : EdgeStyle1;
-
-            dotout << dec
-                << "\"" << srcID << "\""
-                << "->"
-                << "\"" << dstID << "\""
-                << "[ label=\""
-                << "q" << cause[arc]
-                << " , " << weight[arc]
-                << " , " << DepTypesNames[ depType[arc] ]
-                <<"\""
-                << " " << EdgeStyle << " "
-                << "]"
-                << endl;
+        // now print the edges, per source node in the same order as the nodes
+        for (Node n = instruction.size(); n-- > 0; )
+        {
+            for (size_t i = out_offset[n]; i < out_offset[n+1]; i++)
+            {
+                Arc arc = out_arcs[i];
+                Node srcID = source[arc];
+                Node dstID = target[arc];
+
+                if(WithCritical)
+                    EdgeStyle = ( isInCritical[arc]==true ) ? EdgeStyle2 : EdgeStyle1;
+
+                dotout << dec
+                    << "\"" << srcID << "\""
+                    << "->"
+                    << "\"" << dstID << "\""
+                    << "[ label=\""
+                    << "q" << cause[arc]
+                    << " , " << weight[arc]
+                    << " , " << DepTypesNames[ depType[arc] ]
+                    <<"\""
+                    << " " << EdgeStyle << " "
+                    << "]"
+                    << endl;
+            }
         }
 
         dotout << "}" << endl;
@@ -1738,6 +2304,18 @@ public:
 namespace ql
 {
 
+// the dependence graph kept with the kernel, created or updated for its current circuit
+static Scheduler& kernel_dependence_graph(quantum_kernel& kernel, const quantum_platform& platform,
+    size_t nqubits, size_t ncreg)
+{
+    if (!kernel.ddg.graph)
+    {
+        kernel.ddg.graph = std::make_shared<Scheduler>();
+    }
+    kernel.ddg.graph->update(kernel.c, platform, nqubits, ncreg);
+    return *kernel.ddg.graph;
+}
+
 // schedule support for program.h::schedule()
 static void schedule_kernel(quantum_kernel& kernel, quantum_platform platform,
     std::string & dot, std::string& sched_dot)
@@ -1747,8 +2325,7 @@ static void schedule_kernel(quantum_kernel& kernel, quantum_platform platform,
 
     IOUT( scheduler << " scheduling the quantum kernel '" << kernel.name << "'...");
 
-    Scheduler sched;
-    sched.init(kernel.c, platform, kernel.qubit_count, kernel.creg_count);
+    Scheduler& sched = kernel_dependence_graph(kernel, platform, kernel.qubit_count, kernel.creg_count);
 
     if(ql::options::get("print_dot_graphs") == "yes")
     {
@@ -1786,8 +2363,9 @@ static void schedule(ql::quantum_program* programp, const ql::quantum_platform&
         ql::report_qasm(programp, platform, "in", passname);
     
         IOUT("scheduling the quantum program");
-        for (auto& k : programp->kernels)
+        ql::utils::parallel_for(programp->kernels.size(), [&](size_t kernel_index)
         {
+            ql::quantum_kernel& k = programp->kernels[kernel_index];
             std::string dot;
             std::string kernel_sched_dot;
             schedule_kernel(k, platform, dot, kernel_sched_dot);
@@ -1804,7 +2382,7 @@ static void schedule(ql::quantum_program* programp, const ql::quantum_platform&
                 IOUT("writing scheduled dot to '" << fname << "' ...");
                 ql::utils::write_file(fname, kernel_sched_dot);
             }
-        }
+        });
     
         ql::report_statistics(programp, platform, "out", passname, "# ");
         ql::report_qasm(programp, platform, "out", passname);
@@ -1812,32 +2390,69 @@ static void schedule(ql::quantum_program* programp, const ql::quantum_platform&
 }
 
 static void rcschedule_kernel(ql::quantum_kernel& kernel,
-    const ql::quantum_platform & platform, std::string & dot, size_t nqubits, size_t ncreg = 0)
+    const ql::quantum_platform & platform, std::string & dot, size_t nqubits, size_t ncreg = 0,
+    size_t * nogapfill_depth = nullptr, size_t * gapfill_depth = nullptr)
 {
     IOUT("Resource constraint scheduling ...");
 
     std::string schedopt = ql::options::get("scheduler");
+    bool gapfill = ql::options::current().scheduler_gapfill;
+    ql::scheduling_direction_t dir;
     if ("ASAP" == schedopt)
     {
-        Scheduler sched;
-        sched.init(kernel.c, platform, nqubits, ncreg);
-
-        ql::arch::resource_manager_t rm(platform, forward_scheduling);
-        sched.schedule_asap(rm, platform, dot);
+        dir = forward_scheduling;
     }
     else if ("ALAP" == schedopt)
     {
-        Scheduler sched;
-        sched.init(kernel.c, platform, nqubits, ncreg);
-
-        ql::arch::resource_manager_t rm(platform, backward_scheduling);
-        sched.schedule_alap(rm, platform, dot);
+        dir = backward_scheduling;
     }
     else
     {
         FATAL("Not supported scheduler option: scheduler=" << schedopt);
     }
 
+    Scheduler& sched = kernel_dependence_graph(kernel, platform, nqubits, ncreg);
+
+    // schedule with resources that fill gaps or not, into the kernel, returning the depth
+    auto schedule_with = [&](bool fill, std::string & sched_dot)
+    {
+        ql::arch::resource_manager_t rm(platform, dir, fill);
+        if (forward_scheduling == dir)
+        {
+            sched.schedule_asap(rm, platform, sched_dot);
+        }
+        else
+        {
+            sched.schedule_alap(rm, platform, sched_dot);
+        }
+        return sched.depth();
+    };
+
+    if (!gapfill)
+    {
+        schedule_with(false, dot);
+    }
+    else
+    {
+        // filling gaps usually but not always reduces the depth,
+        // so schedule without filling gaps as well, and keep the shorter schedule,
+        // which is that with filling gaps when equal
+        std::string nogapfill_dot;
+        size_t without = schedule_with(false, nogapfill_dot);
+        size_t with = schedule_with(true, dot);
+        if (with > without)
+        {
+            schedule_with(false, dot);
+        }
+        IOUT("Filling gaps changed depth of kernel '" << kernel.name << "' from " << without << " to " << with << " cycles;"
+            << " kept the schedule " << (with > without ? "without" : "with") << " filling gaps");
+        if (nogapfill_depth)
+        {
+            *nogapfill_depth = without;
+            *gapfill_depth = with;
+        }
+    }
+
     IOUT("Resource constraint scheduling [Done].");
 }
 
@@ -1849,15 +2464,22 @@ static void rcschedule(ql::quantum_program* programp, const ql::quantum_platform
     ql::report_statistics(programp, platform, "in", passname, "# ");
     ql::report_qasm(programp, platform, "in", passname);
 
-    for(auto &kernel : programp->kernels)
+    // when filling gaps, each kernel is also scheduled without, and the report lists both depths
+    bool report_gapfill = ql::options::current().scheduler_gapfill && ql::options::get("write_report_files") == "yes";
+    std::vector<size_t> nogapfill_depth(programp->kernels.size(), 0);
+    std::vector<size_t> gapfill_depth(programp->kernels.size(), 0);
+
+    ql::utils::parallel_for(programp->kernels.size(), [&](size_t kernel_index)
     {
+        ql::quantum_kernel& kernel = programp->kernels[kernel_index];
         IOUT("Scheduling kernel: " << kernel.name);
         if (! kernel.c.empty())
         {
             auto num_creg = kernel.creg_count;
             std::string     sched_dot;
 
-            rcschedule_kernel(kernel, platform, sched_dot, platform.qubit_number, num_creg);
+            rcschedule_kernel(kernel, platform, sched_dot, platform.qubit_number, num_creg,
+                report_gapfill ? &nogapfill_depth[kernel_index] : nullptr, &gapfill_depth[kernel_index]);
             kernel.cycles_valid = true; // FIXME HvS move this back into call to right after sort_cycle
 
             if (ql::options::get("print_dot_graphs") == "yes")
@@ -1868,9 +2490,37 @@ static void rcschedule(ql::quantum_program* programp, const ql::quantum_platform
                 ql::utils::write_file(fname.str(), sched_dot);
             }
         }
-    }
+    });
+
+    if (report_gapfill)
+    {
+        std::ofstream   ofs;
+        ofs = ql::report_open(programp, "out", passname);
 
-    ql::report_statistics(programp, platform, "out", passname, "# ");
+        size_t  total_nogapfill_depth = 0;
+        size_t  total_gapfill_depth = 0;
+        for (size_t k = 0; k < programp->kernels.size(); k++)
+        {
+            ql::report_kernel_statistics(ofs, programp->kernels[k], platform, "# ");
+            std::stringstream ss;
+            ss << "# ----- depth without gap filling: " << nogapfill_depth[k] << "\n";
+            ss << "# ----- depth with gap filling: " << gapfill_depth[k] << "\n";
+            ql::report_string(ofs, ss.str());
+            total_nogapfill_depth += nogapfill_depth[k];
+            total_gapfill_depth += gapfill_depth[k];
+        }
+        ql::report_totals_statistics(ofs, programp->kernels, platform, "# ");
+        std::stringstream ss;
+        ss << "# Total depth without gap filling: " << total_nogapfill_depth << "\n";
+        ss << "# Total depth with gap filling: " << total_gapfill_depth << "\n";
+        ss << "# Total depth reduction by gap filling: " << (long(total_nogapfill_depth) - long(total_gapfill_depth)) << "\n";
+        ql::report_string(ofs, ss.str());
+        ql::report_close(ofs);
+    }
+    else
+    {
+        ql::report_statistics(programp, platform, "out", passname, "# ");
+    }
     ql::report_qasm(programp, platform, "out", passname);
 }
 
@@ -7,6 +7,7 @@
  */
 
 #include <unitary.h>
+#include <options.h>
 
 #ifndef WITHOUT_UNITARY_DECOMPOSITION
 #include <Eigen/MatrixFunctions>
@@ -14,11 +15,16 @@
 #define lapack_complex_float    std::complex<float>
 #define lapack_complex_double   std::complex<double>
 #include <src/misc/lapacke.h>
+#include <parallel.h>
 #endif
 
 typedef unsigned int uint;
 
 #include <chrono>
+#include <unordered_map>
+#include <deque>
+#include <set>
+#include <iomanip>
 
 namespace ql
 {
@@ -40,7 +46,7 @@ double unitary::size() {
 
 #ifdef WITHOUT_UNITARY_DECOMPOSITION
 
-void unitary::decompose() {
+static void decompose_matrix(unitary & u) {
     throw std::runtime_error("unitary decomposition was explicitly disabled in this build!");
 }
 
@@ -71,18 +77,25 @@ public:
     double gamma;
     bool is_decomposed;
     std::vector<double> instructionlist;
+    size_t nthreads;    // number of threads on which independent parts are decomposed concurrently
 
     typedef Eigen::Matrix<std::complex<double>, Eigen::Dynamic, Eigen::Dynamic> complex_matrix ;
 
-    UnitaryDecomposer() : name(""), is_decomposed(false) {}
+    UnitaryDecomposer() : name(""), is_decomposed(false), nthreads(1) {}
 
-    UnitaryDecomposer(std::string name, std::vector<std::complex<double>> array) : 
-            name(name), array(array), is_decomposed(false)
+    UnitaryDecomposer(std::string name, std::vector<std::complex<double>> array, size_t nthreads = 1) : 
+            name(name), array(array), is_decomposed(false), nthreads(nthreads)
     {
         DOUT("constructing unitary: " << name 
                   << ", containing: " << array.size() << " elements");
     }
 
+    // decomposer of a part of the matrix of parent, sharing its M^k lookuptable
+    UnitaryDecomposer(const UnitaryDecomposer & parent, size_t nthreads) :
+            name(parent.name), is_decomposed(false), nthreads(nthreads), genMk_lookuptable(parent.genMk_lookuptable)
+    {
+    }
+
     double size()
     {
         if(!array.empty())
@@ -173,6 +186,10 @@ public:
                     instructionlist.push_back(300.0);
                     decomp_function(matrix.topLeftCorner(n, n), numberofbits-1);
                 }
+                else if (nthreads > 1)
+                {
+                    decomp_halves_concurrently({matrix.topLeftCorner(n, n), matrix.bottomRightCorner(n,n)}, Eigen::VectorXcd(), numberofbits);
+                }
                 else
                 {
                     demultiplexing(matrix.topLeftCorner(n, n), matrix.bottomRightCorner(n,n), V, D, W, numberofbits-1);
@@ -203,6 +220,11 @@ public:
             // auto start = std::chrono::steady_clock::now();
             CSD(matrix, L0, L1, R0, R1, ss);
             // CSD_time += (std::chrono::steady_clock::now() - start);
+            if (nthreads > 1)
+            {
+                decomp_halves_concurrently({R0, R1, L0, L1}, ss.diagonal(), numberofbits);
+                return;
+            }
             demultiplexing(R0, R1, V, D, W, numberofbits-1);
             decomp_function(W, numberofbits-1);
             multicontrolledZ(D, D.rows());
@@ -218,6 +240,58 @@ public:
         }
     }
 
+    // does what decomp_function does after the CSD, but concurrently:
+    // demultiplexes each half (R0 with R1, and L0 with L1; only one half when there was no CSD), in parallel,
+    // and then decomposes the resulting W and V of each half, in parallel, each by a decomposer of its own
+    // that gets an equal share of the threads for deeper levels;
+    // the parts are independent, and each is computed exactly as sequentially,
+    // so appending their instructions in the sequential order makes the instructionlist bit-identical to it;
+    // their sizes depend on the optimizations that apply to them, so they cannot be allocated beforehand
+    void decomp_halves_concurrently(const std::vector<complex_matrix> & halves, const Eigen::VectorXcd & ss, int numberofbits)
+    {
+        size_t nhalves = halves.size()/2;
+        int n = halves[0].rows();
+        std::vector<complex_matrix> V(nhalves, complex_matrix(n,n));
+        std::vector<complex_matrix> W(nhalves, complex_matrix(n,n));
+        std::vector<Eigen::VectorXcd> D(nhalves, Eigen::VectorXcd(n));
+        ql::utils::parallel_for(nhalves, nthreads, [&](size_t h)
+        {
+            demultiplexing(halves[2*h], halves[2*h+1], V[h], D[h], W[h], numberofbits-1);
+        });
+
+        // part 2*h decomposes W[h], part 2*h+1 decomposes V[h]
+        size_t nparts = 2*nhalves;
+        std::vector<UnitaryDecomposer> parts;
+        for (size_t p = 0; p < nparts; p++)
+        {
+            parts.emplace_back(*this, std::max<size_t>(1, nthreads/nparts));
+        }
+        ql::utils::parallel_for(nparts, nthreads, [&](size_t p)
+        {
+            parts[p].decomp_function(p % 2 == 0 ? W[p/2] : V[p/2], numberofbits-1);
+        });
+
+        for (size_t h = 0; h < nhalves; h++)
+        {
+            if (h > 0)
+            {
+                multicontrolledY(ss, n);
+            }
+            append(parts[2*h]);
+            multicontrolledZ(D[h], D[h].rows());
+            append(parts[2*h+1]);
+        }
+    }
+
+    // append the instructions of a decomposed part; the angles of its last zyz decomposition are the last ones
+    void append(const UnitaryDecomposer & part)
+    {
+        instructionlist.insert(instructionlist.end(), part.instructionlist.begin(), part.instructionlist.end());
+        alpha = part.alpha;
+        beta = part.beta;
+        gamma = part.gamma;
+    }
+
     void CSD(const Eigen::Ref<const complex_matrix>& U, Eigen::Ref<complex_matrix> u1, Eigen::Ref<complex_matrix> u2, Eigen::Ref<complex_matrix> v1, Eigen::Ref<complex_matrix> v2, Eigen::Ref<complex_matrix> s)
     {
         // auto start = std::chrono::steady_clock::now();        
@@ -460,12 +534,14 @@ public:
     }
 
 
-    std::vector<Eigen::MatrixXd> genMk_lookuptable;
+    // shared with the decomposers of parts, which only read it
+    std::shared_ptr<const std::vector<Eigen::MatrixXd>> genMk_lookuptable;
 
     // returns M^k = (-1)^(b_(i-1)*g_(i-1)), where * is bitwise inner product, g = binary gray code, b = binary code.
     void genMk()
     {
         int numberqubits = uint64_log2(_matrix.rows());
+        std::vector<Eigen::MatrixXd> lookuptable;
         for(int n = 1; n <= numberqubits; n++)
         {
             int size=1<<n;
@@ -477,8 +553,9 @@ public:
                     Mk(i,j) =std::pow(-1, bitParity(i&(j^(j>>1))));
                 }
             }
-        genMk_lookuptable.push_back(Mk);
+        lookuptable.push_back(Mk);
         }
+        genMk_lookuptable = std::make_shared<const std::vector<Eigen::MatrixXd>>(std::move(lookuptable));
         
         // return genMk_lookuptable[numberqubits-1];
     }
@@ -514,10 +591,10 @@ public:
     {
         // auto start = std::chrono::steady_clock::now();
         Eigen::VectorXd temp =  2*Eigen::asin(ss.array()).real();
-        Eigen::CompleteOrthogonalDecomposition<Eigen::MatrixXd> dec(genMk_lookuptable[uint64_log2(halfthesizeofthematrix)-1]);
+        Eigen::CompleteOrthogonalDecomposition<Eigen::MatrixXd> dec((*genMk_lookuptable)[uint64_log2(halfthesizeofthematrix)-1]);
         Eigen::VectorXd tr = dec.solve(temp);
         // Check is very approximate to account for low-precision input matrices
-        if(!temp.isApprox(genMk_lookuptable[uint64_log2(halfthesizeofthematrix)-1]*tr, 10e-2))
+        if(!temp.isApprox((*genMk_lookuptable)[uint64_log2(halfthesizeofthematrix)-1]*tr, 10e-2))
         {
                 EOUT("Multicontrolled Y not correct!");
                 throw ql::exception("Demultiplexing of unitary '"+ name+"' not correct! Failed at demultiplexing of matrix ss: \n"  + to_string(ss), false);
@@ -532,10 +609,10 @@ public:
         // auto start = std::chrono::steady_clock::now();
         
         Eigen::VectorXd temp =  (std::complex<double>(0,-2)*Eigen::log(D.array())).real();
-        Eigen::CompleteOrthogonalDecomposition<Eigen::MatrixXd> dec(genMk_lookuptable[uint64_log2(halfthesizeofthematrix)-1]);
+        Eigen::CompleteOrthogonalDecomposition<Eigen::MatrixXd> dec((*genMk_lookuptable)[uint64_log2(halfthesizeofthematrix)-1]);
         Eigen::VectorXd tr = dec.solve(temp);
         // Check is very approximate to account for low-precision input matrices
-        if(!temp.isApprox(genMk_lookuptable[uint64_log2(halfthesizeofthematrix)-1]*tr, 10e-2))
+        if(!temp.isApprox((*genMk_lookuptable)[uint64_log2(halfthesizeofthematrix)-1]*tr, 10e-2))
         {
                 EOUT("Multicontrolled Z not correct!");
                 throw ql::exception("Demultiplexing of unitary '"+ name+"' not correct! Failed at demultiplexing of matrix D: \n"+ to_string(D), false);
@@ -553,15 +630,20 @@ public:
     }
 };
 
-void unitary::decompose() {
-    UnitaryDecomposer decomposer(name, array);
+static void decompose_matrix(unitary & u) {
+    size_t nthreads = ql::options::current().unitary_decomposition_threads;
+    if (nthreads == 0)
+    {
+        nthreads = std::thread::hardware_concurrency();
+    }
+    UnitaryDecomposer decomposer(u.name, u.array, (nthreads == 0 ? 1 : nthreads));
     decomposer.decompose();
-    SU = decomposer.SU;
-    alpha = decomposer.alpha;
-    beta = decomposer.beta;
-    gamma = decomposer.gamma;
-    is_decomposed = decomposer.is_decomposed;
-    instructionlist = decomposer.instructionlist;
+    u.SU = decomposer.SU;
+    u.alpha = decomposer.alpha;
+    u.beta = decomposer.beta;
+    u.gamma = decomposer.gamma;
+    u.is_decomposed = decomposer.is_decomposed;
+    u.instructionlist = decomposer.instructionlist;
 }
 
 bool unitary::is_decompose_support_enabled() {
@@ -570,5 +652,260 @@ bool unitary::is_decompose_support_enabled() {
 
 #endif
 
+/*
+ * cache of decompositions (option unitary_decomposition_cache)
+ *
+ * A decomposition is found by the canonical form of its matrix:
+ * the matrix is multiplied by the global phase that makes the first large element of its first row real and positive,
+ * and its elements are rounded to multiples of tolerance.
+ * So matrices that are equal up to a global phase and to rounding errors below tolerance share their decomposition;
+ * the decomposition implements each of them up to a global phase, as it does for the matrix it was made for.
+ * The canonical form itself is the key, so that different matrices never share a decomposition by a collision of hashes.
+ *
+ * The in-memory tier keeps the last max_entries decompositions.
+ * With unitary_decomposition_cache=disk, decompositions are also appended to a file in output_dir,
+ * which is read at the first decomposition with that output_dir, so that they are reused by later runs.
+ */
+class decomposition_cache
+{
+public:
+    typedef std::vector<int64_t> key_t;
+
+    struct entry_t
+    {
+        double alpha;
+        double beta;
+        double gamma;
+        std::vector<double> instructionlist;
+    };
+
+    // the canonical form of matrix array; returns false when it has none,
+    // because its elements are too large for the matrix to be unitary
+    static bool canonical_key(const std::vector<std::complex<double>> & array, key_t & key)
+    {
+        size_t dim = (size_t) std::lround(std::sqrt((double) array.size()));
+        std::complex<double> phase = 1;
+        for (size_t i = 0; i < dim; i++)
+        {
+            // as each row of a unitary has norm 1, its first row has an element of at least 1/sqrt(dim)
+            if (std::abs(array[i]) >= 0.5/std::sqrt((double) dim))
+            {
+                phase = std::conj(array[i]) / std::abs(array[i]);
+                break;
+            }
+        }
+        key.clear();
+        key.reserve(2*array.size());
+        for (auto & e : array)
+        {
+            if (std::abs(e) > 2)
+            {
+                return false;
+            }
+            std::complex<double> c = e * phase;
+            key.push_back(std::llround(c.real() / tolerance));
+            key.push_back(std::llround(c.imag() / tolerance));
+        }
+        return true;
+    }
+
+    bool find(const key_t & key, entry_t & entry)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        load();
+        auto it = entries.find(key);
+        if (it == entries.end())
+        {
+            return false;
+        }
+        entry = it->second;
+        return true;
+    }
+
+    void add(const key_t & key, const entry_t & entry)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!insert(key, entry))
+        {
+            return;
+        }
+        if (ql::options::get("unitary_decomposition_cache") == "disk")
+        {
+            std::ofstream file(file_name(), std::ios::app);
+            if (!file)
+            {
+                WOUT("Cannot write unitary decomposition cache " << file_name());
+                return;
+            }
+            write(file, key, entry);
+        }
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        order.clear();
+        loaded.clear();
+    }
+
+private:
+    static constexpr double tolerance = 1e-9;
+    static const size_t max_entries = 1024;
+
+    struct key_hash
+    {
+        size_t operator()(const key_t & key) const
+        {
+            // FNV-1a over the elements
+            uint64_t h = 14695981039346656037ULL;
+            for (auto k : key)
+            {
+                h = (h ^ (uint64_t) k) * 1099511628211ULL;
+            }
+            return (size_t) h;
+        }
+    };
+
+    std::mutex mutex;
+    std::unordered_map<key_t, entry_t, key_hash> entries;
+    std::deque<key_t> order;            // keys of entries, oldest first
+    std::set<std::string> loaded;       // cache files that were read
+
+    static std::string file_name()
+    {
+        return ql::options::get("output_dir") + "/unitary_decomposition_cache.txt";
+    }
+
+    // insert the entry, evicting the oldest one when full; returns false when the key was there already
+    bool insert(const key_t & key, const entry_t & entry)
+    {
+        if (!entries.emplace(key, entry).second)
+        {
+            return false;
+        }
+        order.push_back(key);
+        if (order.size() > max_entries)
+        {
+            entries.erase(order.front());
+            order.pop_front();
+        }
+        return true;
+    }
+
+    // one line per entry: the key's size and elements, alpha, beta, gamma,
+    // and the instructionlist's size and elements; doubles are written such that they read back the same
+    static void write(std::ostream & os, const key_t & key, const entry_t & entry)
+    {
+        os << std::setprecision(17) << key.size();
+        for (auto k : key)
+        {
+            os << " " << k;
+        }
+        os << " " << entry.alpha << " " << entry.beta << " " << entry.gamma << " " << entry.instructionlist.size();
+        for (auto d : entry.instructionlist)
+        {
+            os << " " << d;
+        }
+        os << "\n";
+    }
+
+    static bool read(std::istream & is, key_t & key, entry_t & entry)
+    {
+        size_t n;
+        if (!(is >> n))
+        {
+            return false;
+        }
+        key.resize(n);
+        for (auto & k : key)
+        {
+            is >> k;
+        }
+        is >> entry.alpha >> entry.beta >> entry.gamma >> n;
+        entry.instructionlist.resize(n);
+        for (auto & d : entry.instructionlist)
+        {
+            is >> d;
+        }
+        return bool(is);
+    }
+
+    // read the cache file of the current output_dir, when on disk and not read before
+    void load()
+    {
+        if (ql::options::get("unitary_decomposition_cache") != "disk")
+        {
+            return;
+        }
+        std::string fname = file_name();
+        if (!loaded.insert(fname).second)
+        {
+            return;
+        }
+        std::ifstream file(fname);
+        if (!file)
+        {
+            return;
+        }
+        std::string line;
+        size_t count = 0;
+        while (std::getline(file, line))
+        {
+            std::istringstream ss(line);
+            key_t key;
+            entry_t entry;
+            if (!read(ss, key, entry))
+            {
+                WOUT("Ignoring malformed line in unitary decomposition cache " << fname);
+                continue;
+            }
+            insert(key, entry);
+            count++;
+        }
+        DOUT("Read " << count << " decompositions from unitary decomposition cache " << fname);
+    }
+};
+
+constexpr double decomposition_cache::tolerance;
+
+static decomposition_cache & the_decomposition_cache()
+{
+    static decomposition_cache cache;
+    return cache;
+}
+
+void unitary::decompose() {
+    decomposition_cache::key_t key;
+    bool cached = ql::options::get("unitary_decomposition_cache") != "no"
+        && decomposition_cache::canonical_key(array, key);
+    decomposition_cache::entry_t entry;
+    if (cached && the_decomposition_cache().find(key, entry))
+    {
+        DOUT("Reusing cached decomposition of unitary: " << name);
+        alpha = entry.alpha;
+        beta = entry.beta;
+        gamma = entry.gamma;
+        instructionlist = entry.instructionlist;
+        is_decomposed = true;
+        return;
+    }
+
+    decompose_matrix(*this);
+
+    if (cached && is_decomposed)
+    {
+        entry.alpha = alpha;
+        entry.beta = beta;
+        entry.gamma = gamma;
+        entry.instructionlist = instructionlist;
+        the_decomposition_cache().add(key, entry);
+    }
+}
+
+void unitary::clear_decomposition_cache() {
+    the_decomposition_cache().clear();
+}
+
 }
 
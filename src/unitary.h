@@ -38,6 +38,8 @@ public:
     double size();
     void decompose();
     static bool is_decompose_support_enabled();
+    // forget the decompositions cached in memory by decompose()
+    static void clear_decomposition_cache();
 };
 
 }
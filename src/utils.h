@@ -32,6 +32,7 @@
 #include <iostream>
 #include <utility>
 #include <vector>
+#include <mutex>
 
 using json = nlohmann::json;
 
@@ -216,6 +217,16 @@ namespace ql
             };
             OPENQL_DECLSPEC extern log_level_t LOG_LEVEL;
 
+            // passes may run concurrently (see parallel.h), so each line is first composed
+            // and then written under a lock, keeping lines of different threads apart
+            OPENQL_DECLSPEC extern std::mutex LOG_MUTEX;
+
+            inline void write_line(std::ostream& os, const std::string& line)
+            {
+                std::lock_guard<std::mutex> lock(LOG_MUTEX);
+                os << line << std::endl;
+            }
+
             inline void set_log_level(std::string level)
             {
                 if(level == "LOG_NOTHING")
@@ -242,22 +253,22 @@ namespace ql
 
 #define EOUT(content) \
     if ( ql::utils::logger::LOG_LEVEL >= ql::utils::logger::log_level_t::LOG_ERROR ) \
-        std::cerr << "[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" Error: "<< content << std::endl
+        ql::utils::logger::write_line(std::cerr, SS2S("[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" Error: "<< content))
 
 #define WOUT(content) \
     if ( ql::utils::logger::LOG_LEVEL >= ql::utils::logger::log_level_t::LOG_WARNING ) \
-        std::cerr << "[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" Warning: "<< content << std::endl
+        ql::utils::logger::write_line(std::cerr, SS2S("[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" Warning: "<< content))
 
 #define IOUT(content) \
     if ( ql::utils::logger::LOG_LEVEL >= ql::utils::logger::log_level_t::LOG_INFO ) \
-        std::cout << "[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" Info: "<< content << std::endl
+        ql::utils::logger::write_line(std::cout, SS2S("[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" Info: "<< content))
 
 #define DOUT(content) \
     if ( ql::utils::logger::LOG_LEVEL >= ql::utils::logger::log_level_t::LOG_DEBUG ) \
-        std::cout << "[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" "<< content << std::endl
+        ql::utils::logger::write_line(std::cout, SS2S("[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" "<< content))
 
 #define COUT(content) \
-        std::cout << "[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" "<< content << std::endl
+        ql::utils::logger::write_line(std::cout, SS2S("[OPENQL] " << __FILE__ <<":"<< __LINE__ <<" "<< content))
 
 // helper macro: stringstream to string
 // based on https://stackoverflow.com/questions/21924156/how-to-initialize-a-stdstringstream
@@ -368,7 +368,7 @@ void drawGate(cimg_library::CImg<unsigned char> &image, const Layout layout, con
 	if (gate->type() == __custom_gate__)
 	{
 		IOUT("Custom gate found. Using user specified visualization.");
-		gateVisual = gate->gateVisual;
+		gateVisual = ((ql::custom_gate *) gate)->definition->gateVisual;
 	}
 	else
 	{
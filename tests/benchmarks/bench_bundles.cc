@@ -0,0 +1,100 @@
+/*
+    file:       bench_bundles.cc
+    notes:      benchmark of bundling (ql::ir::bundler) and of CC-Light QISA generation,
+                which combines the sections of the bundles into SIMD instructions,
+                on scheduled kernels of many bundles;
+                each bundle has single-qubit gates of a few kinds on a random half of the qubits,
+                so that several gates of each bundle combine into one instruction;
+                usage: bench_bundles [bundle_count ...], default 1000 10000
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include <openql.h>
+#include <utils.h>
+#include <ir.h>
+#include <arch/cc_light/cc_light_eqasm_compiler.h>
+
+#define CFG_FILE_JSON   "test_mapper_s17.json"
+
+// a kernel of bundle_count bundles, one per cycle, with cycles assigned as by a scheduler
+static void generate(ql::quantum_kernel& k, const ql::quantum_platform& platform, size_t bundle_count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    const std::vector<std::string> gates1q = {"x", "y", "x90", "ym90"};
+    std::vector<size_t> qubits(platform.qubit_number);
+    for (size_t q = 0; q < qubits.size(); q++)
+    {
+        qubits[q] = q;
+    }
+    for (size_t b = 0; b < bundle_count; b++)
+    {
+        for (size_t i = qubits.size(); i > 1; i--)
+        {
+            std::swap(qubits[i-1], qubits[gen() % i]);
+        }
+        for (size_t i = 0; i < qubits.size()/2; i++)
+        {
+            k.gate(gates1q[gen() % gates1q.size()], qubits[i]);
+            k.c.back()->cycle = b + 1;
+        }
+    }
+    k.cycles_valid = true;
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double msecs(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static void bench(const ql::quantum_platform& platform, size_t bundle_count)
+{
+    ql::quantum_program prog("bench_bundles", platform, platform.qubit_number, 0);
+    ql::quantum_kernel k("bundles_" + std::to_string(bundle_count), platform, platform.qubit_number, 0);
+    generate(k, platform, bundle_count, 17);
+    prog.add(k);
+
+    bench_clock::time_point t0 = bench_clock::now();
+    size_t nbundles = ql::ir::bundler(prog.kernels.front().c, platform.cycle_time).size();
+    double t_bundler = msecs(t0);
+
+    ql::arch::cc_light_eqasm_compiler compiler;
+    t0 = bench_clock::now();
+    compiler.qisa_code_generation(&prog, platform, "qisa_code_generation");
+    double t_qisa = msecs(t0);
+
+    std::cout << "bundles=" << nbundles << " gates=" << prog.kernels.front().c.size()
+        << " bundler=" << t_bundler << "ms"
+        << " qisa=" << t_qisa << "ms"
+        << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("output_dir", "test_output");
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+
+    std::vector<size_t> bundle_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        bundle_counts.push_back(std::strtoul(argv[i], NULL, 10));
+    }
+    if (bundle_counts.empty())
+    {
+        bundle_counts = {1000, 10000};
+    }
+
+    for (auto bundle_count : bundle_counts)
+    {
+        bench(platform, bundle_count);
+    }
+    return 0;
+}
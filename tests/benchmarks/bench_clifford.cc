@@ -0,0 +1,195 @@
+/*
+    file:       bench_clifford.cc
+    notes:      benchmark of the clifford optimizer (option clifford_prescheduler=yes)
+                on randomized benchmarking circuits, reporting the number of gates, of two-qubit gates
+                and of cycles (ASAP, without resource constraints) before and after optimization:
+                - rb: the circuits of examples/multi_qubits_randomized_benchmarking.cc,
+                  random single-qubit cliffords followed by their inverse, on each qubit
+                - rb2q: random layers of single-qubit cliffords and a cz or cnot between random qubits,
+                  followed by their inverse
+                - random2q: the same random layers without their inverse
+                usage: bench_clifford [clifford_count ...], default 256 4096
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include <openql.h>
+#include <utils.h>
+#include <clifford.h>
+
+#define CFG_FILE_JSON   "test_cfg_none_simple.json"
+
+// inverse of each of the 24 cliffords of quantum_kernel::clifford, as in examples/randomized_benchmarking.cc
+static const size_t inv_clifford_lut_gs[] = {0, 2, 1, 3, 8, 10, 6, 11, 4, 9, 5, 7, 12, 16, 23, 21, 13, 17, 18, 19, 20, 15, 22, 14};
+
+// the rb circuit of examples/multi_qubits_randomized_benchmarking.cc on each qubit, with different cliffords per qubit;
+// only the raw output of the random number generator is used, which is the same on all platforms
+static void generate_rb(ql::quantum_kernel& k, size_t qubit_count, size_t clifford_count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    for (size_t q = 0; q < qubit_count; q++)
+    {
+        k.prepz(q);
+    }
+    for (size_t q = 0; q < qubit_count; q++)
+    {
+        std::vector<size_t> cl;
+        for (size_t i = 0; i < clifford_count/2; i++)
+        {
+            cl.push_back(gen() % 24);
+        }
+        for (size_t i = 0; i < clifford_count/2; i++)
+        {
+            cl.push_back(inv_clifford_lut_gs[cl[clifford_count/2-1-i]]);
+        }
+        for (auto c : cl)
+        {
+            k.clifford(c, q);
+        }
+        k.measure(q);
+    }
+}
+
+// random layers of a single-qubit clifford on each qubit and a two-qubit gate, followed by their inverse when with_inverse
+static void generate_rb2q(ql::quantum_kernel& k, size_t qubit_count, size_t clifford_count, unsigned seed, bool with_inverse)
+{
+    std::mt19937 gen(seed);
+    const std::vector<std::string> gates1q = {"x", "y", "z", "h", "s", "sdag", "rx90", "mrx90", "ry90", "mry90"};
+    const std::vector<std::string> inverses = {"x", "y", "z", "h", "sdag", "s", "mrx90", "rx90", "mry90", "ry90"};
+    std::vector<std::pair<std::string, std::vector<size_t>>> gates;
+    for (size_t i = 0; i < clifford_count/2; i++)
+    {
+        for (size_t q = 0; q < qubit_count; q++)
+        {
+            size_t g = gen() % gates1q.size();
+            gates.push_back(std::make_pair(gates1q[g], std::vector<size_t>{q}));
+        }
+        size_t q0 = gen() % qubit_count;
+        size_t q1 = (q0 + 1 + gen() % (qubit_count - 1)) % qubit_count;
+        gates.push_back(std::make_pair(std::string((gen() % 2) ? "cz" : "cnot"), std::vector<size_t>{q0, q1}));
+    }
+
+    for (size_t q = 0; q < qubit_count; q++)
+    {
+        k.prepz(q);
+    }
+    for (auto & g : gates)
+    {
+        k.gate(g.first, g.second);
+    }
+    for (size_t i = gates.size(); with_inverse && i-- > 0; )
+    {
+        std::string name = gates[i].first;
+        for (size_t g = 0; g < gates1q.size(); g++)
+        {
+            if (gates1q[g] == name)
+            {
+                name = inverses[g];
+                break;
+            }
+        }
+        k.gate(name, gates[i].second);
+    }
+    for (size_t q = 0; q < qubit_count; q++)
+    {
+        k.measure(q);
+    }
+}
+
+struct counts_t
+{
+    size_t gates;
+    size_t gates_2q;
+    size_t cycles;
+};
+
+// the number of gates and two-qubit gates, and the depth in cycles of an ASAP schedule without resource constraints
+static counts_t count(const ql::quantum_kernel& k)
+{
+    counts_t c = {0, 0, 0};
+    std::vector<size_t> ready(k.qubit_count, 0);
+    for (auto gp : k.c)
+    {
+        size_t start = 0;
+        for (auto q : gp->operands)
+        {
+            start = std::max(start, ready[q]);
+        }
+        size_t end = start + (gp->duration + k.cycle_time - 1) / k.cycle_time;
+        for (auto q : gp->operands)
+        {
+            ready[q] = end;
+        }
+        c.cycles = std::max(c.cycles, end);
+        c.gates++;
+        c.gates_2q += (gp->operands.size() == 2);
+    }
+    return c;
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double msecs(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static void bench(const ql::quantum_platform& platform, const std::string& kind, size_t qubit_count, size_t clifford_count)
+{
+    ql::quantum_program prog("bench_clifford", platform, qubit_count, 0);
+    ql::quantum_kernel k(kind + "_" + std::to_string(clifford_count), platform, qubit_count, 0);
+    if (kind == "rb")
+    {
+        generate_rb(k, qubit_count, clifford_count, 17);
+    }
+    else
+    {
+        generate_rb2q(k, qubit_count, clifford_count, 17, kind == "rb2q");
+    }
+    prog.add(k);
+    counts_t in = count(prog.kernels.front());
+
+    bench_clock::time_point t0 = bench_clock::now();
+    ql::clifford_optimize(&prog, platform, "clifford_prescheduler");
+    double t_opt = msecs(t0);
+
+    counts_t out = count(prog.kernels.front());
+    std::cout << kind << " qubits=" << qubit_count << " cliffords=" << clifford_count
+        << " gates=" << in.gates << "->" << out.gates
+        << " two-qubit gates=" << in.gates_2q << "->" << out.gates_2q
+        << " cycles=" << in.cycles << "->" << out.cycles
+        << " optimize=" << t_opt << "ms"
+        << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("clifford_prescheduler", "yes");
+    ql::quantum_platform platform("none", CFG_FILE_JSON);
+
+    std::vector<size_t> clifford_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        clifford_counts.push_back(std::strtoul(argv[i], NULL, 10));
+    }
+    if (clifford_counts.empty())
+    {
+        clifford_counts = {256, 4096};
+    }
+
+    for (auto clifford_count : clifford_counts)
+    {
+        bench(platform, "rb", 1, clifford_count);
+        bench(platform, "rb", 5, clifford_count);
+        bench(platform, "rb2q", 2, clifford_count);
+        bench(platform, "rb2q", 5, clifford_count);
+        bench(platform, "random2q", 2, clifford_count);
+        bench(platform, "random2q", 5, clifford_count);
+    }
+    return 0;
+}
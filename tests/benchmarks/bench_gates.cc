@@ -0,0 +1,95 @@
+/*
+    file:       bench_gates.cc
+    notes:      benchmark of creating kernels with quantum_kernel::gate(),
+                which looks up each gate by its name and operands in the platform's instructions;
+                the gates are a random mix of custom single- and two-qubit gates
+                and of gates that are decomposed by the platform's gate_decomposition;
+                also reports the size of a custom gate and the time of a pass over the gates' matrices;
+                each is done with the gates on the heap and in a gate arena (as while compiling a program);
+                usage: bench_gates [gate_count ...], default 10000 100000
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include <openql.h>
+#include <utils.h>
+#include <gate_arena.h>
+
+#define CFG_FILE_JSON   "test_mapper_s17.json"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double msecs(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static void bench(const ql::quantum_platform& platform, size_t gate_count, bool in_arena)
+{
+    ql::gate_arena arena;
+    ql::gate_arena::scope arena_scope(in_arena ? &arena : nullptr);
+    const std::vector<std::string> gates1q = {"x", "y", "x90", "ym90", "rx90", "ry180"};
+    std::mt19937 gen(17);
+    ql::quantum_kernel k("gates_" + std::to_string(gate_count), platform, platform.qubit_number, 0);
+
+    bench_clock::time_point t0 = bench_clock::now();
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t q0 = gen() % platform.qubit_number;
+        if (gen() % 4 == 0)
+        {
+            size_t q1 = (q0 + 1 + gen() % (platform.qubit_number - 1)) % platform.qubit_number;
+            k.gate("cnot", q0, q1);
+        }
+        else
+        {
+            k.gate(gates1q[gen() % gates1q.size()], q0);
+        }
+    }
+    double t_gates = msecs(t0);
+
+    t0 = bench_clock::now();
+    ql::complex_t trace = 0;
+    for (auto gp : k.c)
+    {
+        ql::cmat_t m = gp->mat();
+        trace += m.m[0] + m.m[3];
+    }
+    double t_scan = msecs(t0);
+
+    std::cout << (in_arena ? "arena" : "heap ") << " gates=" << gate_count << " circuit=" << k.c.size()
+        << " gate()=" << t_gates << "ms"
+        << " per gate=" << 1e6 * t_gates / gate_count << "ns"
+        << " sizeof(custom_gate)=" << sizeof(ql::custom_gate)
+        << " scan=" << t_scan << "ms"
+        << " (trace " << trace << ")"
+        << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("output_dir", "test_output");
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+
+    std::vector<size_t> gate_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        gate_counts.push_back(std::strtoul(argv[i], NULL, 10));
+    }
+    if (gate_counts.empty())
+    {
+        gate_counts = {10000, 100000};
+    }
+
+    for (auto gate_count : gate_counts)
+    {
+        bench(platform, gate_count, false);
+        bench(platform, gate_count, true);
+    }
+    return 0;
+}
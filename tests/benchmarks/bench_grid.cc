@@ -0,0 +1,156 @@
+/*
+    file:       bench_grid.cc
+    notes:      benchmark of the mapper's grid on large generated topologies:
+                square xy grids of side*side qubits, each qubit connected to its horizontal and vertical neighbors;
+                usage: bench_grid [side ...], default 5 10 32;
+                it reports the time to initialize the grid (including the distance matrix)
+                and the time to generate the shortest paths between random pairs of qubits,
+                first when the next hops along them must be computed and then when these are reused,
+                with the size of the next hops;
+                this is done for the left and right shortest paths (mappathselect=borders) between any pairs,
+                and for all shortest paths (mappathselect=all) between pairs at a distance of at most ALL_DISTANCE,
+                as the number of all shortest paths grows exponentially with the distance
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include <openql.h>
+#include <utils.h>
+#include <mapper.h>
+
+#define CFG_FILE_JSON   "test_mapper_s17.json"
+#define ALL_DISTANCE    8
+
+// write a platform configuration file for a side*side grid, taking all but the topology from CFG_FILE_JSON
+static std::string generate(size_t side)
+{
+    json config = ql::load_json(CFG_FILE_JSON);
+    size_t nq = side * side;
+    config["hardware_settings"]["qubit_number"] = nq;
+
+    json topology;
+    topology["form"] = "xy";
+    topology["x_size"] = side;
+    topology["y_size"] = side;
+    topology["qubits"] = json::array();
+    topology["edges"] = json::array();
+    size_t edge_count = 0;
+    for (size_t q = 0; q < nq; q++)
+    {
+        size_t x = q % side;
+        size_t y = q / side;
+        topology["qubits"].push_back({{"id", q}, {"x", x}, {"y", y}});
+
+        std::vector<size_t> nbs;
+        if (x > 0)          nbs.push_back(q - 1);
+        if (x + 1 < side)   nbs.push_back(q + 1);
+        if (y > 0)          nbs.push_back(q - side);
+        if (y + 1 < side)   nbs.push_back(q + side);
+        for (auto n : nbs)
+        {
+            topology["edges"].push_back({{"id", edge_count++}, {"src", q}, {"dst", n}});
+        }
+    }
+    config["topology"] = topology;
+
+    std::string fname = "test_output/bench_grid_" + std::to_string(side) + ".json";
+    std::ofstream out(fname);
+    out << config.dump(4) << std::endl;
+    return fname;
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double msecs(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+// generate the paths between the pairs twice, and report the times, the size of the next hops, and the paths
+static void bench_paths(Grid& grid, const std::vector<std::pair<size_t,size_t>>& pairs, Grid::whichpaths_t which)
+{
+    size_t path_count = 0;
+    size_t total_distance = 0;
+    double t_paths[2];
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        bench_clock::time_point t0 = bench_clock::now();
+        for (auto & p : pairs)
+        {
+            path_count += grid.ShortestPaths(p.first, p.second, which).size();
+            total_distance += grid.Distance(p.first, p.second);
+        }
+        t_paths[pass] = msecs(t0);
+    }
+
+    std::cout << "    " << (which == Grid::wp_all_shortest ? "all" : "borders")
+        << ": paths of " << pairs.size() << " pairs=" << t_paths[0] << "ms"
+        << " reused=" << t_paths[1] << "ms"
+        << " nexthops=" << grid.NextHopsSize() / 1024 << "KiB"
+        << " (paths=" << path_count / 2 << " distance=" << total_distance / 2 << ")"
+        << std::endl;
+}
+
+static void bench(size_t side)
+{
+    ql::quantum_platform platform("grid", generate(side));
+    size_t nq = platform.qubit_number;
+
+    bench_clock::time_point t0 = bench_clock::now();
+    Grid grid;
+    grid.Init(&platform);
+    double t_init = msecs(t0);
+
+    std::cout << "qubits=" << nq
+        << " init=" << t_init << "ms"
+        << " distances=" << (grid.dist.size() * sizeof(Grid::distance_t)) / 1024 << "KiB"
+        << std::endl;
+
+    std::mt19937 gen(17);
+    std::vector<std::pair<size_t,size_t>> pairs;
+    std::vector<std::pair<size_t,size_t>> near_pairs;
+    while (pairs.size() < 1000 || near_pairs.size() < 1000)
+    {
+        size_t src = gen() % nq;
+        size_t tgt = gen() % nq;
+        if (pairs.size() < 1000)
+        {
+            pairs.push_back(std::make_pair(src, tgt));
+        }
+        if (near_pairs.size() < 1000 && grid.Distance(src, tgt) <= ALL_DISTANCE)
+        {
+            near_pairs.push_back(std::make_pair(src, tgt));
+        }
+    }
+
+    bench_paths(grid, pairs, Grid::wp_leftright_shortest);
+    bench_paths(grid, near_pairs, Grid::wp_all_shortest);
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("mappathselect", "borders");
+    ql::utils::make_output_dir("test_output");
+
+    std::vector<size_t> sides;
+    for (int i = 1; i < argc; i++)
+    {
+        sides.push_back(std::strtoul(argv[i], NULL, 10));
+    }
+    if (sides.empty())
+    {
+        sides = {5, 10, 32};
+    }
+
+    for (auto side : sides)
+    {
+        bench(side);
+    }
+    return 0;
+}
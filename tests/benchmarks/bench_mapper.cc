@@ -0,0 +1,122 @@
+/*
+    file:       bench_mapper.cc
+    notes:      benchmark of mapping generated circuits with many two-qubit gates between any qubits
+                on the s17 platform, reporting the mapper time per two-qubit gate that had to be routed;
+                usage: bench_mapper [gate_count ...], default 200 1000;
+                each size is mapped with minextendrc with mappathselect=all,
+                without recursion (mapselectmaxlevel=0) and with one level of it (mapselectmaxlevel=1),
+                which evaluate many alternatives, each extending a copy of the mapper's past;
+                the latter also with the alternatives evaluated concurrently, one thread per hardware thread
+                (mapselectthreads=0), which must give the same result;
+                each size is also mapped with maxfidelity without recursion,
+                which scores the alternatives by their estimated fidelity instead of their extension
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include <openql.h>
+#include <utils.h>
+#include <mapper.h>
+
+#define CFG_FILE_JSON   "test_mapper_s17.json"
+
+// generate a circuit of gate_count gates with two-qubit gates between any qubits, so that it must be mapped;
+// it starts giving each qubit a state, so that the mapper must really swap them instead of just renaming;
+// only the raw output of the random number generator is used, which is the same on all platforms
+static void generate(ql::quantum_kernel& k, size_t qubit_count, size_t gate_count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    const std::vector<std::string> gates1q = {"x", "y", "x90", "ym90", "h", "z", "s", "t"};
+    for (size_t q = 0; q < qubit_count; q++)
+    {
+        k.gate("x", {q});
+    }
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 16;
+        if (r < 5)
+        {
+            size_t q0 = gen() % qubit_count;
+            size_t q1 = (q0 + 1 + gen() % (qubit_count - 1)) % qubit_count;
+            k.gate("cz", {q0, q1});
+        }
+        else
+        {
+            k.gate(gates1q[gen() % gates1q.size()], {gen() % qubit_count});
+        }
+    }
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double msecs(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static void bench(const ql::quantum_platform& platform, size_t gate_count, const std::string& maxlevel, const std::string& threads,
+    const std::string& mapper_option = "minextendrc")
+{
+    ql::options::set("mapper", mapper_option);
+    ql::options::set("mapselectmaxlevel", maxlevel);
+    ql::options::set("mapselectthreads", threads);
+
+    size_t nq = platform.qubit_number;
+    ql::quantum_kernel k("bench_" + std::to_string(gate_count), platform, nq, 0);
+    generate(k, nq, gate_count, 17);
+
+    Mapper mapper;
+    mapper.Init(&platform);
+
+    bench_clock::time_point t0 = bench_clock::now();
+    mapper.Map(k);
+    double t_map = msecs(t0);
+
+    // with mapselectswaps=all, each routing makes one two-qubit gate nearest-neighbor
+    size_t routed = mapper.nroutings;
+    size_t depth = (k.c.empty() ? 0 : k.c.back()->cycle);
+
+    std::cout << "gates=" << gate_count
+        << " mapper=" << mapper_option
+        << " mapselectmaxlevel=" << maxlevel
+        << " mapselectthreads=" << threads
+        << " map=" << t_map << "ms"
+        << " routed=" << routed
+        << " per routed gate=" << (routed == 0 ? 0.0 : t_map / routed) << "ms"
+        << " (swaps=" << mapper.nswapsadded << " depth=" << depth << ")"
+        << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("mapinitone2one", "yes");
+    ql::options::set("mappathselect", "all");
+    ql::options::set("maplookahead", "noroutingfirst");
+    ql::options::set("maptiebreak", "first");
+    ql::options::set("mapselectswaps", "all");
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+
+    std::vector<size_t> gate_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        gate_counts.push_back(std::strtoul(argv[i], NULL, 10));
+    }
+    if (gate_counts.empty())
+    {
+        gate_counts = {200, 1000};
+    }
+
+    for (auto gate_count : gate_counts)
+    {
+        bench(platform, gate_count, "0", "1");
+        bench(platform, gate_count, "1", "1");
+        bench(platform, gate_count, "1", "0");
+        bench(platform, gate_count, "0", "1", "maxfidelity");
+    }
+    return 0;
+}
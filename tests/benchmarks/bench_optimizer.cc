@@ -0,0 +1,141 @@
+/*
+    file:       bench_optimizer.cc
+    notes:      benchmark of the rotation optimizer (option optimize=yes) on generated kernels
+                that are long sequences of single-qubit rotations with an occasional two-qubit gate,
+                as calibration kernels are, reporting the optimization time per gate;
+                and of the cancellation of inverse gates (option cancel_prescheduler=yes)
+                on generated kernels of cnots and czs with some X and Z rotations in between;
+                usage: bench_optimizer [gate_count ...], default 1000 10000;
+                the time per gate must stay the same for larger kernels
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include <openql.h>
+#include <utils.h>
+#include <optimizer.h>
+#include <cancel.h>
+
+#define CFG_FILE_JSON   "test_cfg_none_simple.json"
+
+// generate a kernel of gate_count gates, mostly single-qubit rotations among which some cancel;
+// only the raw output of the random number generator is used, which is the same on all platforms
+static void generate(ql::quantum_kernel& k, size_t qubit_count, size_t gate_count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    const std::vector<std::string> gates1q = {"x", "y", "h", "rx90", "mrx90", "ry90", "mry90", "s", "t"};
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 64;
+        if (r == 0)
+        {
+            size_t q0 = gen() % qubit_count;
+            size_t q1 = (q0 + 1 + gen() % (qubit_count - 1)) % qubit_count;
+            k.gate("cz", {q0, q1});
+        }
+        else
+        {
+            k.gate(gates1q[gen() % gates1q.size()], {gen() % qubit_count});
+        }
+    }
+}
+
+// generate a kernel of gate_count gates, mostly two-qubit gates on few qubits among which some cancel
+static void generate_2q(ql::quantum_kernel& k, size_t qubit_count, size_t gate_count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    const std::vector<std::string> gates1q = {"x", "z", "s", "sdag", "h"};
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 4;
+        if (r == 0)
+        {
+            k.gate(gates1q[gen() % gates1q.size()], {gen() % qubit_count});
+        }
+        else
+        {
+            size_t q0 = gen() % qubit_count;
+            size_t q1 = (q0 + 1 + gen() % (qubit_count - 1)) % qubit_count;
+            k.gate(r == 1 ? "cz" : "cnot", {q0, q1});
+        }
+    }
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double msecs(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static void bench(const ql::quantum_platform& platform, size_t gate_count)
+{
+    size_t nq = 5;
+    ql::quantum_program prog("bench_optimizer", platform, nq, 0);
+    ql::quantum_kernel k("bench_" + std::to_string(gate_count), platform, nq, 0);
+    generate(k, nq, gate_count, 17);
+    prog.add(k);
+
+    bench_clock::time_point t0 = bench_clock::now();
+    ql::rotation_optimize(&prog, platform, "rotation_optimize");
+    double t_opt = msecs(t0);
+
+    size_t remaining = prog.kernels.front().c.size();
+    std::cout << "gates=" << gate_count
+        << " optimize=" << t_opt << "ms"
+        << " per gate=" << (t_opt * 1000 / gate_count) << "us"
+        << " (removed=" << (gate_count - remaining) << ")"
+        << std::endl;
+}
+
+static void bench_cancel(const ql::quantum_platform& platform, size_t gate_count)
+{
+    size_t nq = 5;
+    ql::quantum_program prog("bench_cancel", platform, nq, 0);
+    ql::quantum_kernel k("bench_" + std::to_string(gate_count), platform, nq, 0);
+    generate_2q(k, nq, gate_count, 17);
+    prog.add(k);
+
+    bench_clock::time_point t0 = bench_clock::now();
+    ql::cancel_gates(&prog, platform, "cancel_prescheduler");
+    double t_cancel = msecs(t0);
+
+    size_t remaining = prog.kernels.front().c.size();
+    std::cout << "gates=" << gate_count
+        << " cancel=" << t_cancel << "ms"
+        << " per gate=" << (t_cancel * 1000 / gate_count) << "us"
+        << " (removed=" << (gate_count - remaining) << ")"
+        << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("optimize", "yes");
+    ql::options::set("cancel_prescheduler", "yes");
+    ql::quantum_platform platform("none", CFG_FILE_JSON);
+
+    std::vector<size_t> gate_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        gate_counts.push_back(std::strtoul(argv[i], NULL, 10));
+    }
+    if (gate_counts.empty())
+    {
+        gate_counts = {1000, 10000};
+    }
+
+    for (auto gate_count : gate_counts)
+    {
+        bench(platform, gate_count);
+    }
+    for (auto gate_count : gate_counts)
+    {
+        bench_cancel(platform, gate_count);
+    }
+    return 0;
+}
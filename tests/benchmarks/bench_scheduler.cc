@@ -0,0 +1,179 @@
+/*
+    file:       bench_scheduler.cc
+    notes:      benchmark of dependence graph construction and (resource-constrained) scheduling
+                on large generated circuits;
+                usage: bench_scheduler [gate_count ...], default 1000 10000 50000;
+                uniform scheduling is quadratic in the number of gates, so it is skipped for more than 10000 gates;
+                rescheduling after a local edit is measured with an updated and with a newly created dependence graph;
+                resource-constrained ASAP scheduling is also measured with resources that fill gaps (scheduler_gapfill)
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include <openql.h>
+#include <utils.h>
+#include <scheduler.h>
+
+#define CFG_FILE_JSON   "test_mapper_s17.json"
+
+// generate a circuit of gate_count gates on the platform's qubits;
+// two-qubit gates are only generated between neighbors in the platform's topology
+// so that the circuit can be scheduled with resource constraints without mapping
+static void generate(ql::quantum_kernel& k, const ql::quantum_platform& platform, size_t gate_count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<std::pair<size_t,size_t>> edges;
+    for (auto & e : platform.topology["edges"])
+    {
+        edges.push_back(std::make_pair(e["src"], e["dst"]));
+    }
+    const std::vector<std::string> gates1q = {"x", "y", "x90", "ym90", "h", "z", "s", "t"};
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 16;
+        if (r < 5)
+        {
+            auto & e = edges[gen() % edges.size()];
+            k.gate((r < 3) ? "cz" : "cnot", {e.first, e.second});
+        }
+        else if (r < 6)
+        {
+            k.gate("measure", {gen() % platform.qubit_number});
+        }
+        else
+        {
+            k.gate(gates1q[gen() % gates1q.size()], {gen() % platform.qubit_number});
+        }
+    }
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double msecs(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static void bench(const ql::quantum_platform& platform, size_t gate_count)
+{
+    size_t nq = platform.qubit_number;
+    ql::quantum_kernel k("bench_" + std::to_string(gate_count), platform, nq, 0);
+    generate(k, platform, gate_count, 17);
+    std::string dot;
+
+    bench_clock::time_point t0;
+    double t_init = 0, t_asap = 0, t_alap = 0, t_uniform = 0, t_rcasap = 0, t_rcalap = 0, t_gapfill = 0;
+    double t_update = 0, t_reinit = 0;
+    size_t depth_asap = 0, depth_rcasap = 0, depth_rcalap = 0, depth_gapfill = 0;
+    {
+        Scheduler sched;
+        t0 = bench_clock::now();
+        sched.init(k.c, platform, nq, 0);
+        t_init = msecs(t0);
+
+        t0 = bench_clock::now();
+        sched.schedule_asap(dot);
+        t_asap = msecs(t0);
+        depth_asap = k.c.back()->cycle;
+
+        t0 = bench_clock::now();
+        sched.schedule_alap(dot);
+        t_alap = msecs(t0);
+
+        if (gate_count <= 10000)
+        {
+            t0 = bench_clock::now();
+            sched.schedule_alap_uniform();
+            t_uniform = msecs(t0);
+        }
+    }
+    {
+        Scheduler sched;
+        sched.init(k.c, platform, nq, 0);
+        ql::arch::resource_manager_t rm(platform, ql::forward_scheduling);
+        t0 = bench_clock::now();
+        sched.schedule_asap(rm, platform, dot);
+        t_rcasap = msecs(t0);
+        depth_rcasap = k.c.back()->cycle;
+    }
+    {
+        Scheduler sched;
+        sched.init(k.c, platform, nq, 0);
+        ql::arch::resource_manager_t rm(platform, ql::backward_scheduling);
+        t0 = bench_clock::now();
+        sched.schedule_alap(rm, platform, dot);
+        t_rcalap = msecs(t0);
+        depth_rcalap = k.c.back()->cycle;
+    }
+    {
+        Scheduler sched;
+        sched.init(k.c, platform, nq, 0);
+        ql::arch::resource_manager_t rm(platform, ql::forward_scheduling, true);
+        t0 = bench_clock::now();
+        sched.schedule_asap(rm, platform, dot);
+        t_gapfill = msecs(t0);
+        depth_gapfill = k.c.back()->cycle;
+    }
+    {
+        // a local edit of the scheduled circuit, replacing a gate halfway by a new one;
+        // rescheduling it ASAP after updating the dependence graph vs. after creating it from scratch
+        Scheduler sched;
+        sched.init(k.c, platform, nq, 0);
+        sched.schedule_asap(dot);
+        sched.update(k.c, platform, nq, 0);     // to the sorted circuit
+        sched.schedule_asap(dot);
+
+        ql::quantum_kernel edit("edit", platform, nq, 0);
+        edit.gate("x", {0});
+        k.c[k.c.size()/2] = edit.c[0];
+
+        t0 = bench_clock::now();
+        sched.update(k.c, platform, nq, 0);
+        sched.schedule_asap(dot);
+        t_update = msecs(t0);
+
+        Scheduler fresh;
+        t0 = bench_clock::now();
+        fresh.init(k.c, platform, nq, 0);
+        fresh.schedule_asap(dot);
+        t_reinit = msecs(t0);
+    }
+
+    std::cout << "gates=" << gate_count
+        << " init=" << t_init << "ms"
+        << " asap=" << t_asap << "ms"
+        << " alap=" << t_alap << "ms"
+        << " uniform=" << t_uniform << "ms"
+        << " rc_asap=" << t_rcasap << "ms"
+        << " rc_alap=" << t_rcalap << "ms"
+        << " rc_asap_gapfill=" << t_gapfill << "ms"
+        << " edit: update+asap=" << t_update << "ms init+asap=" << t_reinit << "ms"
+        << " (depth asap=" << depth_asap << " rc_asap=" << depth_rcasap << " rc_alap=" << depth_rcalap << " rc_asap_gapfill=" << depth_gapfill << ")"
+        << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+
+    std::vector<size_t> gate_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        gate_counts.push_back(std::strtoul(argv[i], NULL, 10));
+    }
+    if (gate_counts.empty())
+    {
+        gate_counts = {1000, 10000, 50000};
+    }
+
+    for (auto gate_count : gate_counts)
+    {
+        bench(platform, gate_count);
+    }
+    return 0;
+}
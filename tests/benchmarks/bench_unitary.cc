@@ -0,0 +1,138 @@
+/*
+    file:       bench_unitary.cc
+    notes:      benchmark of unitary decomposition on Haar-random unitaries,
+                reporting the decomposition time sequentially and concurrently
+                (option unitary_decomposition_threads), and checking that the
+                concurrent decompositions are bit-identical to the sequential one;
+                the cache of decompositions is off (option unitary_decomposition_cache=no);
+                usage: bench_unitary [qubit_count ...], default 2 3 4 5 6;
+                skipped when unitary decomposition was disabled in the build
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <complex>
+#include <random>
+#include <thread>
+#include <cstdlib>
+
+#include <openql.h>
+#include <utils.h>
+#include <unitary.h>
+
+typedef std::vector<std::complex<double>> matrix_t;
+
+// a Haar-random unitary of dim x dim, in row-major order:
+// Gram-Schmidt orthonormalization of a matrix of complex Gaussian elements
+static matrix_t haar_unitary(size_t dim, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> dist(0.0, 1.0);
+    std::vector<matrix_t> rows;
+    for (size_t r = 0; r < dim; r++)
+    {
+        matrix_t v(dim);
+        for (auto & e : v)
+        {
+            e = std::complex<double>(dist(gen), dist(gen));
+        }
+        for (auto & u : rows)
+        {
+            std::complex<double> p = 0;
+            for (size_t i = 0; i < dim; i++)
+            {
+                p += std::conj(u[i]) * v[i];
+            }
+            for (size_t i = 0; i < dim; i++)
+            {
+                v[i] -= p * u[i];
+            }
+        }
+        double norm = 0;
+        for (auto & e : v)
+        {
+            norm += std::norm(e);
+        }
+        for (auto & e : v)
+        {
+            e /= std::sqrt(norm);
+        }
+        rows.push_back(v);
+    }
+    matrix_t m;
+    for (auto & v : rows)
+    {
+        m.insert(m.end(), v.begin(), v.end());
+    }
+    return m;
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double msecs(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+// decompose m on nthreads threads, returning its instructionlist and the time taken
+static std::vector<double> decompose(const matrix_t& m, size_t nthreads, double& t)
+{
+    ql::options::set("unitary_decomposition_threads", std::to_string(nthreads));
+    ql::unitary u("u", m);
+    bench_clock::time_point t0 = bench_clock::now();
+    u.decompose();
+    t = msecs(t0);
+    return u.instructionlist;
+}
+
+int main(int argc, char ** argv)
+{
+    if (!ql::unitary::is_decompose_support_enabled())
+    {
+        std::cout << "unitary decomposition support was disabled during OpenQL build, skipped" << std::endl;
+        return 0;
+    }
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("unitary_decomposition_cache", "no");
+
+    std::vector<size_t> qubit_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        qubit_counts.push_back(std::strtoul(argv[i], NULL, 10));
+    }
+    if (qubit_counts.empty())
+    {
+        qubit_counts = {2, 3, 4, 5, 6};
+    }
+    std::vector<size_t> thread_counts = {2, 4, 8};
+    if (std::thread::hardware_concurrency() > 8)
+    {
+        thread_counts.push_back(std::thread::hardware_concurrency());
+    }
+
+    int failures = 0;
+    for (auto qubit_count : qubit_counts)
+    {
+        matrix_t m = haar_unitary(size_t(1) << qubit_count, 7 + qubit_count);
+        double t_seq;
+        std::vector<double> reference = decompose(m, 1, t_seq);
+        std::cout << "qubits=" << qubit_count << " instructions=" << reference.size()
+            << " threads=1: " << t_seq << "ms";
+        for (auto nthreads : thread_counts)
+        {
+            double t;
+            bool identical = (decompose(m, nthreads, t) == reference);
+            std::cout << " threads=" << nthreads << ": " << t << "ms";
+            if (!identical)
+            {
+                std::cout << " (FAILED: differs from sequential)";
+                failures++;
+            }
+        }
+        std::cout << std::endl;
+    }
+    ql::options::set("unitary_decomposition_threads", "1");
+    ql::options::set("unitary_decomposition_cache", "yes");
+    return (failures == 0 ? 0 : 1);
+}
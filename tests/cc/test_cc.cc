@@ -366,6 +366,42 @@ void test_qi_example( std::string scheduler, std::string scheduler_uniform)
     prog.compile();
 }
 
+// rescheduling with the constraints of the instruments (option backend_cc_rcscheduler):
+// qubits 2, 8 and 14 share group 0 of instrument mw_0, so different gates on them cannot start in the same cycle,
+// which without rescheduling makes code generation fail on a signal conflict
+void test_rc_scheduler(std::string scheduler)
+{
+    // create and set platform
+    ql::quantum_platform s17("s17", CFG_FILE_JSON);
+
+    const int num_qubits = 17;
+    const int num_cregs = 3;
+    ql::quantum_program prog(("test_rc_scheduler_" + scheduler), s17, num_qubits, num_cregs);
+    ql::quantum_kernel k("aKernel", s17, num_qubits, num_cregs);
+
+    k.gate("x", 2);
+    k.gate("y", 8);
+    k.gate("x", 14);
+    k.gate("x", 6);
+    k.gate("cz", 2, 8);
+    k.gate("cz", 14, 15);
+    k.gate("x90", 2);
+    k.gate("y90", 8);
+    k.gate("x90", 14);
+    k.gate("measure", std::vector<size_t> {2}, std::vector<size_t> {0});
+    k.gate("measure", std::vector<size_t> {8}, std::vector<size_t> {1});
+    k.gate("measure", std::vector<size_t> {14}, std::vector<size_t> {2});
+
+    prog.add(k);
+
+    ql::options::set("scheduler", scheduler);
+    ql::options::set("scheduler_uniform", "no");
+    ql::options::set("backend_cc_rcscheduler", "yes");
+    ql::options::set("write_qasm_files", "yes");    // so we can see bundles
+    prog.compile();
+    ql::options::set("backend_cc_rcscheduler", "no");
+}
+
 
 int main(int argc, char ** argv)
 {
@@ -380,6 +416,8 @@ int main(int argc, char ** argv)
 #endif
 
     test_qi_example("ALAP", "no");
+    test_rc_scheduler("ASAP");
+    test_rc_scheduler("ALAP");
 
     return 0;
 }
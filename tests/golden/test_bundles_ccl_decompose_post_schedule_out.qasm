@@ -0,0 +1,47 @@
+version 1.0
+# this file has been automatically generated by the OpenQL compiler please do not modify it manually.
+qubits 7
+
+.combined
+    prepz q[2]
+    wait 1
+    { prepz q[0] | prepz q[3] | y q[2] }
+    wait 1
+    { prepz q[6] | x q[0] | x q[3] | prepz q[1] | prepz q[4] }
+    wait 1
+    { h q[6] | cz q[2],q[0] | x q[1] | y q[4] | sqf q[3] }
+    wait 1
+    { cz q[3],q[6] | cz q[1],q[4] | sqf q[5] | sqf q[3] }
+    wait 1
+    { ry90 q[0] | prepz q[5] }
+    wait 1
+    { cz q[0],q[3] | h q[5] | sqf q[2] }
+    wait 1
+    rx90 q[5]
+    wait 1
+    { ry90 q[3] | ym90 q[1] | ym90 q[6] }
+    wait 1
+    { measure q[0] | measure q[1] | measure q[2] | measure q[3] | measure q[4] | measure q[5] | measure q[6] }
+    wait 1
+
+.long_end
+    x q[0]
+    wait 1
+    { cz q[0],q[3] | sqf q[2] }
+    wait 3
+    { y q[1] | measure q[3] }
+    wait 1
+
+.wait_end
+    { x q[2] | x q[5] }
+    wait 1
+    cz q[2],q[5]
+    wait 3
+
+.empty
+
+.after_empty
+    h q[4]
+    wait 1
+    measure q[4]
+    wait 1
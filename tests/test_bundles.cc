@@ -0,0 +1,131 @@
+/*
+    file:       test_bundles.cc
+    notes:      test of the bundles (ql::ir::bundles_t) and of the CC-Light QISA generated from them:
+                a program for the cc_light platform is compiled with kernels
+                in which gates of the same instruction are combined into one section,
+                with sqf sections added by cz_mode=auto,
+                ending with a long gate, so that the last bundle only adds its duration,
+                ending with a wait gate, which is not bundled,
+                and without gates;
+                the bundled qasm and the QISA are compared with those in golden,
+                which were generated before bundles were stored flat;
+                furthermore a kernel with only a wait gate, so without bundles, must not end with a qwait
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include <openql.h>
+#include <utils.h>
+#include "test_harness.h"
+
+#define CFG_FILE_JSON   "hardware_config_cc_light.json"
+
+using ql_test::check;
+
+static std::string read_file(const std::string& fname)
+{
+    std::ifstream in(fname);
+    std::stringstream content;
+    content << in.rdbuf();
+    return (in ? content.str() : "");
+}
+
+// compile the program into test_output/test_bundles, with cz decomposed into cz and sqf after scheduling
+static void compile(ql::quantum_program& prog)
+{
+    prog.set_option("output_dir", "test_output/test_bundles");
+    prog.set_option("write_qasm_files", "yes");
+    prog.set_option("scheduler", "ALAP");
+    prog.set_option("cz_mode", "auto");
+    prog.compile();
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::quantum_platform platform("cc_light", CFG_FILE_JSON);
+    size_t nq = platform.qubit_number;
+
+    ql::quantum_program prog("test_bundles", platform, nq, 0);
+    {
+        // sections combining gates of the same instruction, and two-qubit gates with sqf sections added
+        ql::quantum_kernel k("combined", platform, nq, 0);
+        for (size_t q = 0; q < nq; q++)
+        {
+            k.gate("prepz", q);
+        }
+        k.gate("x", 0);
+        k.gate("x", 1);
+        k.gate("y", 2);
+        k.gate("x", 3);
+        k.gate("y", 4);
+        k.gate("h", 5);
+        k.gate("h", 6);
+        k.gate("cz", std::vector<size_t>{2, 0});
+        k.gate("cz", std::vector<size_t>{1, 4});
+        k.gate("cz", std::vector<size_t>{3, 6});
+        k.gate("rx90", 5);
+        k.gate("cnot", std::vector<size_t>{0, 3});
+        k.gate("ym90", 1);
+        k.gate("ym90", 6);
+        for (size_t q = 0; q < nq; q++)
+        {
+            k.gate("measure", q);
+        }
+        prog.add(k);
+    }
+    {
+        // ending with a long gate, after which only the duration of the last bundle remains
+        ql::quantum_kernel k("long_end", platform, nq, 0);
+        k.gate("x", 0);
+        k.gate("y", 1);
+        k.gate("cz", std::vector<size_t>{0, 3});
+        k.gate("measure", 3);
+        prog.add(k);
+    }
+    {
+        // ending with a wait gate, which is not bundled
+        ql::quantum_kernel k("wait_end", platform, nq, 0);
+        k.gate("x", 2);
+        k.gate("x", 5);
+        k.gate("cz", std::vector<size_t>{2, 5});
+        k.wait({2, 5}, 100);
+        prog.add(k);
+    }
+    {
+        ql::quantum_kernel k("empty", platform, nq, 0);
+        prog.add(k);
+    }
+    {
+        ql::quantum_kernel k("after_empty", platform, nq, 0);
+        k.gate("h", 4);
+        k.gate("measure", 4);
+        prog.add(k);
+    }
+    compile(prog);
+
+    for (std::string suffix : {"_scheduledqasmwriter_out.qasm", "_rcscheduler_out.qasm",
+        "_ccl_decompose_post_schedule_out.qasm", ".qisa"})
+    {
+        std::string output = read_file("test_output/test_bundles/test_bundles" + suffix);
+        std::string golden = read_file("golden/test_bundles" + suffix);
+        check("test_bundles" + suffix + " identical to golden", !output.empty() && output == golden);
+    }
+
+    // a kernel with gates but no bundles
+    ql::quantum_program wprog("test_bundles_wait", platform, nq, 0);
+    {
+        ql::quantum_kernel k("wait_only", platform, nq, 0);
+        k.wait({0}, 100);
+        wprog.add(k);
+    }
+    compile(wprog);
+    std::string qisa = read_file("test_output/test_bundles/test_bundles_wait.qisa");
+    size_t label = qisa.find("wait_only:");
+    check("kernel without bundles has no qwait", label != std::string::npos && qisa.find("qwait", label) == std::string::npos);
+
+    return ql_test::result();
+}
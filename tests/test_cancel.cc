@@ -0,0 +1,96 @@
+/*
+    file:       test_cancel.cc
+    notes:      test of the cancellation of pairs of inverse gates (option cancel_prescheduler=yes):
+                a gate cancels an earlier inverse gate on the same qubits
+                when it commutes with all gates in between that share a qubit with it,
+                by the signatures of the gates as in the scheduler (cnot controls and cz operands commute,
+                as do cnot targets) and by single-qubit Z and X rotations;
+                gates that don't commute, measurements and waits prevent the cancellation;
+                a gate that the platform declares with the cz signature (cs in test_179.json) commutes as a cz
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <openql.h>
+#include <utils.h>
+#include <cancel.h>
+#include "test_harness.h"
+
+#define CFG_FILE_JSON   "test_cfg_none_simple.json"
+#define CFG_FILE_JSON_SIGNATURE "test_179.json"
+
+struct gate_t
+{
+    std::string         name;
+    std::vector<size_t> qubits;
+};
+
+// the qasm of the kernel with the given gates after cancellation
+static std::string cancel(const std::vector<gate_t>& gates, const std::string& config)
+{
+    ql::quantum_platform platform("none", config);
+    ql::quantum_program prog("test_cancel", platform, 3, 0);
+    ql::quantum_kernel k("k", platform, 3, 0);
+    for (auto & g : gates)
+    {
+        if (g.name == "wait")
+        {
+            k.wait(g.qubits, 20);
+        }
+        else
+        {
+            k.gate(g.name, g.qubits);
+        }
+    }
+    prog.add(k);
+
+    ql::options::set("cancel_prescheduler", "yes");
+    ql::cancel_gates(&prog, platform, "cancel_prescheduler");
+    ql::options::set("cancel_prescheduler", "no");
+
+    std::string qasm;
+    for (auto & gp : prog.kernels.front().c)
+    {
+        qasm += (qasm.empty() ? "" : "; ") + gp->qasm();
+    }
+    return qasm;
+}
+
+static void check(const std::string& what, const std::vector<gate_t>& gates, const std::string& expected,
+    const std::string& config = CFG_FILE_JSON)
+{
+    std::string result = cancel(gates, config);
+    bool ok = (result == expected);
+    ql_test::check(what, ok, ": [" + result + "]" + (ok ? "" : ", expected [" + expected + "]"));
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+
+    check("cnot pair", {{"cnot", {0, 1}}, {"cnot", {0, 1}}}, "");
+    check("cnot reversed", {{"cnot", {0, 1}}, {"cnot", {1, 0}}}, "cnot q[0],q[1]; cnot q[1],q[0]");
+    check("cz pair", {{"cz", {0, 1}}, {"cz", {0, 1}}}, "");
+    check("cz reversed", {{"cz", {0, 1}}, {"cz", {1, 0}}}, "");
+    check("single-qubit pairs", {{"x", {0}}, {"x", {0}}, {"s", {1}}, {"sdag", {1}}, {"rx90", {2}}, {"mrx90", {2}}, {"rx180", {0}}, {"x", {0}}}, "");
+    check("no inverse", {{"s", {0}}, {"s", {0}}}, "s q[0]; s q[0]");
+    check("shared control", {{"cnot", {0, 1}}, {"cnot", {0, 2}}, {"cnot", {0, 1}}}, "cnot q[0],q[2]");
+    check("shared target", {{"cnot", {0, 2}}, {"cnot", {1, 2}}, {"cnot", {0, 2}}}, "cnot q[1],q[2]");
+    check("control and target", {{"cnot", {0, 1}}, {"cnot", {1, 2}}, {"cnot", {0, 1}}}, "cnot q[0],q[1]; cnot q[1],q[2]; cnot q[0],q[1]");
+    check("x on target", {{"cnot", {0, 1}}, {"x", {1}}, {"cnot", {0, 1}}}, "x q[1]");
+    check("x on control", {{"cnot", {0, 1}}, {"x", {0}}, {"cnot", {0, 1}}}, "cnot q[0],q[1]; x q[0]; cnot q[0],q[1]");
+    check("z across cz", {{"z", {0}}, {"cz", {0, 1}}, {"z", {0}}}, "cz q[0],q[1]");
+    check("cz across cnot control", {{"cz", {0, 1}}, {"cnot", {0, 2}}, {"cz", {1, 0}}}, "cnot q[0],q[2]");
+    check("h blocks", {{"cz", {0, 1}}, {"h", {1}}, {"cz", {0, 1}}}, "cz q[0],q[1]; h q[1]; cz q[0],q[1]");
+    check("nested", {{"h", {1}}, {"cz", {0, 1}}, {"h", {1}}, {"h", {1}}, {"cz", {0, 1}}, {"h", {1}}}, "");
+    check("measurement", {{"cnot", {0, 1}}, {"measure", {1}}, {"cnot", {0, 1}}}, "cnot q[0],q[1]; measure q[1]; cnot q[0],q[1]");
+    check("wait", {{"x", {0}}, {"wait", {}}, {"x", {0}}}, "x q[0]; wait 1; x q[0]");
+    check("other qubits", {{"x", {0}}, {"cz", {1, 2}}, {"h", {1}}, {"x", {0}}}, "cz q[1],q[2]; h q[1]");
+    check("cz across declared cz signature", {{"cz", {0, 1}}, {"cs", {1, 0}}, {"cz", {0, 1}}}, "cs q[1],q[0]", CFG_FILE_JSON_SIGNATURE);
+    check("cnot control across declared cz signature", {{"cnot", {0, 1}}, {"cs", {0, 2}}, {"cnot", {0, 1}}}, "cs q[0],q[2]", CFG_FILE_JSON_SIGNATURE);
+    check("cnot target blocked by declared cz signature", {{"cnot", {0, 1}}, {"cs", {1, 2}}, {"cnot", {0, 1}}},
+        "cnot q[0],q[1]; cs q[1],q[2]; cnot q[0],q[1]", CFG_FILE_JSON_SIGNATURE);
+
+    return ql_test::result();
+}
@@ -0,0 +1,248 @@
+/*
+    file:       test_cc_light_masks.cc
+    notes:      test of the allocation of the CC-Light mask registers (smis/smit) in the generated QISA:
+                programs on 17 qubits use more different masks than there are s and t registers,
+                so some registers are set again in the kernels, just before the bundles using them;
+                the QISA is checked by following the contents of the mask registers through each kernel,
+                expanding each SIMD instruction to its operands,
+                and comparing those per bundle with the scheduled gates of the kernel;
+                a program using few masks sets them all before it starts, as before
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+
+#include <openql.h>
+#include <utils.h>
+#include "test_harness.h"
+
+#define CFG_FILE_JSON_S17   "test_mapper_s17.json"
+#define CFG_FILE_JSON_S7    "hardware_config_cc_light.json"
+
+typedef std::vector<std::pair<std::string, std::vector<size_t>>> bundle_t;    // its instructions with their operands
+
+struct qisa_t
+{
+    std::map<std::string, std::vector<bundle_t>>    kernels;    // bundles by kernel name
+    size_t                                          prologue_sets = 0;  // masks set before the program starts
+    size_t                                          kernel_sets = 0;    // masks set in the kernels
+    bool                                            registers_in_range = true;
+};
+
+// the operands of each mask in a smis or smit instruction: {0, 1} or {(0, 1), (2, 3)}
+static std::vector<std::vector<size_t>> parse_mask(const std::string & s)
+{
+    std::vector<std::vector<size_t>> mask;
+    std::vector<size_t> numbers;
+    bool pairs = (s.find('(') != std::string::npos);
+    std::string n;
+    for (char c : s)
+    {
+        if (isdigit(c))
+        {
+            n += c;
+            continue;
+        }
+        if (!n.empty())
+        {
+            numbers.push_back(std::stoul(n));
+            n.clear();
+        }
+    }
+    for (size_t i = 0; i < numbers.size(); i += (pairs ? 2 : 1))
+    {
+        mask.push_back(pairs ? std::vector<size_t>{numbers[i], numbers[i+1]} : std::vector<size_t>{numbers[i]});
+    }
+    return mask;
+}
+
+// the bundles of the kernels in a QISA file, with the masks of the SIMD instructions expanded
+static qisa_t read_qisa(const std::string & fname)
+{
+    qisa_t qisa;
+    std::ifstream file(fname);
+    std::string line;
+    std::map<std::string, std::vector<std::vector<size_t>>> prologue;   // register contents set before start
+    std::map<std::string, std::vector<std::vector<size_t>>> regs;       // register contents in the current kernel
+    std::vector<bundle_t> * kernel = NULL;
+    bool started = false;
+    while (std::getline(file, line))
+    {
+        std::string trimmed = line.substr(std::min(line.size(), line.find_first_not_of(' ')));
+        if (trimmed.compare(0, 4, "smis") == 0 || trimmed.compare(0, 4, "smit") == 0)
+        {
+            std::string reg = trimmed.substr(5, trimmed.find(',') - 5);
+            size_t nregs = (reg[0] == 's' ? 32 : 64);
+            qisa.registers_in_range = qisa.registers_in_range && std::stoul(reg.substr(1)) < nregs;
+            (started ? regs : prologue)[reg] = parse_mask(trimmed.substr(trimmed.find('{')));
+            (started ? qisa.kernel_sets : qisa.prologue_sets)++;
+            continue;
+        }
+        if (!line.empty() && line[0] != ' ' && line.back() == ':')
+        {
+            // a kernel's label: no masks set in other kernels can be relied upon
+            std::string label = line.substr(0, line.size() - 1);
+            started = true;
+            regs = prologue;
+            kernel = (label == "start" ? NULL : &qisa.kernels[label]);
+            continue;
+        }
+        if (kernel == NULL || line.size() < 5 || !isdigit(line[4]))
+        {
+            continue;
+        }
+        // a bundle: pre-interval, then SIMD instructions separated by |
+        bundle_t bundle;
+        std::istringstream ss(trimmed);
+        size_t pre_interval;
+        ss >> pre_interval;
+        std::string instr, reg;
+        while (ss >> instr)
+        {
+            ss >> reg;
+            if (!reg.empty() && reg.back() == '|')
+            {
+                reg.pop_back();
+            }
+            for (auto & operands : regs[reg])
+            {
+                bundle.push_back(std::make_pair(instr, operands));
+            }
+            std::string bar;
+            ss >> bar;
+        }
+        std::sort(bundle.begin(), bundle.end());
+        kernel->push_back(bundle);
+    }
+    return qisa;
+}
+
+// the bundles of the scheduled kernel, with the cc_light_instr of each gate
+static std::vector<bundle_t> scheduled_bundles(const ql::quantum_kernel & k, const ql::quantum_platform & platform)
+{
+    std::map<size_t, bundle_t> bycycle;
+    for (auto gp : k.c)
+    {
+        if (gp->type() == ql::gate_type_t::__wait_gate__ || gp->type() == ql::gate_type_t::__dummy_gate__)
+        {
+            continue;
+        }
+        std::string instr = platform.instruction_settings[gp->name]["cc_light_instr"];
+        bycycle[gp->cycle].push_back(std::make_pair(instr, gp->operands));
+    }
+    std::vector<bundle_t> bundles;
+    for (auto & b : bycycle)
+    {
+        std::sort(b.second.begin(), b.second.end());
+        bundles.push_back(b.second);
+    }
+    return bundles;
+}
+
+// compile the program and check its QISA against its scheduled kernels
+static void check(const std::string & what, ql::quantum_program & prog, const ql::quantum_platform & platform,
+    bool expect_kernel_sets)
+{
+    prog.compile();
+    qisa_t qisa = read_qisa("test_output/" + prog.unique_name + ".qisa");
+
+    std::string error;
+    if (!qisa.registers_in_range)
+    {
+        error = "mask register out of range";
+    }
+    if (expect_kernel_sets != (qisa.kernel_sets != 0))
+    {
+        error = (expect_kernel_sets ? "expected masks set in the kernels" : "expected all masks set before the program");
+    }
+    for (auto & k : prog.kernels)
+    {
+        std::vector<bundle_t> expected = scheduled_bundles(k, platform);
+        if (!expected.empty() && qisa.kernels[k.name] != expected)
+        {
+            error = "instructions of kernel " + k.name + " differ from its scheduled gates";
+        }
+    }
+
+    ql_test::check(what, error.empty(), ": masks set before the program: " + std::to_string(qisa.prologue_sets)
+        + ", in the kernels: " + std::to_string(qisa.kernel_sets) + (error.empty() ? "" : ": " + error));
+}
+
+// layers of single-qubit gates on all qubits, each layer a random choice between x and y per qubit
+static void add_layers(ql::quantum_kernel & k, size_t qubit_count, size_t layer_count, std::mt19937 & gen)
+{
+    for (size_t l = 0; l < layer_count; l++)
+    {
+        for (size_t q = 0; q < qubit_count; q++)
+        {
+            k.gate((gen() % 2) ? "x" : "y", q);
+        }
+    }
+}
+
+// layers of czs on random disjoint edges of the platform
+static void add_cz_layers(ql::quantum_kernel & k, const ql::quantum_platform & platform, size_t layer_count, std::mt19937 & gen)
+{
+    std::vector<std::pair<size_t,size_t>> edges;
+    for (auto & e : platform.topology["edges"])
+    {
+        edges.push_back(std::make_pair(e["src"].get<size_t>(), e["dst"].get<size_t>()));
+    }
+    for (size_t l = 0; l < layer_count; l++)
+    {
+        std::set<size_t> busy;
+        for (size_t n = 0; n < 6; n++)
+        {
+            auto & e = edges[gen() % edges.size()];
+            if (busy.count(e.first) == 0 && busy.count(e.second) == 0)
+            {
+                k.gate("cz", {e.first, e.second});
+                busy.insert(e.first);
+                busy.insert(e.second);
+            }
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("output_dir", "test_output");
+    ql::options::set("write_qasm_files", "no");
+    ql::options::set("mapper", "no");
+    std::mt19937 gen(3);
+
+    {
+        ql::quantum_platform platform("s7", CFG_FILE_JSON_S7);
+        ql::quantum_program prog("test_masks_few", platform, 7, 0);
+        ql::quantum_kernel k("few", platform, 7, 0);
+        add_layers(k, 3, 10, gen);
+        k.gate("cz", {2, 0});
+        prog.add(k);
+        check("few masks", prog, platform, false);
+    }
+
+    {
+        ql::quantum_platform platform("s17", CFG_FILE_JSON_S17);
+        ql::quantum_program prog("test_masks_many", platform, 17, 0);
+        ql::quantum_kernel k1("single", platform, 17, 0);
+        add_layers(k1, 17, 60, gen);
+        prog.add(k1);
+        ql::quantum_kernel k2("loop", platform, 17, 0);
+        add_layers(k2, 17, 20, gen);
+        prog.add_for(k2, 100);
+        ql::quantum_kernel k3("two", platform, 17, 0);
+        add_cz_layers(k3, platform, 120, gen);
+        add_layers(k3, 17, 20, gen);
+        prog.add(k3);
+        check("many masks", prog, platform, true);
+    }
+
+    return ql_test::result();
+}
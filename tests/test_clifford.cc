@@ -0,0 +1,256 @@
+/*
+    file:       test_clifford.cc
+    notes:      test of the clifford optimizer (option clifford_prescheduler=yes)
+                on circuits with two-qubit clifford gates (cnot, cz):
+                the regions of clifford gates between non-clifford gates are resynthesized from their tableau
+                when this gives fewer two-qubit gates;
+                each optimized circuit is checked to be equivalent to its input up to a global phase
+                by simulating both on all basis states,
+                and to have two-qubit gates only between qubits that had one in the input;
+                uses the default gates, which have exact matrices
+*/
+#include <string>
+#include <vector>
+#include <set>
+#include <iostream>
+#include <complex>
+#include <random>
+
+#include <openql.h>
+#include <utils.h>
+#include <clifford.h>
+#include "test_harness.h"
+
+#define CFG_FILE_JSON   "test_cfg_none_simple.json"
+
+static const size_t nq = 3;
+struct gate_t
+{
+    std::string         name;
+    std::vector<size_t> qubits;
+};
+
+typedef std::vector<std::complex<double>> state_t;
+
+// the state after applying gate gp to psi
+static void simulate(state_t& psi, ql::gate* gp)
+{
+    if (gp->operands.size() == 1)
+    {
+        ql::cmat_t mat = gp->mat();
+        const ql::complex_t * m = mat.m;
+        size_t b = size_t(1) << gp->operands[0];
+        for (size_t i = 0; i < psi.size(); i++)
+        {
+            if ((i & b) == 0)
+            {
+                std::complex<double> a0 = psi[i];
+                std::complex<double> a1 = psi[i|b];
+                psi[i] = m[0]*a0 + m[1]*a1;
+                psi[i|b] = m[2]*a0 + m[3]*a1;
+            }
+        }
+        return;
+    }
+    size_t b0 = size_t(1) << gp->operands[0];
+    size_t b1 = size_t(1) << gp->operands[1];
+    for (size_t i = 0; i < psi.size(); i++)
+    {
+        if (gp->name == "cz" && (i & b0) && (i & b1))
+        {
+            psi[i] = -psi[i];
+        }
+        if (gp->name == "cnot" && (i & b0) && (i & b1) == 0)
+        {
+            std::swap(psi[i], psi[i|b1]);
+        }
+    }
+}
+
+// the unitary of a circuit, as its columns
+static std::vector<state_t> unitary(const ql::circuit& c)
+{
+    std::vector<state_t> u;
+    for (size_t k = 0; k < (size_t(1) << nq); k++)
+    {
+        state_t psi(size_t(1) << nq, 0);
+        psi[k] = 1;
+        for (auto gp : c)
+        {
+            simulate(psi, gp);
+        }
+        u.push_back(psi);
+    }
+    return u;
+}
+
+// whether two unitaries are equal up to a global phase;
+// the matrices of the gates have float precision
+static bool equivalent(const std::vector<state_t>& u, const std::vector<state_t>& v)
+{
+    std::complex<double> phase = 0;
+    for (size_t i = 0; i < u[0].size(); i++)
+    {
+        phase += std::conj(u[0][i]) * v[0][i];
+    }
+    for (size_t k = 0; k < u.size(); k++)
+    {
+        for (size_t i = 0; i < u[k].size(); i++)
+        {
+            if (std::abs(phase * u[k][i] - v[k][i]) > 1e-4)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static std::set<std::pair<size_t,size_t>> pairs(const ql::circuit& c)
+{
+    std::set<std::pair<size_t,size_t>> p;
+    for (auto gp : c)
+    {
+        if (gp->operands.size() == 2)
+        {
+            p.insert(std::make_pair(std::min(gp->operands[0], gp->operands[1]), std::max(gp->operands[0], gp->operands[1])));
+        }
+    }
+    return p;
+}
+
+static size_t count_2q(const ql::circuit& c)
+{
+    size_t n = 0;
+    for (auto gp : c)
+    {
+        n += (gp->operands.size() == 2);
+    }
+    return n;
+}
+
+// check the clifford optimization of the kernel with the given gates;
+// when expected_2q is not negative, it is the expected number of two-qubit gates in the output
+static void check(const std::string& what, const std::vector<gate_t>& gates, int expected_2q, bool verbose = true)
+{
+    ql::quantum_platform platform("none", CFG_FILE_JSON);
+    ql::quantum_program prog("test_clifford", platform, nq, 0);
+    ql::quantum_kernel k("k", platform, nq, 0);
+    bool simulatable = true;
+    for (auto & g : gates)
+    {
+        k.gate(g.name, g.qubits);
+        simulatable = simulatable && g.name != "measure";
+    }
+    prog.add(k);
+    ql::circuit input = prog.kernels.front().c;
+
+    ql::options::set("clifford_prescheduler", "yes");
+    ql::clifford_optimize(&prog, platform, "clifford_prescheduler");
+    ql::options::set("clifford_prescheduler", "no");
+    ql::circuit output = prog.kernels.front().c;
+
+    std::string qasm;
+    for (auto & gp : output)
+    {
+        qasm += (qasm.empty() ? "" : "; ") + gp->qasm();
+    }
+
+    std::string error;
+    std::set<std::pair<size_t,size_t>> input_pairs = pairs(input);
+    for (auto & p : pairs(output))
+    {
+        if (input_pairs.count(p) == 0)
+        {
+            error = "two-qubit gate between new pair of qubits";
+        }
+    }
+    if (count_2q(output) > count_2q(input))
+    {
+        error = "more two-qubit gates";
+    }
+    if (expected_2q >= 0 && count_2q(output) != size_t(expected_2q))
+    {
+        error = "expected " + std::to_string(expected_2q) + " two-qubit gates";
+    }
+    if (simulatable && !equivalent(unitary(input), unitary(output)))
+    {
+        error = "not equivalent";
+    }
+
+    ql_test::check(what, error.empty(), ": [" + qasm + "]" + (error.empty() ? "" : ": " + error), !verbose);
+}
+
+static const std::vector<std::string> gates1q = {"x", "y", "z", "h", "s", "sdag", "rx90", "mrx90", "ry90", "mry90"};
+
+static std::string inverse(const std::string& name)
+{
+    if (name == "s") return "sdag";
+    if (name == "sdag") return "s";
+    if (name == "rx90") return "mrx90";
+    if (name == "mrx90") return "rx90";
+    if (name == "ry90") return "mry90";
+    if (name == "mry90") return "ry90";
+    return name;
+}
+
+// random clifford circuit of gate_count gates on nq qubits
+static std::vector<gate_t> random_circuit(std::mt19937& gen, size_t gate_count)
+{
+    std::vector<gate_t> gates;
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 4;
+        if (r == 0)
+        {
+            size_t q0 = gen() % nq;
+            size_t q1 = (q0 + 1 + gen() % (nq - 1)) % nq;
+            gates.push_back({(gen() % 2) ? "cz" : "cnot", {q0, q1}});
+        }
+        else
+        {
+            gates.push_back({gates1q[gen() % gates1q.size()], {gen() % nq}});
+        }
+    }
+    return gates;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+
+    check("single-qubit", {{"x", {0}}, {"y", {0}}, {"h", {1}}}, 0);
+    check("collapse", {{"h", {0}}, {"cnot", {0, 1}}, {"s", {1}}, {"sdag", {1}}, {"cnot", {0, 1}}, {"h", {0}}}, 0);
+    check("cz cz", {{"cz", {0, 1}}, {"h", {2}}, {"cz", {1, 0}}}, 0);
+    check("three czs", {{"cz", {0, 1}}, {"cz", {0, 1}}, {"cz", {0, 1}}}, 1);
+    check("swap", {{"cnot", {0, 1}}, {"cnot", {1, 0}}, {"cnot", {0, 1}}}, 3);
+    check("cnot as cz", {{"h", {1}}, {"cnot", {0, 1}}, {"h", {1}}, {"cz", {0, 1}}}, 0);
+    check("chain", {{"cnot", {0, 1}}, {"cnot", {1, 2}}, {"cnot", {0, 1}}, {"cnot", {1, 2}}}, -1);
+    check("t splits region", {{"cnot", {0, 1}}, {"t", {1}}, {"cnot", {0, 1}}}, 2);
+    check("measure splits region", {{"cnot", {0, 1}}, {"measure", {1}}, {"cnot", {0, 1}}}, 2);
+
+    // randomized benchmarking: a random clifford circuit followed by its inverse is the identity
+    std::mt19937 gen(5);
+    for (size_t n = 0; n < 10; n++)
+    {
+        std::vector<gate_t> gates = random_circuit(gen, 40);
+        for (size_t i = gates.size(); i-- > 0; )
+        {
+            gates.push_back({inverse(gates[i].name), gates[i].qubits});
+        }
+        check("randomized benchmarking " + std::to_string(n), gates, 0, false);
+    }
+
+    // random clifford circuits, sometimes with a t gate
+    for (size_t n = 0; n < 200; n++)
+    {
+        std::vector<gate_t> gates = random_circuit(gen, 5 + gen() % 40);
+        if (n % 3 == 0)
+        {
+            gates.insert(gates.begin() + gen() % gates.size(), {"t", {gen() % nq}});
+        }
+        check("random " + std::to_string(n), gates, -1, false);
+    }
+
+    return ql_test::result();
+}
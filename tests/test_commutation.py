@@ -173,5 +173,48 @@ class Test_commutation(unittest.TestCase):
         qasm_fn = os.path.join(output_dir, p.name+'_scheduledqasmwriter_out.qasm')
         self.assertTrue( file_compare(qasm_fn, gold_fn) )
 
+    # cs is a custom gate that declares by its "signature" attribute in test_179.json
+    # that it commutes as cz, so it should be scheduled as cz in test_cz_anycommute
+    def test_custom_signature_commute(self):
+        config_fn = os.path.join(curdir, 'test_179.json')
+        platf = ql.Platform("starmon", config_fn)
+        ql.set_option("scheduler", 'ALAP');
+        ql.set_option("scheduler_post179", 'yes');
+        ql.set_option("scheduler_commute", 'yes');
+
+        nqubits = 7
+        k = ql.Kernel("aKernel", platf, nqubits)
+
+        k.gate("cs", [0,3]);
+        k.gate("cs", [3,6]);
+        k.gate("t", [6]);
+        k.gate("y", [6]);
+        k.gate("cs", [1,3]);
+        k.gate("t", [1]);
+        k.gate("y", [1]);
+        k.gate("t", [1]);
+        k.gate("y", [1]);
+        k.gate("cs", [3,5]);
+        k.gate("t", [5]);
+        k.gate("y", [5]);
+        k.gate("t", [5]);
+        k.gate("y", [5]);
+        k.gate("t", [5]);
+        k.gate("y", [5]);
+
+        sweep_points = [2]
+
+        p = ql.Program("test_custom_signature_commute", platf, nqubits)
+        p.set_sweep_points(sweep_points)
+        p.add_kernel(k)
+        p.compile()
+
+        qasm_fn = os.path.join(output_dir, p.name+'_scheduledqasmwriter_out.qasm')
+        renamed_fn = os.path.join(output_dir, p.name+'_renamed.qasm')
+        with open(qasm_fn) as f, open(renamed_fn, 'w') as g:
+            g.write(f.read().replace('cs q', 'cz q'))
+        gold_fn = rootDir + '/golden/test_cz_anycommute_scheduled.qasm'
+        self.assertTrue( file_compare(renamed_fn, gold_fn) )
+
 if __name__ == '__main__':
     unittest.main()
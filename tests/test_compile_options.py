@@ -0,0 +1,186 @@
+# tests of the options cancel_prescheduler, mapper=beam, scheduler_gapfill, release_gates and unitary_decomposition_cache
+#
+# each test compiles the same program with different values of the option and compares the results;
+# the options are set per program, so that the programs of a test don't depend on the global options,
+# which are reset at the end of each compilation
+
+from openql import openql as ql
+import math
+import os
+import re
+import unittest
+from utils import file_compare
+
+curdir = os.path.dirname(__file__)
+output_dir = os.path.join(curdir, 'test_output')
+
+def read_file(fn):
+    with open(fn) as f:
+        return f.read()
+
+class Test_compile_options(unittest.TestCase):
+
+    def setUp(self):
+        ql.set_option('output_dir', output_dir)
+        ql.set_option('log_level', 'LOG_NOTHING')
+        ql.set_option('optimize', 'no')
+        ql.set_option('use_default_gates', 'yes')
+        ql.set_option('decompose_toffoli', 'no')
+        ql.set_option('scheduler', 'ALAP')
+        ql.set_option('scheduler_uniform', 'no')
+        ql.set_option('write_qasm_files', 'no')
+        ql.set_option('write_report_files', 'no')
+
+    def program(self, name, platform, nqubits, subdir, options):
+        # program with output in output_dir/subdir and the given options
+        outdir = os.path.join(output_dir, subdir)
+        p = ql.Program(name, platform, nqubits)
+        p.set_option('output_dir', outdir)
+        for option, value in options:
+            p.set_option(option, value)
+        return p, outdir
+
+    def compile_cancel(self, value):
+        config_fn = os.path.join(curdir, 'test_cfg_none_simple.json')
+        platform = ql.Platform('platform_none', config_fn)
+        nqubits = 3
+        p, outdir = self.program('test_cancel_prescheduler', platform, nqubits, 'cancel_prescheduler_' + value,
+            [('write_qasm_files', 'yes'), ('cancel_prescheduler', value)])
+        k = ql.Kernel('aKernel', platform, nqubits)
+        # the cnots cancel since the x on their target commutes with them; s and sdag cancel directly
+        k.gate('cnot', [0, 1])
+        k.gate('x', [1])
+        k.gate('cnot', [0, 1])
+        k.gate('s', [2])
+        k.gate('sdag', [2])
+        p.add_kernel(k)
+        p.compile()
+        return read_file(os.path.join(outdir, p.name + '_scheduledqasmwriter_out.qasm'))
+
+    def test_cancel_prescheduler(self):
+        cancelled = self.compile_cancel('yes')
+        self.assertNotIn('cnot', cancelled)
+        self.assertNotIn('sdag', cancelled)
+        self.assertIn('x q[1]', cancelled)
+
+        kept = self.compile_cancel('no')
+        self.assertIn('cnot', kept)
+        self.assertIn('sdag', kept)
+
+    def compile_map(self, subdir, options):
+        config_fn = os.path.join(curdir, 'test_mapper_s17.json')
+        platform = ql.Platform('starmon', config_fn)
+        nqubits = 17
+        p, outdir = self.program('test_mapper_beam', platform, nqubits, subdir,
+            [('write_qasm_files', 'yes'), ('mapinitone2one', 'yes'), ('clifford_premapper', 'no'),
+             ('clifford_postmapper', 'no')] + options)
+        k = ql.Kernel('aKernel', platform, nqubits)
+        # two-qubit gates between qubits that are not neighbors, so that routing is needed
+        for q0, q1 in [(0, 16), (2, 13), (5, 11), (8, 1), (15, 3), (6, 9), (12, 4), (14, 7)]:
+            k.gate('cnot', [q0, q1])
+            k.gate('x', [q0])
+            k.gate('cz', [q1, q0])
+        p.add_kernel(k)
+        p.compile()
+        return os.path.join(outdir, p.name + '_mapper_out.qasm')
+
+    def test_mapper_beam(self):
+        # a beam of width 1 is the minextendrc mapper that takes the first of equally good alternatives
+        beam_fn = self.compile_map('mapper_beam_1', [('mapper', 'beam'), ('mapbeamwidth', '1')])
+        minextendrc_fn = self.compile_map('mapper_minextendrc', [('mapper', 'minextendrc'), ('maptiebreak', 'first')])
+        self.assertTrue(file_compare(beam_fn, minextendrc_fn))
+
+        # a wider beam, ranking on fidelity, still maps all gates
+        wide_fn = self.compile_map('mapper_beam_4', [('mapper', 'beam'), ('mapbeamwidth', '4'), ('mapbeamrank', 'fidelity')])
+        self.assertEqual(read_file(wide_fn).count('cnot'), read_file(beam_fn).count('cnot'))
+
+    def compile_gapfill(self, value):
+        config_fn = os.path.join(curdir, 'test_mapper_s7.json')
+        platform = ql.Platform('starmon', config_fn)
+        nqubits = 7
+        p, outdir = self.program('test_scheduler_gapfill', platform, nqubits, 'scheduler_gapfill_' + value,
+            [('write_report_files', 'yes'), ('scheduler_gapfill', value)])
+        k = ql.Kernel('aKernel', platform, nqubits)
+        # two-qubit gates on neighbors with single-qubit gates in between, leaving gaps to fill
+        edges = [(2, 0), (0, 3), (3, 1), (1, 4), (2, 5), (5, 3), (3, 6), (6, 4)]
+        for r in range(3):
+            for i, (q0, q1) in enumerate(edges):
+                k.gate('cz', [q0, q1])
+                k.gate('x' if (i + r) % 2 == 0 else 'y', [(q1 + r) % nqubits])
+                k.gate('h', [(q0 + i) % nqubits])
+        p.add_kernel(k)
+        p.compile()
+        return read_file(os.path.join(outdir, p.name + '_rcscheduler_out.report'))
+
+    def test_scheduler_gapfill(self):
+        filled = self.compile_gapfill('yes')
+        without = int(re.search(r'Total depth without gap filling: (\d+)', filled).group(1))
+        with_ = int(re.search(r'Total depth with gap filling: (\d+)', filled).group(1))
+        # of the schedules with and without filling gaps, the shorter one is kept
+        self.assertLessEqual(with_, without)
+
+        unfilled = self.compile_gapfill('no')
+        self.assertNotIn('gap filling', unfilled)
+        latency_filled = int(re.search(r'Total circuit_latency: (\d+)', filled).group(1))
+        latency_unfilled = int(re.search(r'Total circuit_latency: (\d+)', unfilled).group(1))
+        self.assertLessEqual(latency_filled, latency_unfilled)
+
+    def compile_release(self, value):
+        config_fn = os.path.join(curdir, 'hardware_config_cc_light.json')
+        platform = ql.Platform('seven_qubits_chip', config_fn)
+        nqubits = 7
+        p, outdir = self.program('test_release_gates', platform, nqubits, 'release_gates_' + value,
+            [('release_gates', value)])
+        for i in range(2):
+            k = ql.Kernel('aKernel' + str(i), platform, nqubits)
+            k.prepz(0)
+            k.gate('x', [i])
+            k.gate('cz', [2, 0])
+            k.measure(0)
+            p.add_kernel(k)
+        p.compile()
+        return os.path.join(outdir, p.name + '.qisa')
+
+    def test_release_gates(self):
+        # releasing the gates at the end of the compilation doesn't change its output
+        released_fn = self.compile_release('yes')
+        kept_fn = self.compile_release('no')
+        self.assertTrue(file_compare(released_fn, kept_fn))
+
+    def compile_unitary(self, value):
+        config_fn = os.path.join(curdir, 'test_cfg_none_simple.json')
+        platform = ql.Platform('platform_none', config_fn)
+        nqubits = 2
+        p, outdir = self.program('test_unitary_decomposition_cache', platform, nqubits, 'unitary_cache_' + value,
+            [('write_qasm_files', 'yes')])
+        # decompose runs before the compilation, so with the global options
+        ql.set_option('output_dir', outdir)
+        ql.set_option('unitary_decomposition_cache', value)
+        # a controlled rotation by an angle that no other test uses, so that it isn't in the cache yet
+        c, s = math.cos(0.4321), math.sin(0.4321)
+        matrix = [complex(1.0, 0.0), complex(0.0, 0.0), complex(0.0, 0.0), complex(0.0, 0.0),
+                  complex(0.0, 0.0), complex(1.0, 0.0), complex(0.0, 0.0), complex(0.0, 0.0),
+                  complex(0.0, 0.0), complex(0.0, 0.0), complex(c, 0.0), complex(-s, 0.0),
+                  complex(0.0, 0.0), complex(0.0, 0.0), complex(s, 0.0), complex(c, 0.0)]
+        for i in range(2):
+            # a new unitary with the same matrix in each kernel, of which the second can reuse the decomposition
+            u = ql.Unitary('u' + str(i), matrix)
+            u.decompose()
+            k = ql.Kernel('aKernel' + str(i), platform, nqubits)
+            k.gate(u, [0, 1])
+            p.add_kernel(k)
+        p.compile()
+        return os.path.join(outdir, p.name + '_initialqasmwriter_out.qasm'), outdir
+
+    @unittest.skipUnless(ql.Unitary.is_decompose_support_enabled(), "unitary decomposition not supported")
+    def test_unitary_decomposition_cache(self):
+        # on disk first, since a decomposition that is in memory already is not written to disk again
+        disk_fn, disk_dir = self.compile_unitary('disk')
+        cached_fn, _ = self.compile_unitary('yes')
+        uncached_fn, _ = self.compile_unitary('no')
+        self.assertTrue(file_compare(uncached_fn, cached_fn))
+        self.assertTrue(file_compare(uncached_fn, disk_fn))
+        self.assertTrue(os.path.isfile(os.path.join(disk_dir, 'unitary_decomposition_cache.txt')))
+
+if __name__ == '__main__':
+    unittest.main()
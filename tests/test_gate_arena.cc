@@ -0,0 +1,159 @@
+/*
+    file:       test_gate_arena.cc
+    notes:      test of the ownership of gates by gate arenas:
+                the gates created while compiling a program are owned by the arena of the program,
+                which outlives its kernels; the gates added to a kernel outside compilation are on the heap;
+                with option release_gates=yes, the program's gates are released at the end of the compilation,
+                leaving the kernels of the program empty and the kernels that were added to it untouched,
+                both with compile and with compile_modular;
+                threads allocate gates in a shared arena and delete each other's
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <thread>
+
+#include <openql.h>
+#include <utils.h>
+#include <gate_arena.h>
+#include "test_harness.h"
+
+#define CFG_FILE_JSON   "test_cfg_none_simple.json"
+
+using ql_test::check;
+
+static std::string qasm(const ql::circuit& c)
+{
+    std::string s;
+    for (auto & gp : c)
+    {
+        s += (s.empty() ? "" : "; ") + gp->qasm();
+    }
+    return s;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::quantum_platform platform("none", CFG_FILE_JSON);
+
+    // arena on its own
+    {
+        ql::gate_arena arena;
+        ql::gate * kept;
+        ql::gate * deleted;
+        {
+            ql::gate_arena::scope arena_scope(&arena);
+            kept = new ql::hadamard(0);
+            deleted = new ql::cnot(0, 1);
+            {
+                ql::gate_arena other;
+                ql::gate_arena::scope other_scope(&other);
+                delete new ql::pauli_x(0);
+                check("inner scope makes its arena current", other.gate_count() == 0 && other.memory_size() > 0);
+            }
+            check("end of scope restores the current arena", ql::gate_arena::current() == &arena);
+        }
+        ql::gate * heap = new ql::pauli_x(1);
+        check("gates are allocated in the current arena", arena.gate_count() == 2);
+        delete deleted;
+        delete heap;
+        check("deleted gates leave the arena", arena.gate_count() == 1 && kept->qasm() == "h q[0]");
+        arena.release();
+        check("release frees the arena", arena.gate_count() == 0 && arena.memory_size() == 0);
+    }
+
+    // threads sharing an arena, each filling blocks of its own
+    {
+        ql::gate_arena arena;
+        const size_t nthreads = 4;
+        const size_t ngates = 20000;
+        std::vector<std::vector<ql::gate *>> created(nthreads);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nthreads; t++)
+        {
+            threads.emplace_back([&arena, &created, t, ngates]()
+            {
+                ql::gate_arena::scope arena_scope(&arena);
+                for (size_t i = 0; i < ngates; i++)
+                {
+                    created[t].push_back(new ql::cnot(t, i % 7 + 10));
+                }
+            });
+        }
+        for (auto & th : threads)
+        {
+            th.join();
+        }
+        check("threads allocate in the shared arena", arena.gate_count() == nthreads * ngates);
+        bool intact = true;
+        for (size_t t = 0; t < nthreads; t++)
+        {
+            for (size_t i = 0; i < ngates; i++)
+            {
+                auto gp = created[t][i];
+                intact = intact && gp->operands[0] == t && gp->operands[1] == i % 7 + 10;
+            }
+        }
+        check("gates of different threads don't overlap", intact);
+        // delete the gates of one thread from another one, outside any arena scope
+        std::thread deleter([&created]()
+        {
+            for (auto gp : created[0])
+            {
+                delete gp;
+            }
+        });
+        deleter.join();
+        check("gates are deleted by other threads", arena.gate_count() == (nthreads - 1) * ngates);
+    }
+
+    // kernel and program
+    ql::quantum_kernel k("k", platform, 3, 0);
+    k.gate("x", 0);
+    k.toffoli(0, 1, 2);
+    k.gate("cnot", std::vector<size_t>{1, 2});
+    std::string kernel_qasm = qasm(k.c);
+    check("gates of a kernel outside compilation are on the heap", ql::gate_arena::current() == nullptr);
+
+    {
+        ql::quantum_program prog("test_gate_arena", platform, 3, 0);
+        prog.add(k);
+        prog.set_option("decompose_toffoli", "NC");
+        prog.compile();
+        check("compilation creates its gates in the program's arena", prog.arena->gate_count() > 0);
+        check("compiled kernel", prog.kernels.front().c.size() > 3);
+        // the program's kernels and their dependence graph are destroyed before its arena
+    }
+    check("program destroyed", true);
+
+    {
+        ql::quantum_program prog("test_gate_arena", platform, 3, 0);
+        prog.add(k);
+        prog.set_option("decompose_toffoli", "NC");
+        prog.set_option("release_gates", "yes");
+        prog.compile();
+        check("release_gates releases the program's gates", prog.arena->gate_count() == 0 && prog.arena->memory_size() == 0);
+        check("release_gates empties the program's kernels", prog.kernels.front().c.empty() && !prog.kernels.front().ddg.graph);
+    }
+
+    {
+        ql::quantum_program prog("test_gate_arena", platform, 3, 0);
+        prog.add(k);
+        prog.set_option("decompose_toffoli", "NC");
+        prog.compile_modular();
+        check("compile_modular creates its gates in the program's arena", prog.arena->gate_count() > 0);
+    }
+
+    {
+        ql::quantum_program prog("test_gate_arena", platform, 3, 0);
+        prog.add(k);
+        prog.set_option("decompose_toffoli", "NC");
+        prog.set_option("release_gates", "yes");
+        prog.compile_modular();
+        check("compile_modular with release_gates releases the program's gates", prog.arena->gate_count() == 0 && prog.arena->memory_size() == 0);
+    }
+    check("added kernel is untouched", qasm(k.c) == kernel_qasm);
+
+    return ql_test::result();
+}
@@ -0,0 +1,47 @@
+/*
+    file:       test_harness.h
+    notes:      the checks of the C++ tests that consist of a series of independent checks:
+                each check prints whether it is ok or FAILED with what was checked and optional details,
+                and the failed ones are counted; main returns result(), which prints the summary
+                and is the exit status of the test
+*/
+#ifndef QL_TEST_HARNESS_H
+#define QL_TEST_HARNESS_H
+
+#include <string>
+#include <iostream>
+
+namespace ql_test
+{
+
+// the number of checks that failed
+inline int & failures()
+{
+    static int count = 0;
+    return count;
+}
+
+// report a check: what was checked, followed by detail; quiet reports only when it failed
+inline bool check(const std::string & what, bool ok, const std::string & detail = "", bool quiet = false)
+{
+    if (!ok)
+    {
+        failures()++;
+    }
+    if (!ok || !quiet)
+    {
+        std::cout << (ok ? "ok: " : "FAILED: ") << what << detail << std::endl;
+    }
+    return ok;
+}
+
+// print the summary of the checks, and return the exit status of the test
+inline int result()
+{
+    std::cout << (failures() == 0 ? "all tests passed" : std::to_string(failures()) + " tests FAILED") << std::endl;
+    return (failures() == 0 ? 0 : 1);
+}
+
+} // ql_test
+
+#endif // QL_TEST_HARNESS_H
@@ -0,0 +1,160 @@
+/*
+    file:       test_mapper_beam.cc
+    notes:      test of mapper=beam:
+                with a beam width of 1, its output must be identical to that of minextendrc with maptiebreak=first;
+                with a larger beam width, and with a time limit that is exceeded, it must map the circuit as well;
+                the depths of the mapped circuits are reported;
+                finally, a cnot between qubits with two shortest paths between them is routed
+                along the path through the qubit that is free earlier when ranking by cycle extension (mapbeamrank=extension),
+                and along the path through the qubit with the higher estimated fidelity when ranking by fidelity
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <map>
+
+#include <openql.h>
+#include <utils.h>
+
+#define CFG_FILE_JSON   "test_mapper_s17.json"
+
+// generate a circuit of gate_count gates with two-qubit gates between any qubits, so that it must be mapped;
+// only the raw output of the random number generator is used, which is the same on all platforms
+static void generate(ql::quantum_kernel& k, size_t qubit_count, size_t gate_count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    const std::vector<std::string> gates1q = {"x", "y", "x90", "ym90", "h", "z", "s", "t"};
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 16;
+        if (r < 5)
+        {
+            size_t q0 = gen() % qubit_count;
+            size_t q1 = (q0 + 1 + gen() % (qubit_count - 1)) % qubit_count;
+            k.gate((r < 3) ? "cz" : "cnot", {q0, q1});
+        }
+        else
+        {
+            k.gate(gates1q[gen() % gates1q.size()], {gen() % qubit_count});
+        }
+    }
+}
+
+// map a program with the given mapper options into the given output directory and return the depth of its kernels
+static size_t compile(const std::map<std::string, std::string>& options, const std::string& outdir)
+{
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+    size_t nq = platform.qubit_number;
+    ql::quantum_program prog("test_mapper_beam", platform, nq, 0);
+    prog.set_option("output_dir", outdir);
+    prog.set_option("write_qasm_files", "yes");
+    prog.set_option("mapinitone2one", "yes");
+    for (auto & o : options)
+    {
+        prog.set_option(o.first, o.second);
+    }
+    for (unsigned k = 0; k < 2; k++)
+    {
+        ql::quantum_kernel kernel("k" + std::to_string(k), platform, nq, 0);
+        generate(kernel, nq, 100, 500 + k);
+        prog.add(kernel);
+    }
+    prog.compile();
+
+    size_t depth = 0;
+    for (auto & kernel : prog.kernels)
+    {
+        depth += (kernel.c.empty() ? 0 : kernel.c.back()->cycle);
+    }
+    return depth;
+}
+
+static std::string read_file(const std::string& fname)
+{
+    std::ifstream in(fname);
+    std::stringstream content;
+    content << in.rdbuf();
+    return (in ? content.str() : "");
+}
+
+// route cnot(0,6) on s17, of which the shortest paths are through qubit 2 and through qubit 3;
+// qubit 2 is free earlier but has a low estimated fidelity after the cz gates with qubit 5,
+// qubit 3 is busy longer with single-qubit gates but keeps a higher fidelity;
+// decoherence is made negligible, so that the fidelity is determined by the gates;
+// returns the qubit through which the cnot was routed, or 0 when this couldn't be told
+static size_t route(const std::string& rank, const std::string& outdir)
+{
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+    platform.hardware_settings["decoherence_time"] = 1e12;
+    size_t nq = platform.qubit_number;
+    ql::quantum_program prog("test_mapper_beam_route", platform, nq, 0);
+    prog.set_option("output_dir", outdir);
+    prog.set_option("write_qasm_files", "yes");
+    prog.set_option("mapinitone2one", "yes");
+    prog.set_option("mapper", "beam");
+    prog.set_option("mapbeamrank", rank);
+    ql::quantum_kernel kernel("k", platform, nq, 0);
+    for (size_t i = 0; i < 3; i++)
+    {
+        kernel.gate("cz", {2, 5});
+    }
+    for (size_t i = 0; i < 20; i++)
+    {
+        kernel.gate("x", {3});
+    }
+    kernel.gate("cnot", {0, 6});
+    prog.add(kernel);
+    prog.compile();
+
+    std::string mapped = read_file(outdir + "/test_mapper_beam_route_mapper_out.qasm");
+    bool via2 = (mapped.find("q[0],q[2]") != std::string::npos || mapped.find("q[2],q[0]") != std::string::npos
+        || mapped.find("q[2],q[6]") != std::string::npos || mapped.find("q[6],q[2]") != std::string::npos);
+    bool via3 = (mapped.find("q[0],q[3]") != std::string::npos || mapped.find("q[3],q[0]") != std::string::npos
+        || mapped.find("q[3],q[6]") != std::string::npos || mapped.find("q[6],q[3]") != std::string::npos);
+    return (via2 == via3 ? 0 : (via2 ? 2 : 3));
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+
+    size_t depth_minextendrc = compile({{"mapper", "minextendrc"}, {"maptiebreak", "first"}}, "test_output/test_mapper_beam_minextendrc");
+    size_t depth_beam1 = compile({{"mapper", "beam"}, {"mapbeamwidth", "1"}}, "test_output/test_mapper_beam_1");
+    std::string minextendrc = read_file("test_output/test_mapper_beam_minextendrc/test_mapper_beam_mapper_out.qasm");
+    std::string beam1 = read_file("test_output/test_mapper_beam_1/test_mapper_beam_mapper_out.qasm");
+    if (minextendrc.empty() || minextendrc != beam1)
+    {
+        std::cout << "test_mapper_beam: mapbeamwidth=1 differs from minextendrc with maptiebreak=first" << std::endl;
+        return 1;
+    }
+
+    size_t depth_beam4 = compile({{"mapper", "beam"}, {"mapbeamwidth", "4"}}, "test_output/test_mapper_beam_4");
+    size_t depth_beam4t = compile({{"mapper", "beam"}, {"mapbeamwidth", "4"}, {"mapbeamtime", "1"}}, "test_output/test_mapper_beam_4t");
+    for (std::string dir : {"test_mapper_beam_4", "test_mapper_beam_4t"})
+    {
+        if (read_file("test_output/" + dir + "/test_mapper_beam_mapper_out.qasm").empty())
+        {
+            std::cout << "test_mapper_beam: no output in " << dir << std::endl;
+            return 1;
+        }
+    }
+
+    size_t byextension = route("extension", "test_output/test_mapper_beam_extension");
+    size_t byfidelity = route("fidelity", "test_output/test_mapper_beam_fidelity");
+    if (byextension != 2 || byfidelity != 3)
+    {
+        std::cout << "test_mapper_beam: cnot routed through qubit " << byextension << " by extension and through qubit "
+            << byfidelity << " by fidelity instead of through 2 and 3" << std::endl;
+        return 1;
+    }
+
+    std::cout << "test_mapper_beam: depth minextendrc=" << depth_minextendrc
+        << " beam width 1=" << depth_beam1
+        << " beam width 4=" << depth_beam4
+        << " beam width 4 after 1 ms=" << depth_beam4t
+        << std::endl;
+    return 0;
+}
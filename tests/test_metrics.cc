@@ -0,0 +1,158 @@
+/*
+    file:       test_metrics.cc
+    notes:      test of the fidelity estimator used by mapper=maxfidelity:
+                the incremental fidelity_accumulator_t must give exactly the same fidelity
+                as Metrics::bounded_fidelity on the same scheduled circuit,
+                also when the gates of different qubits are added out of cycle order;
+                the estimator parameters must be taken from the platform configuration when specified there;
+                and mapping with mapper=maxfidelity must give a correctly mapped circuit
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+#include <openql.h>
+#include <utils.h>
+#include <metrics.h>
+#include "test_harness.h"
+
+#define CFG_FILE_JSON   "test_mapper_s17.json"
+
+using ql_test::check;
+
+// generate a circuit of gate_count random gates on qubit_count qubits
+// and give each gate an ASAP cycle, with the first cycle being 1 as in the mapper
+static void generate(ql::quantum_kernel& k, size_t qubit_count, size_t gate_count, unsigned seed, size_t cycle_time)
+{
+    std::mt19937 gen(seed);
+    const std::vector<std::string> gates1q = {"x", "y", "x90", "ym90", "h", "prepz", "measure"};
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 16;
+        if (r < 5)
+        {
+            size_t q0 = gen() % qubit_count;
+            size_t q1 = (q0 + 1 + gen() % (qubit_count - 1)) % qubit_count;
+            k.gate("cz", {q0, q1});
+        }
+        else
+        {
+            k.gate(gates1q[gen() % gates1q.size()], {gen() % qubit_count});
+        }
+    }
+
+    std::vector<size_t> freecycle(qubit_count, 1);
+    for (auto & gp : k.c)
+    {
+        size_t cycle = 1;
+        for (auto q : gp->operands)
+        {
+            cycle = std::max(cycle, freecycle[q]);
+        }
+        gp->cycle = cycle;
+        for (auto q : gp->operands)
+        {
+            freecycle[q] = cycle + (gp->duration + cycle_time - 1) / cycle_time;
+        }
+    }
+}
+
+static void test_accumulator(const ql::quantum_platform& platform, size_t gate_count, unsigned seed)
+{
+    size_t nq = platform.qubit_number;
+    ql::fidelity_parameters_t params = ql::fidelity_parameters(platform);
+    ql::quantum_kernel k("k", platform, nq, 0);
+    generate(k, nq, gate_count, seed, params.cycle_time);
+
+    // bounded_fidelity takes the circuit ordered by cycle, like the past of the mapper
+    ql::circuit ordered = k.c;
+    std::stable_sort(ordered.begin(), ordered.end(), [](ql::gate* g1, ql::gate* g2) { return g1->cycle < g2->cycle; });
+    ql::Metrics estimator(nq, params);
+    std::vector<double> fids;
+    double expected = estimator.bounded_fidelity(ordered, fids);
+
+    // the accumulator gets the gates in the order in which they were scheduled
+    ql::fidelity_accumulator_t fa;
+    fa.Init(nq, params);
+    for (auto & gp : k.c)
+    {
+        fa.Add(gp, gp->cycle);
+    }
+    double got = fa.Fidelity();
+
+    std::cout << "gates=" << gate_count << " seed=" << seed << " bounded_fidelity=" << expected << " accumulator=" << got << std::endl;
+    check("accumulator equals bounded_fidelity, " + std::to_string(gate_count) + " gates", expected == got);
+    check("fidelity in (0,1], " + std::to_string(gate_count) + " gates", expected > 0 && expected <= 1);
+
+    fa.clear();
+    check("fidelity is 1 after clear", fa.Fidelity() == 1.0);
+}
+
+static void test_parameters()
+{
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+    ql::fidelity_parameters_t defaults = ql::fidelity_parameters(platform);
+    check("default parameters", defaults.gatefid_1 == 0.999 && defaults.gatefid_2 == 0.99 && defaults.decoherence_time == 3000.0/20);
+
+    platform.hardware_settings["gate_fidelity_1q"] = 0.9995;
+    platform.hardware_settings["gate_fidelity_2q"] = 0.98;
+    platform.hardware_settings["decoherence_time"] = 20000;
+    ql::fidelity_parameters_t params = ql::fidelity_parameters(platform);
+    check("parameters from hardware_settings", params.gatefid_1 == 0.9995 && params.gatefid_2 == 0.98 && params.decoherence_time == 1000.0);
+}
+
+static void test_mapper()
+{
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+    size_t nq = platform.qubit_number;
+    ql::quantum_program prog("test_metrics", platform, nq, 0);
+    prog.set_option("mapper", "maxfidelity");
+    prog.set_option("mapinitone2one", "yes");
+    ql::quantum_kernel k("k", platform, nq, 0);
+    std::mt19937 gen(7);
+    for (size_t i = 0; i < 100; i++)
+    {
+        size_t q0 = gen() % nq;
+        size_t q1 = (q0 + 1 + gen() % (nq - 1)) % nq;
+        k.gate("x", {q0});
+        k.gate("cz", {q0, q1});
+    }
+    prog.add(k);
+    prog.compile();
+
+    // all two-qubit gates must be between neighbors in the topology
+    std::vector<std::pair<size_t, size_t>> edges;
+    for (auto & e : platform.topology["edges"])
+    {
+        edges.push_back({e["src"], e["dst"]});
+    }
+    bool nn = true;
+    for (auto & gp : prog.kernels.front().c)
+    {
+        if (gp->operands.size() == 2)
+        {
+            std::pair<size_t, size_t> e = {gp->operands[0], gp->operands[1]};
+            nn = nn && std::find(edges.begin(), edges.end(), e) != edges.end();
+        }
+    }
+    check("mapper=maxfidelity maps all two-qubit gates to neighbors", nn);
+    prog.set_option("mapper", "no");
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+
+    for (unsigned seed = 1; seed <= 3; seed++)
+    {
+        test_accumulator(platform, 50 * seed, seed);
+    }
+    test_accumulator(platform, 2000, 4);
+    test_parameters();
+    test_mapper();
+
+    return ql_test::result();
+}
@@ -0,0 +1,89 @@
+/*
+    file:       test_optimizer.cc
+    notes:      test of the rotation optimizer (option optimize=yes):
+                sequences of single-qubit gates on a qubit that make up the identity are removed,
+                also when gates on other qubits are interleaved;
+                gates on different qubits never cancel;
+                two-qubit gates, measurements, preparations and waits end the sequences;
+                uses the default gates, which have exact matrices
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+#include <openql.h>
+#include <utils.h>
+#include <optimizer.h>
+#include "test_harness.h"
+
+#define CFG_FILE_JSON   "test_cfg_none_simple.json"
+
+struct gate_t
+{
+    std::string         name;
+    std::vector<size_t> qubits;
+    double              angle;
+};
+
+// the qasm of the kernel with the given gates after rotation optimization
+static std::string optimize(const std::vector<gate_t>& gates)
+{
+    ql::quantum_platform platform("none", CFG_FILE_JSON);
+    ql::quantum_program prog("test_optimizer", platform, 3, 0);
+    ql::quantum_kernel k("k", platform, 3, 0);
+    for (auto & g : gates)
+    {
+        k.gate(g.name, g.qubits, {}, 0, g.angle);
+    }
+    prog.add(k);
+
+    ql::options::set("optimize", "yes");
+    ql::rotation_optimize(&prog, platform, "rotation_optimize");
+    ql::options::set("optimize", "no");
+
+    std::string qasm;
+    for (auto & gp : prog.kernels.front().c)
+    {
+        qasm += (qasm.empty() ? "" : "; ") + gp->qasm();
+    }
+    return qasm;
+}
+
+static void check(const std::string& what, const std::vector<gate_t>& gates, const std::string& expected)
+{
+    std::string result = optimize(gates);
+    bool ok = (result == expected);
+    ql_test::check(what, ok, ": [" + result + "]" + (ok ? "" : ", expected [" + expected + "]"));
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+
+    check("pair", {{"x", {0}}, {"x", {0}}}, "");
+    check("different qubits", {{"x", {0}}, {"x", {1}}}, "x q[0]; x q[1]");
+    check("interleaved", {{"x", {0}}, {"h", {1}}, {"x", {0}}}, "h q[1]");
+    check("nested", {{"h", {0}}, {"x", {0}}, {"x", {0}}, {"h", {0}}}, "");
+    check("inner", {{"h", {0}}, {"y", {0}}, {"y", {0}}}, "h q[0]");
+    check("four quarter turns", {{"rx90", {0}}, {"rx90", {0}}, {"rx90", {0}}, {"rx90", {0}}}, "");
+    check("phase", {{"z", {0}}, {"h", {0}}, {"x", {0}}, {"h", {0}}}, "");
+    check("angles", {{"rx", {0}, 0.3}, {"rx", {0}, -0.3}}, "");
+    check("z is not the identity", {{"s", {0}}, {"s", {0}}}, "s q[0]; s q[0]");
+    check("single identity gate stays", {{"i", {0}}}, "i q[0]");
+    check("two-qubit gate", {{"x", {0}}, {"cnot", {0, 1}}, {"x", {0}}}, "x q[0]; cnot q[0],q[1]; x q[0]");
+    check("two-qubit gate on other qubits", {{"x", {0}}, {"cnot", {1, 2}}, {"x", {0}}}, "cnot q[1],q[2]");
+    check("measurement", {{"x", {0}}, {"measure", {0}}, {"x", {0}}}, "x q[0]; measure q[0]; x q[0]");
+    check("preparation", {{"x", {0}}, {"prepz", {0}}, {"x", {0}}}, "x q[0]; prep_z q[0]; x q[0]");
+
+    // a run longer than the look-back window that only makes up the identity as a whole:
+    // 200 rotations of 2pi/200 make a rotation of 2pi, which is minus the identity
+    std::vector<gate_t> run;
+    for (size_t i = 0; i < 200; i++)
+    {
+        run.push_back({"rx", {0}, 2*M_PI/200});
+    }
+    check("long run", run, "");
+
+    return ql_test::result();
+}
@@ -14,6 +14,11 @@ class Test_options(unittest.TestCase):
         ql.set_option('scheduler_uniform', 'no')
         ql.set_option('use_default_gates', 'yes')
         ql.set_option('decompose_toffoli', 'no')
+        ql.set_option('cancel_prescheduler', 'no')
+        ql.set_option('mapper', 'no')
+        ql.set_option('scheduler_gapfill', 'no')
+        ql.set_option('release_gates', 'no')
+        ql.set_option('unitary_decomposition_cache', 'yes')
 
 
     def test_set_all_options(self):
@@ -43,6 +48,22 @@ class Test_options(unittest.TestCase):
         ql.set_option('decompose_toffoli', 'NC')
         ql.set_option('decompose_toffoli', 'AM')
 
+        ql.set_option('cancel_prescheduler', 'yes')
+        ql.set_option('cancel_prescheduler', 'no')
+
+        ql.set_option('mapper', 'beam')
+        ql.set_option('mapper', 'no')
+
+        ql.set_option('scheduler_gapfill', 'yes')
+        ql.set_option('scheduler_gapfill', 'no')
+
+        ql.set_option('release_gates', 'yes')
+        ql.set_option('release_gates', 'no')
+
+        ql.set_option('unitary_decomposition_cache', 'no')
+        ql.set_option('unitary_decomposition_cache', 'disk')
+        ql.set_option('unitary_decomposition_cache', 'yes')
+
 
     def test_nok(self):
         # supress error printing first as the following will print errors
@@ -61,6 +82,18 @@ class Test_options(unittest.TestCase):
         self.assertEqual(str(cm.exception), 'Error parsing options. The value best is not an allowed value for --scheduler !')
 
 
+        with self.assertRaises(Exception) as cm:
+            ql.set_option('release_gates', 'sometimes')
+
+        self.assertEqual(str(cm.exception), 'Error parsing options. The value sometimes is not an allowed value for --release_gates !')
+
+
+        with self.assertRaises(Exception) as cm:
+            ql.set_option('unitary_decomposition_cache', 'cloud')
+
+        self.assertEqual(str(cm.exception), 'Error parsing options. The value cloud is not an allowed value for --unitary_decomposition_cache !')
+
+
     def test_get_values(self):
         # try to set a legal value and then test if it is indeed set
         ql.set_option('log_level', 'LOG_INFO')
@@ -86,6 +119,21 @@ class Test_options(unittest.TestCase):
         ql.set_option('decompose_toffoli', 'NC')
         self.assertEqual(ql.get_option('decompose_toffoli'), 'NC')
 
+        ql.set_option('cancel_prescheduler', 'yes')
+        self.assertEqual(ql.get_option('cancel_prescheduler'), 'yes')
+
+        ql.set_option('mapper', 'beam')
+        self.assertEqual(ql.get_option('mapper'), 'beam')
+
+        ql.set_option('scheduler_gapfill', 'yes')
+        self.assertEqual(ql.get_option('scheduler_gapfill'), 'yes')
+
+        ql.set_option('release_gates', 'yes')
+        self.assertEqual(ql.get_option('release_gates'), 'yes')
+
+        ql.set_option('unitary_decomposition_cache', 'disk')
+        self.assertEqual(ql.get_option('unitary_decomposition_cache'), 'disk')
+
 
     def test_default_scheduler(self):
         self.tearDown()
@@ -0,0 +1,314 @@
+/*
+    file:       test_parallel.cc
+    notes:      test of compiling the kernels of a program concurrently (option compile_threads):
+                a program of many generated kernels is compiled for the s17 platform with mapping,
+                sequentially and on several threads, and the resulting qasm and qisa files are compared;
+                furthermore ql::utils::parallel_for is checked to do all work once
+                and to rethrow the exception that sequential execution would have thrown;
+                then a value of an option that is rejected is checked to leave the options as they were;
+                then two programs with different options set per program (set_option)
+                are compiled concurrently and their output is compared to that of compiling them one after the other;
+                then a program with options set for it is compiled by compile and by compile_modular,
+                and their output is compared, after which the global options must have been reset;
+                finally a program is mapped with random tie breaking from a fixed seed (option mapseed),
+                evaluating the alternatives sequentially and on several threads (option mapselectthreads),
+                and the results are compared
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include <openql.h>
+#include <utils.h>
+#include <parallel.h>
+
+#define CFG_FILE_JSON   "test_mapper_s17.json"
+
+// generate a circuit of gate_count gates with two-qubit gates between any qubits, so that it must be mapped;
+// only the raw output of the random number generator is used, which is the same on all platforms
+static void generate(ql::quantum_kernel& k, size_t qubit_count, size_t gate_count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    const std::vector<std::string> gates1q = {"x", "y", "x90", "ym90", "h", "z", "s", "t"};
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 16;
+        if (r < 5)
+        {
+            size_t q0 = gen() % qubit_count;
+            size_t q1 = (q0 + 1 + gen() % (qubit_count - 1)) % qubit_count;
+            k.gate((r < 3) ? "cz" : "cnot", {q0, q1});
+        }
+        else if (r < 6)
+        {
+            k.gate("measure", {gen() % qubit_count});
+        }
+        else
+        {
+            k.gate(gates1q[gen() % gates1q.size()], {gen() % qubit_count});
+        }
+    }
+}
+
+// compile the program on the given number of threads into the given output directory
+static void compile(const std::string& threads, const std::string& outdir)
+{
+    ql::options::set("log_level", "LOG_ERROR");
+    ql::options::set("output_dir", outdir);
+    ql::options::set("write_qasm_files", "yes");
+    ql::options::set("compile_threads", threads);
+    ql::options::set("scheduler", "ALAP");
+    ql::options::set("clifford_premapper", "yes");
+    ql::options::set("clifford_postmapper", "yes");
+    ql::options::set("mapper", "minextendrc");
+    ql::options::set("maptiebreak", "first");
+
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+    size_t nq = platform.qubit_number;
+    ql::quantum_program prog("test_parallel", platform, nq, 0);
+    for (unsigned k = 0; k < 16; k++)
+    {
+        ql::quantum_kernel kernel("k" + std::to_string(k), platform, nq, 0);
+        generate(kernel, nq, 20 + 10 * (k % 7), k);
+        prog.add(kernel);
+    }
+    prog.compile();
+}
+
+// check that setting an option to a value that is rejected leaves all options as they were
+static bool check_rejected_set()
+{
+    ql::options::set("mapbeamwidth", "2");
+    bool rejected = false;
+    try
+    {
+        ql::options::set("mapbeamwidth", "0");
+    }
+    catch (const ql::exception&)
+    {
+        rejected = true;
+    }
+    bool ok = rejected && ql::options::get("mapbeamwidth") == "2" && ql::options::current().mapbeamwidth == 2;
+    ql::options::set("mapper", "base");     // throws when the rejected value was kept
+    ok = ok && ql::options::current().mapper == ql::mapper_t::BASE;
+    ql::options::reset_options();
+    return ok;
+}
+
+// compile a program with its own mapper and output directory, leaving the global options untouched
+static void compile_with_options(const std::string& name, unsigned seed, const std::string& mapper, const std::string& outdir)
+{
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+    size_t nq = platform.qubit_number;
+    ql::quantum_program prog(name, platform, nq, 0);
+    prog.set_option("output_dir", outdir);
+    prog.set_option("write_qasm_files", "yes");
+    prog.set_option("mapper", mapper);
+    prog.set_option("maptiebreak", "first");
+    for (unsigned k = 0; k < 4; k++)
+    {
+        ql::quantum_kernel kernel("k" + std::to_string(k), platform, nq, 0);
+        generate(kernel, nq, 40, seed + k);
+        prog.add(kernel);
+    }
+    prog.compile();
+}
+
+// compile a program with its own mapper and output directory by compile or by compile_modular,
+// while the global options have another mapper and output directory
+static void compile_modular_with_options(bool modular, const std::string& outdir)
+{
+    ql::options::set("mapper", "base");
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+    size_t nq = platform.qubit_number;
+    ql::quantum_program prog("test_modular", platform, nq, 0);
+    prog.set_option("output_dir", outdir);
+    prog.set_option("write_qasm_files", "yes");
+    prog.set_option("mapper", "minextendrc");
+    prog.set_option("maptiebreak", "first");
+    for (unsigned k = 0; k < 2; k++)
+    {
+        ql::quantum_kernel kernel("k" + std::to_string(k), platform, nq, 0);
+        generate(kernel, nq, 40, 400 + k);
+        prog.add(kernel);
+    }
+    if (modular)
+    {
+        prog.compile_modular();
+    }
+    else
+    {
+        prog.compile();
+    }
+}
+
+// compile a program, evaluating the mapper's alternatives on the given number of threads
+static void compile_select(const std::string& threads, const std::string& outdir)
+{
+    ql::quantum_platform platform("s17", CFG_FILE_JSON);
+    size_t nq = platform.qubit_number;
+    ql::quantum_program prog("test_select", platform, nq, 0);
+    prog.set_option("output_dir", outdir);
+    prog.set_option("write_qasm_files", "yes");
+    prog.set_option("mapper", "minextendrc");
+    prog.set_option("mapselectmaxlevel", "1");
+    prog.set_option("mapselectmaxwidth", "minplusone");
+    prog.set_option("maptiebreak", "random");
+    prog.set_option("mapseed", "42");
+    prog.set_option("mapselectthreads", threads);
+    for (unsigned k = 0; k < 2; k++)
+    {
+        ql::quantum_kernel kernel("k" + std::to_string(k), platform, nq, 0);
+        generate(kernel, nq, 60, 300 + k);
+        prog.add(kernel);
+    }
+    prog.compile();
+}
+
+static std::string read_file(const std::string& fname)
+{
+    std::ifstream in(fname);
+    std::stringstream content;
+    content << in.rdbuf();
+    return (in ? content.str() : "");
+}
+
+// check that parallel_for does each i once (sequentially only those up to the first that throws),
+// and rethrows the exception of the lowest i
+static bool check_parallel_for(size_t nthreads)
+{
+    std::vector<size_t> done(1000, 0);
+    std::string what;
+    try
+    {
+        ql::utils::parallel_for(done.size(), nthreads, [&](size_t i)
+        {
+            done[i]++;
+            if (i == 123 || i == 456 || i == 789)
+            {
+                throw std::runtime_error(std::to_string(i));
+            }
+        });
+    }
+    catch (const std::runtime_error& e)
+    {
+        what = e.what();
+    }
+    for (size_t i = 0; i < done.size(); i++)
+    {
+        if (done[i] != ((nthreads == 1 && i > 123) ? 0 : 1))
+        {
+            return false;
+        }
+    }
+    return what == "123";
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+
+    for (size_t nthreads : {1, 2, 4, 16})
+    {
+        if (!check_parallel_for(nthreads))
+        {
+            std::cout << "test_parallel: parallel_for on " << nthreads << " threads failed" << std::endl;
+            return 1;
+        }
+    }
+
+    compile("1", "test_output/test_parallel_1");
+    compile("4", "test_output/test_parallel_4");
+    ql::options::reset_options();
+
+    bool same = true;
+    for (std::string suffix : {"_prescheduler_out.qasm", "_clifford_premapper_out.qasm", "_mapper_out.qasm",
+        "_rcscheduler_out.qasm", "_ccl_decompose_post_schedule_out.qasm", ".qisa"})
+    {
+        std::string sequential = read_file("test_output/test_parallel_1/test_parallel" + suffix);
+        std::string parallel = read_file("test_output/test_parallel_4/test_parallel" + suffix);
+        if (sequential.empty() || sequential != parallel)
+        {
+            std::cout << "test_parallel: test_parallel" << suffix << " differs between compile_threads=1 and compile_threads=4" << std::endl;
+            same = false;
+        }
+    }
+    if (!same)
+    {
+        return 1;
+    }
+    std::cout << "test_parallel: output of compile_threads=4 identical to that of compile_threads=1" << std::endl;
+
+    if (!check_rejected_set())
+    {
+        std::cout << "test_parallel: rejected option value not undone" << std::endl;
+        return 1;
+    }
+
+    compile_with_options("test_options_a", 100, "minextendrc", "test_output/test_options_seq");
+    compile_with_options("test_options_b", 200, "base", "test_output/test_options_seq");
+    std::thread other(compile_with_options, "test_options_b", 200, "base", "test_output/test_options_conc");
+    compile_with_options("test_options_a", 100, "minextendrc", "test_output/test_options_conc");
+    other.join();
+
+    for (std::string name : {"test_options_a", "test_options_b"})
+    {
+        for (std::string suffix : {"_mapper_out.qasm", ".qisa"})
+        {
+            std::string sequential = read_file("test_output/test_options_seq/" + name + suffix);
+            std::string concurrent = read_file("test_output/test_options_conc/" + name + suffix);
+            if (sequential.empty() || sequential != concurrent)
+            {
+                std::cout << "test_parallel: " << name << suffix << " differs between sequential and concurrent compilation" << std::endl;
+                same = false;
+            }
+        }
+    }
+    if (!same)
+    {
+        return 1;
+    }
+    std::cout << "test_parallel: output of concurrent compilations identical to that of sequential ones" << std::endl;
+
+    compile_modular_with_options(false, "test_output/test_modular_compile");
+    compile_modular_with_options(true, "test_output/test_modular_modular");
+    for (std::string suffix : {"_mapper_out.qasm", ".qisa"})
+    {
+        std::string compiled = read_file("test_output/test_modular_compile/test_modular" + suffix);
+        std::string modular = read_file("test_output/test_modular_modular/test_modular" + suffix);
+        if (compiled.empty() || compiled != modular)
+        {
+            std::cout << "test_parallel: test_modular" << suffix << " differs between compile and compile_modular" << std::endl;
+            same = false;
+        }
+    }
+    if (!same || ql::options::get("mapper") != "no")
+    {
+        return 1;
+    }
+    std::cout << "test_parallel: options set for a program are used by compile_modular as by compile" << std::endl;
+
+    compile_select("1", "test_output/test_select_1");
+    compile_select("4", "test_output/test_select_4");
+    for (std::string suffix : {"_mapper_out.qasm", ".qisa"})
+    {
+        std::string sequential = read_file("test_output/test_select_1/test_select" + suffix);
+        std::string parallel = read_file("test_output/test_select_4/test_select" + suffix);
+        if (sequential.empty() || sequential != parallel)
+        {
+            std::cout << "test_parallel: test_select" << suffix << " differs between mapselectthreads=1 and mapselectthreads=4" << std::endl;
+            same = false;
+        }
+    }
+    if (!same)
+    {
+        return 1;
+    }
+    std::cout << "test_parallel: output of mapselectthreads=4 identical to that of mapselectthreads=1" << std::endl;
+    return 0;
+}
@@ -0,0 +1,406 @@
+/*
+    file:       test_scheduler.cc
+    notes:      regression test of the schedulers:
+                generated circuits are scheduled ASAP/ALAP, without and with resource constraints,
+                without and with commutation, on the s7 and s17 platforms;
+                the resulting schedules (cycle and qasm of each gate) are written to
+                test_output/test_scheduler.txt and compared to golden/test_scheduler.txt;
+                any change of scheduler implementation should leave these schedules identical;
+                in addition, generated circuits are edited at random (gates deleted, inserted, swapped,
+                modified, and the circuit sorted on cycle), and after each edit the dependence graph
+                as updated by Scheduler::update and the cycle and remaining values as recomputed from it
+                are checked to be identical to those of a dependence graph created from scratch;
+                the resource manager's checkpoint/rollback/commit is checked against copies of it;
+                finally schedules made with resources that fill gaps (option scheduler_gapfill) are checked
+                to respect the dependences and the resources, and their depths are printed;
+                the rcscheduler with that option must keep the shorter of the schedules with and without filling gaps
+*/
+#include <string>
+#include <vector>
+#include <list>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+
+#include <openql.h>
+#include <utils.h>
+#include <scheduler.h>
+
+// generate a circuit of gate_count gates on the platform's qubits;
+// when wide, most gates are one-qubit gates, to have many available gates at each moment;
+// two-qubit gates are only generated between neighbors in the platform's topology
+// so that the circuit can be scheduled with resource constraints without mapping;
+// only the raw output of the random number generator is used, which is the same on all platforms
+static void generate(ql::quantum_kernel& k, const ql::quantum_platform& platform, size_t gate_count, unsigned seed, bool wide)
+{
+    std::mt19937 gen(seed);
+    std::vector<std::pair<size_t,size_t>> edges;
+    for (auto & e : platform.topology["edges"])
+    {
+        edges.push_back(std::make_pair(e["src"], e["dst"]));
+    }
+    const std::vector<std::string> gates1q = {"x", "y", "x90", "ym90", "h", "z", "s", "t", "prepz"};
+    for (size_t i = 0; i < gate_count; i++)
+    {
+        size_t r = gen() % 16;
+        if (r < (wide ? 2 : 6))
+        {
+            auto & e = edges[gen() % edges.size()];
+            k.gate((r % 2) ? "cz" : "cnot", {e.first, e.second});
+        }
+        else if (r < (wide ? 3 : 8))
+        {
+            k.gate("measure", {gen() % platform.qubit_number});
+        }
+        else
+        {
+            k.gate(gates1q[gen() % gates1q.size()], {gen() % platform.qubit_number});
+        }
+    }
+}
+
+// schedule a generated circuit with the given options and write the schedule to out
+static void schedule(std::ostream& out, const std::string& cfg, size_t gate_count, unsigned seed, bool wide,
+    const std::string& schedopt, bool rc, const std::string& commuteopt)
+{
+    ql::options::set("scheduler", schedopt);
+    ql::options::set("scheduler_commute", commuteopt);
+
+    ql::quantum_platform platform(cfg, cfg);
+    size_t nq = platform.qubit_number;
+    ql::quantum_kernel k("k", platform, nq, 0);
+    generate(k, platform, gate_count, seed, wide);
+
+    Scheduler sched;
+    std::string dot;
+    sched.init(k.c, platform, nq, 0);
+    if (rc)
+    {
+        ql::scheduling_direction_t dir = (schedopt == "ASAP" ? ql::forward_scheduling : ql::backward_scheduling);
+        ql::arch::resource_manager_t rm(platform, dir);
+        if (schedopt == "ASAP")
+            sched.schedule_asap(rm, platform, dot);
+        else
+            sched.schedule_alap(rm, platform, dot);
+    }
+    else
+    {
+        if (schedopt == "ASAP")
+            sched.schedule_asap(dot);
+        else
+            sched.schedule_alap(dot);
+    }
+
+    out << "# " << cfg << " gates=" << gate_count << " seed=" << seed << (wide ? " wide" : "")
+        << " scheduler=" << schedopt << (rc ? " rc" : "") << " scheduler_commute=" << commuteopt << std::endl;
+    for (auto gp : k.c)
+    {
+        out << gp->cycle << " " << gp->qasm() << std::endl;
+    }
+}
+
+// edit a generated circuit at random and check after each edit that the updated dependence graph
+// and the values recomputed from it are those of a dependence graph created from scratch
+static bool check_update(const std::string& cfg, unsigned seed, const std::string& commuteopt)
+{
+    ql::options::set("scheduler_commute", commuteopt);
+
+    ql::quantum_platform platform(cfg, cfg);
+    size_t nq = platform.qubit_number;
+    ql::quantum_kernel k("k", platform, nq, 0);
+    generate(k, platform, 200, seed, false);
+
+    std::mt19937 gen(seed);
+    std::list<ql::quantum_kernel> inserted;     // keeps the inserted gates' kernels alive while k refers to them
+    Scheduler updated;
+    updated.init(k.c, platform, nq, 0);
+    for (size_t round = 0; round < 100; round++)
+    {
+        ql::scheduling_direction_t dir = (round < 50 ? ql::forward_scheduling : ql::backward_scheduling);
+        size_t i = gen() % k.c.size();
+        switch (gen() % 6)
+        {
+        case 0:
+            k.c.erase(k.c.begin() + i);
+            break;
+        case 1:
+        {
+            inserted.emplace_back("ins", platform, nq, 0);
+            ql::quantum_kernel & ins = inserted.back();
+            generate(ins, platform, 1 + gen() % 3, gen(), false);
+            k.c.insert(k.c.begin() + i, ins.c.begin(), ins.c.end());
+            break;
+        }
+        case 2:
+            std::swap(k.c[i], k.c[(i + 1) % k.c.size()]);
+            break;
+        case 3:
+            k.c[i]->duration += platform.cycle_time;
+            break;
+        case 4:
+            if (k.c[i]->operands.size() == 1)
+            {
+                k.c[i]->operands[0] = gen() % nq;
+            }
+            break;
+        case 5:
+            updated.sort_by_cycle(&k.c);
+            break;
+        }
+
+        updated.update(k.c, platform, nq, 0);
+        updated.set_cycle(dir);
+        updated.set_remaining(dir);
+        std::vector<size_t> cycles;
+        for (auto gp : k.c)
+        {
+            cycles.push_back(gp->cycle);
+        }
+
+        Scheduler fresh;
+        fresh.init(k.c, platform, nq, 0);
+        fresh.set_cycle(dir);
+        fresh.set_remaining(dir);
+        bool same_cycles = true;
+        for (size_t j = 0; j < k.c.size(); j++)
+        {
+            same_cycles = same_cycles && cycles[j] == k.c[j]->cycle;
+        }
+
+        // all but SOURCE and SINK, which are created by each init
+        if (updated.instruction.size() != fresh.instruction.size()
+            || !std::equal(fresh.instruction.begin()+1, fresh.instruction.end()-1, updated.instruction.begin()+1)
+            || updated.source != fresh.source
+            || updated.target != fresh.target
+            || updated.weight != fresh.weight
+            || updated.cause != fresh.cause
+            || updated.depType != fresh.depType
+            || updated.in_arcs != fresh.in_arcs
+            || updated.out_arcs != fresh.out_arcs
+            || !same_cycles
+            || updated.remaining != fresh.remaining
+            || updated.critdep != fresh.critdep
+            || updated.critcount != fresh.critcount
+           )
+        {
+            std::cout << "test_scheduler: updated dependence graph differs from created one: "
+                << cfg << " seed=" << seed << " scheduler_commute=" << commuteopt << " round=" << round << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// reserve gates of a generated circuit at random cycles in a resource manager after (nested) checkpoints,
+// and check that after rollback and commit it answers availability of all gates in the cycles used
+// as a copy does in which only the committed gates were reserved
+static bool check_rollback(const std::string& cfg, unsigned seed, bool gapfill)
+{
+    ql::quantum_platform platform(cfg, cfg);
+    size_t nq = platform.qubit_number;
+    ql::quantum_kernel k("k", platform, nq, 0);
+    generate(k, platform, 200, seed, false);
+
+    std::mt19937 gen(seed);
+    for (ql::scheduling_direction_t dir : {ql::forward_scheduling, ql::backward_scheduling})
+    {
+        ql::arch::resource_manager_t rm(platform, dir, gapfill);
+        ql::arch::resource_manager_t ref(platform, dir, gapfill);
+        for (size_t round = 0; round < 40; round++)
+        {
+            rm.checkpoint();
+            std::vector<std::pair<ql::gate*,size_t>> committed;
+            for (size_t i = 0; i < 10; i++)
+            {
+                ql::gate* gp = k.c[gen() % k.c.size()];
+                size_t cycle = gen() % 100;
+                rm.reserve(cycle, gp, platform);
+                committed.push_back(std::make_pair(gp, cycle));
+            }
+            rm.checkpoint();
+            for (size_t i = 0; i < 10; i++)
+            {
+                rm.reserve(gen() % 100, k.c[gen() % k.c.size()], platform);
+            }
+            rm.rollback();
+            if (round % 2 == 0)
+            {
+                rm.rollback();
+                committed.clear();
+            }
+            else
+            {
+                rm.commit();
+            }
+            for (auto & r : committed)
+            {
+                ref.reserve(r.second, r.first, platform);
+            }
+
+            for (auto gp : k.c)
+            {
+                for (size_t cycle = 0; cycle < 110; cycle++)
+                {
+                    if (rm.available(cycle, gp, platform) != ref.available(cycle, gp, platform))
+                    {
+                        std::cout << "test_scheduler: " << cfg << (gapfill ? " gapfill" : "") << " resources differ after " << (round % 2 == 0 ? "rollback" : "commit")
+                            << " in round " << round << " for " << gp->qasm() << " at cycle " << cycle << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// schedule a generated circuit with resource constraints, with and without filling gaps,
+// check that the schedule that fills gaps respects the dependences of the gates on each qubit in circuit order
+// and that its gates can be reserved in a resource manager in circuit order, and print both depths
+static bool check_gapfill(const std::string& cfg, size_t gate_count, unsigned seed, bool wide, const std::string& schedopt)
+{
+    ql::options::set("scheduler_commute", "no");
+
+    ql::quantum_platform platform(cfg, cfg);
+    size_t nq = platform.qubit_number;
+    ql::quantum_kernel k("k", platform, nq, 0);
+    generate(k, platform, gate_count, seed, wide);
+    std::vector<ql::gate*> gates(k.c.begin(), k.c.end());
+
+    ql::scheduling_direction_t dir = (schedopt == "ASAP" ? ql::forward_scheduling : ql::backward_scheduling);
+    Scheduler sched;
+    std::string dot;
+    sched.init(k.c, platform, nq, 0);
+    size_t depths[2];
+    for (bool gapfill : {false, true})
+    {
+        ql::arch::resource_manager_t rm(platform, dir, gapfill);
+        if (schedopt == "ASAP")
+            sched.schedule_asap(rm, platform, dot);
+        else
+            sched.schedule_alap(rm, platform, dot);
+        depths[gapfill] = sched.depth();
+    }
+
+    std::vector<size_t> qubit_free(nq, 0);
+    ql::arch::resource_manager_t replay(platform, dir, true);
+    for (auto gp : gates)
+    {
+        size_t duration = (gp->duration + platform.cycle_time - 1) / platform.cycle_time;
+        for (auto q : gp->operands)
+        {
+            if (gp->cycle < qubit_free[q])
+            {
+                std::cout << "test_scheduler: " << cfg << " gapfill " << schedopt << ": " << gp->qasm() << " at cycle " << gp->cycle
+                    << " starts before the previous gate on q" << q << " has completed" << std::endl;
+                return false;
+            }
+            qubit_free[q] = gp->cycle + duration;
+        }
+        if (!replay.available(gp->cycle, gp, platform))
+        {
+            std::cout << "test_scheduler: " << cfg << " gapfill " << schedopt << ": resources of " << gp->qasm()
+                << " at cycle " << gp->cycle << " are not available" << std::endl;
+            return false;
+        }
+        replay.reserve(gp->cycle, gp, platform);
+    }
+
+    // the rcscheduler with option scheduler_gapfill keeps the shorter of both schedules
+    std::string prev_schedopt = ql::options::get("scheduler");
+    ql::options::set("scheduler", schedopt);
+    ql::options::set("scheduler_gapfill", "yes");
+    ql::quantum_kernel kept("kept", platform, nq, 0);
+    generate(kept, platform, gate_count, seed, wide);
+    size_t without = 0;
+    size_t with = 0;
+    ql::rcschedule_kernel(kept, platform, dot, nq, 0, &without, &with);
+    ql::options::set("scheduler_gapfill", "no");
+    ql::options::set("scheduler", prev_schedopt);
+    if (without != depths[0] || with != depths[1] || kept.ddg.graph->depth() != std::min(depths[0], depths[1]))
+    {
+        std::cout << "test_scheduler: " << cfg << " gapfill " << schedopt << ": rcscheduler kept depth " << kept.ddg.graph->depth()
+            << " instead of the shorter of " << depths[0] << " and " << depths[1] << std::endl;
+        return false;
+    }
+
+    std::cout << "test_scheduler: " << cfg << " gates=" << gate_count << (wide ? " wide" : "") << " scheduler=" << schedopt
+        << " rc depth: " << depths[0] << ", with gapfill: " << depths[1] << std::endl;
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    ql::utils::logger::set_log_level("LOG_ERROR");
+
+    bool updates_ok = true;
+    for (std::string cfg : {"test_mapper_s7.json", "test_mapper_s17.json"})
+    {
+        for (std::string commuteopt : {"no", "yes"})
+        {
+            updates_ok = check_update(cfg, 11, commuteopt) && updates_ok;
+        }
+    }
+    if (!updates_ok)
+    {
+        return 1;
+    }
+
+    for (std::string cfg : {"test_mapper_s7.json", "test_mapper_s17.json"})
+    {
+        for (bool gapfill : {false, true})
+        {
+            if (!check_rollback(cfg, 13, gapfill))
+            {
+                return 1;
+            }
+        }
+    }
+
+    for (std::string cfg : {"test_mapper_s7.json", "test_mapper_s17.json"})
+    {
+        for (bool wide : {false, true})
+        {
+            for (std::string schedopt : {"ASAP", "ALAP"})
+            {
+                if (!check_gapfill(cfg, 300, 17, wide, schedopt))
+                {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    std::stringstream out;
+    for (std::string cfg : {"test_mapper_s7.json", "test_mapper_s17.json"})
+    {
+        for (bool wide : {false, true})
+        {
+            for (std::string schedopt : {"ASAP", "ALAP"})
+            {
+                for (bool rc : {false, true})
+                {
+                    for (std::string commuteopt : {"no", "yes"})
+                    {
+                        schedule(out, cfg, 100, 7, wide, schedopt, rc, commuteopt);
+                    }
+                }
+            }
+        }
+    }
+
+    ql::utils::write_file("test_output/test_scheduler.txt", out.str());
+
+    std::ifstream golden("golden/test_scheduler.txt");
+    std::stringstream expected;
+    expected << golden.rdbuf();
+    if (!golden || expected.str() != out.str())
+    {
+        std::cout << "test_scheduler: schedules differ from golden/test_scheduler.txt, see test_output/test_scheduler.txt" << std::endl;
+        return 1;
+    }
+    std::cout << "test_scheduler: schedules identical to golden/test_scheduler.txt" << std::endl;
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+    file:       test_unitary_cache.cc
+    notes:      test of the cache of unitary decompositions (option unitary_decomposition_cache):
+                a matrix that equals an earlier decomposed one up to a global phase and rounding
+                reuses its decomposition, in memory and, with unitary_decomposition_cache=disk,
+                through a file in output_dir; other matrices are decomposed anew,
+                and matrices that are not unitary are never cached;
+                skipped when unitary decomposition was disabled in the build
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <complex>
+#include <random>
+#include <chrono>
+#include <cstdio>
+
+#include <openql.h>
+#include <utils.h>
+#include <unitary.h>
+#include "test_harness.h"
+
+typedef std::vector<std::complex<double>> matrix_t;
+
+using ql_test::check;
+
+// a random unitary of dim x dim, in row-major order, by Gram-Schmidt orthonormalization of a random matrix
+static matrix_t random_unitary(size_t dim, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<matrix_t> rows;
+    for (size_t r = 0; r < dim; r++)
+    {
+        matrix_t v(dim);
+        for (auto & e : v)
+        {
+            e = std::complex<double>(dist(gen), dist(gen));
+        }
+        for (auto & u : rows)
+        {
+            std::complex<double> p = 0;
+            for (size_t i = 0; i < dim; i++)
+            {
+                p += std::conj(u[i]) * v[i];
+            }
+            for (size_t i = 0; i < dim; i++)
+            {
+                v[i] -= p * u[i];
+            }
+        }
+        double norm = 0;
+        for (auto & e : v)
+        {
+            norm += std::norm(e);
+        }
+        for (auto & e : v)
+        {
+            e /= std::sqrt(norm);
+        }
+        rows.push_back(v);
+    }
+    matrix_t m;
+    for (auto & v : rows)
+    {
+        m.insert(m.end(), v.begin(), v.end());
+    }
+    return m;
+}
+
+static matrix_t scaled(const matrix_t& m, std::complex<double> factor)
+{
+    matrix_t r = m;
+    for (auto & e : r)
+    {
+        e *= factor;
+    }
+    return r;
+}
+
+static std::vector<double> decompose(const matrix_t& m)
+{
+    ql::unitary u("u", m);
+    u.decompose();
+    return u.instructionlist;
+}
+
+typedef std::chrono::steady_clock test_clock;
+
+static double msecs(test_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(test_clock::now() - t0).count();
+}
+
+int main(int argc, char ** argv)
+{
+    if (!ql::unitary::is_decompose_support_enabled())
+    {
+        std::cout << "unitary decomposition support was disabled during OpenQL build, skipped" << std::endl;
+        return 0;
+    }
+    ql::utils::logger::set_log_level("LOG_ERROR");
+    ql::options::set("output_dir", "test_output");
+
+    matrix_t m = random_unitary(8, 11);
+    matrix_t phased = scaled(m, std::polar(1.0, 0.3));
+    matrix_t perturbed = m;
+    perturbed[0] += 1e-6;
+
+    // without cache
+    ql::options::set("unitary_decomposition_cache", "no");
+    test_clock::time_point t0 = test_clock::now();
+    std::vector<double> reference = decompose(m);
+    double t_decompose = msecs(t0);
+    check("decomposition is deterministic", decompose(m) == reference);
+    check("phased matrix has a decomposition of its own", decompose(phased) != reference);
+
+    // in memory
+    ql::options::set("unitary_decomposition_cache", "yes");
+    ql::unitary::clear_decomposition_cache();
+    check("first decomposition is not changed by the cache", decompose(m) == reference);
+    t0 = test_clock::now();
+    check("same matrix reuses the decomposition", decompose(m) == reference);
+    double t_cached = msecs(t0);
+    check("matrix equal up to a global phase reuses the decomposition", decompose(phased) == reference);
+    check("different matrix is decomposed anew", decompose(perturbed) != reference);
+    ql::unitary::clear_decomposition_cache();
+    check("cleared cache decomposes anew", decompose(phased) != reference);
+
+    // matrices that are not unitary are not decomposed, and so not cached
+    ql::unitary::clear_decomposition_cache();
+    for (size_t n = 0; n < 2; n++)
+    {
+        bool thrown = false;
+        try
+        {
+            decompose(scaled(m, 2.0));
+        }
+        catch (const std::exception &)
+        {
+            thrown = true;
+        }
+        check("non-unitary matrix is refused, attempt " + std::to_string(n), thrown);
+    }
+
+    // on disk
+    std::string fname = "test_output/unitary_decomposition_cache.txt";
+    std::remove(fname.c_str());
+    ql::options::set("unitary_decomposition_cache", "disk");
+    ql::unitary::clear_decomposition_cache();
+    check("first decomposition on disk is not changed by the cache", decompose(m) == reference);
+    ql::unitary::clear_decomposition_cache();
+    check("decomposition is read back from disk bit-identically", decompose(phased) == reference);
+    ql::unitary::clear_decomposition_cache();
+    ql::options::set("unitary_decomposition_cache", "yes");
+    check("disk is not read in memory mode", decompose(phased) != reference);
+    ql::options::set("unitary_decomposition_cache", "no");
+    std::remove(fname.c_str());
+
+    std::cout << "decompose 3 qubits: " << t_decompose << "ms, from cache: " << t_cached << "ms" << std::endl;
+    return ql_test::result();
+}